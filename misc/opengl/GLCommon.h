@@ -44,6 +44,7 @@ typedef hc_uintptr GLpointer;
 #define GL_ONE_MINUS_SRC_ALPHA   0x0303
 
 #define GL_UNSIGNED_BYTE         0x1401
+#define GL_SHORT                 0x1402
 #define GL_UNSIGNED_SHORT        0x1403
 #define GL_UNSIGNED_INT          0x1405
 #define GL_FLOAT                 0x1406
@@ -80,6 +81,7 @@ typedef hc_uintptr GLpointer;
 #define GL_RENDERER              0x1F01
 #define GL_VERSION               0x1F02
 #define GL_EXTENSIONS            0x1F03
+#define GL_MAJOR_VERSION         0x821B
 
 #define GL_TEXTURE_2D            0x0DE1
 #define GL_NEAREST               0x2600
@@ -95,6 +97,7 @@ typedef hc_uintptr GLpointer;
 #define GL_ARRAY_BUFFER          0x8892
 #define GL_ELEMENT_ARRAY_BUFFER  0x8893
 #define GL_STATIC_DRAW           0x88E4
+#define GL_STREAM_DRAW           0x88E0
 #define GL_DYNAMIC_DRAW          0x88E8
 
 #define GL_FRAGMENT_SHADER       0x8B30
@@ -653,13 +653,12 @@ static void Png_EncodeRow(const hc_uint8* cur, const hc_uint8* prior, hc_uint8*
 
 static BitmapCol* DefaultGetRow(struct Bitmap* bmp, int y, void* ctx) { return Bitmap_GetRow(bmp, y); }
 static hc_result Png_EncodeCore(struct Bitmap* bmp, struct Stream* stream, hc_uint8* buffer,
-					Png_RowGetter getRow, hc_bool alpha, void* ctx) {
+					struct ZLibState* zlState, Png_RowGetter getRow, hc_bool alpha, void* ctx) {
 	hc_uint8 tmp[32];
 	hc_uint8* prevLine = buffer;
 	hc_uint8*  curLine = buffer + (bmp->width * 4) * 1;
 	hc_uint8* bestLine = buffer + (bmp->width * 4) * 2;
 
-	struct ZLibState zlState;
 	struct Stream chunk, zlStream;
 	hc_uint32 stream_end, stream_beg;
 	int y, lineSize;
@@ -692,7 +691,8 @@ static hc_result Png_EncodeCore(struct Bitmap* bmp, struct Stream* stream, hc_ui
 	Stream_SetU32_BE(&tmp[0], PNG_FourCC('I','D','A','T'));
 	if ((res = Stream_Write(&chunk, tmp, 4))) return res;
 
-	ZLib_MakeStream(&zlStream, &zlState, &chunk); 
+	ZLib_MakeStream(&zlStream, zlState, &chunk); 
+	Deflate_SetLevel(&zlState->Base, DEFLATE_LEVEL_DEFAULT);
 	lineSize = bmp->width * (alpha ? 4 : 3);
 	Mem_Set(prevLine, 0, lineSize);
 
@@ -727,12 +727,20 @@ static hc_result Png_EncodeCore(struct Bitmap* bmp, struct Stream* stream, hc_ui
 
 hc_result Png_Encode(struct Bitmap* bmp, struct Stream* stream, 
 					Png_RowGetter getRow, hc_bool alpha, void* ctx) {
+	struct ZLibState* zlState;
+	hc_uint8* buffer;
 	hc_result res;
+
 	/* Add 1 for scanline filter type byter */
-	hc_uint8* buffer = (hc_uint8*)Mem_TryAlloc(3, bmp->width * 4 + 1);
+	buffer = (hc_uint8*)Mem_TryAlloc(3, bmp->width * 4 + 1);
 	if (!buffer) return ERR_NOT_SUPPORTED;
 
-	res = Png_EncodeCore(bmp, stream, buffer, getRow, alpha, ctx);
+	/* Compressor state is too large to safely put on the stack */
+	zlState = (struct ZLibState*)Mem_TryAlloc(1, sizeof(struct ZLibState));
+	if (!zlState) { Mem_Free(buffer); return ERR_OUT_OF_MEMORY; }
+
+	res = Png_EncodeCore(bmp, stream, buffer, zlState, getRow, alpha, ctx);
+	Mem_Free(zlState);
 	Mem_Free(buffer);
 	return res;
 }
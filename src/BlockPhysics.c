@@ -14,75 +14,65 @@
 #include "Vectors.h"
 #include "Chat.h"
 
-/* Data for a resizable queue, used for liquid physic tick entries. */
-struct TickQueue {
-	hc_uint32* entries; /* Buffer holding the items in the tick queue */
+/* Liquid physics tick entries are stored in a wheel of buckets, one for each of the next ticks. */
+/* Entries are only indices into the map, so support maps of any volume, */
+/*  and entries waiting for their tick do not have to be requeued every tick. */
+#define TICK_WHEEL_SIZE 32 /* Must be a power of two and more than longest delay + 1 */
+#define TICK_WHEEL_MASK (TICK_WHEEL_SIZE - 1)
+
+/* Data for a resizable list, used for liquid physic tick entries that are due on the same tick. */
+struct TickBucket {
+	hc_uint32* entries; /* Buffer holding the indices of the blocks to tick */
 	int capacity; /* Max number of elements in the buffer */
-	int mask;     /* capacity - 1, as capacity is always a power of two */
 	int count;    /* Number of used elements */
-	int head;     /* Head index into the buffer */
-	int tail;     /* Tail index into the buffer */
+};
+
+struct TickQueue {
+	struct TickBucket buckets[TICK_WHEEL_SIZE];
+	int tick; /* Index of the next tick to run */
 };
 
 static void TickQueue_Init(struct TickQueue* queue) {
-	queue->entries  = NULL;
-	queue->capacity = 0;
-	queue->mask  = 0;
-	queue->count = 0;
-	queue->head  = 0;
-	queue->tail  = 0;
+	Mem_Set(queue, 0, sizeof(struct TickQueue));
 }
 
 static void TickQueue_Clear(struct TickQueue* queue) {
-	if (!queue->entries) return;
-	Mem_Free(queue->entries);
+	int i;
+	for (i = 0; i < TICK_WHEEL_SIZE; i++) {
+		Mem_Free(queue->buckets[i].entries);
+	}
 	TickQueue_Init(queue);
 }
 
-static void TickQueue_Resize(struct TickQueue* queue) {
-	hc_uint32* entries;
-	int i, idx, capacity;
+static void TickBucket_Resize(struct TickBucket* bucket) {
+	int capacity;
 
-	if (queue->capacity >= (Int32_MaxValue / 4)) {
+	if (bucket->capacity >= (Int32_MaxValue / 4)) {
 		Chat_AddRaw("&cToo many physics entries, clearing");
-		TickQueue_Clear(queue);
+		bucket->count = 0;
+		return;
 	}
 
-	capacity = queue->capacity * 2;
+	capacity = bucket->capacity * 2;
 	if (capacity < 32) capacity = 32;
-	entries = (hc_uint32*)Mem_Alloc(capacity, 4, "physics tick queue");
-
-	/* Elements must be readjusted to avoid index wrapping issues */
-	/* https://stackoverflow.com/questions/55343683/resizing-of-the-circular-queue-using-dynamic-array */
-	for (i = 0; i < queue->count; i++) {
-		idx = (queue->head + i) & queue->mask;
-		entries[i] = queue->entries[idx];
-	}
-	Mem_Free(queue->entries);
 
-	queue->entries  = entries;
-	queue->capacity = capacity;
-	queue->mask     = capacity - 1; /* capacity is power of two */
-	queue->head = 0;
-	queue->tail = queue->count;
+	bucket->entries  = (hc_uint32*)Mem_Realloc(bucket->entries, capacity, 4, "physics tick queue");
+	bucket->capacity = capacity;
 }
 
-/* Appends an entry to the end of the queue, resizing if necessary. */
-static void TickQueue_Enqueue(struct TickQueue* queue, hc_uint32 item) {
-	if (queue->count == queue->capacity)
-		TickQueue_Resize(queue);
+/* Appends an entry to be ticked after the given number of ticks, resizing if necessary. */
+static void TickQueue_Enqueue(struct TickQueue* queue, int index, int delay) {
+	struct TickBucket* bucket = &queue->buckets[(queue->tick + delay) & TICK_WHEEL_MASK];
+	if (bucket->count == bucket->capacity)
+		TickBucket_Resize(bucket);
 
-	queue->entries[queue->tail] = item;
-	queue->tail = (queue->tail + 1) & queue->mask;
-	queue->count++;
+	bucket->entries[bucket->count++] = index;
 }
 
-/* Retrieves the entry from the front of the queue. */
-static hc_uint32 TickQueue_Dequeue(struct TickQueue* queue) {
-	hc_uint32 result = queue->entries[queue->head];
-	queue->head = (queue->head + 1) & queue->mask;
-	queue->count--;
-	return result;
+/* Retrieves the entries to tick now, then moves on to the next tick. */
+/* NOTE: The returned bucket must be reset once its entries have been ticked. */
+static struct TickBucket* TickQueue_Advance(struct TickQueue* queue) {
+	return &queue->buckets[queue->tick++ & TICK_WHEEL_MASK];
 }
 
 
@@ -92,14 +82,86 @@ static int physics_tickCount;
 static int physics_maxWaterX, physics_maxWaterY, physics_maxWaterZ;
 static struct TickQueue lavaQ, waterQ;
 
-#define PHYSICS_DELAY_MASK 0xF8000000UL
-#define PHYSICS_POS_MASK   0x07FFFFFFUL
-#define PHYSICS_DELAY_SHIFT 27
-#define PHYSICS_ONE_DELAY   (1U << PHYSICS_DELAY_SHIFT)
-#define PHYSICS_LAVA_DELAY (30U << PHYSICS_DELAY_SHIFT)
-#define PHYSICS_WATER_DELAY (5U << PHYSICS_DELAY_SHIFT)
+#define PHYSICS_ONE_DELAY   1
+#define PHYSICS_LAVA_DELAY  30
+#define PHYSICS_WATER_DELAY 5
+#define PHYSICS_RANDOM_TICKS 3 /* Number of random blocks ticked in each chunk every tick */
+
+/* Number of blocks with a random tick handler in each chunk of the map, */
+/*  so that random ticking can skip over chunks where nothing would react to it */
+/* NOTE: Only calculated once physics is ticked, as that's not the case in multiplayer */
+static hc_uint16* tickableCounts;
+/* Number of blocks in each chunk of the map that might be sponges, */
+/*  so that water spreading can skip checking for nearby sponges in most chunks */
+static hc_uint16* spongeCounts;
+static int physics_chunksX, physics_chunksZ;
+
+#define Physics_ChunkIndex(cx, cy, cz) (((cy) * physics_chunksZ + (cz)) * physics_chunksX + (cx))
+
+static void Physics_FreeChunkCounts(void) {
+	Mem_Free(tickableCounts);
+	tickableCounts = NULL;
+	spongeCounts   = NULL;
+}
+
+static void Physics_CountChunkBlocks(void) {
+	hc_uint8 tickable[256];
+	hc_uint16* tickCounts;
+	hc_uint16* spCounts;
+	int i, x, y, z, cx, index = 0, chunksY, numChunks;
+	BlockRaw block;
+
+	physics_chunksX = (World.Width  + CHUNK_MAX) >> CHUNK_SHIFT;
+	chunksY         = (World.Height + CHUNK_MAX) >> CHUNK_SHIFT;
+	physics_chunksZ = (World.Length + CHUNK_MAX) >> CHUNK_SHIFT;
+	numChunks = physics_chunksX * chunksY * physics_chunksZ;
+
+	tickableCounts = (hc_uint16*)Mem_AllocCleared(numChunks * 2, 2, "physics chunk counts");
+	spongeCounts   = tickableCounts + numChunks;
+
+	for (i = 0; i < 256; i++) {
+		tickable[i] = Physics.OnRandomTick[i] != NULL;
+	}
+
+	for (y = 0; y < World.Height; y++) {
+		for (z = 0; z < World.Length; z++) {
+			i = Physics_ChunkIndex(0, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
+			tickCounts = &tickableCounts[i];
+			spCounts   = &spongeCounts[i];
+
+			for (x = 0; x < World.Width; x++, index++) {
+				block = World.Blocks[index];
+				cx    = x >> CHUNK_SHIFT;
+
+				tickCounts[cx] += tickable[block];
+				spCounts[cx]   += block == BLOCK_SPONGE;
+			}
+		}
+	}
+}
+
+void Physics_OnBlockUpdated(int x, int y, int z, BlockID old, BlockID now) {
+	int i;
+	if (!tickableCounts) return;
+	i = Physics_ChunkIndex(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
+
+	/* Only the lower 8 bits of block IDs are checked, same as random ticks */
+	if (Physics.OnRandomTick[(BlockRaw)old]) tickableCounts[i]--;
+	if (Physics.OnRandomTick[(BlockRaw)now]) tickableCounts[i]++;
+
+	if ((BlockRaw)old == BLOCK_SPONGE) spongeCounts[i]--;
+	if ((BlockRaw)now == BLOCK_SPONGE) spongeCounts[i]++;
+}
+
+static void LiquidTick_FreeRegions(void);
+static void Physics_OnNewMap(void* obj) {
+	Physics_FreeChunkCounts();
+	LiquidTick_FreeRegions();
+}
 
 static void Physics_OnNewMapLoaded(void* obj) {
+	Physics_FreeChunkCounts();
+	LiquidTick_FreeRegions();
 	TickQueue_Clear(&lavaQ);
 	TickQueue_Clear(&waterQ);
 
@@ -163,36 +225,31 @@ void Physics_OnBlockChanged(int x, int y, int z, BlockID old, BlockID now) {
 }
 
 static void Physics_TickRandomBlocks(void) {
-	int lo, hi, index;
+	int i, index;
 	BlockID block;
 	PhysicsHandler tick;
-	int x, y, z, x2, y2, z2;
+	int x, y, z, width, height, length;
+	hc_uint16* counts;
+
+	counts = tickableCounts;
 
 	for (y = 0; y < World.Height; y += CHUNK_SIZE) {
-		y2 = min(y + CHUNK_MAX, World.MaxY);
+		height = min(CHUNK_SIZE, World.Height - y);
 		for (z = 0; z < World.Length; z += CHUNK_SIZE) {
-			z2 = min(z + CHUNK_MAX, World.MaxZ);
-			for (x = 0; x < World.Width; x += CHUNK_SIZE) {
-				x2 = min(x + CHUNK_MAX, World.MaxX);
-
-				/* Inlined 3 random ticks for this chunk */
-				lo = World_Pack( x,  y,  z);
-				hi = World_Pack(x2, y2, z2);
-				
-				index = Random_Range(&physics_rnd, lo, hi);
-				block = World.Blocks[index];
-				tick = Physics.OnRandomTick[block];
-				if (tick) tick(index, block);
-
-				index = Random_Range(&physics_rnd, lo, hi);
-				block = World.Blocks[index];
-				tick = Physics.OnRandomTick[block];
-				if (tick) tick(index, block);
-
-				index = Random_Range(&physics_rnd, lo, hi);
-				block = World.Blocks[index];
-				tick = Physics.OnRandomTick[block];
-				if (tick) tick(index, block);
+			length = min(CHUNK_SIZE, World.Length - z);
+			for (x = 0; x < World.Width; x += CHUNK_SIZE, counts++) {
+				/* No block in this chunk would react to a random tick */
+				if (!(*counts)) continue;
+				width = min(CHUNK_SIZE, World.Width - x);
+
+				for (i = 0; i < PHYSICS_RANDOM_TICKS; i++) {
+					index = World_Pack(x + Random_Next(&physics_rnd, width),
+									   y + Random_Next(&physics_rnd, height),
+									   z + Random_Next(&physics_rnd, length));
+					block = World.Blocks[index];
+					tick  = Physics.OnRandomTick[block];
+					if (tick) tick(index, block);
+				}
 			}
 		}
 	}
@@ -224,19 +281,6 @@ static void Physics_DoFalling(int index, BlockID block) {
 	Physics_ActivateNeighbours(x, y, z, start);
 }
 
-static hc_bool Physics_CheckItem(struct TickQueue* queue, int* posIndex) {
-	hc_uint32 item = TickQueue_Dequeue(queue);
-	*posIndex     = (int)(item & PHYSICS_POS_MASK);
-
-	if (item >= PHYSICS_ONE_DELAY) {
-		item -= PHYSICS_ONE_DELAY;
-		TickQueue_Enqueue(queue, item);
-		return false;
-	}
-	return true;
-}
-
-
 static void Physics_HandleSapling(int index, BlockID block) {
 	IVec3 coords[TREE_MAX_COUNT];
 	BlockRaw blocks[TREE_MAX_COUNT];
@@ -321,8 +365,343 @@ static void Physics_HandleMushroom(int index, BlockID block) {
 }
 
 
+static hc_bool Physics_MaybeSpongesIn(int minX, int minY, int minZ, int maxX, int maxY, int maxZ) {
+	int cx, cy, cz;
+	if (!spongeCounts) return true;
+
+	for (cy = minY >> CHUNK_SHIFT; cy <= (maxY >> CHUNK_SHIFT); cy++) {
+		for (cz = minZ >> CHUNK_SHIFT; cz <= (maxZ >> CHUNK_SHIFT); cz++) {
+			for (cx = minX >> CHUNK_SHIFT; cx <= (maxX >> CHUNK_SHIFT); cx++) {
+				if (spongeCounts[Physics_ChunkIndex(cx, cy, cz)]) return true;
+			}
+		}
+	}
+	return false;
+}
+
+/* Whether there is a sponge within 2 blocks of the given coordinates, which stops water spreading there */
+static hc_bool Physics_IsNearSponge(int x, int y, int z) {
+	int minX = x < 2 ? 0 : x - 2, maxX = x > physics_maxWaterX ? World.MaxX : x + 2;
+	int minY = y < 2 ? 0 : y - 2, maxY = y > physics_maxWaterY ? World.MaxY : y + 2;
+	int minZ = z < 2 ? 0 : z - 2, maxZ = z > physics_maxWaterZ ? World.MaxZ : z + 2;
+	int xx, yy, zz;
+	if (!Physics_MaybeSpongesIn(minX, minY, minZ, maxX, maxY, maxZ)) return false;
+
+	for (yy = minY; yy <= maxY; yy++) {
+		for (zz = minZ; zz <= maxZ; zz++) {
+			for (xx = minX; xx <= maxX; xx++) {
+				if (World_GetBlock(xx, yy, zz) == BLOCK_SPONGE) return true;
+			}
+		}
+	}
+	return false;
+}
+
+
+/* Large liquid ticks are split up by the 16x16 column of chunks each ticked block is in. */
+/* The blocks each column spreads into are worked out across multiple threads, using the map */
+/*  as it was at the start of the tick, then applied in column order on the main thread. */
+/* A change is only applied if that block can still be spread into, so when two liquid blocks */
+/*  (e.g. either side of a column border) spread into the same block, the first one wins. */
+#define LIQUID_PARALLEL_MIN 4096 /* Smaller ticks are just processed directly */
+#define LIQUID_MAX_THREADS  32
+#define LIQUID_APPLY_BATCH  1024
+#define LIQUID_RECENT_SIZE  4096 /* Must be a power of two */
+
+struct LiquidChange { hc_uint32 index; BlockRaw block; };
+
+struct LiquidRegion {
+	struct LiquidChange* changes; /* Blocks that ticked blocks in this column spread into */
+	int count, capacity;
+};
+
+static struct LiquidTick {
+	void* mutex;
+	int numThreads;  /* Number of extra threads used to calculate columns */
+	void* threads[LIQUID_MAX_THREADS];
+	void* wakeups[LIQUID_MAX_THREADS]; /* Signalled to start each thread working on a tick */
+	void* finished;  /* Signalled once every thread has run out of columns */
+	int numWorking;
+	volatile hc_bool quit;
+	hc_bool isLava;  /* Whether lava is being ticked, instead of water */
+	int numRegions, nextRegion;
+	struct LiquidRegion* regions;
+	int* regionStart;   /* Index of first entry of each column in sorted */
+	hc_uint32* sorted;  /* Ticked blocks, sorted by column */
+	int sortedCapacity;
+	struct LightingBlockChange applied[LIQUID_APPLY_BATCH];
+	int numApplied;
+} liquid;
+
+static void LiquidTick_FreeRegions(void) {
+	int i;
+	for (i = 0; i < liquid.numRegions; i++) {
+		Mem_Free(liquid.regions[i].changes);
+	}
+	Mem_Free(liquid.regions);
+	Mem_Free(liquid.regionStart);
+	Mem_Free(liquid.sorted);
+
+	liquid.regions     = NULL;
+	liquid.regionStart = NULL;
+	liquid.sorted      = NULL;
+	liquid.numRegions  = 0;
+	liquid.sortedCapacity = 0;
+}
+
+#define LiquidTick_RegionOf(index) ((((index) / World.Width) % World.Length >> CHUNK_SHIFT) * World.ChunksX + ((index) % World.Width >> CHUNK_SHIFT))
+
+/* Sorts the entries of the given bucket by the column of chunks they are in */
+static void LiquidTick_Partition(struct TickBucket* bucket) {
+	int i, region, total;
+
+	if (!liquid.regions) {
+		liquid.numRegions  = World.ChunksX * World.ChunksZ;
+		liquid.regions     = (struct LiquidRegion*)Mem_AllocCleared(liquid.numRegions, sizeof(struct LiquidRegion), "liquid regions");
+		liquid.regionStart = (int*)Mem_Alloc(liquid.numRegions + 1, 4, "liquid region starts");
+	}
+	if (bucket->count > liquid.sortedCapacity) {
+		liquid.sorted = (hc_uint32*)Mem_Realloc(liquid.sorted, bucket->count, 4, "liquid sorted entries");
+		liquid.sortedCapacity = bucket->count;
+	}
+	Mem_Set(liquid.regionStart, 0, (liquid.numRegions + 1) * 4);
+
+	for (i = 0; i < bucket->count; i++) {
+		liquid.regionStart[LiquidTick_RegionOf(bucket->entries[i]) + 1]++;
+	}
+	for (i = 0, total = 0; i <= liquid.numRegions; i++) {
+		total += liquid.regionStart[i];
+		liquid.regionStart[i] = total;
+	}
+	/* regionStart is used as the insert position, and so ends up shifted down by one column */
+	for (i = 0; i < bucket->count; i++) {
+		region = LiquidTick_RegionOf(bucket->entries[i]);
+		liquid.sorted[liquid.regionStart[region]++] = bucket->entries[i];
+	}
+	for (i = liquid.numRegions; i > 0; i--) {
+		liquid.regionStart[i] = liquid.regionStart[i - 1];
+	}
+	liquid.regionStart[0] = 0;
+}
+
+static void LiquidTick_Add(struct LiquidRegion* region, int index, BlockID block) {
+	if (region->count == region->capacity) {
+		region->capacity = max(32, region->capacity * 2);
+		region->changes  = (struct LiquidChange*)Mem_Realloc(region->changes, region->capacity, 
+									sizeof(struct LiquidChange), "liquid changes");
+	}
+	region->changes[region->count].index = index;
+	region->changes[region->count].block = (BlockRaw)block;
+	region->count++;
+}
+
+/* Whether the given block is the liquid that turns solid when the ticked liquid spreads into it */
+static hc_bool LiquidTick_IsOpposite(BlockID block) {
+	if (liquid.isLava) return block == BLOCK_WATER || block == BLOCK_STILL_WATER;
+	return block == BLOCK_LAVA || block == BLOCK_STILL_LAVA;
+}
+
+/* State of a thread calculating columns */
+struct LiquidWorker {
+	struct LiquidRegion* region;
+	/* Blocks this thread recently spread into, so that a block next to multiple ticked */
+	/*  liquid blocks is usually only checked once (duplicates are rejected when applying anyways) */
+	hc_uint32 recent[LIQUID_RECENT_SIZE];
+};
+
+static void LiquidTick_Propagate(struct LiquidWorker* w, int posIndex, int x, int y, int z) {
+	hc_uint32* recent = &w->recent[posIndex & (LIQUID_RECENT_SIZE - 1)];
+	BlockID block;
+	if (*recent == (hc_uint32)posIndex) return;
+	block = World.Blocks[posIndex];
+
+	if (block >= BLOCK_WATER && block <= BLOCK_STILL_LAVA) {
+		/* Lava and water spreading into each other turns the other liquid solid */
+		if (!LiquidTick_IsOpposite(block)) return;
+		LiquidTick_Add(w->region, posIndex, BLOCK_STONE);
+	} else if (Blocks.Collide[block] == COLLIDE_NONE) {
+		if (!liquid.isLava && Physics_IsNearSponge(x, y, z)) return;
+		LiquidTick_Add(w->region, posIndex, liquid.isLava ? BLOCK_LAVA : BLOCK_WATER);
+	} else {
+		return;
+	}
+	*recent = posIndex;
+}
+
+static void LiquidTick_CalcRegion(struct LiquidWorker* w, int i) {
+	int j, end = liquid.regionStart[i + 1];
+	int index, x, y, z;
+	BlockID block;
+
+	w->region = &liquid.regions[i];
+	w->region->count = 0;
+
+	for (j = liquid.regionStart[i]; j < end; j++) {
+		index = liquid.sorted[j];
+		block = World.Blocks[index];
+
+		if (liquid.isLava) {
+			if (!(block == BLOCK_LAVA  || block == BLOCK_STILL_LAVA))  continue;
+		} else {
+			if (!(block == BLOCK_WATER || block == BLOCK_STILL_WATER)) continue;
+		}
+		World_Unpack(index, x, y, z);
+
+		if (x > 0)          LiquidTick_Propagate(w, index - 1,           x - 1, y,     z);
+		if (x < World.MaxX) LiquidTick_Propagate(w, index + 1,           x + 1, y,     z);
+		if (z > 0)          LiquidTick_Propagate(w, index - World.Width, x,     y,     z - 1);
+		if (z < World.MaxZ) LiquidTick_Propagate(w, index + World.Width, x,     y,     z + 1);
+		if (y > 0)          LiquidTick_Propagate(w, index - World.OneY,  x,     y - 1, z);
+	}
+}
+
+static void LiquidTick_CalcRegions(struct LiquidWorker* w) {
+	int region;
+	Mem_Set(w->recent, 0xFF, sizeof(w->recent));
+
+	for (;;) {
+		Mutex_Lock(liquid.mutex);
+		{
+			region = liquid.nextRegion++;
+		}
+		Mutex_Unlock(liquid.mutex);
+		if (region >= liquid.numRegions) break;
+
+		if (liquid.regionStart[region] == liquid.regionStart[region + 1]) continue;
+		LiquidTick_CalcRegion(w, region);
+	}
+}
+
+#ifndef HC_BUILD_COOPTHREADED
+static void LiquidTick_Worker(void) {
+	struct LiquidWorker w;
+	void* wakeup;
+	int i, working;
+
+	/* Threads are started one at a time, and so can pick their wakeup from the number started so far */
+	Mutex_Lock(liquid.mutex);
+	{
+		i = liquid.numWorking++;
+	}
+	Mutex_Unlock(liquid.mutex);
+	wakeup = liquid.wakeups[i];
+	Waitable_Signal(liquid.finished);
+
+	for (;;) {
+		/* Block until main thread starts ticking another large bucket */
+		Waitable_Wait(wakeup);
+		if (liquid.quit) return;
+		LiquidTick_CalcRegions(&w);
+
+		Mutex_Lock(liquid.mutex);
+		{
+			working = --liquid.numWorking;
+		}
+		Mutex_Unlock(liquid.mutex);
+		if (!working) Waitable_Signal(liquid.finished);
+	}
+}
+
+static void LiquidTick_StartWorkers(void) {
+	int i;
+	liquid.finished = Waitable_Create("Liquid columns finished");
+
+	for (i = 0; i < liquid.numThreads; i++) 
+	{
+		liquid.wakeups[i] = Waitable_Create("Liquid columns wakeup");
+		Thread_Run(&liquid.threads[i], LiquidTick_Worker, 64 * 1024, "Physics worker");
+		Waitable_Wait(liquid.finished);
+	}
+	liquid.numWorking = 0;
+}
+
+static void LiquidTick_StopWorkers(void) {
+	int i;
+	liquid.quit = true;
+
+	for (i = 0; i < liquid.numThreads; i++) 
+	{
+		Waitable_Signal(liquid.wakeups[i]);
+		Thread_Join(liquid.threads[i]);
+		Waitable_Free(liquid.wakeups[i]);
+	}
+	Waitable_Free(liquid.finished);
+	liquid.finished = NULL;
+	liquid.quit     = false;
+}
+#endif
+
+static void LiquidTick_Flush(void) {
+	Game_OnBlocksChanged(liquid.applied, liquid.numApplied);
+	liquid.numApplied = 0;
+}
+
+static void LiquidTick_Apply(int index, BlockID block) {
+	struct LightingBlockChange* c = &liquid.applied[liquid.numApplied++];
+	World_Unpack(index, c->x, c->y, c->z);
+	c->oldBlock = World_GetBlock(c->x, c->y, c->z);
+	c->newBlock = block;
+	World_SetBlock(c->x, c->y, c->z, block);
+
+	if (liquid.numApplied == LIQUID_APPLY_BATCH) LiquidTick_Flush();
+}
+
+static void LiquidTick_Commit(struct TickQueue* queue, int delay) {
+	struct LiquidRegion* region;
+	struct LiquidChange* change;
+	BlockID block;
+	int i, j;
+
+	for (i = 0; i < liquid.numRegions; i++) {
+		region = &liquid.regions[i];
+		if (liquid.regionStart[i] == liquid.regionStart[i + 1]) continue;
+
+		for (j = 0; j < region->count; j++) {
+			change = &region->changes[j];
+			block  = World.Blocks[change->index];
+
+			/* Another liquid block might have already spread into this block */
+			if (change->block == BLOCK_STONE) {
+				if (!LiquidTick_IsOpposite(block)) continue;
+			} else {
+				if (block >= BLOCK_WATER && block <= BLOCK_STILL_LAVA) continue;
+				if (Blocks.Collide[block] != COLLIDE_NONE) continue;
+				TickQueue_Enqueue(queue, change->index, delay);
+			}
+			LiquidTick_Apply(change->index, change->block);
+		}
+	}
+	if (liquid.numApplied) LiquidTick_Flush();
+}
+
+/* Ticks all the liquid blocks in the given bucket across multiple threads */
+static void LiquidTick_Run(struct TickBucket* bucket, struct TickQueue* queue, hc_bool isLava, int delay) {
+	struct LiquidWorker w;
+#ifndef HC_BUILD_COOPTHREADED
+	int i;
+#endif
+	LiquidTick_Partition(bucket);
+	liquid.isLava     = isLava;
+	liquid.nextRegion = 0;
+
+#ifndef HC_BUILD_COOPTHREADED
+	liquid.numWorking = liquid.numThreads;
+	for (i = 0; i < liquid.numThreads; i++) {
+		Waitable_Signal(liquid.wakeups[i]);
+	}
+#endif
+	/* This thread works on columns too while waiting */
+	LiquidTick_CalcRegions(&w);
+
+#ifndef HC_BUILD_COOPTHREADED
+	if (liquid.numThreads) Waitable_Wait(liquid.finished);
+#endif
+	LiquidTick_Commit(queue, delay);
+}
+
+
 static void Physics_PlaceLava(int index, BlockID block) {
-	TickQueue_Enqueue(&lavaQ, PHYSICS_LAVA_DELAY | index);
+	TickQueue_Enqueue(&lavaQ, index, PHYSICS_LAVA_DELAY);
 }
 
 static void Physics_PropagateLava(int posIndex, int x, int y, int z) {
@@ -334,7 +713,7 @@ static void Physics_PropagateLava(int posIndex, int x, int y, int z) {
 			Game_UpdateBlock(x, y, z, BLOCK_STONE);
 		}
 	} else if (Blocks.Collide[block] == COLLIDE_NONE) {
-		TickQueue_Enqueue(&lavaQ, PHYSICS_LAVA_DELAY | posIndex);
+		TickQueue_Enqueue(&lavaQ, posIndex, PHYSICS_LAVA_DELAY);
 		Game_UpdateBlock(x, y, z, BLOCK_LAVA);
 	}
 }
@@ -351,25 +730,30 @@ static void Physics_ActivateLava(int index, BlockID block) {
 }
 
 static void Physics_TickLava(void) {
-	int i, count = lavaQ.count;
-	for (i = 0; i < count; i++) {
-		int index;
-		if (Physics_CheckItem(&lavaQ, &index)) {
-			BlockID block = World.Blocks[index];
-			if (!(block == BLOCK_LAVA || block == BLOCK_STILL_LAVA)) continue;
-			Physics_ActivateLava(index, block);
-		}
+	struct TickBucket* bucket = TickQueue_Advance(&lavaQ);
+	int i;
+
+	if (bucket->count >= LIQUID_PARALLEL_MIN) {
+		LiquidTick_Run(bucket, &lavaQ, true, PHYSICS_LAVA_DELAY);
+		bucket->count = 0;
+		return;
 	}
+	for (i = 0; i < bucket->count; i++) {
+		int index = bucket->entries[i];
+		BlockID block = World.Blocks[index];
+		if (!(block == BLOCK_LAVA || block == BLOCK_STILL_LAVA)) continue;
+		Physics_ActivateLava(index, block);
+	}
+	bucket->count = 0;
 }
 
 
 static void Physics_PlaceWater(int index, BlockID block) {
-	TickQueue_Enqueue(&waterQ, PHYSICS_WATER_DELAY | index);
+	TickQueue_Enqueue(&waterQ, index, PHYSICS_WATER_DELAY);
 }
 
 static void Physics_PropagateWater(int posIndex, int x, int y, int z) {
 	BlockID block = World.Blocks[posIndex];
-	int xx, yy, zz;
 
 	if (block >= BLOCK_WATER && block <= BLOCK_STILL_LAVA) {
 		/* Water spreading into lava turns the lava solid */
@@ -377,17 +761,9 @@ static void Physics_PropagateWater(int posIndex, int x, int y, int z) {
 			Game_UpdateBlock(x, y, z, BLOCK_STONE);
 		}
 	} else if (Blocks.Collide[block] == COLLIDE_NONE) {
-		/* Sponge check */		
-		for (yy = (y < 2 ? 0 : y - 2); yy <= (y > physics_maxWaterY ? World.MaxY : y + 2); yy++) {
-			for (zz = (z < 2 ? 0 : z - 2); zz <= (z > physics_maxWaterZ ? World.MaxZ : z + 2); zz++) {
-				for (xx = (x < 2 ? 0 : x - 2); xx <= (x > physics_maxWaterX ? World.MaxX : x + 2); xx++) {
-					block = World_GetBlock(xx, yy, zz);
-					if (block == BLOCK_SPONGE) return;
-				}
-			}
-		}
+		if (Physics_IsNearSponge(x, y, z)) return;
 
-		TickQueue_Enqueue(&waterQ, PHYSICS_WATER_DELAY | posIndex);
+		TickQueue_Enqueue(&waterQ, posIndex, PHYSICS_WATER_DELAY);
 		Game_UpdateBlock(x, y, z, BLOCK_WATER);
 	}
 }
@@ -404,15 +780,21 @@ static void Physics_ActivateWater(int index, BlockID block) {
 }
 
 static void Physics_TickWater(void) {
-	int i, count = waterQ.count;
-	for (i = 0; i < count; i++) {
-		int index;
-		if (Physics_CheckItem(&waterQ, &index)) {
-			BlockID block = World.Blocks[index];
-			if (!(block == BLOCK_WATER || block == BLOCK_STILL_WATER)) continue;
-			Physics_ActivateWater(index, block);
-		}
+	struct TickBucket* bucket = TickQueue_Advance(&waterQ);
+	int i;
+
+	if (bucket->count >= LIQUID_PARALLEL_MIN) {
+		LiquidTick_Run(bucket, &waterQ, false, PHYSICS_WATER_DELAY);
+		bucket->count = 0;
+		return;
+	}
+	for (i = 0; i < bucket->count; i++) {
+		int index = bucket->entries[i];
+		BlockID block = World.Blocks[index];
+		if (!(block == BLOCK_WATER || block == BLOCK_STILL_WATER)) continue;
+		Physics_ActivateWater(index, block);
 	}
+	bucket->count = 0;
 }
 
 
@@ -447,7 +829,7 @@ static void Physics_DeleteSponge(int index, BlockID block) {
 					index = World_Pack(xx, yy, zz);
 					block = World.Blocks[index];
 					if (block == BLOCK_WATER || block == BLOCK_STILL_WATER) {
-						TickQueue_Enqueue(&waterQ, index | PHYSICS_ONE_DELAY);
+						TickQueue_Enqueue(&waterQ, index, PHYSICS_ONE_DELAY);
 					}
 				}
 			}
@@ -515,8 +897,16 @@ static void Physics_HandleTnt(int index, BlockID block) {
 }
 
 void Physics_Init(void) {
+	Event_Register_(&WorldEvents.NewMap,       NULL, Physics_OnNewMap);
 	Event_Register_(&WorldEvents.MapLoaded,    NULL, Physics_OnNewMapLoaded);
 	Physics.Enabled = Options_GetBool(OPT_BLOCK_PHYSICS, true);
+#ifndef HC_BUILD_COOPTHREADED
+	liquid.numThreads = Options_GetInt(OPT_PHYSICS_THREADS, 0, LIQUID_MAX_THREADS, 0);
+#endif
+	liquid.mutex = Mutex_Create("Liquid columns");
+#ifndef HC_BUILD_COOPTHREADED
+	if (liquid.numThreads) LiquidTick_StartWorkers();
+#endif
 	TickQueue_Init(&lavaQ);
 	TickQueue_Init(&waterQ);
 
@@ -558,11 +948,20 @@ void Physics_Init(void) {
 }
 
 void Physics_Free(void) {
+	Event_Unregister_(&WorldEvents.NewMap,       NULL, Physics_OnNewMap);
 	Event_Unregister_(&WorldEvents.MapLoaded,    NULL, Physics_OnNewMapLoaded);
+	Physics_FreeChunkCounts();
+	LiquidTick_FreeRegions();
+#ifndef HC_BUILD_COOPTHREADED
+	if (liquid.numThreads) LiquidTick_StopWorkers();
+#endif
+	Mutex_Free(liquid.mutex);
+	liquid.mutex = NULL;
 }
 
 void Physics_Tick(void) {
 	if (!Physics.Enabled || !World.Blocks) return;
+	if (!tickableCounts) Physics_CountChunkBlocks();
 
 	/*if ((tickCount % 5) == 0) {*/
 	Physics_TickLava();
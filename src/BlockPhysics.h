@@ -25,6 +25,9 @@ HC_VAR extern struct Physics_ {
 
 void Physics_SetEnabled(hc_bool enabled);
 void Physics_OnBlockChanged(int x, int y, int z, BlockID old, BlockID now);
+/* Keeps track of which chunks contain blocks that react to random ticks. */
+/* NOTE: Must be called whenever a block in the map is changed. */
+void Physics_OnBlockUpdated(int x, int y, int z, BlockID old, BlockID now);
 void Physics_Init(void);
 void Physics_Free(void);
 void Physics_Tick(void);
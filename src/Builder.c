@@ -13,6 +13,7 @@
 #include "TexturePack.h"
 #include "Game.h"
 #include "Options.h"
+#include "Drawer.h"
 
 int Builder_SidesLevel, Builder_EdgeLevel;
 /* Packs an index into the 16x16x16 count array. Coordinates range from 0 to 15. */
@@ -20,14 +21,23 @@ int Builder_SidesLevel, Builder_EdgeLevel;
 /* Packs an index into the 18x18x18 chunk array. Coordinates range from -1 to 16. */
 #define Builder_PackChunk(xx, yy, zz) (((yy) + 1) * EXTCHUNK_SIZE_2 + ((zz) + 1) * EXTCHUNK_SIZE + ((xx) + 1))
 
-static BlockID* Builder_Chunk;
-static hc_uint8* Builder_Counts;
-static int* Builder_BitFlags;
-static int Builder_X, Builder_Y, Builder_Z;
-static BlockID Builder_Block;
-static int Builder_ChunkIndex;
-static hc_bool Builder_FullBright;
-static int Builder_ChunkEndX, Builder_ChunkEndZ;
+/* State used while building a chunk mesh is per-thread, as meshes may be built on several worker threads at once */
+#ifdef HC_BUILD_THREADEDBUILDER
+#define BUILDER_TLS HC_THREADLOCAL
+#else
+#define BUILDER_TLS
+#endif
+
+static BUILDER_TLS BlockID* Builder_Chunk;
+static BUILDER_TLS hc_uint8* Builder_Counts;
+static BUILDER_TLS int* Builder_BitFlags;
+static BUILDER_TLS int Builder_X, Builder_Y, Builder_Z;
+static BUILDER_TLS BlockID Builder_Block;
+static BUILDER_TLS int Builder_ChunkIndex;
+static BUILDER_TLS hc_bool Builder_FullBright;
+static BUILDER_TLS int Builder_ChunkX1, Builder_ChunkY1, Builder_ChunkZ1;
+static BUILDER_TLS int Builder_ChunkEndX, Builder_ChunkEndZ;
+static BUILDER_TLS struct _DrawerData Builder_Drawer;
 static int Builder_Offsets[FACE_COUNT] = { -1,1, -EXTCHUNK_SIZE,EXTCHUNK_SIZE, -EXTCHUNK_SIZE_2,EXTCHUNK_SIZE_2 };
 
 static int (*Builder_StretchXLiquid)(int countIndex, int x, int y, int z, int chunkIndex, BlockID block);
@@ -47,10 +57,47 @@ struct Builder1DPart {
 	int sCount, sOffset;
 };
 
+#define BUILDER_PARTS_COUNT (ATLAS1D_MAX_ATLASES * 2)
 /* Part builder data, for both normal and translucent parts.
 The first ATLAS1D_MAX_ATLASES parts are for normal parts, remainder are for translucent parts. */
-static struct Builder1DPart Builder_Parts[ATLAS1D_MAX_ATLASES * 2];
-static struct VertexTextured* Builder_Vertices;
+static BUILDER_TLS struct Builder1DPart* Builder_Parts;
+static BUILDER_TLS struct VertexTextured* Builder_Vertices;
+/* Part builder data used when building chunk meshes on the main thread */
+static struct Builder1DPart mainParts[BUILDER_PARTS_COUNT];
+
+#ifdef HC_BUILD_TERRAINVERTICES
+/* Vertices of chunk meshes built on the main thread, before being compressed */
+static struct VertexTextured* mainVertices;
+static int mainVertsCapacity;
+
+/* Compresses the given vertices into the chunk's vertex buffer, relative to the chunk's origin */
+static void Builder_UploadTerrain(struct ChunkInfo* info, const struct VertexTextured* src, int count,
+								int x1, int y1, int z1) {
+	struct VertexTerrain* dst;
+	int i;
+#ifdef HC_BUILD_TERRAINPOOL
+	dst = MapRenderer_LockMesh(info, count);
+#else
+	/* add an extra element to fix crashing on some GPUs */
+	dst = (struct VertexTerrain*)Gfx_RecreateAndLockVb(&info->vb, VERTEX_FORMAT_TERRAIN, count + 1);
+#endif
+
+	for (i = 0; i < count; i++, src++, dst++)
+	{
+		dst->x   = (hc_int16)Math_Floor((src->x - x1) * TERRAIN_POS_SCALE + 0.5f);
+		dst->y   = (hc_int16)Math_Floor((src->y - y1) * TERRAIN_POS_SCALE + 0.5f);
+		dst->z   = (hc_int16)Math_Floor((src->z - z1) * TERRAIN_POS_SCALE + 0.5f);
+		dst->U   = (hc_int16)Math_Floor(src->U * TERRAIN_U_SCALE + 0.5f);
+		dst->Col = src->Col;
+		dst->V   = src->V;
+	}
+#ifdef HC_BUILD_TERRAINPOOL
+	MapRenderer_UnlockMesh(info);
+#else
+	Gfx_UnlockVb(info->vb);
+#endif
+}
+#endif
 
 static int Builder1DPart_VerticesCount(struct Builder1DPart* part) {
 	int i, count = part->sCount;
@@ -79,7 +126,7 @@ static int Builder1DPart_CalcOffsets(struct Builder1DPart* part, int offset) {
 
 static int Builder_TotalVerticesCount(void) {
 	int i, count = 0;
-	for (i = 0; i < ATLAS1D_MAX_ATLASES * 2; i++) {
+	for (i = 0; i < BUILDER_PARTS_COUNT; i++) {
 		count += Builder1DPart_VerticesCount(&Builder_Parts[i]);
 	}
 	return count;
@@ -155,20 +202,6 @@ static void PrepareChunk(int x1, int y1, int z1) {
 	BlockID b;
 	int x, y, z, xx, yy, zz;
 
-#ifdef OCCLUSION
-	int flags = ComputeOcclusion();
-#endif
-#ifdef DEBUG_OCCLUSION
-	FastColour col = new FastColour(60, 60, 60, 255);
-	if (flags & 1) col.R = 255; /* x */
-	if (flags & 4) col.G = 255; /* y */
-	if (flags & 2) col.B = 255; /* z */
-	map.Sunlight = map.Shadowlight = col;
-	map.SunlightXSide = map.ShadowlightXSide = col;
-	map.SunlightZSide = map.ShadowlightZSide = col;
-	map.SunlightYBottom = map.ShadowlightYBottom = col;
-#endif
-	
 	for (y = y1, yy = 0; y < yMax; y++, yy++) {
 		for (z = z1, zz = 0; z < zMax; z++, zz++) {
 			cIndex = Builder_PackChunk(0, yy, zz);
@@ -333,23 +366,27 @@ static hc_bool ReadBorderChunkData(int x1, int y1, int z1, hc_bool* outAllAir) {
 	return false;
 }
 
-static void OutputChunkPartsMeta(int x, int y, int z, struct ChunkInfo* info) {
-	hc_bool hasNorm, hasTran;
-	int partsIndex;
-	int i, j, curIdx, offset;
-	
-	partsIndex = World_ChunkPack(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
-	offset  = 0;
-	hasNorm = false;
-	hasTran = false;
+/* Calculates the offset and counts of vertices for each 1D atlas batch part of the chunk mesh */
+static void OutputChunkParts(struct ChunkPartInfo* normal, struct ChunkPartInfo* translucent, int stride,
+							hc_bool* hasNorm, hc_bool* hasTran) {
+	int i, j, offset = 0;
+	*hasNorm = false;
+	*hasTran = false;
 
 	for (i = 0; i < MapRenderer_1DUsedCount; i++) {
 		j = i + ATLAS1D_MAX_ATLASES;
-		curIdx = partsIndex + i * World.ChunksCount;
 
-		hasNorm |= SetPartInfo(&Builder_Parts[i], &offset, &MapRenderer_PartsNormal[curIdx]);
-		hasTran |= SetPartInfo(&Builder_Parts[j], &offset, &MapRenderer_PartsTranslucent[curIdx]);
+		*hasNorm |= SetPartInfo(&Builder_Parts[i], &offset, &normal[i * stride]);
+		*hasTran |= SetPartInfo(&Builder_Parts[j], &offset, &translucent[i * stride]);
 	}
+}
+
+static void OutputChunkPartsMeta(int x, int y, int z, struct ChunkInfo* info) {
+	hc_bool hasNorm, hasTran;
+	int partsIndex = World_ChunkPack(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
+
+	OutputChunkParts(&MapRenderer_PartsNormal[partsIndex], &MapRenderer_PartsTranslucent[partsIndex], 
+					World.ChunksCount, &hasNorm, &hasTran);
 
 	if (hasNorm) {
 		info->normalParts      = &MapRenderer_PartsNormal[partsIndex];
@@ -359,6 +396,117 @@ static void OutputChunkPartsMeta(int x, int y, int z, struct ChunkInfo* info) {
 	}
 }
 
+/* Reads the blocks of the 18x18x18 region surrounding the given chunk into Builder_Chunk */
+/* Returns whether all the blocks are fully opaque (i.e. chunk mesh would be empty) */
+static hc_bool ReadChunk(int x1, int y1, int z1, hc_bool* allAir) {
+	hc_bool onBorder = 
+		x1 == 0 || y1 == 0 || z1 == 0   || x1 + CHUNK_SIZE >= World.Width ||
+		y1 + CHUNK_SIZE >= World.Height || z1 + CHUNK_SIZE >= World.Length;
+
+	if (onBorder) {
+		/* less optimal case here */
+		Mem_Set(Builder_Chunk, BLOCK_AIR, EXTCHUNK_SIZE_3 * sizeof(BlockID));
+		return ReadBorderChunkData(x1, y1, z1, allAir);
+	}
+	return ReadChunkData(x1, y1, z1, allAir);
+}
+
+/* Calculates which faces of which blocks in the chunk are visible */
+/* Returns the total number of vertices in the chunk mesh */
+static int PrepareMesh(int x1, int y1, int z1) {
+	Builder_ChunkX1 = x1; Builder_ChunkY1 = y1; Builder_ChunkZ1 = z1;
+	Builder_PrePrepareChunk();
+
+	Mem_Set(Builder_Counts, 1, CHUNK_SIZE_3 * FACE_COUNT);
+	Builder_ChunkEndX = min(World.Width,  x1 + CHUNK_SIZE);
+	Builder_ChunkEndZ = min(World.Length, z1 + CHUNK_SIZE);
+
+	PrepareChunk(x1, y1, z1);
+	return Builder_TotalVerticesCount();
+}
+
+/* Generates the vertices of the chunk mesh into Builder_Vertices */
+static void RenderMesh(int x1, int y1, int z1) {
+	int xMax, yMax, zMax;
+	int cIndex, index;
+	int x, y, z, xx, yy, zz;
+
+	xMax = min(World.Width,  x1 + CHUNK_SIZE);
+	yMax = min(World.Height, y1 + CHUNK_SIZE);
+	zMax = min(World.Length, z1 + CHUNK_SIZE);
+	Builder_PostPrepareChunk();
+
+	for (y = y1, yy = 0; y < yMax; y++, yy++) {
+		for (z = z1, zz = 0; z < zMax; z++, zz++) {
+			cIndex = Builder_PackChunk(0, yy, zz);
+
+			for (x = x1, xx = 0; x < xMax; x++, xx++, cIndex++) {
+				Builder_Block = Builder_Chunk[cIndex];
+				if (Blocks.Draw[Builder_Block] == DRAW_GAS) continue;
+
+				index = Builder_PackCount(xx, yy, zz);
+				Builder_ChunkIndex = cIndex;
+				Builder_RenderBlock(index, x, y, z);
+			}
+		}
+	}
+}
+
+/* Returns connections between all pairs of the given faces */
+static int ConnectFaces(int faces) {
+	int a, b, connections = 0;
+	for (a = 0; a < FACE_COUNT; a++) {
+		if (!(faces & (1 << a))) continue;
+
+		for (b = a + 1; b < FACE_COUNT; b++) {
+			if (faces & (1 << b)) connections |= CHUNK_CONNECTION_BIT(a, b);
+		}
+	}
+	return connections;
+}
+
+#define Connections_Visit(xx, yy, zz, index) \
+if (!visited[index] && !Blocks.FullOpaque[Builder_Chunk[Builder_PackChunk(xx, yy, zz)]]) {\
+	visited[index] = true; queue[tail++] = index;\
+}
+
+/* Flood fills the non-opaque blocks in the chunk, to work out which faces of the chunk */
+/*  can be seen through the chunk from which other faces (see CHUNK_CONNECTION_BIT) */
+static int CalcConnections(void) {
+#ifdef HC_BUILD_TINYSTACK
+	static hc_uint8  visited[CHUNK_SIZE_3];
+	static hc_uint16 queue[CHUNK_SIZE_3];
+#else
+	hc_uint8  visited[CHUNK_SIZE_3];
+	hc_uint16 queue[CHUNK_SIZE_3];
+#endif
+	int connections = 0, faces;
+	int i, index, head, tail;
+	int x, y, z;
+	Mem_Set(visited, 0, sizeof(visited));
+
+	for (i = 0; i < CHUNK_SIZE_3; i++) {
+		x = i & CHUNK_MASK; z = (i >> CHUNK_SHIFT) & CHUNK_MASK; y = i >> (CHUNK_SHIFT * 2);
+		head = 0; tail = 0; faces = 0;
+		Connections_Visit(x, y, z, i);
+
+		while (head < tail) {
+			index = queue[head++];
+			x = index & CHUNK_MASK; z = (index >> CHUNK_SHIFT) & CHUNK_MASK; y = index >> (CHUNK_SHIFT * 2);
+
+			if (x == 0) { faces |= FACE_BIT_XMIN; } else { Connections_Visit(x - 1, y, z, index - 1); }
+			if (x == CHUNK_MAX) { faces |= FACE_BIT_XMAX; } else { Connections_Visit(x + 1, y, z, index + 1); }
+			if (z == 0) { faces |= FACE_BIT_ZMIN; } else { Connections_Visit(x, y, z - 1, index - CHUNK_SIZE); }
+			if (z == CHUNK_MAX) { faces |= FACE_BIT_ZMAX; } else { Connections_Visit(x, y, z + 1, index + CHUNK_SIZE); }
+			if (y == 0) { faces |= FACE_BIT_YMIN; } else { Connections_Visit(x, y - 1, z, index - CHUNK_SIZE_2); }
+			if (y == CHUNK_MAX) { faces |= FACE_BIT_YMAX; } else { Connections_Visit(x, y + 1, z, index + CHUNK_SIZE_2); }
+		}
+		connections |= ConnectFaces(faces);
+		if (connections == CHUNK_ALL_CONNECTED) break;
+	}
+	return connections;
+}
+
 void Builder_MakeChunk(struct ChunkInfo* info) {
 #ifdef HC_BUILD_TINYSTACK
 	/* The Saturn build only has 16 kb stack, not large enough */
@@ -371,51 +519,37 @@ void Builder_MakeChunk(struct ChunkInfo* info) {
 	int bitFlags[EXTCHUNK_SIZE_3];
 #endif
 
-	hc_bool allAir, allSolid, onBorder;
-	int xMax, yMax, zMax, totalVerts;
-	int cIndex, index;
-	int x, y, z, xx, yy, zz;
+	hc_bool allAir, allSolid;
+	int totalVerts;
 	int x1 = info->centreX - 8, y1 = info->centreY - 8, z1 = info->centreZ - 8;
+#ifdef HC_BUILD_GL11
+	int cIndex, index;
+#endif
 
-	Builder_Chunk  = chunk;
-	Builder_Counts = counts;
+	Builder_Chunk    = chunk;
+	Builder_Counts   = counts;
 	Builder_BitFlags = bitFlags;
-	Builder_PrePrepareChunk();
-	
-	onBorder = 
-		x1 == 0 || y1 == 0 || z1 == 0   || x1 + CHUNK_SIZE >= World.Width ||
-		y1 + CHUNK_SIZE >= World.Height || z1 + CHUNK_SIZE >= World.Length;
-
-	if (onBorder) {
-		/* less optimal case here */
-		Mem_Set(chunk, BLOCK_AIR, EXTCHUNK_SIZE_3 * sizeof(BlockID));
-		allSolid = ReadBorderChunkData(x1, y1, z1, &allAir);
-	} else {
-		allSolid = ReadChunkData(x1, y1, z1, &allAir);
-	}
+	Builder_Parts    = mainParts;
+	allSolid = ReadChunk(x1, y1, z1, &allAir);
 
 	info->allAir = allAir;
+	info->connections = allAir ? CHUNK_ALL_CONNECTED : (allSolid ? 0 : CalcConnections());
 	if (allAir || allSolid) return;
 	Lighting.LightHint(x1 - 1, y1 - 1, z1 - 1);
 
-	Mem_Set(counts, 1, CHUNK_SIZE_3 * FACE_COUNT);
-	xMax = min(World.Width,  x1 + CHUNK_SIZE);
-	yMax = min(World.Height, y1 + CHUNK_SIZE);
-	zMax = min(World.Length, z1 + CHUNK_SIZE);
-
-	Builder_ChunkEndX = xMax; Builder_ChunkEndZ = zMax;
-	PrepareChunk(x1, y1, z1);
-
-	totalVerts = Builder_TotalVerticesCount();
+	totalVerts = PrepareMesh(x1, y1, z1);
 	if (!totalVerts) return;
 	
 	OutputChunkPartsMeta(x1, y1, z1, info);
-#ifdef OCCLUSION
-	if (info.NormalParts != null || info.TranslucentParts != null)
-		info.occlusionFlags = (hc_uint8)ComputeOcclusion();
-#endif
 
-#ifndef HC_BUILD_GL11
+#if defined HC_BUILD_TERRAINVERTICES
+	if (totalVerts > mainVertsCapacity) {
+		Mem_Free(mainVertices);
+		mainVertices      = (struct VertexTextured*)Mem_Alloc(totalVerts, sizeof(struct VertexTextured), "chunk vertices");
+		mainVertsCapacity = totalVerts;
+	}
+	Builder_Vertices = mainVertices;
+#elif !defined HC_BUILD_GL11
 	/* add an extra element to fix crashing on some GPUs */
 	Builder_Vertices = (struct VertexTextured*)Gfx_RecreateAndLockVb(&info->vb,
 													VERTEX_FORMAT_TEXTURED, totalVerts + 1);
@@ -424,23 +558,8 @@ void Builder_MakeChunk(struct ChunkInfo* info) {
 	Builder_Vertices = (struct VertexTextured*)Gfx_LockVb(0, 
 													VERTEX_FORMAT_TEXTURED, totalVerts + 1);
 #endif
-	Builder_PostPrepareChunk();
 	/* now render the chunk */
-
-	for (y = y1, yy = 0; y < yMax; y++, yy++) {
-		for (z = z1, zz = 0; z < zMax; z++, zz++) {
-			cIndex = Builder_PackChunk(0, yy, zz);
-
-			for (x = x1, xx = 0; x < xMax; x++, xx++, cIndex++) {
-				Builder_Block = chunk[cIndex];
-				if (Blocks.Draw[Builder_Block] == DRAW_GAS) continue;
-
-				index = Builder_PackCount(xx, yy, zz);
-				Builder_ChunkIndex = cIndex;
-				Builder_RenderBlock(index, x, y, z);
-			}
-		}
-	}
+	RenderMesh(x1, y1, z1);
 
 #ifdef HC_BUILD_GL11
 	cIndex = World_ChunkPack(x1 >> CHUNK_SHIFT, y1 >> CHUNK_SHIFT, z1 >> CHUNK_SHIFT);
@@ -451,6 +570,8 @@ void Builder_MakeChunk(struct ChunkInfo* info) {
 		BuildPartVbs(&MapRenderer_PartsNormal[curIdx]);
 		BuildPartVbs(&MapRenderer_PartsTranslucent[curIdx]);
 	}
+#elif defined HC_BUILD_TERRAINVERTICES
+	Builder_UploadTerrain(info, mainVertices, totalVerts, x1, y1, z1);
 #else
 	Gfx_UnlockVb(info->vb);
 #endif
@@ -467,7 +588,7 @@ static hc_bool Builder_OccludedLiquid(int chunkIndex) {
 }
 
 static void DefaultPrePrepateChunk(void) {
-	Mem_Set(Builder_Parts, 0, sizeof(Builder_Parts));
+	Mem_Set(Builder_Parts, 0, BUILDER_PARTS_COUNT * sizeof(struct Builder1DPart));
 }
 
 static void DefaultPostStretchChunk(void) {
@@ -481,7 +602,7 @@ static void DefaultPostStretchChunk(void) {
 	}
 }
 
-static RNGState spriteRng;
+static BUILDER_TLS RNGState spriteRng;
 static void Builder_DrawSprite(int x, int y, int z) {
 	struct Builder1DPart* part;
 	struct VertexTextured* v;
@@ -654,6 +775,7 @@ static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {
 	hc_bool fullBright;
 
 	/* per-face state */
+	struct _DrawerData* drawer;
 	struct Builder1DPart* part;
 	TextureLoc loc;
 	PackedCol col;
@@ -677,15 +799,16 @@ static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {
 	baseOffset = (Blocks.Draw[Builder_Block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
 	lightFlags = Blocks.LightOffset[Builder_Block];
 
-	Drawer.MinBB = Blocks.MinBB[Builder_Block]; Drawer.MinBB.y = 1.0f - Drawer.MinBB.y;
-	Drawer.MaxBB = Blocks.MaxBB[Builder_Block]; Drawer.MaxBB.y = 1.0f - Drawer.MaxBB.y;
+	drawer = &Builder_Drawer;
+	drawer->MinBB = Blocks.MinBB[Builder_Block]; drawer->MinBB.y = 1.0f - drawer->MinBB.y;
+	drawer->MaxBB = Blocks.MaxBB[Builder_Block]; drawer->MaxBB.y = 1.0f - drawer->MaxBB.y;
 
 	min = Blocks.RenderMinBB[Builder_Block]; max = Blocks.RenderMaxBB[Builder_Block];
-	Drawer.X1 = x + min.x; Drawer.Y1 = y + min.y; Drawer.Z1 = z + min.z;
-	Drawer.X2 = x + max.x; Drawer.Y2 = y + max.y; Drawer.Z2 = z + max.z;
+	drawer->X1 = x + min.x; drawer->Y1 = y + min.y; drawer->Z1 = z + min.z;
+	drawer->X2 = x + max.x; drawer->Y2 = y + max.y; drawer->Z2 = z + max.z;
 
-	Drawer.Tinted  = Blocks.Tinted[Builder_Block];
-	Drawer.TintCol = Blocks.FogCol[Builder_Block];
+	drawer->Tinted  = Blocks.Tinted[Builder_Block];
+	drawer->TintCol = Blocks.FogCol[Builder_Block];
 
 	if (count_XMin) {
 		loc    = Block_Tex(Builder_Block, FACE_XMIN);
@@ -694,7 +817,7 @@ static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {
 
 		col = fullBright ? PACKEDCOL_WHITE :
 			x >= offset ? Lighting.Color_XSide_Fast(x - offset, y, z) : Env.SunXSide;
-		Drawer_XMin(count_XMin, col, loc, &part->faces.vertices[FACE_XMIN]);
+		Drawer_XMinWith(drawer, count_XMin, col, loc, &part->faces.vertices[FACE_XMIN]);
 	}
 
 	if (count_XMax) {
@@ -704,7 +827,7 @@ static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {
 
 		col = fullBright ? PACKEDCOL_WHITE :
 			x <= (World.MaxX - offset) ? Lighting.Color_XSide_Fast(x + offset, y, z) : Env.SunXSide;
-		Drawer_XMax(count_XMax, col, loc, &part->faces.vertices[FACE_XMAX]);
+		Drawer_XMaxWith(drawer, count_XMax, col, loc, &part->faces.vertices[FACE_XMAX]);
 	}
 
 	if (count_ZMin) {
@@ -714,7 +837,7 @@ static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {
 
 		col = fullBright ? PACKEDCOL_WHITE :
 			z >= offset ? Lighting.Color_ZSide_Fast(x, y, z - offset) : Env.SunZSide;
-		Drawer_ZMin(count_ZMin, col, loc, &part->faces.vertices[FACE_ZMIN]);
+		Drawer_ZMinWith(drawer, count_ZMin, col, loc, &part->faces.vertices[FACE_ZMIN]);
 	}
 
 	if (count_ZMax) {
@@ -724,7 +847,7 @@ static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {
 
 		col = fullBright ? PACKEDCOL_WHITE :
 			z <= (World.MaxZ - offset) ? Lighting.Color_ZSide_Fast(x, y, z + offset) : Env.SunZSide;
-		Drawer_ZMax(count_ZMax, col, loc, &part->faces.vertices[FACE_ZMAX]);
+		Drawer_ZMaxWith(drawer, count_ZMax, col, loc, &part->faces.vertices[FACE_ZMAX]);
 	}
 
 	if (count_YMin) {
@@ -733,7 +856,7 @@ static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {
 		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
 
 		col = fullBright ? PACKEDCOL_WHITE : Lighting.Color_YMin_Fast(x, y - offset, z);
-		Drawer_YMin(count_YMin, col, loc, &part->faces.vertices[FACE_YMIN]);
+		Drawer_YMinWith(drawer, count_YMin, col, loc, &part->faces.vertices[FACE_YMIN]);
 	}
 
 	if (count_YMax) {
@@ -742,7 +865,7 @@ static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {
 		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
 
 		col = fullBright ? PACKEDCOL_WHITE : Lighting.Color_YMax_Fast(x, y + offset, z);
-		Drawer_YMax(count_YMax, col, loc, &part->faces.vertices[FACE_YMAX]);
+		Drawer_YMaxWith(drawer, count_YMax, col, loc, &part->faces.vertices[FACE_YMAX]);
 	}
 }
 
@@ -769,12 +892,12 @@ static void NormalBuilder_SetActive(void) {
 *-------------------------------------------------Advanced mesh builder---------------------------------------------------*
 *#########################################################################################################################*/
 #ifdef HC_BUILD_ADVLIGHTING
-static Vec3 adv_minBB, adv_maxBB;
-static int adv_initBitFlags, adv_baseOffset;
-static int* adv_bitFlags;
-static float adv_x1, adv_y1, adv_z1, adv_x2, adv_y2, adv_z2;
-static PackedCol adv_lerp[5], adv_lerpX[5], adv_lerpZ[5], adv_lerpY[5];
-static hc_bool adv_tinted;
+static BUILDER_TLS Vec3 adv_minBB, adv_maxBB;
+static BUILDER_TLS int adv_initBitFlags, adv_baseOffset;
+static BUILDER_TLS int* adv_bitFlags;
+static BUILDER_TLS float adv_x1, adv_y1, adv_z1, adv_x2, adv_y2, adv_z2;
+static BUILDER_TLS PackedCol adv_lerp[5], adv_lerpX[5], adv_lerpZ[5], adv_lerpY[5];
+static BUILDER_TLS hc_bool adv_tinted;
 
 enum ADV_MASK {
 	/* z-1 cube points */
@@ -1281,7 +1404,8 @@ static void AdvBuilder_SetActive(void) { NormalBuilder_SetActive(); }
 #define AVERAGE(a, b)   ( ((((a) ^ (b)) & 0xfefefefe) >> 1) + ((a) & (b)) )
 
 static hc_bool Modern_IsOccluded(int x, int y, int z) {
-	BlockID block = World_SafeGetBlock(x, y, z);
+	/* Coordinates are always within the 18x18x18 chunk array, which is air outside the map */
+	BlockID block = Builder_Chunk[Builder_PackChunk(x - Builder_ChunkX1, y - Builder_ChunkY1, z - Builder_ChunkZ1)];
 	if (Blocks.Brightness[block] > 0) { return false; }
 	/* If the block we're pulling colors from is solid, return a darker version of original and increment how many are like this */
 	if (Blocks.FullOpaque[block] || (Blocks.Draw[block] == DRAW_TRANSPARENT && Blocks.BlocksLight[block] && Blocks.LightOffset[block] == 0xFF)) {
@@ -1619,11 +1743,277 @@ static void ModernBuilder_SetActive(void) {
 static void ModernBuilder_SetActive(void) { NormalBuilder_SetActive(); }
 #endif
 
+/*########################################################################################################################*
+*------------------------------------------------Builder worker threads---------------------------------------------------*
+*#########################################################################################################################*/
+int Builder_WorkerThreads;
+#ifdef HC_BUILD_THREADEDBUILDER
+enum BuilderJobState { JOB_FREE, JOB_PENDING, JOB_WORKING, JOB_FINISHED };
+
+/* Describes the input and output of building the mesh for a chunk on a worker thread */
+struct BuilderJob {
+	struct ChunkInfo* info;
+	int x1, y1, z1;
+	hc_uint32 sequence; /* Jobs are started in the order they were queued */
+	hc_uint8 state;
+	hc_bool allAir, hasNorm, hasTran;
+	hc_uint16 connections;
+	int totalVerts, vertsCapacity;
+	struct VertexTextured* vertices;
+	BlockID chunk[EXTCHUNK_SIZE_3];
+	struct Builder1DPart parts[BUILDER_PARTS_COUNT];
+	struct ChunkPartInfo normal[ATLAS1D_MAX_ATLASES];
+	struct ChunkPartInfo translucent[ATLAS1D_MAX_ATLASES];
+};
+
+#define JOBS_PER_THREAD 4
+static struct BuilderJob* jobs;
+static struct BuilderJob* finishedJob;
+static int jobsCount;
+static hc_uint32 jobsSequence;
+static void* jobsMutex;
+static void* jobsWaitable;
+
+/* NOTE: jobsMutex must be locked when calling this */
+static struct BuilderJob* NextPendingJob(void) {
+	struct BuilderJob* next = NULL;
+	int i;
+
+	for (i = 0; i < jobsCount; i++) 
+	{
+		if (jobs[i].state != JOB_PENDING) continue;
+		if (!next || jobs[i].sequence < next->sequence) next = &jobs[i];
+	}
+	return next;
+}
+
+static void BuildJob(struct BuilderJob* job, hc_uint8* counts, int* bitFlags) {
+	struct VertexTextured* vertices;
+	int totalVerts;
+
+	Builder_Chunk    = job->chunk;
+	Builder_Counts   = counts;
+	Builder_BitFlags = bitFlags;
+	Builder_Parts    = job->parts;
+
+	job->connections = CalcConnections();
+	totalVerts = PrepareMesh(job->x1, job->y1, job->z1);
+	job->totalVerts = 0;
+	if (!totalVerts) return;
+	OutputChunkParts(job->normal, job->translucent, 1, &job->hasNorm, &job->hasTran);
+
+	if (totalVerts > job->vertsCapacity) {
+		vertices = (struct VertexTextured*)Mem_TryRealloc(job->vertices, totalVerts, sizeof(struct VertexTextured));
+		/* Treat running out of memory like the chunk being empty */
+		if (!vertices) return;
+
+		job->vertices      = vertices;
+		job->vertsCapacity = totalVerts;
+	}
+
+	Builder_Vertices = job->vertices;
+	RenderMesh(job->x1, job->y1, job->z1);
+	job->totalVerts  = totalVerts;
+}
+
+static void BuilderWorker_Run(void) {
+	hc_uint8 counts[CHUNK_SIZE_3 * FACE_COUNT];
+	int bitFlags[EXTCHUNK_SIZE_3];
+	struct BuilderJob* job;
+	hc_bool morePending;
+
+	for (;;) {
+		Mutex_Lock(jobsMutex);
+		{
+			job = NextPendingJob();
+			if (job) job->state = JOB_WORKING;
+			morePending = job && NextPendingJob();
+		}
+		Mutex_Unlock(jobsMutex);
+
+		if (!job) {
+			/* Block until main thread queues another chunk to build */
+			Waitable_Wait(jobsWaitable); continue;
+		}
+		/* Wake up another worker to help with remaining jobs */
+		if (morePending) Waitable_Signal(jobsWaitable);
+
+		BuildJob(job, counts, bitFlags);
+		Mutex_Lock(jobsMutex);
+		{
+			job->state = JOB_FINISHED;
+		}
+		Mutex_Unlock(jobsMutex);
+	}
+}
+
+hc_bool Builder_QueueChunk(struct ChunkInfo* info) {
+	struct BuilderJob* job = NULL;
+	hc_bool allAir, allSolid, empty;
+	int i;
+
+	/* Only the main thread ever changes a job from free, so no need to lock here */
+	for (i = 0; i < jobsCount; i++) 
+	{
+		if (jobs[i].state == JOB_FREE) { job = &jobs[i]; break; }
+	}
+	if (!job) return false;
+
+	job->info = info;
+	job->x1   = info->centreX - 8; 
+	job->y1   = info->centreY - 8; 
+	job->z1   = info->centreZ - 8;
+	job->totalVerts = 0;
+
+	Builder_Chunk = job->chunk;
+	allSolid = ReadChunk(job->x1, job->y1, job->z1, &allAir);
+	job->allAir = allAir;
+	job->connections = allAir ? CHUNK_ALL_CONNECTED : 0;
+
+	info->building = true;
+	info->dirty    = false;
+
+	/* Mesh is always empty, so don't bother waking up a worker thread */
+	empty = allAir || allSolid;
+	/* Lighting must be calculated on the main thread, as it can modify lighting state */
+	if (!empty) Lighting.LightHint(job->x1 - 1, job->y1 - 1, job->z1 - 1);
+
+	Mutex_Lock(jobsMutex);
+	{
+		job->sequence = jobsSequence++;
+		job->state    = empty ? JOB_FINISHED : JOB_PENDING;
+	}
+	Mutex_Unlock(jobsMutex);
+
+	if (!empty) Waitable_Signal(jobsWaitable);
+	return true;
+}
+
+struct ChunkInfo* Builder_FinishedChunk(void) {
+	struct BuilderJob* job = NULL;
+	int i;
+
+	Mutex_Lock(jobsMutex);
+	{
+		for (i = 0; i < jobsCount; i++) 
+		{
+			if (jobs[i].state != JOB_FINISHED) continue;
+			if (!job || jobs[i].sequence < job->sequence) job = &jobs[i];
+		}
+	}
+	Mutex_Unlock(jobsMutex);
+
+	finishedJob = job;
+	return job ? job->info : NULL;
+}
+
+void Builder_UploadChunk(void) {
+	struct BuilderJob* job = finishedJob;
+	struct ChunkInfo* info = job->info;
+#ifndef HC_BUILD_TERRAINVERTICES
+	struct VertexTextured* vertices;
+#endif
+	int i, partsIndex, curIdx;
+
+	/* Blocks changed while the mesh was being built, so the chunk may no longer be all air */
+	if (!info->dirty) info->allAir = job->allAir;
+	info->connections = job->connections;
+	info->building    = false;
+
+	if (job->totalVerts) {
+		partsIndex = World_ChunkPack(job->x1 >> CHUNK_SHIFT, job->y1 >> CHUNK_SHIFT, job->z1 >> CHUNK_SHIFT);
+
+		for (i = 0; i < MapRenderer_1DUsedCount; i++) {
+			curIdx = partsIndex + i * World.ChunksCount;
+
+			MapRenderer_PartsNormal[curIdx]      = job->normal[i];
+			MapRenderer_PartsTranslucent[curIdx] = job->translucent[i];
+		}
+
+		if (job->hasNorm) info->normalParts      = &MapRenderer_PartsNormal[partsIndex];
+		if (job->hasTran) info->translucentParts = &MapRenderer_PartsTranslucent[partsIndex];
+
+#ifdef HC_BUILD_TERRAINVERTICES
+		Builder_UploadTerrain(info, job->vertices, job->totalVerts, job->x1, job->y1, job->z1);
+#else
+		/* add an extra element to fix crashing on some GPUs */
+		vertices = (struct VertexTextured*)Gfx_RecreateAndLockVb(&info->vb,
+												VERTEX_FORMAT_TEXTURED, job->totalVerts + 1);
+		Mem_Copy(vertices, job->vertices, job->totalVerts * sizeof(struct VertexTextured));
+		Gfx_UnlockVb(info->vb);
+#endif
+	}
+
+	finishedJob = NULL;
+	Mutex_Lock(jobsMutex);
+	{
+		job->state = JOB_FREE;
+	}
+	Mutex_Unlock(jobsMutex);
+}
+
+void Builder_CancelJobs(void) {
+	int i, working;
+	if (!jobs) return;
+	finishedJob = NULL;
+
+	for (;;) {
+		working = 0;
+		Mutex_Lock(jobsMutex);
+		{
+			for (i = 0; i < jobsCount; i++) 
+			{
+				if (jobs[i].state == JOB_WORKING) {
+					working++;
+				} else if (jobs[i].state != JOB_FREE) {
+					/* Chunk needs to be queued to be built again later */
+					jobs[i].info->building = false;
+					jobs[i].info->dirty    = true;
+					jobs[i].state = JOB_FREE;
+				}
+			}
+		}
+		Mutex_Unlock(jobsMutex);
+
+		/* Jobs being built still reference lighting and world state, so must wait for them */
+		if (!working) return;
+		Thread_Sleep(1);
+	}
+}
+
+static void StartWorkers(void) {
+	void* thread;
+	int i;
+
+	Builder_WorkerThreads = Options_GetInt(OPT_BUILDER_THREADS, 0, 32, 0);
+	if (!Builder_WorkerThreads) return;
+
+	jobsCount = Builder_WorkerThreads * JOBS_PER_THREAD;
+	jobs = (struct BuilderJob*)Mem_TryAllocCleared(jobsCount, sizeof(struct BuilderJob));
+	if (!jobs) { Builder_WorkerThreads = 0; return; }
+
+	jobsMutex    = Mutex_Create("Builder jobs");
+	jobsWaitable = Waitable_Create("Builder wakeup");
+
+	for (i = 0; i < Builder_WorkerThreads; i++) 
+	{
+		Thread_Run(&thread, BuilderWorker_Run, 256 * 1024, "Chunk builder");
+		Thread_Detach(thread);
+	}
+}
+#else
+void Builder_CancelJobs(void) { }
+static void StartWorkers(void) { }
+#endif
+
+
 /*########################################################################################################################*
 *---------------------------------------------------Builder interface-----------------------------------------------------*
 *#########################################################################################################################*/
 hc_bool Builder_SmoothLighting;
 void Builder_ApplyActive(void) {
+	/* Jobs being built on worker threads use the currently active builder functions */
+	Builder_CancelJobs();
 	if (Builder_SmoothLighting) {
 		if (Lighting_Mode != LIGHTING_MODE_CLASSIC) {
 			ModernBuilder_SetActive();
@@ -1646,6 +2036,15 @@ static void OnInit(void) {
 
 	if (!Game_ClassicMode) Builder_SmoothLighting = Options_GetBool(OPT_SMOOTH_LIGHTING, false);
 	Builder_ApplyActive();
+	StartWorkers();
+}
+
+static void OnFree(void) {
+#ifdef HC_BUILD_TERRAINVERTICES
+	Mem_Free(mainVertices);
+	mainVertices      = NULL;
+	mainVertsCapacity = 0;
+#endif
 }
 
 static void OnNewMapLoaded(void) {
@@ -1655,7 +2054,7 @@ static void OnNewMapLoaded(void) {
 
 struct IGameComponent Builder_Component = {
 	OnInit, /* Init */
-	NULL, /* Free */
+	OnFree, /* Free */
 	NULL, /* Reset */
 	NULL, /* OnNewMap */
 	OnNewMapLoaded /* OnNewMapLoaded */
@@ -22,6 +22,22 @@ extern hc_bool Builder_SmoothLighting;
 /* Builds the mesh of vertices for the given chunk. */
 void Builder_MakeChunk(struct ChunkInfo* info);
 
+/* Number of worker threads that chunk meshes are built on. (0 = built on main thread) */
+extern int Builder_WorkerThreads;
+#ifdef HC_BUILD_THREADEDBUILDER
+/* Queues the mesh of the given chunk to be built on a worker thread. */
+/* Returns false if too many chunks are already queued to be built. */
+hc_bool Builder_QueueChunk(struct ChunkInfo* info);
+/* Returns the chunk whose mesh was queued the earliest and has finished building. */
+/* Returns NULL if no queued chunk meshes have finished building yet. */
+struct ChunkInfo* Builder_FinishedChunk(void);
+/* Uploads the mesh of the chunk previously returned by Builder_FinishedChunk. */
+void Builder_UploadChunk(void);
+#endif
+/* Discards all queued chunk meshes, and waits for meshes currently being built to finish. */
+/* NOTE: Must be called before freeing any state that worker threads read (e.g. lighting) */
+void Builder_CancelJobs(void);
+
 void Builder_ApplyActive(void);
 
 HC_END_HEADER
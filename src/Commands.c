@@ -17,6 +17,17 @@
 #include "TexturePack.h"
 #include "Options.h"
 #include "Drawer2D.h"
+#include "Deflate.h"
+#include "Stream.h"
+#include "Platform.h"
+#include "Errors.h"
+#include "Generator.h"
+#include "Formats.h"
+#include "Lighting.h"
+#include "MapRenderer.h"
+#include "BlockPhysics.h"
+#include "Builder.h"
+#include "Screens.h"
 
 #define COMMANDS_PREFIX "/client"
 #define COMMANDS_PREFIX_SPACE "/client "
@@ -792,6 +803,647 @@ static struct ChatCommand BlockEditCommand = {
 };
 
 
+/*########################################################################################################################*
+*--------------------------------------------------------BenchCommand-----------------------------------------------------*
+*#########################################################################################################################*/
+/* Returns the average number of milliseconds each of the given number of runs took since beg */
+static float Bench_AverageMS(hc_uint64 beg, int runs) {
+	hc_uint64 end = Stopwatch_Measure();
+	return Stopwatch_ElapsedMicroseconds(beg, end) / 1000.0f / runs;
+}
+
+/* Returns the number of MB processed per second, given the average milliseconds taken */
+static float Bench_Speed(hc_uint32 size, float elapsedMS) {
+	return size / (max(elapsedMS, 0.001f) * 1000.0f);
+}
+
+static hc_result CompressBench_Write(struct Stream* s, const hc_uint8* data, hc_uint32 count, hc_uint32* modified) {
+	if (count > s->meta.mem.left) return ERR_END_OF_STREAM;
+
+	Mem_Copy(s->meta.mem.cur, data, count);
+	s->meta.mem.cur  += count;
+	s->meta.mem.left -= count;
+	*modified = count;
+	return 0;
+}
+
+/* Repeating 4 byte pattern, which only uses a single distance code when compressed */
+#define COMPRESS_BENCH_PATTERN_SIZE 65536
+
+struct CompressBench {
+	struct DeflateState* state;
+	struct InflateState* inflate;
+	hc_uint8* comp;
+	hc_uint8* decomp;
+	hc_uint32 compCapacity;
+};
+
+static hc_result CompressBench_Level(struct CompressBench* b, const hc_uint8* data, hc_uint32 size, int level, int runs) {
+	struct Stream compStream, memStream;
+	float ratio, deflateSpeed, inflateSpeed;
+	hc_uint32 compSize;
+	hc_uint64 beg;
+	hc_result res = 0;
+	int i;
+
+	beg = Stopwatch_Measure();
+	for (i = 0; i < runs && !res; i++) {
+		Stream_Init(&memStream);
+		memStream.Write = CompressBench_Write;
+		memStream.meta.mem.cur  = b->comp;
+		memStream.meta.mem.left = b->compCapacity;
+
+		Deflate_MakeStream(&compStream, b->state, &memStream);
+		Deflate_SetLevel(b->state, level);
+
+		res = Stream_Write(&compStream, data, size);
+		if (!res) res = compStream.Close(&compStream);
+	}
+	if (res) return res;
+
+	deflateSpeed = Bench_Speed(size, Bench_AverageMS(beg, runs));
+	compSize     = b->compCapacity - memStream.meta.mem.left;
+	ratio        = (float)size / max(compSize, 1);
+
+	beg = Stopwatch_Measure();
+	for (i = 0; i < runs && !res; i++) {
+		Stream_ReadonlyMemory(&memStream, b->comp, compSize);
+		Inflate_MakeStream2(&compStream, b->inflate, &memStream);
+		res = Stream_Read(&compStream, b->decomp, size);
+	}
+
+	if (res) {
+		Chat_Add1("&eLevel %i: &cCompressed data could not be decompressed", &level);
+		return 0;
+	}
+	inflateSpeed = Bench_Speed(size, Bench_AverageMS(beg, runs));
+
+	if (!Mem_Equal(b->decomp, data, size)) {
+		Chat_Add1("&eLevel %i: &cDecompressed data does not match", &level);
+	} else {
+		Chat_Add4("&eLevel %i: ratio &f%f2&e, deflate &f%f1 &eMB/s, inflate &f%f1 &eMB/s", 
+				&level, &ratio, &deflateSpeed, &inflateSpeed);
+	}
+	return 0;
+}
+
+static void CompressBench_Levels(struct CompressBench* b, const hc_uint8* data, hc_uint32 size, int runs) {
+	hc_result res;
+	int level;
+
+	for (level = DEFLATE_LEVEL_FAST; level <= DEFLATE_LEVEL_BEST; level++) {
+		res = CompressBench_Level(b, data, size, level, runs);
+		if (res) { Logger_SysWarn(res, "benchmarking compression"); return; }
+	}
+}
+
+static void CompressBench_Run(int runs) {
+	struct CompressBench b;
+	hc_uint8* pattern;
+	hc_uint32 size;
+	int i;
+
+	if (!World.Loaded) {
+		Chat_AddRaw("&e/client: &cThere is no map loaded to compress."); return;
+	}
+	/* Fixed huffman blocks may be slightly larger than the original data */
+	size = max((hc_uint32)World.Volume, COMPRESS_BENCH_PATTERN_SIZE);
+	b.compCapacity = size + size / 4 + 1024;
+
+	b.state   = (struct DeflateState*)Mem_TryAlloc(1, sizeof(struct DeflateState));
+	b.inflate = (struct InflateState*)Mem_TryAlloc(1, sizeof(struct InflateState));
+	b.comp    = (hc_uint8*)Mem_TryAlloc(b.compCapacity, 1);
+	b.decomp  = (hc_uint8*)Mem_TryAlloc(size, 1);
+	pattern   = (hc_uint8*)Mem_TryAlloc(COMPRESS_BENCH_PATTERN_SIZE, 1);
+
+	if (b.state && b.inflate && b.comp && b.decomp && pattern) {
+		Chat_Add1("&eCompressing &f%i &ebytes of block data:", &World.Volume);
+		CompressBench_Levels(&b, World.Blocks, World.Volume, runs);
+
+		for (i = 0; i < COMPRESS_BENCH_PATTERN_SIZE; i++) pattern[i] = (hc_uint8)(i & 3);
+		Chat_AddRaw("&eCompressing repeating 4 byte pattern:");
+		CompressBench_Levels(&b, pattern, COMPRESS_BENCH_PATTERN_SIZE, runs);
+	} else {
+		Chat_AddRaw("&e/client: &cOut of memory.");
+	}
+
+	Mem_Free(b.state);
+	Mem_Free(b.inflate);
+	Mem_Free(b.comp);
+	Mem_Free(b.decomp);
+	Mem_Free(pattern);
+}
+
+struct InflateBench {
+	struct InflateState* state;
+	hc_uint8* buffer;
+	int runs, files;
+	hc_uint32 totalSize;
+	float totalMS;
+};
+#define INFLATE_BENCH_BUFFER_SIZE 65536
+
+/* Decompresses the given gzip'd data once, returning the number of decompressed bytes in size */
+static hc_result InflateBench_Decompress(struct InflateBench* b, hc_uint8* data, hc_uint32 len, hc_uint32* size) {
+	struct Stream memStream, compStream;
+	struct GZipHeader gzHeader;
+	hc_uint32 read;
+	hc_result res;
+
+	Stream_ReadonlyMemory(&memStream, data, len);
+	GZipHeader_Init(&gzHeader);
+	while (!gzHeader.done) {
+		if ((res = GZipHeader_Read(&memStream, &gzHeader))) return res;
+	}
+
+	Inflate_MakeStream2(&compStream, b->state, &memStream);
+	for (*size = 0;; *size += read) {
+		res = compStream.Read(&compStream, b->buffer, INFLATE_BENCH_BUFFER_SIZE, &read);
+		if (res || !read) return res;
+	}
+}
+
+static hc_result InflateBench_ReadAll(const hc_string* path, hc_uint8** data, hc_uint32* len) {
+	struct Stream stream;
+	hc_result res, closeRes;
+
+	*data = NULL;
+	if ((res = Stream_OpenFile(&stream, path))) return res;
+
+	if (!(res = stream.Length(&stream, len))) {
+		*data = (hc_uint8*)Mem_TryAlloc(max(*len, 1), 1);
+		res   = *data ? Stream_Read(&stream, *data, *len) : ERR_OUT_OF_MEMORY;
+	}
+
+	closeRes = stream.Close(&stream);
+	return res ? res : closeRes;
+}
+
+static void InflateBench_Measure(const hc_string* path, void* obj, int isDirectory) {
+	static const hc_string cw = String_FromConst(".cw");
+	struct InflateBench* b = (struct InflateBench*)obj;
+	hc_uint8* data;
+	hc_uint32 len, size = 0;
+	float elapsedMS, speed;
+	hc_uint64 beg;
+	hc_result res;
+	int i;
+
+	if (isDirectory) {
+		Directory_Enum(path, obj, InflateBench_Measure); return;
+	}
+	if (!String_CaselessEnds(path, &cw)) return;
+
+	/* Read the whole file into memory first, so disk speed isn't measured */
+	res = InflateBench_ReadAll(path, &data, &len);
+	if (res) {
+		Logger_SysWarn2(res, "reading", path); Mem_Free(data); return;
+	}
+
+	beg = Stopwatch_Measure();
+	for (i = 0; i < b->runs && !res; i++) {
+		res = InflateBench_Decompress(b, data, len, &size);
+	}
+	elapsedMS = Bench_AverageMS(beg, b->runs);
+	Mem_Free(data);
+
+	if (res) {
+		Logger_SysWarn2(res, "decompressing", path); return;
+	}
+	speed = Bench_Speed(size, elapsedMS);
+	Chat_Add4("&e%s: &f%i &ebytes in &f%f2 &ems, &f%f1 &eMB/s", path, &size, &elapsedMS, &speed);
+
+	b->totalSize += size;
+	b->totalMS   += elapsedMS;
+	b->files++;
+}
+
+static void InflateBench_Run(int runs) {
+	static const hc_string maps = String_FromConst("maps");
+	struct InflateBench b = { 0 };
+	float speed;
+
+	b.runs   = runs;
+	b.state  = (struct InflateState*)Mem_TryAlloc(1, sizeof(struct InflateState));
+	b.buffer = (hc_uint8*)Mem_TryAlloc(INFLATE_BENCH_BUFFER_SIZE, 1);
+
+	if (b.state && b.buffer) {
+		Directory_Enum(&maps, &b, InflateBench_Measure);
+
+		if (!b.files) {
+			Chat_AddRaw("&e/client: &cNo .cw map files found in maps folder.");
+		} else {
+			speed = Bench_Speed(b.totalSize, b.totalMS);
+			Chat_Add3("&eTotal: &f%f1 &eMB/s over &f%i &emaps (&f%f2 &ems)", &speed, &b.files, &b.totalMS);
+		}
+	} else {
+		Chat_AddRaw("&e/client: &cOut of memory.");
+	}
+
+	Mem_Free(b.state);
+	Mem_Free(b.buffer);
+}
+
+struct LoadBench { int runs, files; float totalMS; };
+
+static void LoadBench_Measure(const hc_string* path, void* obj, int isDirectory) {
+	static const hc_string cw = String_FromConst(".cw");
+	struct LoadBench* b = (struct LoadBench*)obj;
+	float elapsedMS;
+	hc_uint64 beg;
+	hc_result res = 0;
+	int i;
+
+	if (isDirectory) {
+		Directory_Enum(path, obj, LoadBench_Measure); return;
+	}
+	if (!String_CaselessEnds(path, &cw)) return;
+
+	beg = Stopwatch_Measure();
+	for (i = 0; i < b->runs && !res; i++) {
+		res = Map_DecodeNbt(path);
+	}
+
+	if (res) {
+		Logger_SysWarn2(res, "decoding", path); return;
+	}
+	elapsedMS = Bench_AverageMS(beg, b->runs);
+	Chat_Add2("&e%s: &f%f2 &ems", path, &elapsedMS);
+
+	b->totalMS += elapsedMS;
+	b->files++;
+}
+
+static void LoadBench_Run(int runs) {
+	static const hc_string maps = String_FromConst("maps");
+	struct LoadBench b = { 0 };
+	b.runs = runs;
+
+	Directory_Enum(&maps, &b, LoadBench_Measure);
+	if (!b.files) {
+		Chat_AddRaw("&e/client: &cNo .cw map files found in maps folder."); return;
+	}
+	Chat_Add2("&eTotal: &f%f2 &ems for &f%i &emaps", &b.totalMS, &b.files);
+}
+
+static void LightBench_LightAll(void) {
+	int cx, cy, cz;
+
+	for (cy = 0; cy < World.ChunksY; cy++) {
+		for (cz = 0; cz < World.ChunksZ; cz++) {
+			for (cx = 0; cx < World.ChunksX; cx++) {
+				Lighting.LightHint((cx << CHUNK_SHIFT) - 1, (cy << CHUNK_SHIFT) - 1, (cz << CHUNK_SHIFT) - 1);
+			}
+		}
+	}
+}
+
+static void LightBench_Run(int runs) {
+	int i, sources = 0;
+	float elapsedMS;
+	hc_uint64 beg;
+
+	if (!World.Loaded) {
+		Chat_AddRaw("&e/client: &cNo map is loaded."); return;
+	}
+
+	for (i = 0; i < World.Volume; i++) {
+		if (Blocks.Brightness[World_GetRawBlock(i)]) sources++;
+	}
+
+	beg = Stopwatch_Measure();
+	for (i = 0; i < runs; i++) {
+		Lighting.Refresh();
+		/* Lighting might still be being calculated in the background */
+		Lighting.WaitPending();
+		LightBench_LightAll();
+	}
+	elapsedMS = Bench_AverageMS(beg, runs);
+
+	Chat_Add3("&eRelit map with &f%i &elight sources: &f%f2 &ems per run over &f%i &eruns",
+			&sources, &elapsedMS, &runs);
+	MapRenderer_Refresh();
+}
+
+/* Maps are always generated with the same size and seed, so results can be compared between builds */
+#define GEN_BENCH_WIDTH  512
+#define GEN_BENCH_HEIGHT 64
+#define GEN_BENCH_LENGTH 512
+#define GEN_BENCH_SEED   12345
+#define GEN_BENCH_CONFIGS 3
+
+struct GenBench {
+	float stageMS[GEN_BENCH_CONFIGS][GEN_MAX_STAGES];
+	float totalMS[GEN_BENCH_CONFIGS];
+	BlockRaw* reference;
+	hc_bool mismatch;
+};
+
+/* Generates the map the given number of runs, returning false if out of memory */
+static hc_bool GenBench_Measure(struct GenBench* b, int config, int threads, hc_bool simd, int runs) {
+	BlockRaw* blocks;
+	int i, run;
+
+	for (run = 0; run < runs; run++) {
+		blocks = Gen_GenerateNow(&NotchyGen, threads, simd);
+		if (!blocks) return false;
+
+		for (i = 0; i < Gen_StagesCount; i++) {
+			b->stageMS[config][i] += Gen_StageMicros[i] / 1000.0f / runs;
+			b->totalMS[config]    += Gen_StageMicros[i] / 1000.0f / runs;
+		}
+
+		/* Every config must generate exactly the same map */
+		if (!b->reference) {
+			b->reference = blocks; continue;
+		}
+		if (!Mem_Equal(blocks, b->reference, World.Volume)) b->mismatch = true;
+		Mem_Free(blocks);
+	}
+	return true;
+}
+
+static void GenBench_Print(struct GenBench* b, int threads) {
+	float* ms;
+	int i;
+
+	Chat_Add4("&eGenerated %ix%ix%i map, in ms for scalar / SIMD / SIMD with &f%i &eextra threads:",
+			&World.Width, &World.Height, &World.Length, &threads);
+	for (i = 0; i < Gen_StagesCount; i++) {
+		Chat_Add4("&e%c: &f%f2 &e/ &f%f2 &e/ &f%f2", Gen_StageNames[i],
+				&b->stageMS[0][i], &b->stageMS[1][i], &b->stageMS[2][i]);
+	}
+
+	ms = b->totalMS;
+	Chat_Add3("&eTotal: &f%f2 &e/ &f%f2 &e/ &f%f2", &ms[0], &ms[1], &ms[2]);
+	if (b->mismatch) Chat_AddRaw("&cGenerated maps were not identical across configurations");
+}
+
+static void GenBench_Run(int runs) {
+	struct GenBench b = { 0 };
+	struct _WorldData saved;
+	int threads, seed;
+	hc_bool success;
+
+	if (Gen_Blocks || Map_IsLoading()) {
+		Chat_AddRaw("&e/client: &cCannot benchmark while a map is being generated or loaded."); return;
+	}
+	threads = Options_GetInt(OPT_GEN_THREADS, 0, 32, 0);
+	if (!threads) threads = 3;
+
+	/* World's dimensions are temporarily changed to the benchmark map's, */
+	/*  so make sure nothing is still reading the current map in the background */
+	Map_WaitForSave();
+	Builder_CancelJobs();
+	Lighting.WaitPending();
+
+	saved   = World;
+	seed    = Gen_Seed;
+	Gen_Seed = GEN_BENCH_SEED;
+	World_SetDimensions(GEN_BENCH_WIDTH, GEN_BENCH_HEIGHT, GEN_BENCH_LENGTH);
+
+	success = GenBench_Measure(&b, 0, 0,       false, runs)
+		&& GenBench_Measure(&b, 1, 0,       true,  runs)
+		&& GenBench_Measure(&b, 2, threads, true,  runs);
+
+	if (success) GenBench_Print(&b, threads);
+	else Chat_AddRaw("&e/client: &cOut of memory.");
+
+	World    = saved;
+	Gen_Seed = seed;
+	Mem_Free(b.reference);
+	MapRenderer_Refresh();
+}
+
+/* Adds a hook called every frame, returning its index or -1 if already added or no free slots are left */
+static int Bench_AddDrawHook(Game_Draw2DHook hook) {
+	int i;
+	for (i = 0; i < Array_Elems(Game.Draw2DHooks); i++)
+	{
+		if (Game.Draw2DHooks[i] == hook) return -1;
+	}
+
+	for (i = 0; i < Array_Elems(Game.Draw2DHooks); i++)
+	{
+		if (Game.Draw2DHooks[i]) continue;
+		Game.Draw2DHooks[i] = hook; return i;
+	}
+	return -1;
+}
+
+static int renderBench_frame, renderBench_frames;
+static int renderBench_hook, renderBench_fpsLimit;
+static hc_uint64 renderBench_beg;
+
+static void RenderBench_Finish(void) {
+	float frameMS = Bench_AverageMS(renderBench_beg, renderBench_frames);
+	float fps     = 1000.0f / max(frameMS, 0.001f);
+
+	Chat_Add3("&eRendered &f%i &eframes: &f%f2 &ems per frame, &f%f1 &eFPS", 
+			&renderBench_frames, &frameMS, &fps);
+	Game.Draw2DHooks[renderBench_hook] = NULL;
+	Game_SetFpsLimit(renderBench_fpsLimit);
+}
+
+/* Called once every frame, turns the camera a bit further around for the next frame */
+static void RenderBench_Frame(float delta) {
+	struct Entity* e = &Entities.CurPlayer->Base;
+	struct LocationUpdate update;
+
+	if (renderBench_frame == 0) renderBench_beg = Stopwatch_Measure();
+	if (renderBench_frame == renderBench_frames) { RenderBench_Finish(); return; }
+
+	update.flags = LU_HAS_YAW | LU_HAS_PITCH;
+	update.yaw   = 360.0f * renderBench_frame / renderBench_frames;
+	update.pitch = 0.0f;
+	e->VTABLE->SetLocation(e, &update);
+	renderBench_frame++;
+}
+
+static void RenderBench_Run(int runs) {
+	int hook = Bench_AddDrawHook(RenderBench_Frame);
+	if (hook == -1) {
+		Chat_AddRaw("&e/client: &cUnable to start render benchmark."); return;
+	}
+
+	renderBench_hook     = hook;
+	renderBench_frame    = 0;
+	renderBench_frames   = runs;
+	renderBench_fpsLimit = Game_FpsLimit;
+
+	/* Benchmark should measure how fast frames are rendered, not the FPS limit */
+	Game_SetFpsLimit(FPS_LIMIT_NONE);
+}
+
+/* Physics is benchmarked on a map this large, so water is placed at indices above 2^27 */
+#define PHYSICS_BENCH_WIDTH   2048
+#define PHYSICS_BENCH_HEIGHT  256
+#define PHYSICS_BENCH_LENGTH  2048
+#define PHYSICS_BENCH_SPACING 64
+/* How long after the warning the benchmark must be started again to confirm replacing the map */
+#define PHYSICS_BENCH_CONFIRM_MS 30000
+
+static int physicsBench_hook, physicsBench_ticks;
+static hc_uint64 physicsBench_warned;
+
+static hc_bool PhysicsBench_CanRun(void) {
+	if (!Server.IsSinglePlayer) {
+		Chat_AddRaw("&e/client: &cPhysics can only be benchmarked in singleplayer."); return false;
+	}
+	if (!Physics.Enabled) {
+		Chat_AddRaw("&e/client: &cBlock physics is disabled."); return false;
+	}
+	if (!Physics.OnPlace[BLOCK_WATER]) {
+		Chat_AddRaw("&e/client: &cWater does not have any physics."); return false;
+	}
+	return true;
+}
+
+static void PhysicsBench_Measure(void) {
+	int i, x, z, ticks = physicsBench_ticks;
+	int sources = 0, flowed = 0;
+	float tickMS, tps;
+	hc_uint64 beg;
+
+	/* Flood water down from points spread out across the top of the map */
+	for (z = PHYSICS_BENCH_SPACING / 2; z < World.Length; z += PHYSICS_BENCH_SPACING) {
+		for (x = PHYSICS_BENCH_SPACING / 2; x < World.Width; x += PHYSICS_BENCH_SPACING) {
+			Game_UpdateBlock(x, World.MaxY, z, BLOCK_WATER);
+			Physics.OnPlace[BLOCK_WATER](World_Pack(x, World.MaxY, z), BLOCK_WATER);
+			sources++;
+		}
+	}
+
+	beg = Stopwatch_Measure();
+	for (i = 0; i < ticks; i++) {
+		Physics_Tick();
+	}
+	tickMS = Bench_AverageMS(beg, ticks);
+	tps    = 1000.0f / max(tickMS, 0.001f);
+
+	Chat_Add3("&eRan &f%i &ephysics ticks with &f%i &ewater sources: &f%f2 &ems per tick",
+			&ticks, &sources, &tickMS);
+	Chat_Add1("&e  (&f%f1 &eticks per second, &f20 &eare needed to keep up)", &tps);
+
+	/* Every source is at the same height, so either all or none should have flowed down */
+	for (z = PHYSICS_BENCH_SPACING / 2; z < World.Length; z += PHYSICS_BENCH_SPACING) {
+		for (x = PHYSICS_BENCH_SPACING / 2; x < World.Width; x += PHYSICS_BENCH_SPACING) {
+			if (World_GetBlock(x, World.MaxY - 1, z) == BLOCK_WATER) flowed++;
+		}
+	}
+
+	if (flowed && flowed != sources) {
+		Chat_Add2("&cOnly %i of %i water sources flowed down", &flowed, &sources);
+	} else {
+		Chat_Add2("&f%i &eof &f%i &ewater sources flowed down", &flowed, &sources);
+	}
+}
+
+/* Called once every frame, waits until the benchmark map has been generated */
+static void PhysicsBench_Frame(float delta) {
+	if (Gen_Blocks) return;
+	Game.Draw2DHooks[physicsBench_hook] = NULL;
+
+	if (!World.Blocks) {
+		Chat_AddRaw("&e/client: &cFailed to generate the benchmark map."); return;
+	}
+	if (PhysicsBench_CanRun()) PhysicsBench_Measure();
+}
+
+static void PhysicsBench_Run(int runs) {
+	hc_uint64 now = Stopwatch_Measure();
+	int hook;
+
+	if (!PhysicsBench_CanRun()) return;
+	if (Gen_Blocks || Map_IsLoading()) {
+		Chat_AddRaw("&e/client: &cCannot benchmark while a map is being generated or loaded."); return;
+	}
+
+	/* Replacing the map loses any unsaved changes, so require confirmation */
+	if (!physicsBench_warned || Stopwatch_ElapsedMS(physicsBench_warned, now) > PHYSICS_BENCH_CONFIRM_MS) {
+		physicsBench_warned = now;
+		Chat_AddRaw("&eThis replaces the current map with a flat 2048x256x2048 map,");
+		Chat_AddRaw("&e  losing any unsaved changes. Run the same command again within");
+		Chat_AddRaw("&e  30 seconds to confirm.");
+		return;
+	}
+	physicsBench_warned = 0;
+
+	hook = Bench_AddDrawHook(PhysicsBench_Frame);
+	if (hook == -1) {
+		Chat_AddRaw("&e/client: &cUnable to start physics benchmark."); return;
+	}
+	physicsBench_hook  = hook;
+	physicsBench_ticks = runs;
+
+	World_NewMap();
+	World_SetDimensions(PHYSICS_BENCH_WIDTH, PHYSICS_BENCH_HEIGHT, PHYSICS_BENCH_LENGTH);
+	Gen_Active = &FlatgrassGen;
+	Gen_Start();
+	GeneratingScreen_Show();
+}
+
+static const struct BenchType {
+	const char* name;
+	void (*Run)(int runs);
+	int defaultRuns;
+	const char* desc;
+} benchTypes[] = {
+	{ "compress", CompressBench_Run, 1, "Deflates then inflates the map's blocks at each level" },
+	{ "inflate",  InflateBench_Run,  5, "Decompresses each .cw map file in the maps folder" },
+	{ "render",   RenderBench_Run, 360, "Turns the camera one full circle over the given number of frames" },
+	{ "load",     LoadBench_Run,     1, "Reads and decodes each .cw map file in the maps folder" },
+	{ "light",    LightBench_Run,    3, "Recalculates lighting for the entire current map" },
+	{ "gen",      GenBench_Run,      3, "Generates a fixed map, with scalar noise, SIMD noise and threads" },
+	{ "physics",  PhysicsBench_Run, 100, "Replaces the map with a large flat map, then floods water on it" }
+};
+
+static void BenchCommand_PrintTypes(void) {
+	int i;
+	Chat_AddRaw("&eBenchmarks (default number of runs in brackets):");
+
+	for (i = 0; i < Array_Elems(benchTypes); i++)
+	{
+		Chat_Add3("&a%c &f(%i)&e: %c", benchTypes[i].name, &benchTypes[i].defaultRuns, benchTypes[i].desc);
+	}
+}
+
+static void BenchCommand_Execute(const hc_string* args, int argsCount) {
+	const struct BenchType* bench = NULL;
+	int i, runs;
+
+	if (!argsCount) { BenchCommand_PrintTypes(); return; }
+	for (i = 0; i < Array_Elems(benchTypes); i++)
+	{
+		if (String_CaselessEqualsConst(&args[0], benchTypes[i].name)) bench = &benchTypes[i];
+	}
+	if (!bench) {
+		Chat_Add1("&e/client: &cUnrecognised benchmark &f\"%s\"&c.", &args[0]); return;
+	}
+
+	runs = bench->defaultRuns;
+	if (argsCount > 1 && !Convert_ParseInt(&args[1], &runs)) {
+		Chat_AddRaw("&e/client: &cNumber of runs must be an integer."); return;
+	}
+	if (runs <= 0) {
+		Chat_AddRaw("&e/client: &cNumber of runs must be above 0."); return;
+	}
+	bench->Run(runs);
+}
+
+static struct ChatCommand BenchCommand = {
+	"Bench", BenchCommand_Execute,
+	0,
+	{
+		"&a/client bench [type] [runs]",
+		"&eMeasures how long part of the game takes, averaged over",
+		"&e  the given number of runs.",
+		"&eType &a/client bench &ewithout any arguments to list the types.",
+		"&eNote that the game freezes while most benchmarks run.",
+	}
+};
+
+
 /*########################################################################################################################*
 *------------------------------------------------------Commands component-------------------------------------------------*
 *#########################################################################################################################*/
@@ -809,6 +1461,7 @@ static void OnInit(void) {
 	Commands_Register(&BlockEditCommand);
 	Commands_Register(&CuboidCommand);
 	Commands_Register(&ReplaceCommand);
+	Commands_Register(&BenchCommand);
 }
 
 static void OnFree(void) {
@@ -28,6 +28,7 @@ Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 	#define HC_INLINE   inline
 	#define HC_NOINLINE __declspec(noinline)
 #endif
+	#define HC_THREADLOCAL __declspec(thread)
 
 	#ifndef HC_API
 	#define HC_API __declspec(dllexport, noinline)
@@ -65,6 +66,7 @@ Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 	
 	#define HC_INLINE inline
 	#define HC_NOINLINE __attribute__((noinline))
+	#define HC_THREADLOCAL __thread
 	
 	#ifndef HC_API
 	#ifdef _WIN32
@@ -505,6 +507,24 @@ typedef hc_uint8  hc_bool;
 #ifdef HC_BUILD_NETWORKING
 #define CUSTOM_MODELS
 #endif
+/* Chunk meshes can only be built on worker threads with real threads and thread local storage */
+#if defined HC_THREADLOCAL && !defined HC_BUILD_COOPTHREADED && !defined HC_BUILD_CONSOLE && !defined HC_BUILD_GL11
+#define HC_BUILD_THREADEDBUILDER
+#endif
+/* Map files can only be memory mapped on platforms with mmap */
+#if defined HC_BUILD_POSIX && !defined HC_BUILD_OS2 && defined HC_BUILD_FILESYSTEM
+#define HC_BUILD_FILEMAP
+#endif
+/* Terrain meshes can only use the compact vertex format on backends whose shaders decode it */
+/* Those backends can also draw terrain meshes from ranges of shared vertex buffers */
+#if HC_GFX_BACKEND == HC_GFX_BACKEND_GL2
+#define HC_BUILD_TERRAINVERTICES
+#define HC_BUILD_TERRAINPOOL
+#endif
+/* Entity model parts can only be drawn with instancing on backends whose shaders support it */
+#if HC_GFX_BACKEND == HC_GFX_BACKEND_GL2
+#define HC_BUILD_MODELINSTANCING
+#endif
 #ifndef HC_BUILD_LOWMEM
 #define EXTENDED_BLOCKS
 #endif
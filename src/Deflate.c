@@ -8,6 +8,18 @@
 #include "Utils.h"
 
 #define Header_ReadU8(value) if ((res = s->ReadU8(s, &value))) return res;
+
+/* 64 bit platforms where unaligned little endian 8 byte loads/stores are fast */
+#if defined __GNUC__ && (defined __x86_64__ || defined __aarch64__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	#define Deflate_Load64(dst, src)  __builtin_memcpy(&(dst), (src), 8)
+	#define Deflate_Store64(dst, src) __builtin_memcpy((dst), &(src), 8)
+	#define Deflate_Ctz64(value)      __builtin_ctzll(value)
+#elif defined _MSC_VER && (defined _M_X64 || defined _M_ARM64)
+	#include <intrin.h>
+	#define Deflate_Load64(dst, src)  dst = *(const __unaligned hc_uint64*)(src)
+	#define Deflate_Store64(dst, src) *(__unaligned hc_uint64*)(dst) = src
+	static int Deflate_Ctz64(hc_uint64 value) { unsigned long bit; _BitScanForward64(&bit, value); return (int)bit; }
+#endif
 /*########################################################################################################################*
 *-------------------------------------------------------GZip header-------------------------------------------------------*
 *#########################################################################################################################*/
@@ -306,46 +318,6 @@ static int Huffman_Decode(struct InflateState* state, struct HuffmanTable* table
 	return -1;
 }
 
-/* Inline the common <= 9 bits case */
-#define Huffman_UNSAFE_Decode(state, table, result) \
-{\
-	Inflate_UNSAFE_EnsureBits(state, INFLATE_MAX_BITS);\
-	packed = table.fast[Inflate_PeekBits(state, INFLATE_FAST_BITS)];\
-	if (packed >= 0) {\
-		consumedBits = packed >> INFLATE_FAST_BITS;\
-		Inflate_ConsumeBits(state, consumedBits);\
-		result = packed & 0x1FF;\
-	} else {\
-		result = Huffman_UNSAFE_Decode_Slow(state, &table);\
-	}\
-}
-
-static int Huffman_UNSAFE_Decode_Slow(struct InflateState* state, struct HuffmanTable* table) {
-	hc_uint32 i, j, codeword;
-	int offset;
-
-	/* Slow, bit by bit lookup. Need to reverse order for huffman. */
-	codeword = Inflate_PeekBits(state,       INFLATE_FAST_BITS);
-	codeword = Huffman_ReverseBits(codeword, INFLATE_FAST_BITS);
-
-	for (i = INFLATE_FAST_BITS + 1, j = INFLATE_FAST_BITS; i < INFLATE_MAX_BITS; i++, j++) {
-		codeword = (codeword << 1) | ((state->Bits >> j) & 1);
-
-		if (codeword < table->endCodewords[i]) {
-			offset = table->firstOffsets[i] + (codeword - table->firstCodewords[i]);
-			Inflate_ConsumeBits(state, i);
-			return table->values[offset];
-		}
-	}
-
-	Inflate_Fail(state, INF_ERR_INVALID_CODE);
-	/* Need to exit the fast decode loop */
-	/* TODO: This means a few garbage bytes can get written */
-	/* to the output, but it probably doesn't matter */
-	state->AvailIn = 0;
-	return 0;
-}
-
 void Inflate_Init2(struct InflateState* state, struct Stream* source) {
 	state->State = INFLATE_STATE_HEADER;
 	state->LastBlock = false;
@@ -399,12 +371,99 @@ static const hc_uint8 codelens_order[INFLATE_MAX_CODELENS] = {
 	16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 
 };
 
+/* Decodes a codeword longer than INFLATE_FAST_BITS, from the next 15 bits of input */
+/* Returns length of the codeword in bits, or 0 if the codeword is invalid */
+static int Huffman_DecodeLong(struct HuffmanTable* table, hc_uint32 input, int* value) {
+	hc_uint32 i, j, codeword;
+	int offset;
+
+	/* Slow, bit by bit lookup. Need to reverse order for huffman. */
+	codeword = input & ((1UL << INFLATE_FAST_BITS) - 1);
+	codeword = Huffman_ReverseBits(codeword, INFLATE_FAST_BITS);
+
+	for (i = INFLATE_FAST_BITS + 1, j = INFLATE_FAST_BITS; i < INFLATE_MAX_BITS; i++, j++) {
+		codeword = (codeword << 1) | ((input >> j) & 1);
+
+		if (codeword < table->endCodewords[i]) {
+			offset = table->firstOffsets[i] + (codeword - table->firstCodewords[i]);
+			*value = table->values[offset];
+			return i;
+		}
+	}
+	return 0;
+}
+
+/* Builds lookup table for decoding up to 3 short literal codewords at once */
+static void Inflate_BuildMultiLits(struct InflateState* s) {
+	struct HuffmanTable* table = &s->Table.Lits;
+	hc_uint32 i, entry, bits, count;
+	int packed, len;
+
+	for (i = 0; i < (1 << INFLATE_MULTI_BITS); i++) {
+		entry = 0; bits = 0;
+
+		for (count = 0; count < 3; count++) {
+			/* NOTE: Unknown higher bits are zero, but that doesn't matter as long */
+			/*  as the codeword found fits entirely within the known lower bits */
+			packed = table->fast[(i >> bits) & ((1 << INFLATE_FAST_BITS) - 1)];
+			if (packed < 0) break;
+
+			len = packed >> INFLATE_FAST_LEN_SHIFT;
+			if ((packed & INFLATE_FAST_VAL_MASK) >= 256 || bits + len > INFLATE_MULTI_BITS) break;
+
+			entry |= (hc_uint32)(packed & 0xFF) << (count * 8);
+			bits  += len;
+		}
+		s->MultiLits[i] = count ? (entry | (bits << 24) | (count << 28)) : 0;
+	}
+}
+
+#ifdef Deflate_Load64
+typedef hc_uint64 inflate_bitbuf;
+/* Refills bit buffer to at least 56 bits, using a single unaligned 8 byte load */
+/* https://fgiesen.wordpress.com/2018/02/20/reading-bits-in-far-too-many-ways-part-2/ */
+#define Fast_Refill() Deflate_Load64(tmp, in); bitBuf |= tmp << numBits; in += (63 - numBits) >> 3; numBits |= 56;
+/* Refilled bit buffer always has enough bits for a length and distance pair */
+#define Fast_EnsureBits(bitsCount)
+#define Fast_Copy8(dst, src) Deflate_Load64(tmp, src); Deflate_Store64(dst, tmp);
+#else
+typedef hc_uint32 inflate_bitbuf;
+#define Fast_Refill()
+#define Fast_EnsureBits(bitsCount) while (numBits < (bitsCount)) { bitBuf |= (hc_uint32)(*in++) << numBits; numBits += 8; }
+#define Fast_Copy8(dst, src) (dst)[0] = (src)[0]; (dst)[1] = (src)[1]; (dst)[2] = (src)[2]; (dst)[3] = (src)[3]; \
+							(dst)[4] = (src)[4]; (dst)[5] = (src)[5]; (dst)[6] = (src)[6]; (dst)[7] = (src)[7];
+#endif
+#define Fast_PeekBits(bitsCount) ((hc_uint32)bitBuf & ((1UL << (bitsCount)) - 1UL))
+#define Fast_ConsumeBits(bitsCount) bitBuf >>= (bitsCount); numBits -= (bitsCount);
+
+/* Decodes the next huffman codeword, using fast table lookup for the common <= 9 bits case */
+#define Fast_Decode(table, result) \
+	packed = table.fast[Fast_PeekBits(INFLATE_FAST_BITS)];\
+	if (packed >= 0) {\
+		consumedBits = packed >> INFLATE_FAST_LEN_SHIFT;\
+		result = packed & INFLATE_FAST_VAL_MASK;\
+	} else {\
+		consumedBits = Huffman_DecodeLong(&table, Fast_PeekBits(INFLATE_MAX_BITS - 1), &packed);\
+		if (!consumedBits) { Inflate_Fail(s, INF_ERR_INVALID_CODE); break; }\
+		result = packed;\
+	}\
+	Fast_ConsumeBits(consumedBits);
+
 static void Inflate_InflateFast(struct InflateState* s) {
 	/* huffman variables */
-	hc_uint32 lit, len, dist;
+	hc_uint32 lit, len, dist, multi, count;
 	hc_uint32 bits, lenIdx, distIdx;
 	int packed, consumedBits;
 
+	/* bit buffer variables */
+	inflate_bitbuf bitBuf;
+	hc_uint32 numBits, unread;
+	hc_uint8* in;
+	hc_uint8* inEnd;
+#ifdef Deflate_Load64
+	hc_uint64 tmp;
+#endif
+
 	/* window variables */
 	hc_uint8* window;
 	hc_uint32 i, curIdx, startIdx;
@@ -415,9 +474,30 @@ static void Inflate_InflateFast(struct InflateState* s) {
 	copyStart = s->WindowIndex;
 	copyLen   = 0;
 
+	bitBuf  = s->Bits;
+	numBits = s->NumBits;
+	in      = s->NextIn;
+	inEnd   = s->NextIn + s->AvailIn;
+
 #define INFLATE_FAST_COPY_MAX (INFLATE_WINDOW_SIZE - INFLATE_FASTINF_OUT)
-	while (s->AvailOut >= INFLATE_FASTINF_OUT && s->AvailIn >= INFLATE_FASTINF_IN && copyLen < INFLATE_FAST_COPY_MAX) {
-		Huffman_UNSAFE_Decode(s, s->Table.Lits, lit);
+	while (s->AvailOut >= INFLATE_FASTINF_OUT && (inEnd - in) >= INFLATE_FASTINF_IN && copyLen < INFLATE_FAST_COPY_MAX) {
+		Fast_Refill();
+		Fast_EnsureBits(INFLATE_MAX_BITS);
+
+		/* Short literal codewords can often be decoded several at once */
+		multi = s->MultiLits[Fast_PeekBits(INFLATE_MULTI_BITS)];
+		if (multi) {
+			count = multi >> 28;
+			Fast_ConsumeBits((multi >> 24) & 0x0F);
+
+			for (i = 0; i < count; i++, multi >>= 8) {
+				window[curIdx] = (hc_uint8)multi;
+				curIdx = (curIdx + 1) & INFLATE_WINDOW_MASK;
+			}
+			s->AvailOut -= count; copyLen += count;
+			continue;
+		}
+		Fast_Decode(s->Table.Lits, lit);
 
 		if (lit <= 256) {
 			if (lit < 256) {
@@ -431,13 +511,16 @@ static void Inflate_InflateFast(struct InflateState* s) {
 		} else {
 			lenIdx = lit - 257;
 			bits = len_bits[lenIdx];
-			Inflate_UNSAFE_EnsureBits(s, bits);
-			len  = len_base[lenIdx] + Inflate_ReadBits(s, bits);
+			Fast_EnsureBits(bits);
+			len  = len_base[lenIdx] + Fast_PeekBits(bits);
+			Fast_ConsumeBits(bits);
 
-			Huffman_UNSAFE_Decode(s, s->TableDists, distIdx);
+			Fast_EnsureBits(INFLATE_MAX_BITS);
+			Fast_Decode(s->TableDists, distIdx);
 			bits = dist_bits[distIdx];
-			Inflate_UNSAFE_EnsureBits(s, bits);
-			dist = dist_base[distIdx] + Inflate_ReadBits(s, bits);
+			Fast_EnsureBits(bits);
+			dist = dist_base[distIdx] + Fast_PeekBits(bits);
+			Fast_ConsumeBits(bits);
 	
 			/* Window infinitely repeats like ...xyz|uvwxyz|uvwxyz|uvw... */
 			/* If start and end don't cross a boundary, can avoid masking index */
@@ -446,10 +529,19 @@ static void Inflate_InflateFast(struct InflateState* s) {
 				hc_uint8* src = &window[startIdx]; 
 				hc_uint8* dst = &window[curIdx];
 
-				for (i = 0; i < (len & ~0x3); i += 4) {
-					*dst++ = *src++; *dst++ = *src++; *dst++ = *src++; *dst++ = *src++;
+				if (dist == 1) {
+					/* Run of the same byte (very common in map data) */
+					Mem_Set(dst, *src, len);
+				} else if (dist >= 8) {
+					/* Source and destination are far enough apart to copy 8 bytes at a time */
+					for (i = 0; i + 8 <= len; i += 8) { Fast_Copy8(dst + i, src + i); }
+					for (; i < len; i++) { dst[i] = src[i]; }
+				} else {
+					for (i = 0; i < (len & ~0x3); i += 4) {
+						*dst++ = *src++; *dst++ = *src++; *dst++ = *src++; *dst++ = *src++;
+					}
+					for (; i < len; i++) { *dst++ = *src++; }
 				}
-				for (; i < len; i++) { *dst++ = *src++; }
 			} else {
 				for (i = 0; i < len; i++) {
 					window[(curIdx + i) & INFLATE_WINDOW_MASK] = window[(startIdx + i) & INFLATE_WINDOW_MASK];
@@ -460,6 +552,17 @@ static void Inflate_InflateFast(struct InflateState* s) {
 		}
 	}
 
+	/* Return whole bytes that were buffered but not used back to the input */
+	/* (only bytes read by this function though, as earlier bytes may have been overwritten) */
+	unread   = min(numBits >> 3, (hc_uint32)(in - s->NextIn));
+	in      -= unread;
+	numBits -= unread * 8;
+
+	s->Bits    = (hc_uint32)(bitBuf & (((hc_uint64)1 << numBits) - 1));
+	s->NumBits = numBits;
+	s->AvailIn -= (hc_uint32)(in - s->NextIn);
+	s->NextIn   = in;
+
 	s->WindowIndex = curIdx;
 	if (!copyLen) return;
 
@@ -507,6 +610,7 @@ void Inflate_Process(struct InflateState* s) {
 			case 1: { /* Fixed/static huffman compressed */
 				(void)Huffman_Build(&s->Table.Lits, fixed_lits,  INFLATE_MAX_LITS);
 				(void)Huffman_Build(&s->TableDists, fixed_dists, INFLATE_MAX_DISTS);
+				Inflate_BuildMultiLits(s);
 				s->State = Inflate_NextCompressState(s);
 			} break;
 
@@ -619,6 +723,7 @@ void Inflate_Process(struct InflateState* s) {
 				if (res) { Inflate_Fail(s, res); return; }
 				res = Huffman_Build(&s->TableDists, s->Buffer + s->NumLits, s->NumDists);
 				if (res) { Inflate_Fail(s, res); return; }
+				Inflate_BuildMultiLits(s);
 			}
 			break;
 		}
@@ -805,7 +910,7 @@ static const hc_uint16 deflate_dist[31] = {
 };
 
 /* Pushes given bits, but does not write them */
-#define Deflate_PushBits(state, value, bits) state->Bits |= (value) << state->NumBits; state->NumBits += (bits);
+#define Deflate_PushBits(state, value, bits) state->Bits |= (hc_uint32)(value) << state->NumBits; state->NumBits += (bits);
 /* Pushes bits of the huffman codeword bits for the given literal, but does not write them */
 #define Deflate_PushLit(state, value) Deflate_PushBits(state, state->LitsCodewords[value], state->LitsLens[value])
 /* Pushes given bits (reversing for huffman code), but does not write them */
@@ -818,16 +923,92 @@ static const hc_uint16 deflate_dist[31] = {
 #define MIN_MATCH_LEN 3
 #define MAX_MATCH_LEN 258
 
+#ifdef Deflate_Load64
+/* Number of bytes that match (are the same) from a and b */
+/* Compares 8 bytes at a time, then uses count trailing zeros to find the first different byte */
+static int Deflate_MatchLen(hc_uint8* a, hc_uint8* b, int maxLen) {
+	hc_uint64 x, y;
+	int i = 0;
+
+	for (; i + 8 <= maxLen; i += 8) {
+		Deflate_Load64(x, a + i);
+		Deflate_Load64(y, b + i);
+		if (x != y) return i + (Deflate_Ctz64(x ^ y) >> 3);
+	}
+	while (i < maxLen && a[i] == b[i]) i++;
+	return i;
+}
+#else
 /* Number of bytes that match (are the same) from a and b */
 static int Deflate_MatchLen(hc_uint8* a, hc_uint8* b, int maxLen) {
 	int i = 0;
 	while (i < maxLen && *a == *b) { i++; a++; b++; }
 	return i;
 }
+#endif
 
 /* Hashes 3 bytes of data */
+/* Multiplicative hashing spreads similar inputs (e.g. runs of a few block types) across the whole table */
 static hc_uint32 Deflate_Hash(hc_uint8* src) {
-	return (hc_uint32)((src[0] << 8) ^ (src[1] << 4) ^ (src[2])) & DEFLATE_HASH_MASK;
+	hc_uint32 value = src[0] | (src[1] << 8) | ((hc_uint32)src[2] << 16);
+	return (hc_uint32)(value * 0x9E3779B1UL) >> (32 - DEFLATE_HASH_BITS);
+}
+
+/* How much effort to put into finding matches at each compression level */
+static const struct DeflateLevel {
+	hc_uint16 maxChain; /* Maximum number of previous positions to check for a match */
+	hc_uint16 niceLen;  /* Stop searching once a match of at least this length is found */
+	hc_uint16 maxLazy;  /* Only look for a better match at next byte if current match is shorter than this */
+} deflate_levels[DEFLATE_LEVEL_BEST + 1] = {
+	{    0,   0,   0 }, {    5, 258,   0 }, /* level 1 uses Deflate_FlushBlock instead */
+	{    4,   8,   0 }, {    8,  16,   0 }, {   16,  32,   8 }, {   32,  64,  16 },
+	{   64, 128,  32 }, {  128, 128,  64 }, {  256, 258, 128 }, { 1024, 258, 258 }
+};
+
+/* Inserts the given position into the hash chains */
+static void Deflate_Insert(struct DeflateState* state, hc_uint8* cur) {
+	hc_uint32 hash = Deflate_Hash(cur);
+	hc_uint32 pos  = state->WindowBase + (hc_uint32)(cur - state->Input);
+	hc_uint32 dist = pos - state->Head[hash];
+
+	/* Distance of 0 marks the end of the chain */
+	state->Prev[pos & DEFLATE_WINDOW_MASK] = dist < DEFLATE_BUFFER_SIZE ? dist : 0;
+	state->Head[hash] = pos;
+}
+
+/* Finds the longest previous match for data starting at cur */
+static int Deflate_FindMatch(struct DeflateState* state, hc_uint8* cur, int maxLen, 
+							const struct DeflateLevel* cfg, int* bestDist) {
+	hc_uint8* input = state->Input;
+	hc_uint32 base  = state->WindowBase;
+	hc_uint32 pos   = state->Head[Deflate_Hash(cur)];
+	int bestLen  = MIN_MATCH_LEN - 1;
+	int maxChain = cfg->maxChain;
+	int matchLen, dist;
+	hc_uint8* prev;
+
+	/* Positions before the start of Input are no longer available */
+	/* (also Input[0] is excluded so that a position of 0 means 'no match') */
+	for (; pos > base && maxChain; maxChain--) {
+		prev = input + (pos - base);
+
+		/* Can't be a longer match when the byte just past the best match differs */
+		if (prev[bestLen] == cur[bestLen]) {
+			matchLen = Deflate_MatchLen(prev, cur, maxLen);
+
+			if (matchLen > bestLen) {
+				bestLen   = matchLen;
+				*bestDist = (int)(cur - prev);
+				if (bestLen >= cfg->niceLen || bestLen == maxLen) break;
+			}
+		}
+
+		/* Also stop when previous position would be before start of Input */
+		dist = state->Prev[pos & DEFLATE_WINDOW_MASK];
+		if (!dist || (hc_uint32)dist >= pos - base) break;
+		pos -= dist;
+	}
+	return bestLen;
 }
 
 /* Writes a literal to state->Output */
@@ -854,26 +1035,27 @@ static void Deflate_LenDist(struct DeflateState* state, int len, int dist) {
 
 /* Moves "current block" to "previous block", adjusting state if needed. */
 static void Deflate_MoveBlock(struct DeflateState* state) {
+	hc_uint32 base;
 	int i;
 	Mem_Copy(state->Input, state->Input + DEFLATE_BLOCK_SIZE, DEFLATE_BLOCK_SIZE);
 	state->InputPosition = DEFLATE_BLOCK_SIZE;
 
-	/* adjust hash table offsets, removing offsets that are no longer in data at all */
+	/* Head stores absolute positions, so only need to be adjusted before they overflow */
+	/* (Prev stores relative distances, so never needs to be adjusted) */
+	state->WindowBase += DEFLATE_BLOCK_SIZE;
+	if (state->WindowBase < 0x80000000UL) return;
+
+	base = state->WindowBase;
 	for (i = 0; i < Array_Elems(state->Head); i++) {
-		state->Head[i] = state->Head[i] < DEFLATE_BLOCK_SIZE ? 0 : (state->Head[i] - DEFLATE_BLOCK_SIZE);
-	}
-	for (i = 0; i < Array_Elems(state->Prev); i++) {
-		state->Prev[i] = state->Prev[i] < DEFLATE_BLOCK_SIZE ? 0 : (state->Prev[i] - DEFLATE_BLOCK_SIZE);
+		state->Head[i] = state->Head[i] <= base ? 0 : (state->Head[i] - base);
 	}
+	state->WindowBase = 0;
 }
 
 /* Compresses current block of data */
 static hc_result Deflate_FlushBlock(struct DeflateState* state, int len) {
-	hc_uint32 hash, nextHash;
-	int bestLen, maxLen, matchLen, depth;
-	int bestPos, pos, nextPos;
-	hc_uint16 oldHead;
-	hc_uint8* input;
+	const struct DeflateLevel* cfg = &deflate_levels[DEFLATE_LEVEL_FAST];
+	int bestLen, bestDist = 0, nextLen, nextDist;
 	hc_uint8* cur;
 	hc_result res;
 
@@ -884,50 +1066,28 @@ static hc_result Deflate_FlushBlock(struct DeflateState* state, int len) {
 
 	/* Based off descriptions from http://www.gzip.org/algorithm.txt and
 	https://github.com/nothings/stb/blob/master/stb_image_write.h */
-	input = state->Input;
-	cur   = input + DEFLATE_BLOCK_SIZE;
+	cur = state->Input + DEFLATE_BLOCK_SIZE;
 
 	/* Compress current block of data */
 	/* Use > instead of >=, because also try match at one byte after current */
 	while (len > MIN_MATCH_LEN) {
-		hash   = Deflate_Hash(cur);
-		maxLen = min(len, MAX_MATCH_LEN);
-
-		bestLen = MIN_MATCH_LEN - 1; /* Match must be at least 3 bytes */
-		bestPos = 0;
-
 		/* Find longest match starting at this byte */
 		/* Only explore up to 5 previous matches, to avoid slow performance */
 		/* (i.e prefer quickly saving maps/screenshots to completely optimal filesize) */
-		pos = state->Head[hash];
-		for (depth = 0; pos != 0 && depth < 5; depth++) {
-			matchLen = Deflate_MatchLen(&input[pos], cur, maxLen);
-			if (matchLen > bestLen) { bestLen = matchLen; bestPos = pos; }
-			pos = state->Prev[pos];
-		}
+		bestLen = Deflate_FindMatch(state, cur, min(len, MAX_MATCH_LEN), cfg, &bestDist);
 
 		/* Insert this entry into the hash chain */
-		pos = (int)(cur - input);
-		oldHead = state->Head[hash];
-		state->Head[hash] = pos;
-		state->Prev[pos]  = oldHead;
+		Deflate_Insert(state, cur);
 
 		/* Lazy evaluation: Find longest match starting at next byte */
 		/* If that's longer than the longest match at current byte, throwaway this match */
-		if (bestPos) {
-			nextHash = Deflate_Hash(cur + 1);
-			nextPos  = state->Head[nextHash];
-			maxLen   = min(len - 1, MAX_MATCH_LEN);
-
-			for (depth = 0; nextPos != 0 && depth < 5; depth++) {
-				matchLen = Deflate_MatchLen(&input[nextPos], cur + 1, maxLen);
-				if (matchLen > bestLen) { bestPos = 0; break; }
-				nextPos = state->Prev[nextPos];
-			}
+		if (bestLen >= MIN_MATCH_LEN) {
+			nextLen = Deflate_FindMatch(state, cur + 1, min(len - 1, MAX_MATCH_LEN), cfg, &nextDist);
+			if (nextLen > bestLen) bestLen = 0;
 		}
 
-		if (bestPos) {
-			Deflate_LenDist(state, bestLen, pos - bestPos);
+		if (bestLen >= MIN_MATCH_LEN) {
+			Deflate_LenDist(state, bestLen, bestDist);
 			len -= bestLen; cur += bestLen;
 		} else {
 			Deflate_Lit(state, *cur);
@@ -956,6 +1116,382 @@ static hc_result Deflate_FlushBlock(struct DeflateState* state, int len) {
 	return res;
 }
 
+/* Constructs a huffman encoding table (for values to codewords) */
+static void Deflate_BuildTable(const hc_uint8* lens, int count, hc_uint16* codewords, hc_uint8* bitlens) {
+	int i, j, offset, codeword;
+	struct HuffmanTable table;
+
+	/* NOTE: Can ignore since lens table is not user controlled */
+	(void)Huffman_Build(&table, lens, count);
+	for (i = 0; i < INFLATE_MAX_BITS; i++) {
+		if (!table.endCodewords[i]) continue;
+		count = table.endCodewords[i] - table.firstCodewords[i];
+
+		for (j = 0; j < count; j++) {
+			offset   = table.values[table.firstOffsets[i] + j];
+			codeword = table.firstCodewords[i] + j;
+			bitlens[offset]   = i;
+			codewords[offset] = Huffman_ReverseBits(codeword, i);
+		}
+	}
+}
+
+/* Finds the length code (0-28) for the given match length */
+static int Deflate_LenCode(int len) {
+	int j;
+	for (j = 0; len >= deflate_len[j + 1]; j++);
+	return j;
+}
+
+/* Finds the distance code (0-29) for the given match distance */
+static int Deflate_DistCode(int dist) {
+	int j;
+	for (j = 0; dist >= deflate_dist[j + 1]; j++);
+	return j;
+}
+
+
+/*########################################################################################################################*
+*-----------------------------------------------Deflate dynamic huffman blocks--------------------------------------------*
+*#########################################################################################################################*/
+static void Deflate_AddLit(struct DeflateState* state, int lit, hc_uint16* litFreqs) {
+	state->SymValues[state->NumSymbols] = lit;
+	state->SymDists[state->NumSymbols]  = 0;
+	state->NumSymbols++;
+	litFreqs[lit]++;
+}
+
+static void Deflate_AddMatch(struct DeflateState* state, int len, int dist, 
+							hc_uint16* litFreqs, hc_uint16* distFreqs) {
+	state->SymValues[state->NumSymbols] = len - MIN_MATCH_LEN;
+	state->SymDists[state->NumSymbols]  = dist;
+	state->NumSymbols++;
+
+	litFreqs[257 + Deflate_LenCode(len)]++;
+	distFreqs[Deflate_DistCode(dist)]++;
+}
+
+/* Converts current block of data into a list of literals and length-distance pairs */
+/* Based off descriptions from http://www.gzip.org/algorithm.txt and zlib's deflate_slow */
+static void Deflate_FindSymbols(struct DeflateState* state, int len, hc_uint16* litFreqs, hc_uint16* distFreqs) {
+	const struct DeflateLevel* cfg = &deflate_levels[state->Level];
+	hc_uint8* cur = state->Input + DEFLATE_BLOCK_SIZE;
+	hc_uint8* end = cur + len;
+	hc_uint8* last;
+	int bestLen, bestDist = 0, left;
+	int prevLen = 0, prevDist = 0;
+	hc_bool havePrev = false;
+
+	state->NumSymbols = 0;
+	/* Hash reads 3 bytes, so stop inserting positions just before the end */
+	last = end - MIN_MATCH_LEN;
+
+	while (cur < end) {
+		left    = (int)(end - cur);
+		bestLen = MIN_MATCH_LEN - 1;
+
+		/* Use > instead of >=, for consistency with Deflate_FlushBlock */
+		if (left > MIN_MATCH_LEN) {
+			/* Don't bother searching when previous byte already has a good enough match */
+			if (!cfg->maxLazy || prevLen < cfg->maxLazy) {
+				bestLen = Deflate_FindMatch(state, cur, min(left, MAX_MATCH_LEN), cfg, &bestDist);
+			}
+			Deflate_Insert(state, cur);
+		}
+
+		if (prevLen >= MIN_MATCH_LEN && bestLen <= prevLen) {
+			/* Match starting at previous byte is at least as long, so use that match */
+			Deflate_AddMatch(state, prevLen, prevDist, litFreqs, distFreqs);
+
+			for (cur++, prevLen -= 2; prevLen > 0; cur++, prevLen--) {
+				if (cur <= last) Deflate_Insert(state, cur);
+			}
+			havePrev = false;
+		} else if (!cfg->maxLazy) {
+			/* Greedy matching: always immediately use match if there is one */
+			if (bestLen >= MIN_MATCH_LEN) {
+				Deflate_AddMatch(state, bestLen, bestDist, litFreqs, distFreqs);
+
+				for (cur++, bestLen--; bestLen > 0; cur++, bestLen--) {
+					if (cur <= last) Deflate_Insert(state, cur);
+				}
+			} else {
+				Deflate_AddLit(state, *cur, litFreqs);
+				cur++;
+			}
+		} else {
+			/* Lazy matching: defer deciding until next byte has also been checked */
+			if (havePrev) Deflate_AddLit(state, cur[-1], litFreqs);
+			havePrev = true;
+			prevLen  = bestLen;
+			prevDist = bestDist;
+			cur++;
+		}
+	}
+	if (havePrev) Deflate_AddLit(state, cur[-1], litFreqs);
+}
+
+/* Calculates optimal code lengths, limited to maxBits, for the given symbol frequencies */
+/* Based on the in-place minimum redundancy algorithm by Moffat and Katajainen (as used in miniz) */
+static void Deflate_CalcLengths(const hc_uint16* freqs, int count, int maxBits, hc_uint8* lens) {
+	hc_uint16 syms[INFLATE_MAX_LITS];
+	int A[INFLATE_MAX_LITS];
+	int numCodes[INFLATE_MAX_BITS];
+	int i, j, n, sym, root, leaf, next, avbl, used, depth;
+	hc_uint32 total;
+
+	Mem_Set(lens, 0, count);
+	for (i = 0, n = 0; i < count; i++) {
+		if (freqs[i]) syms[n++] = i;
+	}
+
+	/* Always produce at least two codes, as some decoders reject single code tables */
+	if (n < 2) {
+		sym = n ? syms[0] : 0;
+		lens[sym] = 1; lens[sym ? 0 : 1] = 1;
+		return;
+	}
+
+	/* Sort used symbols by ascending frequency */
+	for (i = 1; i < n; i++) {
+		sym = syms[i];
+		for (j = i; j > 0 && freqs[syms[j - 1]] > freqs[sym]; j--) {
+			syms[j] = syms[j - 1];
+		}
+		syms[j] = sym;
+	}
+	for (i = 0; i < n; i++) A[i] = freqs[syms[i]];
+
+	/* Phase 1: Combine lowest weight nodes, replacing weights with parent indices */
+	A[0] += A[1]; root = 0; leaf = 2;
+	for (next = 1; next < n - 1; next++) {
+		if (leaf >= n || A[root] < A[leaf]) { A[next] = A[root]; A[root++] = next; } 
+		else { A[next] = A[leaf++]; }
+
+		if (leaf >= n || (root < next && A[root] < A[leaf])) { A[next] += A[root]; A[root++] = next; } 
+		else { A[next] += A[leaf++]; }
+	}
+
+	/* Phase 2: Convert parent indices into internal node depths */
+	A[n - 2] = 0;
+	for (next = n - 3; next >= 0; next--) A[next] = A[A[next]] + 1;
+
+	/* Phase 3: Convert internal node depths into leaf depths (i.e. code lengths) */
+	avbl = 1; used = depth = 0; root = n - 2; next = n - 1;
+	while (avbl > 0) {
+		while (root >= 0 && A[root] == depth) { used++; root--; }
+		while (avbl > used) { A[next--] = depth; avbl--; }
+		avbl = 2 * used; depth++; used = 0;
+	}
+
+	/* Limit code lengths to maxBits, while keeping the code complete */
+	for (i = 0; i < INFLATE_MAX_BITS; i++) numCodes[i] = 0;
+	for (i = 0; i < n; i++) numCodes[min(A[i], maxBits)]++;
+
+	for (i = 1, total = 0; i <= maxBits; i++) {
+		total += (hc_uint32)numCodes[i] << (maxBits - i);
+	}
+	while (total != (1UL << maxBits)) {
+		numCodes[maxBits]--;
+		for (i = maxBits - 1; i > 0; i--) {
+			if (!numCodes[i]) continue;
+			numCodes[i]--; numCodes[i + 1] += 2; break;
+		}
+		total--;
+	}
+
+	/* Most frequent symbols get the shortest codes */
+	for (i = 1, j = n; i <= maxBits; i++) {
+		for (used = numCodes[i]; used > 0; used--) lens[syms[--j]] = i;
+	}
+}
+
+/* Run length encodes the code lengths of the literal and distance tables */
+static int Deflate_EncodeCodeLens(const hc_uint8* lens, int count, hc_uint8* codes, hc_uint8* extra, hc_uint16* freqs) {
+	int i = 0, n = 0, run, cur, amount;
+	#define CodeLens_Add(code, value) codes[n] = code; extra[n] = value; n++; freqs[code]++;
+
+	while (i < count) {
+		cur = lens[i];
+		for (run = 1; i + run < count && lens[i + run] == cur; run++) { }
+		i += run;
+
+		if (cur == 0) {
+			/* 17 = repeat zero 3-10 times, 18 = repeat zero 11-138 times */
+			for (; run >= 11; run -= amount) {
+				amount = min(run, 138); CodeLens_Add(18, amount - 11);
+			}
+			if (run >= 3) { CodeLens_Add(17, run - 3); run = 0; }
+		} else {
+			/* 16 = repeat previous length 3-6 times */
+			CodeLens_Add(cur, 0); run--;
+			for (; run >= 3; run -= amount) {
+				amount = min(run, 6); CodeLens_Add(16, amount - 3);
+			}
+		}
+		for (; run > 0; run--) { CodeLens_Add(cur, 0); }
+	}
+	return n;
+}
+
+/* Writes output buffer to destination stream, if it is almost full */
+static hc_result Deflate_CheckOutput(struct DeflateState* state, hc_uint32 required) {
+	hc_result res;
+	if (state->AvailOut >= required) return 0;
+
+	res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
+	state->NextOut  = state->Output;
+	state->AvailOut = DEFLATE_OUT_SIZE;
+	return res;
+}
+
+/* Writes current block of data uncompressed */
+static hc_result Deflate_WriteStored(struct DeflateState* state, int len, hc_bool final) {
+	hc_result res;
+	Deflate_PushBits(state, final, 1);
+	Deflate_PushBits(state, 0, 2); /* block type STORED */
+
+	/* Stored block data starts at next byte boundary */
+	if (state->NumBits & 7) { Deflate_PushBits(state, 0, 8 - (state->NumBits & 7)); }
+	Deflate_FlushBits(state);
+
+	Deflate_PushBits(state, len, 16);
+	Deflate_PushBits(state, len ^ 0xFFFF, 16);
+	Deflate_FlushBits(state);
+
+	if ((res = Deflate_CheckOutput(state, DEFLATE_OUT_SIZE))) return res;
+	return Stream_Write(state->Dest, state->Input + DEFLATE_BLOCK_SIZE, len);
+}
+
+/* Writes the buffered literals and length-distance pairs using current huffman tables */
+static hc_result Deflate_WriteSymbols(struct DeflateState* state) {
+	int i, j, len, dist;
+	hc_result res;
+
+	for (i = 0; i < state->NumSymbols; i++) {
+		dist = state->SymDists[i];
+		if (!dist) {
+			Deflate_Lit(state, state->SymValues[i]);
+		} else {
+			len = state->SymValues[i] + MIN_MATCH_LEN;
+			j   = Deflate_LenCode(len);
+			Deflate_PushLit(state, j + 257);
+			if (len_bits[j]) { Deflate_PushBits(state, len - deflate_len[j], len_bits[j]); }
+			Deflate_FlushBits(state);
+
+			j = Deflate_DistCode(dist);
+			Deflate_PushBits(state, state->DistsCodewords[j], state->DistsLens[j]);
+			Deflate_FlushBits(state);
+			if (dist_bits[j]) { Deflate_PushBits(state, dist - deflate_dist[j], dist_bits[j]); }
+			Deflate_FlushBits(state);
+		}
+
+		/* leave room for a few bytes and literals at end */
+		if ((res = Deflate_CheckOutput(state, 20))) return res;
+	}
+
+	Deflate_PushLit(state, 256);
+	Deflate_FlushBits(state);
+	return 0;
+}
+
+/* Compresses current block of data, using whichever of dynamic huffman/fixed huffman/stored is smallest */
+static hc_result Deflate_FlushDynamic(struct DeflateState* state, int len, hc_bool final) {
+	hc_uint16 litFreqs[INFLATE_MAX_LITS]   = { 0 };
+	hc_uint16 distFreqs[INFLATE_MAX_DISTS] = { 0 };
+	hc_uint16 clFreqs[INFLATE_MAX_CODELENS] = { 0 };
+	hc_uint8 lens[INFLATE_MAX_LITS_DISTS], allLens[INFLATE_MAX_LITS_DISTS];
+	hc_uint8 clLens[INFLATE_MAX_CODELENS];
+	hc_uint8 clCodes[INFLATE_MAX_LITS_DISTS], clExtra[INFLATE_MAX_LITS_DISTS];
+	hc_uint16 clCodewords[INFLATE_MAX_CODELENS];
+	hc_uint8 clBitLens[INFLATE_MAX_CODELENS];
+	hc_uint32 extraBits = 0, dynamicBits, fixedBits, storedBits;
+	int i, numLits, numDists, numCodeLens, numCL;
+	hc_result res;
+
+	Deflate_FindSymbols(state, len, litFreqs, distFreqs);
+	litFreqs[256] = 1; /* end of block symbol */
+
+	Deflate_CalcLengths(litFreqs,  INFLATE_MAX_LITS,  15, lens);
+	Deflate_CalcLengths(distFreqs, INFLATE_MAX_DISTS, 15, lens + INFLATE_MAX_LITS);
+	for (numLits  = 286; numLits  > 257 && !lens[numLits - 1]; numLits--) { }
+	for (numDists =  30; numDists >   1 && !lens[INFLATE_MAX_LITS + numDists - 1]; numDists--) { }
+
+	/* Code lengths of literals are immediately followed by code lengths of distances */
+	Mem_Copy(allLens,           lens,                    numLits);
+	Mem_Copy(allLens + numLits, lens + INFLATE_MAX_LITS, numDists);
+	numCL = Deflate_EncodeCodeLens(allLens, numLits + numDists, clCodes, clExtra, clFreqs);
+
+	Deflate_CalcLengths(clFreqs, INFLATE_MAX_CODELENS, 7, clLens);
+	for (numCodeLens = INFLATE_MAX_CODELENS; numCodeLens > 4 && !clLens[codelens_order[numCodeLens - 1]]; numCodeLens--) { }
+
+	/* Work out which block type produces the smallest output */
+	for (i = 0; i < 29; i++) extraBits += litFreqs[257 + i] * len_bits[i];
+	for (i = 0; i < 30; i++) extraBits += distFreqs[i] * dist_bits[i];
+
+	dynamicBits = 3 + 5 + 5 + 4 + 3 * numCodeLens + extraBits;
+	fixedBits   = 3 + extraBits;
+	for (i = 0; i < INFLATE_MAX_CODELENS; i++) {
+		dynamicBits += clFreqs[i] * clLens[i];
+	}
+	dynamicBits += clFreqs[16] * 2 + clFreqs[17] * 3 + clFreqs[18] * 7;
+
+	for (i = 0; i < INFLATE_MAX_LITS; i++) {
+		dynamicBits += litFreqs[i] * lens[i];
+		fixedBits   += litFreqs[i] * fixed_lits[i];
+	}
+	for (i = 0; i < INFLATE_MAX_DISTS; i++) {
+		dynamicBits += distFreqs[i] * lens[INFLATE_MAX_LITS + i];
+		fixedBits   += distFreqs[i] * fixed_dists[i];
+	}
+	storedBits = 3 + 7 + 32 + len * 8;
+
+	if (storedBits < dynamicBits && storedBits < fixedBits) {
+		res = Deflate_WriteStored(state, len, final);
+	} else if (fixedBits <= dynamicBits) {
+		Deflate_PushBits(state, final, 1);
+		Deflate_PushBits(state, 1, 2); /* block type FIXED */
+		Deflate_BuildTable(fixed_lits,  INFLATE_MAX_LITS,  state->LitsCodewords,  state->LitsLens);
+		Deflate_BuildTable(fixed_dists, INFLATE_MAX_DISTS, state->DistsCodewords, state->DistsLens);
+		res = Deflate_WriteSymbols(state);
+	} else {
+		Deflate_PushBits(state, final, 1);
+		Deflate_PushBits(state, 2, 2); /* block type DYNAMIC */
+		Deflate_PushBits(state, numLits  - 257, 5);
+		Deflate_PushBits(state, numDists - 1,   5);
+		Deflate_PushBits(state, numCodeLens - 4, 4);
+		Deflate_FlushBits(state);
+
+		/* Header is at most ~330 bytes */
+		if ((res = Deflate_CheckOutput(state, 512))) return res;
+		for (i = 0; i < numCodeLens; i++) {
+			Deflate_PushBits(state, clLens[codelens_order[i]], 3);
+			Deflate_FlushBits(state);
+		}
+
+		Deflate_BuildTable(clLens, INFLATE_MAX_CODELENS, clCodewords, clBitLens);
+		for (i = 0; i < numCL; i++) {
+			Deflate_PushBits(state, clCodewords[clCodes[i]], clBitLens[clCodes[i]]);
+			if (clCodes[i] == 16) { Deflate_PushBits(state, clExtra[i], 2); }
+			if (clCodes[i] == 17) { Deflate_PushBits(state, clExtra[i], 3); }
+			if (clCodes[i] == 18) { Deflate_PushBits(state, clExtra[i], 7); }
+			Deflate_FlushBits(state);
+		}
+
+		Deflate_BuildTable(lens, INFLATE_MAX_LITS, state->LitsCodewords, state->LitsLens);
+		Deflate_BuildTable(lens + INFLATE_MAX_LITS, INFLATE_MAX_DISTS, state->DistsCodewords, state->DistsLens);
+		res = Deflate_WriteSymbols(state);
+	}
+	if (res) return res;
+
+	res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
+	state->NextOut  = state->Output;
+	state->AvailOut = DEFLATE_OUT_SIZE;
+
+	Deflate_MoveBlock(state);
+	return res;
+}
+
 /* Adds data to buffered output data, flushing if needed */
 static hc_result Deflate_StreamWrite(struct Stream* stream, const hc_uint8* data, hc_uint32 total, hc_uint32* modified) {
 	struct DeflateState* state;
@@ -978,7 +1514,11 @@ static hc_result Deflate_StreamWrite(struct Stream* stream, const hc_uint8* data
 		data += len;
 
 		if (state->InputPosition == DEFLATE_BUFFER_SIZE) {
-			res = Deflate_FlushBlock(state, DEFLATE_BLOCK_SIZE);
+			if (state->Level > DEFLATE_LEVEL_FAST) {
+				res = Deflate_FlushDynamic(state, DEFLATE_BLOCK_SIZE, false);
+			} else {
+				res = Deflate_FlushBlock(state, DEFLATE_BLOCK_SIZE);
+			}
 			if (res) return res;
 		}
 	}
@@ -989,14 +1529,22 @@ static hc_result Deflate_StreamWrite(struct Stream* stream, const hc_uint8* data
 static hc_result Deflate_StreamClose(struct Stream* stream) {
 	struct DeflateState* state;
 	hc_result res;
+	int len;
 
 	state = (struct DeflateState*)stream->meta.inflate;
-	res   = Deflate_FlushBlock(state, state->InputPosition - DEFLATE_BLOCK_SIZE);
-	if (res) return res;
+	len   = state->InputPosition - DEFLATE_BLOCK_SIZE;
 
-	/* Write huffman encoded "literal 256" to terminate symbols */
-	Deflate_PushLit(state, 256);
-	Deflate_FlushBits(state);
+	if (state->Level > DEFLATE_LEVEL_FAST) {
+		res = Deflate_FlushDynamic(state, len, true);
+		if (res) return res;
+	} else {
+		res = Deflate_FlushBlock(state, len);
+		if (res) return res;
+
+		/* Write huffman encoded "literal 256" to terminate symbols */
+		Deflate_PushLit(state, 256);
+		Deflate_FlushBits(state);
+	}
 
 	/* In case last byte still has a few extra bits */
 	if (state->NumBits) {
@@ -1007,26 +1555,6 @@ static hc_result Deflate_StreamClose(struct Stream* stream) {
 	return Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
 }
 
-/* Constructs a huffman encoding table (for values to codewords) */
-static void Deflate_BuildTable(const hc_uint8* lens, int count, hc_uint16* codewords, hc_uint8* bitlens) {
-	int i, j, offset, codeword;
-	struct HuffmanTable table;
-
-	/* NOTE: Can ignore since lens table is not user controlled */
-	(void)Huffman_Build(&table, lens, count);
-	for (i = 0; i < INFLATE_MAX_BITS; i++) {
-		if (!table.endCodewords[i]) continue;
-		count = table.endCodewords[i] - table.firstCodewords[i];
-
-		for (j = 0; j < count; j++) {
-			offset   = table.values[table.firstOffsets[i] + j];
-			codeword = table.firstCodewords[i] + j;
-			bitlens[offset]   = i;
-			codewords[offset] = Huffman_ReverseBits(codeword, i);
-		}
-	}
-}
-
 void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struct Stream* underlying) {
 	Stream_Init(stream);
 	stream->meta.inflate = state;
@@ -1042,12 +1570,18 @@ void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struc
 	state->AvailOut = DEFLATE_OUT_SIZE;
 	state->Dest     = underlying;
 	state->WroteHeader = false;
+	state->Level       = DEFLATE_LEVEL_FAST;
+	state->WindowBase  = 0;
 
 	Mem_Set(state->Head, 0, sizeof(state->Head));
 	Mem_Set(state->Prev, 0, sizeof(state->Prev));
 	Deflate_BuildTable(fixed_lits, INFLATE_MAX_LITS, state->LitsCodewords, state->LitsLens);
 }
 
+void Deflate_SetLevel(struct DeflateState* state, int level) {
+	state->Level = max(DEFLATE_LEVEL_FAST, min(level, DEFLATE_LEVEL_BEST));
+}
+
 
 /*########################################################################################################################*
 *-----------------------------------------------------GZip (compress)-----------------------------------------------------*
@@ -33,6 +33,8 @@ hc_result ZLibHeader_Read(struct Stream* s, struct ZLibHeader* header);
 #define INFLATE_FAST_BITS 9
 #define INFLATE_FAST_LEN_SHIFT 9
 #define INFLATE_FAST_VAL_MASK  0x1FF
+/* Number of bits used to decode several literals at once */
+#define INFLATE_MULTI_BITS 10
 
 #define INFLATE_WINDOW_SIZE 0x8000UL
 #define INFLATE_WINDOW_MASK 0x7FFFUL
@@ -69,6 +71,7 @@ struct InflateState {
 		struct HuffmanTable Lits;           /* Values represent literal or lengths */
 	} Table; /* union to save on memory */
 	struct HuffmanTable TableDists;         /* Values represent distances back */
+	hc_uint32 MultiLits[1 << INFLATE_MULTI_BITS]; /* Up to 3 literals that can be decoded at once */
 	hc_uint8 Window[INFLATE_WINDOW_SIZE];    /* Holds circular buffer of recent output data, used for LZ77 */
 	hc_result result;
 };
@@ -87,8 +90,16 @@ HC_API void Inflate_MakeStream2(struct Stream* stream, struct InflateState* stat
 #define DEFLATE_BLOCK_SIZE  16384
 #define DEFLATE_BUFFER_SIZE 32768
 #define DEFLATE_OUT_SIZE 8192
-#define DEFLATE_HASH_SIZE 0x1000UL
-#define DEFLATE_HASH_MASK 0x0FFFUL
+#define DEFLATE_HASH_BITS 15
+#define DEFLATE_HASH_SIZE 0x8000UL
+#define DEFLATE_WINDOW_MASK (DEFLATE_BUFFER_SIZE - 1)
+/* Fastest compression level (output is a single fixed huffman block) */
+#define DEFLATE_LEVEL_FAST    1
+/* Default level for dynamic huffman compression */
+#define DEFLATE_LEVEL_DEFAULT 6
+/* Slowest compression level, but produces the smallest output */
+#define DEFLATE_LEVEL_BEST    9
+
 struct DeflateState {
 	hc_uint32 Bits;         /* Holds bits across byte boundaries */
 	hc_uint32 NumBits;      /* Number of bits in Bits buffer */
@@ -103,15 +114,25 @@ struct DeflateState {
 	
 	hc_uint8 Input[DEFLATE_BUFFER_SIZE];
 	hc_uint8 Output[DEFLATE_OUT_SIZE];
-	hc_uint16 Head[DEFLATE_HASH_SIZE];
-	hc_uint16 Prev[DEFLATE_BUFFER_SIZE];
-	/* NOTE: The largest possible value that can get */
-	/*  stored in Head/Prev is <= DEFLATE_BUFFER_SIZE */
+	hc_uint32 Head[DEFLATE_HASH_SIZE];   /* Most recent absolute position for each hash */
+	hc_uint16 Prev[DEFLATE_BUFFER_SIZE]; /* Distance back to previous position with same hash */
+	hc_uint32 WindowBase;                /* Absolute position of first byte in Input buffer */
 	hc_bool WroteHeader;
+	int Level; /* Compression level (see DEFLATE_LEVEL_ constants) */
+
+	hc_uint16 DistsCodewords[INFLATE_MAX_DISTS]; /* Codewords for each distance */
+	hc_uint8 DistsLens[INFLATE_MAX_DISTS];       /* Bit lengths of each distance codeword */
+	int NumSymbols;                             /* Number of symbols buffered for the current block */
+	hc_uint8 SymValues[DEFLATE_BLOCK_SIZE];      /* Literal byte, or match length - 3 */
+	hc_uint16 SymDists[DEFLATE_BLOCK_SIZE];      /* Match distance, or 0 for a literal */
 };
 /* Compresses input data using DEFLATE, then writes compressed output to another stream. Write only stream. */
 /* DEFLATE compression is pure compressed data, there is no header or footer. */
 HC_API void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struct Stream* underlying);
+/* Sets the compression level used by the given DEFLATE compressor. (defaults to DEFLATE_LEVEL_FAST) */
+/* Levels above DEFLATE_LEVEL_FAST output dynamic huffman blocks, which are smaller but slower to produce. */
+/* NOTE: Must be called after Deflate_MakeStream/GZip_MakeStream/ZLib_MakeStream, before writing any data. */
+HC_API void Deflate_SetLevel(struct DeflateState* state, int level);
 
 struct GZipState { struct DeflateState Base; hc_uint32 Crc32, Size; };
 /* Compresses input data using GZIP, then writes compressed output to another stream. Write only stream. */
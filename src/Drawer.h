@@ -38,5 +38,14 @@ HC_API void Drawer_YMin(int count, PackedCol col, TextureLoc texLoc, struct Vert
 /* Draws maximum Y face of the cuboid. (i.e. at Y2) */
 HC_API void Drawer_YMax(int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
 
+/* Same as the functions above, but use the given state instead of the shared Drawer state. */
+/* (e.g. so chunk meshes can be built on several threads at once) */
+HC_API void Drawer_XMinWith(const struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+HC_API void Drawer_XMaxWith(const struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+HC_API void Drawer_ZMinWith(const struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+HC_API void Drawer_ZMaxWith(const struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+HC_API void Drawer_YMinWith(const struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+HC_API void Drawer_YMaxWith(const struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+
 HC_END_HEADER
 #endif
@@ -454,15 +454,27 @@ void Entities_Tick(struct ScheduledTask* task) {
 	}
 }
 
+/* Frames rendered so far, used to stagger reduced rate animation of distant entities */
+static hc_uint32 lod_frame;
+/* Squared distances beyond which entities are drawn at lower detail (0 if never) */
+static float lod_reducedDist, lod_stillDist;
+
 void Entities_RenderModels(float delta, float t) {
 	int i;
+	lod_frame++;
 	Gfx_SetAlphaTest(true);
+#ifdef HC_BUILD_MODELINSTANCING
+	Model_BeginInstancing();
+#endif
 	
 	for (i = 0; i < ENTITIES_MAX_COUNT; i++) 
 	{
 		if (!Entities.List[i]) continue;
 		Entities.List[i]->VTABLE->RenderModel(Entities.List[i], delta, t);
 	}
+#ifdef HC_BUILD_MODELINSTANCING
+	Model_EndInstancing();
+#endif
 	Gfx_SetAlphaTest(false);
 }
 
@@ -1082,16 +1094,41 @@ static void NetPlayer_Tick(struct Entity* e, float delta) {
 	AnimatedComp_Update(e, e->prev.pos, e->next.pos, delta);
 }
 
+#define LOD_ANIM_INTERVAL 4
+
+static int NetPlayer_GetLod(float distance) {
+	if (lod_stillDist   && distance > lod_stillDist)   return MODEL_LOD_STILL;
+	if (lod_reducedDist && distance > lod_reducedDist) return MODEL_LOD_REDUCED;
+	return MODEL_LOD_FULL;
+}
+
 static void NetPlayer_RenderModel(struct Entity* e, float delta, float t) {
+	int id = (int)((struct NetPlayer*)e - NetPlayers_List);
+	float distance;
+	int lod;
+
 	Vec3_Lerp(&e->Position, &e->prev.pos, &e->next.pos, t);
 	Entity_LerpAngles(e, t);
 
-	AnimatedComp_GetCurrent(e, t);
 	e->ShouldRender = Model_ShouldRender(e);
+	distance = Model_RenderDistance(e);
 	/* Original classic only shows players up to 64 blocks away */
-	if (Game_ClassicMode) e->ShouldRender &= Model_RenderDistance(e) <= 64 * 64;
+	if (Game_ClassicMode) e->ShouldRender &= distance <= 64 * 64;
+	if (!e->ShouldRender) return;
+
+	lod = NetPlayer_GetLod(distance);
+	if (lod == MODEL_LOD_FULL) {
+		AnimatedComp_GetCurrent(e, t);
+	} else if (lod == MODEL_LOD_REDUCED) {
+		/* Spread out animating distant entities across frames */
+		if ((lod_frame + id) % LOD_ANIM_INTERVAL == 0) AnimatedComp_GetCurrent(e, t);
+	} else {
+		AnimatedComp_GetStill(e);
+	}
 
-	if (e->ShouldRender) Model_Render(e->Model, e);
+	Models.Lod = lod;
+	Model_Render(e->Model, e);
+	Models.Lod = MODEL_LOD_FULL;
 }
 
 static hc_bool NetPlayer_ShouldRenderName(struct Entity* e) {
@@ -1131,6 +1168,11 @@ static void Entities_Init(void) {
 		ShadowMode_Names, Array_Elems(ShadowMode_Names));
 	if (Game_ClassicMode) Entities.ShadowsMode = SHADOW_MODE_NONE;
 
+	lod_reducedDist = (float)Options_GetInt(OPT_ENTITY_LOD_DISTANCE,   0, 4096, 32);
+	lod_stillDist   = (float)Options_GetInt(OPT_ENTITY_STILL_DISTANCE, 0, 4096, 96);
+	lod_reducedDist *= lod_reducedDist;
+	lod_stillDist   *= lod_stillDist;
+
 	for (i = 0; i < Game_NumStates; i++)
 	{
 		LocalPlayer_Init(&LocalPlayer_Instances[i], i);
@@ -111,6 +111,15 @@ void AnimatedComp_GetCurrent(struct Entity* e, float t) {
 	}
 }
 
+void AnimatedComp_GetStill(struct Entity* e) {
+	struct AnimatedComp* anim = &e->Anim;
+	anim->Swing = 0.0f;
+
+	anim->LeftLegX  = 0.0f; anim->LeftLegZ  = 0.0f; anim->RightLegX = 0.0f; anim->RightLegZ = 0.0f;
+	anim->LeftArmX  = 0.0f; anim->LeftArmZ  = 0.0f; anim->RightArmX = 0.0f; anim->RightArmZ = 0.0f;
+	anim->BobbingHor = 0.0f; anim->BobbingVer = 0.0f; anim->BobbingModel = 0.0f;
+}
+
 
 /*########################################################################################################################*
 *------------------------------------------------------TiltComponent------------------------------------------------------*
@@ -25,6 +25,8 @@ struct AnimatedComp {
 void AnimatedComp_Init(struct AnimatedComp* anim);
 void AnimatedComp_Update(struct Entity* entity, Vec3 oldPos, Vec3 newPos, float delta);
 void AnimatedComp_GetCurrent(struct Entity* entity, float t);
+/* Sets the current animation state to standing still, e.g. for distant entities */
+void AnimatedComp_GetStill(struct Entity* entity);
 
 /* Entity component that performs tilt animation depending on movement speed and time */
 struct TiltComp {
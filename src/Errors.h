@@ -138,5 +138,7 @@ enum HC_ERRORS {
 	SSL_ERR_CONTEXT_DEAD = 0xCCDED070UL, /* Server shutdown the SSL context and it must be recreated */
 	PNG_ERR_16BITSAMPLES = 0xCCDED071UL, /* Image uses 16 bit samples, which is unimplemented */
 	ERR_NO_NETWORKING    = 0xCCDED072UL, /* No working network connection */
+	RAW_ERR_IDENTIFIER   = 0xCCDED073UL, /* Raw map stream bytes #1-#4 aren't "HCRW" */
+	RAW_ERR_VERSION      = 0xCCDED074UL, /* Raw map stream byte #5 isn't 1 */
 };
 #endif
@@ -11,16 +11,64 @@
 #include "Chat.h"
 #include "ExtMath.h"
 #include "Options.h"
-#include "Queue.h"
 
+/* A cell that light spreads into, addressed by its chunk and its index within that chunk */
+/*  (so that spreading into neighbouring cells rarely needs to recalculate either) */
 struct LightNode {
-	IVec3 coords; /* 12 bytes */
+	hc_uint32 chunk; /* 4 bytes */
+	hc_uint16 local; /* 2 bytes */
 	hc_uint8 brightness; /* 1 byte */
-	/* char padding[3]; */
+	/* char padding[1]; */
 };
 
-static struct Queue lightQueue;
-static struct Queue unlightQueue;
+/* Ring buffer of light nodes, whose capacity is always a power of two */
+struct LightQueue {
+	struct LightNode* entries;
+	hc_uint32 capacity;
+	hc_uint32 head, tail; /* Only ever increase, and wrap around when indexing entries */
+};
+#define LightQueue_Count(queue) ((queue)->tail - (queue)->head)
+#define LightQueue_Pop(queue) ((queue)->entries[(queue)->head++ & ((queue)->capacity - 1)])
+
+static void LightQueue_Grow(struct LightQueue* queue) {
+	hc_uint32 i, count = LightQueue_Count(queue);
+	hc_uint32 capacity = queue->capacity ? queue->capacity * 2 : 1024;
+	struct LightNode* entries = (struct LightNode*)Mem_Alloc(capacity, sizeof(struct LightNode), "light queue");
+
+	/* Unwrap the entries, so that head is at the start of the new buffer */
+	for (i = 0; i < count; i++) {
+		entries[i] = queue->entries[(queue->head + i) & (queue->capacity - 1)];
+	}
+	Mem_Free(queue->entries);
+
+	queue->entries  = entries;
+	queue->capacity = capacity;
+	queue->head = 0;
+	queue->tail = count;
+}
+
+static HC_INLINE void LightQueue_Push(struct LightQueue* queue, hc_uint32 chunk, int local, int brightness) {
+	struct LightNode* node;
+	if (LightQueue_Count(queue) == queue->capacity) LightQueue_Grow(queue);
+
+	node = &queue->entries[queue->tail++ & (queue->capacity - 1)];
+	node->chunk      = chunk;
+	node->local      = local;
+	node->brightness = brightness;
+}
+
+static void LightQueue_Free(struct LightQueue* queue) {
+	Mem_Free(queue->entries);
+	queue->entries  = NULL;
+	queue->capacity = 0;
+	queue->head = 0;
+	queue->tail = 0;
+}
+
+static struct LightQueue lightQueue;
+static struct LightQueue unlightQueue;
+/* Lit cells bordering darkened areas, which need to spread their light back into those areas */
+static struct LightQueue respreadQueue;
 
 /* Top face, X face, Z face, bottomY face*/
 #define PALETTE_SHADES 4
@@ -45,6 +93,8 @@ static hc_uint8* chunkLightingDataFlags;
 #define CHUNK_SELF_CALCULATED 1
 #define CHUNK_ALL_CALCULATED 2
 static LightingChunk* chunkLightingData;
+/* Coordinates of each chunk, so they never need to be calculated from the chunk index */
+static struct LightChunkPos { hc_uint16 x, y, z; }* chunkPositions;
 
 #define MakePaletteIndex(lampLevel, lavaLevel) ((lampLevel << FANCY_LIGHTING_LAMP_SHIFT) | lavaLevel)
 /* Fill in a palette with values based on the current light colors, shaded by the given shade value and lightened by the given ambientColor */
@@ -100,16 +150,39 @@ static void FreePalettes(void) {
 	}
 }
 
+/* Converts chunk x/y/z coordinates to the corresponding index in chunks array/list */
+#define ChunkCoordsToIndex(cx, cy, cz) (((cy) * World.ChunksZ + (cz)) * World.ChunksX + (cx))
+/* Converts local x/y/z coordinates to the corresponding index in a chunk */
+#define LocalCoordsToIndex(lx, ly, lz) ((lx) | ((lz) << CHUNK_SHIFT) | ((ly) << (CHUNK_SHIFT * 2)))
+/* Converts global x/y/z coordinates to the corresponding index in a chunk */
+#define GlobalCoordsToChunkCoordsIndex(x, y, z) (LocalCoordsToIndex(x & CHUNK_MASK, y & CHUNK_MASK, z & CHUNK_MASK))
+/* Converts global x/y/z coordinates to the index of the chunk containing them */
+#define GlobalCoordsToChunkIndex(x, y, z) ChunkCoordsToIndex((x) >> CHUNK_SHIFT, (y) >> CHUNK_SHIFT, (z) >> CHUNK_SHIFT)
+
+static void Precompute_Start(void);
+static void Precompute_Stop(void);
+
 static int chunksCount;
 static void AllocState(void) {
+	struct LightChunkPos* pos;
+	int cx, cy, cz;
 	ClassicLighting_AllocState();
 	InitPalettes();
 	chunksCount = World.ChunksCount;
 
 	chunkLightingDataFlags = (hc_uint8*)Mem_AllocCleared(chunksCount, sizeof(hc_uint8), "light flags");
 	chunkLightingData = (LightingChunk*)Mem_AllocCleared(chunksCount, sizeof(LightingChunk), "light chunks");
-	Queue_Init(&lightQueue, sizeof(struct LightNode));
-	Queue_Init(&unlightQueue, sizeof(struct LightNode));
+	chunkPositions = (struct LightChunkPos*)Mem_Alloc(chunksCount, sizeof(struct LightChunkPos), "light chunk positions");
+
+	for (cy = 0; cy < World.ChunksY; cy++) {
+		for (cz = 0; cz < World.ChunksZ; cz++) {
+			for (cx = 0; cx < World.ChunksX; cx++) {
+				pos = &chunkPositions[ChunkCoordsToIndex(cx, cy, cz)];
+				pos->x = cx; pos->y = cy; pos->z = cz;
+			}
+		}
+	}
+	Precompute_Start();
 }
 
 static void FreeState(void) {
@@ -119,6 +192,7 @@ static void FreeState(void) {
 	/* This function can be called multiple times without calling AllocState, so... */
 	if (!chunkLightingDataFlags) return;
 
+	Precompute_Stop();
 	FreePalettes();
 
 	for (i = 0; i < chunksCount; i++) {
@@ -127,71 +201,162 @@ static void FreeState(void) {
 
 	Mem_Free(chunkLightingDataFlags);
 	Mem_Free(chunkLightingData);
+	Mem_Free(chunkPositions);
 	chunkLightingDataFlags = NULL;
 	chunkLightingData = NULL;
-	Queue_Clear(&lightQueue);
-	Queue_Clear(&unlightQueue);
+	chunkPositions = NULL;
+	LightQueue_Free(&lightQueue);
+	LightQueue_Free(&unlightQueue);
+	LightQueue_Free(&respreadQueue);
 }
 
-/* Converts chunk x/y/z coordinates to the corresponding index in chunks array/list */
-#define ChunkCoordsToIndex(cx, cy, cz) (((cy) * World.ChunksZ + (cz)) * World.ChunksX + (cx))
-/* Converts local x/y/z coordinates to the corresponding index in a chunk */
-#define LocalCoordsToIndex(lx, ly, lz) ((lx) | ((lz) << CHUNK_SHIFT) | ((ly) << (CHUNK_SHIFT * 2)))
-/* Converts global x/y/z coordinates to the corresponding index in a chunk */
-#define GlobalCoordsToChunkCoordsIndex(x, y, z) (LocalCoordsToIndex(x & CHUNK_MASK, y & CHUNK_MASK, z & CHUNK_MASK))
 
-/* Sets the light level at this cell. Does NOT check that the cell is in bounds. */
-static void SetBrightness(hc_uint8 brightness, int x, int y, int z, hc_bool isLamp, hc_bool refreshChunk) {
-	hc_uint8 clearMask, shift = isLamp ? FANCY_LIGHTING_LAMP_SHIFT : 0, prevValue;
-	int cx = x >> CHUNK_SHIFT, lx = x & CHUNK_MASK;
-	int cy = y >> CHUNK_SHIFT, ly = y & CHUNK_MASK;
-	int cz = z >> CHUNK_SHIFT, lz = z & CHUNK_MASK;
-	int chunkIndex = ChunkCoordsToIndex(cx, cy, cz);
-	int localIndex = LocalCoordsToIndex(lx, ly, lz);
-
-	if (chunkLightingData[chunkIndex] == NULL) {
-		chunkLightingData[chunkIndex] = (hc_uint8*)Mem_TryAllocCleared(CHUNK_SIZE_3, sizeof(hc_uint8));
-	}
+/* Returns the light level of the given cell in a chunk */
+#define LightData_Get(chunk, local, shift) \
+	(chunkLightingData[chunk] ? (chunkLightingData[chunk][local] >> (shift)) & FANCY_LIGHTING_MAX_LEVEL : 0)
+
+/* Sets the light level of the given cell in a chunk, returning false if the chunk has no light data. */
+static hc_bool SetBrightness(hc_uint32 chunk, int local, hc_uint8 brightness, int shift, hc_bool refreshChunk) {
+	hc_uint8* data = chunkLightingData[chunk];
+	hc_uint8 prevValue, clearMask;
+	int lx, ly, lz, cx, cy, cz;
+	if (!data) return false;
 
 	/* 00001111 if lamp, otherwise 11110000*/
 	clearMask = ~(FANCY_LIGHTING_MAX_LEVEL << shift);
+	prevValue = data[local];
+	data[local] = (prevValue & clearMask) | (brightness << shift);
+	if (!refreshChunk || prevValue == data[local]) return true;
+
+	lx = local & CHUNK_MASK; lz = (local >> CHUNK_SHIFT) & CHUNK_MASK; ly = local >> (CHUNK_SHIFT * 2);
+	cx = chunkPositions[chunk].x; cy = chunkPositions[chunk].y; cz = chunkPositions[chunk].z;
+
+	/* There is no reason to refresh current chunk as the builder does that automatically */
+	if (lx == CHUNK_MAX) Lighting_RefreshChunk(cx + 1, cy, cz);
+	if (lx == 0)         Lighting_RefreshChunk(cx - 1, cy, cz);
+	if (ly == CHUNK_MAX) Lighting_RefreshChunk(cx, cy + 1, cz);
+	if (ly == 0)         Lighting_RefreshChunk(cx, cy - 1, cz);
+	if (lz == CHUNK_MAX) Lighting_RefreshChunk(cx, cy, cz + 1);
+	if (lz == 0)         Lighting_RefreshChunk(cx, cy, cz - 1);
+	return true;
+}
+/* Returns the light level at this cell. Does NOT check that the cell is in bounds. */
+static hc_uint8 GetBrightness(int x, int y, int z, hc_bool isLamp) {
+	hc_uint32 chunk = GlobalCoordsToChunkIndex(x, y, z);
+	int local = GlobalCoordsToChunkCoordsIndex(x, y, z);
+	return LightData_Get(chunk, local, isLamp ? FANCY_LIGHTING_LAMP_SHIFT : 0);
+}
 
-	if (refreshChunk) {
-		prevValue = chunkLightingData[chunkIndex][localIndex];
+/* Distance along an axis from the given coordinate to the nearest cell in the given chunk */
+#define ChunkAxisDistance(v, c) \
+	((v) < ((c) << CHUNK_SHIFT) ? ((c) << CHUNK_SHIFT) - (v) : \
+	 (v) > ((c) << CHUNK_SHIFT) + CHUNK_MAX ? (v) - ((c) << CHUNK_SHIFT) - CHUNK_MAX : 0)
 
-		chunkLightingData[chunkIndex][localIndex] &= clearMask;
-		chunkLightingData[chunkIndex][localIndex] |= brightness << shift;
+/* Allocates light data for every chunk that light of the given brightness spreading from this cell can reach, */
+/*  so that memory never needs to be allocated while spreading light */
+static void AllocChunksInReach(int x, int y, int z, int brightness) {
+	int cx, cy, cz, chunk, reach = brightness - 1;
 
-		/* There is no reason to refresh current chunk as the builder does that automatically */
-		if (prevValue != chunkLightingData[chunkIndex][localIndex]) {
-			if (lx == CHUNK_MAX) MapRenderer_RefreshChunk(cx + 1, cy, cz);
-			if (lx == 0)         MapRenderer_RefreshChunk(cx - 1, cy, cz);
-			if (ly == CHUNK_MAX) MapRenderer_RefreshChunk(cx, cy + 1, cz);
-			if (ly == 0)         MapRenderer_RefreshChunk(cx, cy - 1, cz);
-			if (lz == CHUNK_MAX) MapRenderer_RefreshChunk(cx, cy, cz + 1);
-			if (lz == 0)         MapRenderer_RefreshChunk(cx, cy, cz - 1);
+	for (cy = max(y - reach, 0) >> CHUNK_SHIFT; cy <= (min(y + reach, World.MaxY) >> CHUNK_SHIFT); cy++) {
+		for (cz = max(z - reach, 0) >> CHUNK_SHIFT; cz <= (min(z + reach, World.MaxZ) >> CHUNK_SHIFT); cz++) {
+			for (cx = max(x - reach, 0) >> CHUNK_SHIFT; cx <= (min(x + reach, World.MaxX) >> CHUNK_SHIFT); cx++) {
+				if (ChunkAxisDistance(x, cx) + ChunkAxisDistance(y, cy) + ChunkAxisDistance(z, cz) > reach) continue;
+
+				chunk = ChunkCoordsToIndex(cx, cy, cz);
+				if (chunkLightingData[chunk]) continue;
+				chunkLightingData[chunk] = (hc_uint8*)Mem_TryAllocCleared(CHUNK_SIZE_3, sizeof(hc_uint8));
+			}
 		}
 	}
-	else {
-		chunkLightingData[chunkIndex][localIndex] &= clearMask;
-		chunkLightingData[chunkIndex][localIndex] |= brightness << shift;
-	}
 }
-/* Returns the light level at this cell. Does NOT check that the cell is in bounds. */
-static hc_uint8 GetBrightness(int x, int y, int z, hc_bool isLamp) {
-	int cx = x >> CHUNK_SHIFT, lx = x & CHUNK_MASK;
-	int cy = y >> CHUNK_SHIFT, ly = y & CHUNK_MASK;
-	int cz = z >> CHUNK_SHIFT, lz = z & CHUNK_MASK;
-	int chunkIndex = ChunkCoordsToIndex(cx, cy, cz), localIndex;
 
-	if (chunkLightingData[chunkIndex] == NULL) { return 0; }
-	localIndex = LocalCoordsToIndex(lx, ly, lz);
+/* A cell that light is being spread from, along with everything needed to find its neighbours */
+struct LightCell {
+	hc_uint32 chunk;
+	int local, lx, ly, lz;
+	int x, y, z, index; /* Coordinates and index of the cell in the world */
+};
+
+static void LightCell_Init(struct LightCell* cell, hc_uint32 chunk, int local) {
+	struct LightChunkPos* pos = &chunkPositions[chunk];
+	cell->chunk = chunk;
+	cell->local = local;
+
+	cell->lx = local & CHUNK_MASK;
+	cell->lz = (local >> CHUNK_SHIFT) & CHUNK_MASK;
+	cell->ly = local >> (CHUNK_SHIFT * 2);
+	cell->x  = (pos->x << CHUNK_SHIFT) + cell->lx;
+	cell->y  = (pos->y << CHUNK_SHIFT) + cell->ly;
+	cell->z  = (pos->z << CHUNK_SHIFT) + cell->lz;
+	cell->index = World_Pack(cell->x, cell->y, cell->z);
+}
+
+/* Queues light to be spread from the given cell, allocating light data for every chunk it can reach */
+static void LightQueue_PushSeed(struct LightQueue* queue, hc_uint32 chunk, int local, int brightness) {
+	struct LightCell cell;
+	LightCell_Init(&cell, chunk, local);
 
-	return isLamp ?
-		chunkLightingData[chunkIndex][localIndex] >> FANCY_LIGHTING_LAMP_SHIFT :
-		chunkLightingData[chunkIndex][localIndex] & FANCY_LIGHTING_MAX_LEVEL;
+	AllocChunksInReach(cell.x, cell.y, cell.z, brightness);
+	LightQueue_Push(queue, chunk, local, brightness);
 }
 
+/* Finds the cell adjacent to the given face of a cell, returning false if it is outside the map */
+/* Only crossing into another chunk changes the chunk, so neither index is recalculated from coordinates */
+static HC_INLINE hc_bool LightCell_Neighbour(const struct LightCell* cell, int face, struct LightNode* node, int* index) {
+	node->chunk = cell->chunk;
+
+	switch (face) {
+	case FACE_XMIN:
+		if (cell->x == 0) return false;
+		*index = cell->index - 1;
+		if (cell->lx) { node->local = cell->local - 1; return true; }
+
+		node->chunk -= 1;
+		node->local  = cell->local | CHUNK_MAX;
+		return true;
+	case FACE_XMAX:
+		if (cell->x == World.MaxX) return false;
+		*index = cell->index + 1;
+		if (cell->lx != CHUNK_MAX) { node->local = cell->local + 1; return true; }
+
+		node->chunk += 1;
+		node->local  = cell->local & ~CHUNK_MAX;
+		return true;
+	case FACE_ZMIN:
+		if (cell->z == 0) return false;
+		*index = cell->index - World.Width;
+		if (cell->lz) { node->local = cell->local - CHUNK_SIZE; return true; }
+
+		node->chunk -= World.ChunksX;
+		node->local  = cell->local | (CHUNK_MAX << CHUNK_SHIFT);
+		return true;
+	case FACE_ZMAX:
+		if (cell->z == World.MaxZ) return false;
+		*index = cell->index + World.Width;
+		if (cell->lz != CHUNK_MAX) { node->local = cell->local + CHUNK_SIZE; return true; }
+
+		node->chunk += World.ChunksX;
+		node->local  = cell->local & ~(CHUNK_MAX << CHUNK_SHIFT);
+		return true;
+	case FACE_YMIN:
+		if (cell->y == 0) return false;
+		*index = cell->index - World.OneY;
+		if (cell->ly) { node->local = cell->local - CHUNK_SIZE_2; return true; }
+
+		node->chunk -= World.ChunksX * World.ChunksZ;
+		node->local  = cell->local | (CHUNK_MAX << (CHUNK_SHIFT * 2));
+		return true;
+	case FACE_YMAX:
+		if (cell->y == World.MaxY) return false;
+		*index = cell->index + World.OneY;
+		if (cell->ly != CHUNK_MAX) { node->local = cell->local + CHUNK_SIZE_2; return true; }
+
+		node->chunk += World.ChunksX * World.ChunksZ;
+		node->local  = cell->local & ~(CHUNK_MAX << (CHUNK_SHIFT * 2));
+		return true;
+	}
+	return false;
+}
 
 /* Light can never pass through a block that's full sized and blocks light */
 /* We can assume a block is full sized if none of the LightOffset flags are 0 */
@@ -214,50 +379,44 @@ static hc_bool CanLightPass(BlockID thisBlock, Face face) {
 	return !Block_IsFaceHidden(BLOCK_STONE, thisBlock, face);
 }
 
-#define Light_TrySpreadInto(axis, AXIS, dir, limit, isLamp, thisFace, thatFace) \
-	if (ln.coords.axis dir ## = limit && \
-		CanLightPass(thisBlock, FACE_ ## AXIS ## thisFace) && \
-		CanLightPass(World_GetBlock(ln.coords.x, ln.coords.y, ln.coords.z), FACE_ ## AXIS ## thatFace) && \
-		GetBrightness(ln.coords.x, ln.coords.y, ln.coords.z, isLamp) < ln.brightness) { \
-		Queue_Enqueue(&lightQueue, &ln); \
+/* NOTE: thisFace is the face opposite to face */
+#define Light_TrySpreadInto(face) \
+	if (LightCell_Neighbour(&cell, face, &next, &index) && \
+		CanLightPass(thisBlock, (face) ^ 1) && \
+		CanLightPass(World_GetRawBlock(index), face) && \
+		LightData_Get(next.chunk, next.local, shift) < next.brightness) { \
+		LightQueue_Push(queue, next.chunk, next.local, next.brightness); \
 	} \
 
-static void FlushLightQueue(hc_bool isLamp, hc_bool refreshChunk) {
-	struct LightNode ln;
-	hc_uint8 brightnessHere;
+static void FlushLightQueue(struct LightQueue* queue, hc_bool isLamp, hc_bool refreshChunk) {
+	int shift = isLamp ? FANCY_LIGHTING_LAMP_SHIFT : 0;
+	struct LightNode ln, next;
+	struct LightCell cell;
 	BlockID thisBlock;
+	int index;
 
-	while (lightQueue.count > 0) {
-		ln = *(struct LightNode*)(Queue_Dequeue(&lightQueue));
-
-		brightnessHere = GetBrightness(ln.coords.x, ln.coords.y, ln.coords.z, isLamp);
+	while (LightQueue_Count(queue) > 0) {
+		ln = LightQueue_Pop(queue);
 
 		/* If this cell is already more lit, we can assume this cell and its neighbors have been accounted for */
-		if (brightnessHere >= ln.brightness) { continue; }
+		if (LightData_Get(ln.chunk, ln.local, shift) >= ln.brightness) { continue; }
 		if (ln.brightness == 0) { continue; }
 
-		SetBrightness(ln.brightness, ln.coords.x, ln.coords.y, ln.coords.z, isLamp, refreshChunk);
-
-		thisBlock = World_GetBlock(ln.coords.x, ln.coords.y, ln.coords.z);
-		ln.brightness--;
-		if (ln.brightness == 0) continue;
+		/* Light data for every chunk in reach was allocated beforehand, unless that failed */
+		if (!SetBrightness(ln.chunk, ln.local, ln.brightness, shift, refreshChunk)) continue;
 
-		ln.coords.x--;
-		Light_TrySpreadInto(x, X, > , 0, isLamp, MAX, MIN)
-		ln.coords.x += 2;
-		Light_TrySpreadInto(x, X, < , World.MaxX, isLamp, MIN, MAX)
-		ln.coords.x--;
+		next.brightness = ln.brightness - 1;
+		if (next.brightness == 0) continue;
 
-		ln.coords.y--;
-		Light_TrySpreadInto(y, Y, >, 0, isLamp, MAX, MIN)
-		ln.coords.y += 2;
-		Light_TrySpreadInto(y, Y, <, World.MaxY, isLamp, MIN, MAX)
-		ln.coords.y--;
+		LightCell_Init(&cell, ln.chunk, ln.local);
+		thisBlock = World_GetRawBlock(cell.index);
 
-		ln.coords.z--;
-		Light_TrySpreadInto(z, Z, > , 0, isLamp, MAX, MIN)
-		ln.coords.z += 2;
-		Light_TrySpreadInto(z, Z, < , World.MaxZ, isLamp, MIN, MAX)
+		Light_TrySpreadInto(FACE_XMIN)
+		Light_TrySpreadInto(FACE_XMAX)
+		Light_TrySpreadInto(FACE_YMIN)
+		Light_TrySpreadInto(FACE_YMAX)
+		Light_TrySpreadInto(FACE_ZMIN)
+		Light_TrySpreadInto(FACE_ZMAX)
 	}
 }
 
@@ -266,16 +425,12 @@ hc_uint8 GetBlockBrightness(BlockID curBlock, hc_bool isLamp) {
 	return Blocks.Brightness[curBlock] & FANCY_LIGHTING_MAX_LEVEL;
 }
 
-#define LightNode_Init(node, X, Y, Z, bright) \
-	node.coords.x = X; node.coords.y = Y; node.coords.z = Z; node.brightness = bright;
-
-static void CalculateChunkLightingSelf(int chunkIndex, int cx, int cy, int cz) {
+static void CalculateChunkLightingSelf(struct LightQueue* queue, int chunkIndex, int cx, int cy, int cz) {
 	int x, y, z;
 	/* Block coordinates */
 	int chunkStartX, chunkStartY, chunkStartZ, chunkEndX, chunkEndY, chunkEndZ;
 	hc_uint8 brightness;
 	BlockID curBlock;
-	struct LightNode entry;
 
 	chunkStartX = cx * CHUNK_SIZE;
 	chunkStartY = cy * CHUNK_SIZE;
@@ -299,16 +454,16 @@ static void CalculateChunkLightingSelf(int chunkIndex, int cx, int cy, int cz) {
 					brightness = GetBlockBrightness(curBlock, false);
 
 					if (brightness > 0) {
-						LightNode_Init(entry, x, y, z, brightness);
-						Queue_Enqueue(&lightQueue, &entry);
-						FlushLightQueue(false, false);
+						AllocChunksInReach(x, y, z, brightness);
+						LightQueue_Push(queue, chunkIndex, GlobalCoordsToChunkCoordsIndex(x, y, z), brightness);
+						FlushLightQueue(queue, false, false);
 					}
 					else {
 						/* If no lava brightness, it must use lamp brightness */
 						brightness = Blocks.Brightness[curBlock] >> FANCY_LIGHTING_LAMP_SHIFT;
-						LightNode_Init(entry, x, y, z, brightness);
-						Queue_Enqueue(&lightQueue, &entry);
-						FlushLightQueue(true, false);
+						AllocChunksInReach(x, y, z, brightness);
+						LightQueue_Push(queue, chunkIndex, GlobalCoordsToChunkCoordsIndex(x, y, z), brightness);
+						FlushLightQueue(queue, true, false);
 					}
 				}
 
@@ -349,7 +504,7 @@ static void CalculateChunkLightingAll(int chunkIndex, int cx, int cy, int cz) {
 				curChunkIndex = ChunkCoordsToIndex(x, y, z);
 
 				if (chunkLightingDataFlags[curChunkIndex] == CHUNK_UNCALCULATED) {
-					CalculateChunkLightingSelf(curChunkIndex, x, y, z);
+					CalculateChunkLightingSelf(&lightQueue, curChunkIndex, x, y, z);
 				}
 			}
 		}
@@ -358,116 +513,306 @@ static void CalculateChunkLightingAll(int chunkIndex, int cx, int cy, int cz) {
 }
 
 
-#define Light_TryUnSpreadInto(axis, dir, limit, AXIS, thisFace, thatFace) \
-		if (neighborCoords.axis dir ## = limit && \
-			CanLightPass(thisBlock, FACE_ ## AXIS ## thisFace) && \
-			CanLightPass(World_GetBlock(neighborCoords.x, neighborCoords.y, neighborCoords.z), FACE_ ## AXIS ## thatFace) \
+#ifndef HC_BUILD_COOPTHREADED
+/* Light from a block spreads at most 14 blocks, so never reaches past the adjacent chunk. */
+/* The map is split into slabs 2 chunks wide along X, and all even slabs are calculated */
+/*  before any odd slabs, so two threads never write light into the same chunk at once */
+#define PRECOMPUTE_SLAB_CHUNKS 2
+#define PRECOMPUTE_MAX_THREADS 32
+
+static struct LightPrecompute {
+	void* mutex;
+	void* finished; /* Signalled once the background calculation has stopped */
+	volatile hc_bool running, cancel;
+	hc_bool active; /* Whether the background calculation has not been waited on yet */
+	int numThreads, numSlabs, nextSlab;
+	hc_uint8* slabsDone;
+	volatile hc_uint8* columnsReady; /* Whether lighting in each column of chunks along X is final */
+} precompute;
+#define Precompute_Busy() precompute.running
+
+static void Precompute_CalcSlab(struct LightQueue* queue, int slab) {
+	int cx, cy, cz;
+	int endX = min((slab + 1) * PRECOMPUTE_SLAB_CHUNKS, World.ChunksX);
+
+	for (cx = slab * PRECOMPUTE_SLAB_CHUNKS; cx < endX; cx++) {
+		for (cy = 0; cy < World.ChunksY; cy++) {
+			for (cz = 0; cz < World.ChunksZ; cz++) {
+				if (precompute.cancel) return;
+				CalculateChunkLightingSelf(queue, ChunkCoordsToIndex(cx, cy, cz), cx, cy, cz);
+			}
+		}
+	}
+}
+
+static hc_bool Precompute_ColumnDone(int cx) {
+	if (cx < 0 || cx >= World.ChunksX) return true;
+	return precompute.slabsDone[cx / PRECOMPUTE_SLAB_CHUNKS];
+}
+
+/* Marks columns that can no longer receive light from any other column as final */
+static void Precompute_MarkDone(int slab) {
+	int cx, cy, cz, minX, maxX;
+	precompute.slabsDone[slab] = true;
+
+	minX = max(slab * PRECOMPUTE_SLAB_CHUNKS - 1, 0);
+	maxX = min((slab + 1) * PRECOMPUTE_SLAB_CHUNKS, World.ChunksX - 1);
+
+	for (cx = minX; cx <= maxX; cx++) {
+		if (!Precompute_ColumnDone(cx - 1) || !Precompute_ColumnDone(cx) || !Precompute_ColumnDone(cx + 1)) continue;
+
+		for (cy = 0; cy < World.ChunksY; cy++) {
+			for (cz = 0; cz < World.ChunksZ; cz++) {
+				chunkLightingDataFlags[ChunkCoordsToIndex(cx, cy, cz)] = CHUNK_ALL_CALCULATED;
+			}
+		}
+		precompute.columnsReady[cx] = true;
+	}
+}
+
+static void Precompute_Worker(void) {
+	struct LightQueue queue = { 0 };
+	int slab;
+
+	for (;;) {
+		Mutex_Lock(precompute.mutex);
+		{
+			slab = precompute.nextSlab;
+			precompute.nextSlab += 2;
+		}
+		Mutex_Unlock(precompute.mutex);
+		if (slab >= precompute.numSlabs) break;
+
+		Precompute_CalcSlab(&queue, slab);
+		if (precompute.cancel) break;
+
+		Mutex_Lock(precompute.mutex);
+		{
+			Precompute_MarkDone(slab);
+		}
+		Mutex_Unlock(precompute.mutex);
+	}
+	LightQueue_Free(&queue);
+}
+
+static void Precompute_Run(void) {
+	void* threads[PRECOMPUTE_MAX_THREADS];
+	int i, phase;
+
+	/* Even slabs first, then odd slabs */
+	for (phase = 0; phase < 2 && !precompute.cancel; phase++) {
+		precompute.nextSlab = phase;
+
+		for (i = 1; i < precompute.numThreads; i++) {
+			Thread_Run(&threads[i], Precompute_Worker, 64 * 1024, "Lighting worker");
+		}
+		/* This thread works on slabs too while waiting */
+		Precompute_Worker();
+
+		for (i = 1; i < precompute.numThreads; i++) {
+			Thread_Join(threads[i]);
+		}
+	}
+
+	precompute.running = false;
+	Waitable_Signal(precompute.finished);
+}
+
+/* Starts calculating lighting for the entire map across gfx-lightingthreads background threads */
+static void Precompute_Start(void) {
+	void* thread;
+	int numThreads = Options_GetInt(OPT_LIGHTING_THREADS, 0, PRECOMPUTE_MAX_THREADS, 0);
+	if (!numThreads) return;
+
+	if (!precompute.mutex) {
+		precompute.mutex    = Mutex_Create("Lighting slabs");
+		precompute.finished = Waitable_Create("Lighting finished");
+	}
+	precompute.numThreads = numThreads;
+	precompute.numSlabs   = (World.ChunksX + PRECOMPUTE_SLAB_CHUNKS - 1) / PRECOMPUTE_SLAB_CHUNKS;
+
+	precompute.slabsDone    = (hc_uint8*)Mem_AllocCleared(precompute.numSlabs, 1, "light slabs");
+	precompute.columnsReady = (hc_uint8*)Mem_AllocCleared(World.ChunksX, 1, "light columns");
+	precompute.cancel  = false;
+	precompute.running = true;
+	precompute.active  = true;
+
+	Thread_Run(&thread, Precompute_Run, 64 * 1024, "Lighting calc");
+	Thread_Detach(thread);
+}
+
+/* Blocks until the background calculation has finished */
+static void Precompute_Wait(void) {
+	if (!precompute.active) return;
+	Waitable_Wait(precompute.finished);
+	precompute.active = false;
+
+	Mem_Free(precompute.slabsDone);
+	Mem_Free((hc_uint8*)precompute.columnsReady);
+	precompute.slabsDone    = NULL;
+	precompute.columnsReady = NULL;
+}
+
+static void Precompute_Stop(void) {
+	precompute.cancel = true;
+	Precompute_Wait();
+}
+
+static hc_bool IsChunkPending(int cx, int cy, int cz) {
+	int x;
+	if (!precompute.active) return false;
+	if (!precompute.running) { Precompute_Wait(); return false; }
+
+	/* Building a chunk's mesh needs the lighting of its neighbours too */
+	for (x = max(cx - 1, 0); x <= min(cx + 1, World.ChunksX - 1); x++) {
+		if (!precompute.columnsReady[x]) return true;
+	}
+	return false;
+}
+#else
+#define Precompute_Busy() false
+static void Precompute_Start(void) { }
+static void Precompute_Wait(void) { }
+static void Precompute_Stop(void) { }
+static hc_bool IsChunkPending(int cx, int cy, int cz) { return false; }
+#endif
+
+
+/* NOTE: thisFace is the face opposite to face */
+#define Light_TryUnSpreadInto(face) \
+		if (LightCell_Neighbour(&cell, face, &next, &index) && \
+			CanLightPass(thisBlock, (face) ^ 1) && \
+			CanLightPass(World_GetRawBlock(index), face) \
 		) \
 		{ \
-			neighborBrightness = GetBrightness(neighborCoords.x, neighborCoords.y, neighborCoords.z, isLamp); \
-			neighborBlockBrightness = GetBlockBrightness(World_GetBlock(neighborCoords.x, neighborCoords.y, neighborCoords.z), isLamp); \
+			neighborBlock = World_GetRawBlock(index); \
+			neighborBrightness = LightData_Get(next.chunk, next.local, shift); \
+			neighborBlockBrightness = GetBlockBrightness(neighborBlock, isLamp); \
 			/* This spot is a light caster, mark this spot as needing to be re-spread */ \
 			if (neighborBlockBrightness > 0) { \
-				LightNode_Init(otherNode, neighborCoords.x, neighborCoords.y, neighborCoords.z, neighborBlockBrightness); \
-				Queue_Enqueue(&lightQueue, &otherNode); \
+				LightQueue_PushSeed(&lightQueue, next.chunk, next.local, neighborBlockBrightness); \
 			} \
 			if (neighborBrightness > 0) { \
 				/* This neighbor is darker than cur spot, darken it*/ \
 				if (neighborBrightness < curNode.brightness) { \
-					SetBrightness(0, neighborCoords.x, neighborCoords.y, neighborCoords.z, isLamp, true); \
-					LightNode_Init(otherNode, neighborCoords.x, neighborCoords.y, neighborCoords.z, neighborBrightness); \
-					Queue_Enqueue(&unlightQueue, &otherNode); \
+					SetBrightness(next.chunk, next.local, 0, shift, true); \
+					LightQueue_Push(&unlightQueue, next.chunk, next.local, neighborBrightness); \
 				} \
 				/* This neighbor is brighter or same, mark this spot as needing to be re-spread */ \
 				else { \
 					/* But only if the neighbor actually *can* spread to this block */ \
 					if ( \
-						CanLightPass(thisBlockTrue, FACE_ ## AXIS ## thisFace) && \
-						CanLightPass(World_GetBlock(neighborCoords.x, neighborCoords.y, neighborCoords.z), FACE_ ## AXIS ## thatFace) \
+						CanLightPass(thisBlockTrue, (face) ^ 1) && \
+						CanLightPass(neighborBlock, face) \
 					) \
 					{ \
-						otherNode = curNode; \
-						otherNode.brightness = neighborBrightness-1; \
-						Queue_Enqueue(&lightQueue, &otherNode); \
+						LightQueue_Push(&respreadQueue, next.chunk, next.local, neighborBrightness); \
 					} \
 				} \
 			} \
 		} \
 
-/* Spreads darkness out from this point and relights any necessary areas afterward */
-static void CalcUnlight(int x, int y, int z, hc_uint8 brightness, hc_bool isLamp) {
-	int count = 0;
-	struct LightNode curNode, otherNode;
+/* Spreads darkness out from the cells queued by QueueBlockChange and relights any necessary areas afterward */
+/* NOTE: The first 'seeds' cells in the unlight queue must be the cells where the blocks changed */
+static void SpreadBlockChanges(int seeds, hc_bool isLamp) {
+	int shift = isLamp ? FANCY_LIGHTING_LAMP_SHIFT : 0;
+	int count = 0, index;
+	struct LightNode curNode, next;
+	struct LightCell cell;
 	hc_uint8 neighborBrightness, neighborBlockBrightness;
-	IVec3 neighborCoords;
-	BlockID thisBlockTrue, thisBlock;
-
-	SetBrightness(0, x, y, z, isLamp, true);
-	LightNode_Init(curNode, x, y, z, brightness);
-	Queue_Enqueue(&unlightQueue, &curNode);
+	BlockID thisBlockTrue, thisBlock, neighborBlock;
 
-	while (unlightQueue.count > 0) {
-		curNode = *(struct LightNode*)(Queue_Dequeue(&unlightQueue));
-		neighborCoords = curNode.coords;
+	while (LightQueue_Count(&unlightQueue) > 0) {
+		curNode = LightQueue_Pop(&unlightQueue);
+		LightCell_Init(&cell, curNode.chunk, curNode.local);
 
-		thisBlockTrue = World_GetBlock(neighborCoords.x, neighborCoords.y, neighborCoords.z);
-		/* For the original cell in the queue, assume this block is air
+		thisBlockTrue = World_GetRawBlock(cell.index);
+		/* For the original cells in the queue, assume this block is air
 		so that light can unspread "out" of it in the case of a solid blocks. */
-		thisBlock = count == 0 ? BLOCK_AIR : thisBlockTrue;
+		thisBlock = count < seeds ? BLOCK_AIR : thisBlockTrue;
 
 		count++;
 
-		neighborCoords.x--;
-		Light_TryUnSpreadInto(x, >, 0, X, MAX, MIN)
-		neighborCoords.x += 2;
-		Light_TryUnSpreadInto(x, <, World.MaxX, X, MIN, MAX)
-		neighborCoords.x--;
-
-		neighborCoords.y--;
-		Light_TryUnSpreadInto(y, >, 0, Y, MAX, MIN)
-		neighborCoords.y += 2;
-		Light_TryUnSpreadInto(y, <, World.MaxY, Y, MIN, MAX)
-		neighborCoords.y--;
-
-		neighborCoords.z--;
-		Light_TryUnSpreadInto(z, >, 0, Z, MAX, MIN)
-		neighborCoords.z += 2;
-		Light_TryUnSpreadInto(z, <, World.MaxZ, Z, MIN, MAX)
+		Light_TryUnSpreadInto(FACE_XMIN)
+		Light_TryUnSpreadInto(FACE_XMAX)
+		Light_TryUnSpreadInto(FACE_YMIN)
+		Light_TryUnSpreadInto(FACE_YMAX)
+		Light_TryUnSpreadInto(FACE_ZMIN)
+		Light_TryUnSpreadInto(FACE_ZMAX)
 	}
 
-	FlushLightQueue(isLamp, true);
+	/* Darkness spreading out from another changed block may have since reached a bordering cell too */
+	while (LightQueue_Count(&respreadQueue) > 0) {
+		curNode = LightQueue_Pop(&respreadQueue);
+		neighborBrightness = LightData_Get(curNode.chunk, curNode.local, shift);
+		if (!neighborBrightness) continue;
+
+		/* Clear the cell so that it is relit, and so spreads its light again */
+		SetBrightness(curNode.chunk, curNode.local, 0, shift, false);
+		LightQueue_PushSeed(&lightQueue, curNode.chunk, curNode.local, neighborBrightness);
+	}
+	FlushLightQueue(&lightQueue, isLamp, true);
 }
-static void CalcBlockChange(int x, int y, int z, BlockID oldBlock, BlockID newBlock, hc_bool isLamp) {
+
+/* Queues the light changes needed for a block change, returning whether darkness needs to spread out from it */
+static hc_bool QueueBlockChange(int x, int y, int z, BlockID oldBlock, BlockID newBlock, hc_bool isLamp) {
 	hc_uint8 oldBlockLightLevel = GetBlockBrightness(oldBlock, isLamp);
 	hc_uint8 newBlockLightLevel = GetBlockBrightness(newBlock, isLamp);
 	hc_uint8 oldLightLevelHere = GetBrightness(x, y, z, isLamp);
-	struct LightNode entry;
+	hc_uint32 chunk = GlobalCoordsToChunkIndex(x, y, z);
+	int local = GlobalCoordsToChunkCoordsIndex(x, y, z);
 
 	/* Cell has no lighting and new block doesn't cast light and blocks all light, no change */
-	if (!oldLightLevelHere && !newBlockLightLevel && IsFullOpaque(newBlock)) return;
+	if (!oldLightLevelHere && !newBlockLightLevel && IsFullOpaque(newBlock)) return false;
 
 	/* Cell is darker than the new block, only brighter case */
 	if (oldLightLevelHere < newBlockLightLevel) {
 		/* brighten this spot, recalculate lighting */
-		LightNode_Init(entry, x, y, z, newBlockLightLevel);
-		Queue_Enqueue(&lightQueue, &entry);
-		FlushLightQueue(isLamp, true);
-		return;
+		AllocChunksInReach(x, y, z, newBlockLightLevel);
+		LightQueue_Push(&lightQueue, chunk, local, newBlockLightLevel);
+		return false;
 	}
 
 	/* Light passes through old and new, old block does not cast light, new block does not cast light; no change */
-	if (IsFullTransparent(oldBlock) && IsFullTransparent(newBlock) && !oldBlockLightLevel && !newBlockLightLevel) return;
+	if (IsFullTransparent(oldBlock) && IsFullTransparent(newBlock) && !oldBlockLightLevel && !newBlockLightLevel) return false;
 
-	CalcUnlight(x, y, z, oldLightLevelHere, isLamp);
+	SetBrightness(chunk, local, 0, isLamp ? FANCY_LIGHTING_LAMP_SHIFT : 0, true);
+	LightQueue_Push(&unlightQueue, chunk, local, oldLightLevelHere);
+	return true;
 }
+
 static void OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock) {
 	/* For some reason this is a possible case */
 	if (oldBlock == newBlock) { return; }
+	Precompute_Wait();
 
 	ClassicLighting_OnBlockChanged(x, y, z, oldBlock, newBlock);
 
-	CalcBlockChange(x, y, z, oldBlock, newBlock, false);
-	CalcBlockChange(x, y, z, oldBlock, newBlock, true);
+	SpreadBlockChanges(QueueBlockChange(x, y, z, oldBlock, newBlock, false), false);
+	SpreadBlockChanges(QueueBlockChange(x, y, z, oldBlock, newBlock, true),  true);
+}
+
+/* Darkness spreads out from all the changed blocks together, so overlapping areas are only relit once */
+static void CalcBlockChanges(const struct LightingBlockChange* changes, int count, hc_bool isLamp) {
+	const struct LightingBlockChange* c;
+	int i, seeds = 0;
+
+	for (i = 0; i < count; i++) {
+		c = &changes[i];
+		if (c->oldBlock == c->newBlock) continue;
+		seeds += QueueBlockChange(c->x, c->y, c->z, c->oldBlock, c->newBlock, isLamp);
+	}
+	SpreadBlockChanges(seeds, isLamp);
+}
+
+static void OnBlocksChanged(const struct LightingBlockChange* changes, int count) {
+	Precompute_Wait();
+	Lighting_BeginBatch();
+
+	ClassicLighting_OnBlocksChanged(changes, count);
+	CalcBlockChanges(changes, count, false);
+	CalcBlockChanges(changes, count, true);
+	Lighting_EndBatch();
 }
 /* Invalidates/Resets lighting state for all of the blocks in the world */
 /*  (e.g. because a block changed whether it is full bright or not) */
@@ -479,8 +824,9 @@ static void Refresh(void) {
 static hc_bool IsLit(int x, int y, int z) { return ClassicLighting_IsLit(x, y, z); }
 static hc_bool IsLit_Fast(int x, int y, int z) { return ClassicLighting_IsLit_Fast(x, y, z); }
 
+/* Chunks still being calculated in the background are left alone */
 #define CalcForChunkIfNeeded(cx, cy, cz, chunkIndex) \
-	if (chunkLightingDataFlags[chunkIndex] < CHUNK_ALL_CALCULATED) { \
+	if (chunkLightingDataFlags[chunkIndex] < CHUNK_ALL_CALCULATED && !Precompute_Busy()) { \
 		CalculateChunkLightingAll(chunkIndex, cx, cy, cz); \
 	}
 
@@ -497,7 +843,8 @@ static PackedCol Color_Core(int x, int y, int z, int paletteFace) {
 	CalcForChunkIfNeeded(cx, cy, cz, chunkIndex);
 
 	/* There might be no light data in this chunk even after it was calculated */
-	if (chunkLightingData[chunkIndex] == NULL) {
+	/*  (and chunks still being calculated in the background are treated as unlit) */
+	if (chunkLightingDataFlags[chunkIndex] < CHUNK_ALL_CALCULATED || chunkLightingData[chunkIndex] == NULL) {
 		lightData = 0;
 	} else {
 		chunkCoordsIndex = GlobalCoordsToChunkCoordsIndex(x, y, z);
@@ -537,20 +884,29 @@ static PackedCol Color_ZSide(int x, int y, int z) {
 
 static void LightHint(int startX, int startY, int startZ) {
 	int cx, cy, cz, chunkIndex;
+	int x1, y1, z1, x2, y2, z2;
 	ClassicLighting_LightHint(startX, startY, startZ);
-	/* Add 1 to startX/Z, as coordinates are for the extended chunk (18x18x18) */
-	startX++; startY++; startZ++;
-
-	cx = (startX + HALF_CHUNK_SIZE) >> CHUNK_SHIFT;
-	cy = (startY + HALF_CHUNK_SIZE) >> CHUNK_SHIFT;
-	cz = (startZ + HALF_CHUNK_SIZE) >> CHUNK_SHIFT;
 
-	chunkIndex = ChunkCoordsToIndex(cx, cy, cz);
-	CalcForChunkIfNeeded(cx, cy, cz, chunkIndex);
+	/* Calculate lighting for every chunk the extended chunk (18x18x18) overlaps, */
+	/*  so that the _Fast functions never need to calculate lighting themselves */
+	/*  (as chunk meshes may be built on a worker thread) */
+	x1 = max(startX, 0) >> CHUNK_SHIFT; x2 = min(startX + EXTCHUNK_SIZE, World.Width)  - 1;
+	y1 = max(startY, 0) >> CHUNK_SHIFT; y2 = min(startY + EXTCHUNK_SIZE, World.Height) - 1;
+	z1 = max(startZ, 0) >> CHUNK_SHIFT; z2 = min(startZ + EXTCHUNK_SIZE, World.Length) - 1;
+
+	for (cy = y1; cy <= (y2 >> CHUNK_SHIFT); cy++) {
+		for (cz = z1; cz <= (z2 >> CHUNK_SHIFT); cz++) {
+			for (cx = x1; cx <= (x2 >> CHUNK_SHIFT); cx++) {
+				chunkIndex = ChunkCoordsToIndex(cx, cy, cz);
+				CalcForChunkIfNeeded(cx, cy, cz, chunkIndex);
+			}
+		}
+	}
 }
 
 void FancyLighting_SetActive(void) {
 	Lighting.OnBlockChanged = OnBlockChanged;
+	Lighting.OnBlocksChanged = OnBlocksChanged;
 	Lighting.Refresh = Refresh;
 	Lighting.IsLit = IsLit;
 	Lighting.Color = Color;
@@ -566,6 +922,8 @@ void FancyLighting_SetActive(void) {
 	Lighting.FreeState  = FreeState;
 	Lighting.AllocState = AllocState;
 	Lighting.LightHint  = LightHint;
+	Lighting.IsChunkPending = IsChunkPending;
+	Lighting.WaitPending    = Precompute_Wait;
 }
 
 static void OnEnvVariableChanged(void* obj, int envVar) {
@@ -16,11 +16,19 @@
 #include "Chat.h"
 #include "TexturePack.h"
 #include "Utils.h"
+#include "Options.h"
+#include "Screens.h"
+#include "Builder.h"
 
 #ifdef HC_BUILD_FILESYSTEM
 static struct LocationUpdate* spawn_point;
 static struct MapImporter* imp_head;
 static struct MapImporter* imp_tail;
+static struct MapImporter raw_imp;
+#ifdef HC_BUILD_FILEMAP
+/* File being imported from, when the map is loaded directly from a file */
+static hc_file* raw_file;
+#endif
 
 
 /*########################################################################################################################*
@@ -61,27 +69,14 @@ struct MapImporter* MapImporter_Find(const hc_string* path) {
 	return NULL;
 }
 
-hc_result Map_LoadFrom(const hc_string* path) {
+static hc_result Map_Import(struct MapImporter* imp, struct Stream* stream, const hc_string* path) {
 	hc_string relPath, fileName, fileExt;
 	struct LocationUpdate update = { 0 };
-	struct MapImporter* imp;
-	struct Stream stream;
 	hc_result res;
 	Game_Reset();
 	
 	spawn_point = &update;
-	res = Stream_OpenFile(&stream, path);
-	if (res) { Logger_SysWarn2(res, "opening", path); return res; }
-
-	imp = MapImporter_Find(path);
-	if (!imp) {
-		res = ERR_NOT_SUPPORTED;
-	} else if ((res = imp->import(&stream))) {
-		World_Reset();
-	}
-
-	/* No point logging error for closing readonly file */
-	(void)stream.Close(&stream);
+	if ((res = imp->import(stream))) World_Reset();
 	if (res) Logger_SysWarn2(res, "decoding", path);
 
 	World_SetNewMap(World.Blocks, World.Width, World.Height, World.Length);
@@ -96,6 +91,247 @@ hc_result Map_LoadFrom(const hc_string* path) {
 }
 
 
+/*########################################################################################################################*
+*---------------------------------------------------Background map I/O----------------------------------------------------*
+*#########################################################################################################################*/
+/* Reading and decompressing (or compressing and writing) a large map can take several seconds, */
+/*  so where real threads are available this is done on a background thread instead */
+#ifndef HC_BUILD_COOPTHREADED
+#define MAP_BACKGROUND_IO
+#endif
+#define MAP_TASK_CHUNK (64 * 1024)
+
+static struct MapTask {
+	void* thread;
+	volatile hc_bool done, cancel;
+	volatile float progress;
+	hc_bool active, saving, inflated;
+	hc_result res;
+	struct Stream file;
+	struct MapImporter* imp;
+	struct GZipState* gzip;
+	hc_uint8* data; /* File contents when loading, encoded map when saving */
+	hc_uint32 length;
+	hc_string path; char _pathBuffer[FILENAME_SIZE];
+} map_task;
+
+static void MapTask_FinishLoad(void);
+static void MapTask_FinishSave(void);
+
+static void MapTask_Finish(void) {
+#ifdef MAP_BACKGROUND_IO
+	Thread_Join(map_task.thread);
+#endif
+	map_task.active = false;
+
+	if (map_task.saving) {
+		MapTask_FinishSave();
+	} else {
+		MapTask_FinishLoad();
+	}
+	Mem_Free(map_task.data);
+	map_task.data = NULL;
+}
+
+static void MapTask_Start(Thread_StartFunc func, const char* name, const hc_string* path) {
+	String_InitArray(map_task.path, map_task._pathBuffer);
+	String_Copy(&map_task.path, path);
+
+	map_task.done     = false;
+	map_task.cancel   = false;
+	map_task.progress = 0.0f;
+	map_task.active   = true;
+
+#ifdef MAP_BACKGROUND_IO
+	Thread_Run(&map_task.thread, func, 64 * 1024, name);
+#else
+	func();
+	MapTask_Finish();
+#endif
+}
+
+/* Blocks until the current background load or save (if any) has completed */
+static void MapTask_Wait(void) {
+	if (map_task.active) MapTask_Finish();
+}
+
+static void MapTask_Tick(struct ScheduledTask* task) {
+	hc_string msg; char msgBuffer[STRING_SIZE];
+	int percent;
+	if (!map_task.active) return;
+	if (map_task.done) { MapTask_Finish(); return; }
+
+	if (!map_task.saving) {
+		Event_RaiseFloat(&WorldEvents.Loading, map_task.progress); return;
+	}
+	percent = (int)(map_task.progress * 100);
+
+	String_InitArray(msg, msgBuffer);
+	String_Format1(&msg, "&eSaving map (&7%i&e%%)", &percent);
+	Chat_AddOf(&msg, MSG_TYPE_EXTRASTATUS_1);
+}
+
+
+/*########################################################################################################################*
+*---------------------------------------------------------Loading---------------------------------------------------------*
+*#########################################################################################################################*/
+#ifdef MAP_BACKGROUND_IO
+static hc_result MapTask_ReadFile(void) {
+	hc_uint32 i, count;
+	hc_result res;
+	if ((res = map_task.file.Length(&map_task.file, &map_task.length))) return res;
+
+	map_task.data = (hc_uint8*)Mem_TryAlloc(max(map_task.length, 1), 1);
+	if (!map_task.data) return ERR_OUT_OF_MEMORY;
+
+	for (i = 0; i < map_task.length && !map_task.cancel; i += count) 
+	{
+		count = min(map_task.length - i, MAP_TASK_CHUNK);
+		if ((res = Stream_Read(&map_task.file, map_task.data + i, count))) return res;
+		map_task.progress = 0.25f * (float)(i + count) / map_task.length;
+	}
+	return 0;
+}
+
+/* Decompresses the whole gzip compressed file, replacing map_task.data */
+static hc_result MapTask_Inflate(void) {
+	struct InflateState* state;
+	struct Stream src, comp;
+	hc_uint32 size, capacity, used, read;
+	hc_uint8* data;
+	hc_uint8* grown;
+	hc_result res;
+
+	/* Last 4 bytes of gzip data are the decompressed size (modulo 2^32) */
+	/*  +1 so that the end of the data is found without having to grow the buffer */
+	size     = Stream_GetU32_LE(map_task.data + map_task.length - 4);
+	capacity = max(size, MAP_TASK_CHUNK);
+	if (capacity < 0xFFFFFFFFUL) capacity++;
+
+	state = (struct InflateState*)Mem_TryAlloc(1, sizeof(struct InflateState));
+	data  = (hc_uint8*)Mem_TryAlloc(capacity, 1);
+	if (!state || !data) { Mem_Free(state); Mem_Free(data); return ERR_OUT_OF_MEMORY; }
+
+	Stream_ReadonlyMemory(&src, map_task.data, map_task.length);
+	Inflate_MakeStream2(&comp, state, &src);
+	res  = Map_SkipGZipHeader(&src);
+	used = 0;
+
+	while (!res && !map_task.cancel) 
+	{
+		if (used == capacity) {
+			grown = capacity < 0x80000000UL ? (hc_uint8*)Mem_TryRealloc(data, capacity * 2, 1) : NULL;
+			if (!grown) { res = ERR_OUT_OF_MEMORY; break; }
+			data = grown; capacity *= 2;
+		}
+
+		res = comp.Read(&comp, data + used, min(capacity - used, MAP_TASK_CHUNK), &read);
+		if (res || !read) break;
+		used += read;
+		map_task.progress = 0.25f + 0.75f * (float)(map_task.length - src.meta.mem.left) / map_task.length;
+	}
+
+	Mem_Free(state);
+	Mem_Free(map_task.data);
+	map_task.data     = data;
+	map_task.length   = used;
+	map_task.inflated = true;
+	return res;
+}
+
+static void MapTask_LoadMain(void) {
+	hc_uint8* data;
+	hc_result res;
+
+	res  = MapTask_ReadFile();
+	data = map_task.data;
+	/* No point logging error for closing readonly file */
+	(void)map_task.file.Close(&map_task.file);
+
+	if (!res && !map_task.cancel && map_task.length >= 18 && data[0] == 0x1F && data[1] == 0x8B) {
+		res = MapTask_Inflate();
+	}
+	map_task.res  = res;
+	map_task.done = true;
+}
+
+#endif
+
+/* Whether the stream passed to the importer contains already decompressed gzip data */
+static hc_bool map_inflated;
+
+static void MapTask_FinishLoad(void) {
+	struct Stream stream;
+	if (map_task.cancel) return;
+	if (map_task.res) { Logger_SysWarn2(map_task.res, "reading", &map_task.path); return; }
+
+	Stream_ReadonlyMemory(&stream, map_task.data, map_task.length);
+	map_inflated = map_task.inflated;
+	Map_Import(map_task.imp, &stream, &map_task.path);
+	map_inflated = false;
+}
+
+/* Decompresses gzip data from the given stream (unless the background loader already did so) */
+static hc_result Map_OpenGZip(struct Stream* compStream, struct InflateState* state, struct Stream* stream) {
+	if (map_inflated) { *compStream = *stream; return 0; }
+
+	Inflate_MakeStream2(compStream, state, stream);
+	return Map_SkipGZipHeader(stream);
+}
+
+hc_result Map_LoadFrom(const hc_string* path) {
+	struct MapImporter* imp;
+	struct Stream stream;
+	hc_result res;
+
+	Map_CancelLoad();
+	MapTask_Wait();
+	res = Stream_OpenFile(&stream, path);
+	if (res) { Logger_SysWarn2(res, "opening", path); return res; }
+
+	imp = MapImporter_Find(path);
+	if (!imp) {
+		(void)stream.Close(&stream);
+		Logger_SysWarn2(ERR_NOT_SUPPORTED, "decoding", path);
+		return ERR_NOT_SUPPORTED;
+	}
+
+#ifdef MAP_BACKGROUND_IO
+	/* Raw maps are uncompressed and can be memory mapped, so are quick enough to load directly */
+	if (imp != &raw_imp) {
+		map_task.file     = stream;
+		map_task.imp      = imp;
+		map_task.saving   = false;
+		map_task.inflated = false;
+		map_task.data     = NULL;
+
+		MapTask_Start(MapTask_LoadMain, "Map load", path);
+		LoadingMapScreen_Show(&map_task.path);
+		return 0;
+	}
+#endif
+
+#ifdef HC_BUILD_FILEMAP
+	raw_file = &stream.meta.file;
+#endif
+	res = Map_Import(imp, &stream, path);
+#ifdef HC_BUILD_FILEMAP
+	raw_file = NULL;
+#endif
+	/* No point logging error for closing readonly file */
+	(void)stream.Close(&stream);
+	return res;
+}
+
+void Map_CancelLoad(void) {
+	if (!Map_IsLoading()) return;
+	map_task.cancel = true;
+	MapTask_Finish();
+}
+
+hc_bool Map_IsLoading(void) { return map_task.active && !map_task.saving; }
+
+
 /*########################################################################################################################*
 *--------------------------------------------------MCSharp level Format---------------------------------------------------*
 *#########################################################################################################################*/
@@ -187,9 +423,7 @@ static hc_result Lvl_Load(struct Stream* stream) {
 
 	struct Stream compStream;
 	struct InflateState state;
-	Inflate_MakeStream2(&compStream, &state, stream);
-	
-	if ((res = Map_SkipGZipHeader(stream)))                       return res;
+	if ((res = Map_OpenGZip(&compStream, &state, stream)))       return res;
 	if ((res = Stream_Read(&compStream, header, sizeof(header)))) return res;
 	if (Stream_GetU16_LE(&header[0]) != 1874) return LVL_ERR_VERSION;
 
@@ -308,6 +542,126 @@ static hc_result Fcm_Load(struct Stream* stream) {
 }
 
 
+/*########################################################################################################################*
+*-----------------------------------------------------Raw map format------------------------------------------------------*
+*#########################################################################################################################*/
+/* Uncompressed map format, meant for caches of maps that need to be loaded quickly.
+	U8[4] "Identifier" (must be "HCRW")
+	U8  "Version" (must be 1)
+	U8  "Flags" (1 = has upper 8 bits of blocks)
+	U16 "Width", "Height", "Length"
+	U16 "SpawnX", "SpawnY", "SpawnZ"
+	U8  "Yaw", "Pitch"
+	-- zero padding up to RAW_HEADER_SIZE
+	U8* "Blocks"
+	-- zero padding up to multiple of RAW_HEADER_SIZE (only if has upper blocks)
+	U8* "Upper blocks"
+}*/
+/* Blocks start on a page boundary, so the whole file can be memory mapped as is */
+#define RAW_HEADER_SIZE 4096
+#define RAW_FIELDS_SIZE 20
+#define RAW_FLAG_UPPER  0x01
+#define Raw_Align(size) (((size) + (RAW_HEADER_SIZE - 1)) & ~(RAW_HEADER_SIZE - 1))
+
+#ifdef HC_BUILD_FILEMAP
+static hc_result Raw_Map(hc_uint32 size, hc_uint32 upperOffset) {
+	hc_uint32 length;
+	hc_uint8* data;
+	hc_result res;
+
+	/* Accessing mapped pages beyond the end of the file would crash */
+	if ((res = File_Length(*raw_file, &length))) return res;
+	if (length < size) return ERR_END_OF_STREAM;
+	if ((res = File_Map(*raw_file, size, (void**)&data))) return res;
+
+	World.Blocks = data + RAW_HEADER_SIZE;
+#ifdef EXTENDED_BLOCKS
+	if (upperOffset) World_SetMapUpper(data + upperOffset);
+#endif
+	World_SetMapped(data, size);
+	return 0;
+}
+#endif
+
+static hc_result Raw_Load(struct Stream* stream) {
+	hc_uint8 header[RAW_FIELDS_SIZE];
+	hc_uint32 upperOffset = 0, size;
+	hc_result res;
+
+	if ((res = Stream_Read(stream, header, sizeof(header)))) return res;
+	if (!Mem_Equal(header, "HCRW", 4)) return RAW_ERR_IDENTIFIER;
+	if (header[4] != 1) return RAW_ERR_VERSION;
+
+	World.Width  = Stream_GetU16_LE(&header[6]);
+	World.Height = Stream_GetU16_LE(&header[8]);
+	World.Length = Stream_GetU16_LE(&header[10]);
+	World.Volume = World.Width * World.Height * World.Length;
+
+	spawn_point->flags = LU_HAS_POS | LU_HAS_YAW | LU_HAS_PITCH;
+	spawn_point->pos.x = Stream_GetU16_LE(&header[12]);
+	spawn_point->pos.y = Stream_GetU16_LE(&header[14]);
+	spawn_point->pos.z = Stream_GetU16_LE(&header[16]);
+	spawn_point->yaw   = Math_Packed2Deg(header[18]);
+	spawn_point->pitch = Math_Packed2Deg(header[19]);
+
+	if (header[5] & RAW_FLAG_UPPER) upperOffset = RAW_HEADER_SIZE + Raw_Align(World.Volume);
+	size = (upperOffset ? upperOffset : RAW_HEADER_SIZE) + World.Volume;
+
+#ifdef HC_BUILD_FILEMAP
+	/* Falls back to reading the file when mapping it fails */
+	if (raw_file && !Raw_Map(size, upperOffset)) return 0;
+#endif
+	if ((res = stream->Skip(stream, RAW_HEADER_SIZE - RAW_FIELDS_SIZE))) return res;
+	if ((res = Map_ReadBlocks(stream))) return res;
+
+#ifdef EXTENDED_BLOCKS
+	if (!upperOffset) return 0;
+	if ((res = stream->Skip(stream, upperOffset - RAW_HEADER_SIZE - World.Volume))) return res;
+
+	World_SetMapUpper((BlockRaw*)Mem_TryAlloc(World.Volume, 1));
+	if (!World.Blocks2) return ERR_OUT_OF_MEMORY;
+	return Stream_Read(stream, World.Blocks2, World.Volume);
+#else
+	return 0;
+#endif
+}
+
+hc_result Raw_Save(struct Stream* stream) {
+	struct LocalPlayer* p = Entities.CurPlayer;
+	hc_uint8 header[RAW_HEADER_SIZE] = { 0 };
+	hc_bool upper = false;
+	hc_result res;
+#ifdef EXTENDED_BLOCKS
+	upper = World.Blocks != World.Blocks2;
+#endif
+
+	Mem_Copy(header, "HCRW", 4);
+	header[4] = 1;
+	header[5] = upper ? RAW_FLAG_UPPER : 0;
+	Stream_SetU16_LE(&header[6],  World.Width);
+	Stream_SetU16_LE(&header[8],  World.Height);
+	Stream_SetU16_LE(&header[10], World.Length);
+
+	Stream_SetU16_LE(&header[12], (hc_uint16)p->Base.Position.x);
+	Stream_SetU16_LE(&header[14], (hc_uint16)p->Base.Position.y);
+	Stream_SetU16_LE(&header[16], (hc_uint16)p->Base.Position.z);
+	header[18] = Math_Deg2Packed(p->SpawnYaw);
+	header[19] = Math_Deg2Packed(p->SpawnPitch);
+
+	if ((res = Stream_Write(stream, header, RAW_HEADER_SIZE))) return res;
+	if ((res = Stream_Write(stream, World.Blocks, World.Volume))) return res;
+
+#ifdef EXTENDED_BLOCKS
+	if (!upper) return 0;
+	Mem_Set(header, 0, RAW_HEADER_SIZE);
+
+	if ((res = Stream_Write(stream, header, Raw_Align(World.Volume) - World.Volume))) return res;
+	if ((res = Stream_Write(stream, World.Blocks2, World.Volume))) return res;
+#endif
+	return 0;
+}
+
+
 /*########################################################################################################################*
 *---------------------------------------------------------NBTFile---------------------------------------------------------*
 *#########################################################################################################################*/
@@ -398,27 +752,77 @@ static hc_string NbtTag_String(struct NbtTag* tag) {
 	return String_Empty;
 }
 
-static hc_result Nbt_ReadString(struct Stream* stream, hc_string* str) {
-	hc_uint8 buffer[NBT_STRING_SIZE * 4];
+#define NBT_BUFFER_SIZE 8192
+/* Reads NBT data through a large buffer, rather than making many small reads from the (inflate) stream */
+/* Large byte arrays bypass the buffer and are decompressed directly into their final allocation */
+struct NbtReader {
+	struct Stream* source; /* NULL when all of the data is already in memory */
+	hc_uint8* cur;
+	hc_uint8* end;
+	hc_uint8 buffer[NBT_BUFFER_SIZE];
+};
+
+static hc_result NbtReader_Fill(struct NbtReader* r, hc_uint32 count) {
+	hc_uint32 left = (hc_uint32)(r->end - r->cur), read;
+	hc_result res;
+	if (!r->source) return ERR_END_OF_STREAM;
+
+	Mem_Move(r->buffer, r->cur, left);
+	r->cur = r->buffer;
+	r->end = r->buffer + left;
+
+	while (left < count) {
+		res = r->source->Read(r->source, r->end, NBT_BUFFER_SIZE - left, &read);
+		if (res)   return res;
+		if (!read) return ERR_END_OF_STREAM;
+
+		r->end += read; left += read;
+	}
+	return 0;
+}
+/* Ensures at least count (at most NBT_BUFFER_SIZE) bytes can be read from cur */
+#define NbtReader_Ensure(r, count) ((hc_uint32)((r)->end - (r)->cur) >= (count) ? 0 : NbtReader_Fill(r, count))
+
+static hc_result NbtReader_Read(struct NbtReader* r, hc_uint8* data, hc_uint32 count) {
+	hc_uint32 copy = min((hc_uint32)(r->end - r->cur), count);
+	Mem_Copy(data, r->cur, copy);
+	r->cur += copy;
+
+	if (copy == count) return 0;
+	if (!r->source)    return ERR_END_OF_STREAM;
+	return Stream_Read(r->source, data + copy, count - copy);
+}
+
+static hc_result NbtReader_Skip(struct NbtReader* r, hc_uint32 count) {
+	hc_uint32 skip = min((hc_uint32)(r->end - r->cur), count);
+	r->cur += skip;
+
+	if (skip == count) return 0;
+	if (!r->source)    return ERR_END_OF_STREAM;
+	return r->source->Skip(r->source, count - skip);
+}
+
+static hc_result Nbt_ReadString(struct NbtReader* r, hc_string* str) {
 	int len;
 	hc_result res;
 
-	if ((res = Stream_Read(stream, buffer, 2)))   return res;
-	len = Stream_GetU16_BE(buffer);
+	if ((res = NbtReader_Ensure(r, 2)))   return res;
+	len = Stream_GetU16_BE(r->cur);
+	r->cur += 2;
 
-	if (len > Array_Elems(buffer)) return CW_ERR_STRING_LEN;
-	if ((res = Stream_Read(stream, buffer, len))) return res;
+	if (len > NBT_STRING_SIZE * 4) return CW_ERR_STRING_LEN;
+	if ((res = NbtReader_Ensure(r, len))) return res;
 
-	String_AppendUtf8(str, buffer, len);
+	String_AppendUtf8(str, r->cur, len);
+	r->cur += len;
 	return 0;
 }
 
 typedef void (*Nbt_Callback)(struct NbtTag* tag);
-static hc_result Nbt_ReadTag(hc_uint8 typeId, hc_bool readTagName, struct Stream* stream, 
+static hc_result Nbt_ReadTag(hc_uint8 typeId, hc_bool readTagName, struct NbtReader* r, 
 							struct NbtTag* parent, Nbt_Callback callback, int listIndex) {
 	struct NbtTag tag;
 	hc_uint8 childType;
-	hc_uint8 tmp[5];	
 	hc_result res;
 	hc_uint32 i, count;
 	
@@ -430,62 +834,70 @@ static hc_result Nbt_ReadTag(hc_uint8 typeId, hc_bool readTagName, struct Stream
 	String_InitArray(tag.name, tag._nameBuffer);
 
 	if (readTagName) {
-		res = Nbt_ReadString(stream, &tag.name);
+		res = Nbt_ReadString(r, &tag.name);
 		if (res) return res;
 	}
 
 	switch (typeId) {
 	case NBT_I8:
-		res = stream->ReadU8(stream, &tag.value.u8);
+		if ((res = NbtReader_Ensure(r, 1))) break;
+		tag.value.u8 = *r->cur++;
 		break;
 	case NBT_I16:
-		res = Stream_Read(stream, tmp, 2);
-		tag.value.u16 = Stream_GetU16_BE(tmp);
+		if ((res = NbtReader_Ensure(r, 2))) break;
+		tag.value.u16 = Stream_GetU16_BE(r->cur);
+		r->cur += 2;
 		break;
 	case NBT_I32:
 	case NBT_F32:
-		res = Stream_ReadU32_BE(stream, &tag.value.u32);
+		if ((res = NbtReader_Ensure(r, 4))) break;
+		tag.value.u32 = Stream_GetU32_BE(r->cur);
+		r->cur += 4;
 		break;
 	case NBT_I64:
 	case NBT_F64:
-		res = stream->Skip(stream, 8);
+		res = NbtReader_Skip(r, 8);
 		break; /* (8) data */
 
 	case NBT_I8S:
-		if ((res = Stream_ReadU32_BE(stream, &tag.dataSize))) break;
+		if ((res = NbtReader_Ensure(r, 4))) break;
+		tag.dataSize = Stream_GetU32_BE(r->cur);
+		r->cur += 4;
 
 		if (NbtTag_IsSmall(&tag)) {
-			res = Stream_Read(stream, tag.value.small, tag.dataSize);
+			res = NbtReader_Read(r, tag.value.small, tag.dataSize);
 		} else {
 			tag.value.big = (hc_uint8*)Mem_TryAlloc(tag.dataSize, 1);
 			if (!tag.value.big) return ERR_OUT_OF_MEMORY;
 
-			res = Stream_Read(stream, tag.value.big, tag.dataSize);
+			res = NbtReader_Read(r, tag.value.big, tag.dataSize);
 			if (res) Mem_Free(tag.value.big);
 		}
 		break;
 	case NBT_STR:
 		String_InitArray(tag.value.str.text, tag.value.str.buffer);
-		res = Nbt_ReadString(stream, &tag.value.str.text);
+		res = Nbt_ReadString(r, &tag.value.str.text);
 		break;
 
 	case NBT_LIST:
-		if ((res = Stream_Read(stream, tmp, 5))) break;
-		childType = tmp[0];
-		count = Stream_GetU32_BE(&tmp[1]);
+		if ((res = NbtReader_Ensure(r, 5))) break;
+		childType = r->cur[0];
+		count = Stream_GetU32_BE(&r->cur[1]);
+		r->cur += 5;
 
 		for (i = 0; i < count; i++) {
-			res = Nbt_ReadTag(childType, false, stream, &tag, callback, i);
+			res = Nbt_ReadTag(childType, false, r, &tag, callback, i);
 			if (res) break;
 		}
 		break;
 
 	case NBT_DICT:
 		for (;;) {
-			if ((res = stream->ReadU8(stream, &childType))) break;
+			if ((res = NbtReader_Ensure(r, 1))) break;
+			childType = *r->cur++;
 			if (childType == NBT_END) break;
 
-			res = Nbt_ReadTag(childType, true, stream, &tag, callback, 0);
+			res = Nbt_ReadTag(childType, true, r, &tag, callback, 0);
 			if (res) break;
 		}
 		break;
@@ -518,15 +930,40 @@ static BlockRaw* Nbt_TakeArray(struct NbtTag* tag, const char* type) {
 static hc_result Nbt_Read(struct Stream* stream, Nbt_Callback callback) {
 	struct Stream compStream;
 	struct InflateState state;
+	struct NbtReader reader;
 	hc_result res;
-	hc_uint8 tag;
 
-	Inflate_MakeStream2(&compStream, &state, stream);
-	if ((res = Map_SkipGZipHeader(stream))) return res;
-	if ((res = compStream.ReadU8(&compStream, &tag))) return res;
+	if ((res = Map_OpenGZip(&compStream, &state, stream))) return res;
+
+	if (map_inflated) {
+		/* Data was already decompressed into memory by the background loader */
+		reader.source = NULL;
+		reader.cur    = compStream.meta.mem.cur;
+		reader.end    = compStream.meta.mem.cur + compStream.meta.mem.left;
+	} else {
+		reader.source = &compStream;
+		reader.cur    = reader.buffer;
+		reader.end    = reader.buffer;
+	}
 
-	if (tag != NBT_DICT) return CW_ERR_ROOT_TAG;
-	return Nbt_ReadTag(NBT_DICT, true, &compStream, NULL, callback, 0);
+	if ((res = NbtReader_Ensure(&reader, 1))) return res;
+	if (*reader.cur++ != NBT_DICT) return CW_ERR_ROOT_TAG;
+	return Nbt_ReadTag(NBT_DICT, true, &reader, NULL, callback, 0);
+}
+
+static void Nbt_IgnoreTag(struct NbtTag* tag) { }
+
+hc_result Map_DecodeNbt(const hc_string* path) {
+	struct Stream stream;
+	hc_result res;
+
+	res = Stream_OpenFile(&stream, path);
+	if (res) return res;
+
+	res = Nbt_Read(&stream, Nbt_IgnoreTag);
+	/* No point logging error for closing readonly file */
+	(void)stream.Close(&stream);
+	return res;
 }
 
 
@@ -1347,8 +1784,7 @@ static hc_result Dat_Load(struct Stream* stream) {
 
 	struct Stream compStream;
 	struct InflateState state;
-	Inflate_MakeStream2(&compStream, &state, stream);
-	if ((res = Map_SkipGZipHeader(stream)))                       return res;
+	if ((res = Map_OpenGZip(&compStream, &state, stream)))       return res;
 	if ((res = Stream_Read(&compStream, header, sizeof(header)))) return res;
 
 	signature = Stream_GetU32_BE(header + 0);
@@ -1856,6 +2292,152 @@ hc_result Dat_Save(struct Stream* stream) {
 }
 
 
+/*########################################################################################################################*
+*------------------------------------------------------Map saving---------------------------------------------------------*
+*#########################################################################################################################*/
+/* Appends written data to a growable memory buffer */
+static hc_result MapBuffer_Write(struct Stream* s, const hc_uint8* data, hc_uint32 count, hc_uint32* modified) {
+	hc_uint32 used, capacity;
+	hc_uint8* base;
+	*modified = 0;
+
+	if (count > s->meta.mem.left) {
+		used     = s->meta.mem.length - s->meta.mem.left;
+		capacity = max(s->meta.mem.length * 2, used + count);
+		base     = (hc_uint8*)Mem_TryRealloc(s->meta.mem.base, capacity, 1);
+		if (!base) return ERR_OUT_OF_MEMORY;
+
+		s->meta.mem.base   = base;
+		s->meta.mem.cur    = base + used;
+		s->meta.mem.length = capacity;
+		s->meta.mem.left   = capacity - used;
+	}
+
+	Mem_Copy(s->meta.mem.cur, data, count);
+	s->meta.mem.cur  += count;
+	s->meta.mem.left -= count;
+	*modified = count;
+	return 0;
+}
+
+/* Encodes the world in the format given by the file extension into memory */
+static hc_result Map_Encode(const hc_string* path) {
+	static const hc_string schematic = String_FromConst(".schematic");
+	static const hc_string mine      = String_FromConst(".mine");
+	static const hc_string raw       = String_FromConst(".hcraw");
+	struct Stream stream;
+	hc_uint32 capacity;
+	hc_result res;
+
+	capacity = World.Volume + MAP_TASK_CHUNK;
+	Stream_Init(&stream);
+	stream.Write = MapBuffer_Write;
+	stream.meta.mem.base   = (hc_uint8*)Mem_TryAlloc(capacity, 1);
+	stream.meta.mem.cur    = stream.meta.mem.base;
+	stream.meta.mem.length = capacity;
+	stream.meta.mem.left   = capacity;
+	if (!stream.meta.mem.base) return ERR_OUT_OF_MEMORY;
+
+	if (String_CaselessEnds(path, &schematic)) {
+		res = Schematic_Save(&stream);
+	} else if (String_CaselessEnds(path, &raw)) {
+		res = Raw_Save(&stream);
+	} else if (String_CaselessEnds(path, &mine)) {
+		res = Dat_Save(&stream);
+	} else {
+		res = Cw_Save(&stream);
+	}
+
+	map_task.data   = stream.meta.mem.base;
+	map_task.length = stream.meta.mem.length - stream.meta.mem.left;
+	return res;
+}
+
+static void MapTask_SaveMain(void) {
+	struct Stream compStream;
+	struct Stream* dst = &map_task.file;
+	hc_uint32 i, count;
+	hc_result res = 0, closeRes;
+
+	/* Raw maps are written uncompressed */
+	if (map_task.gzip) {
+		GZip_MakeStream(&compStream, map_task.gzip, &map_task.file);
+		dst = &compStream;
+	}
+
+	for (i = 0; i < map_task.length && !res; i += count) 
+	{
+		count = min(map_task.length - i, MAP_TASK_CHUNK);
+		res   = Stream_Write(dst, map_task.data + i, count);
+		map_task.progress = (float)(i + count) / map_task.length;
+	}
+	if (!res && map_task.gzip) res = compStream.Close(&compStream);
+
+	closeRes = map_task.file.Close(&map_task.file);
+	map_task.res  = res ? res : closeRes;
+	map_task.done = true;
+}
+
+static void MapTask_FinishSave(void) {
+	Mem_Free(map_task.gzip);
+	map_task.gzip = NULL;
+	/* Game is shutting down */
+	if (map_task.cancel) return;
+
+	Chat_AddOf(&String_Empty, MSG_TYPE_EXTRASTATUS_1);
+	if (map_task.res) { Logger_SysWarn2(map_task.res, "saving", &map_task.path); return; }
+
+	World.LastSave = Game.Time;
+	Chat_Add1("&eSaved map to: %s", &map_task.path);
+}
+
+hc_result Map_SaveTo(const hc_string* path) {
+	static const hc_string raw = String_FromConst(".hcraw");
+	hc_result res;
+	MapTask_Wait();
+
+	map_task.gzip   = NULL;
+	map_task.saving = true;
+	if (!String_CaselessEnds(path, &raw)) {
+		map_task.gzip = (struct GZipState*)Mem_TryAlloc(1, sizeof(struct GZipState));
+		res = ERR_OUT_OF_MEMORY;
+		if (!map_task.gzip) { Logger_SysWarn(res, "allocating temp memory"); return res; }
+	}
+
+	/* World is encoded on the main thread since it may change while the file is being written */
+	res = Map_Encode(path);
+	if (res) { Logger_SysWarn2(res, "encoding", path); goto failed; }
+
+#ifdef HC_BUILD_FILEMAP
+	/* Creating the file truncates it, which would invalidate the world's blocks if mapped from it */
+	/* Chunks being built on worker threads still reference the mapped blocks, so must wait for them */
+	Builder_CancelJobs();
+	res = World_CopyMapped();
+	if (res) { Logger_SysWarn(res, "copying map blocks"); goto failed; }
+#endif
+	res = Stream_CreateFile(&map_task.file, path);
+	if (res) { Logger_SysWarn2(res, "creating", path); goto failed; }
+	if (map_task.gzip) {
+		Deflate_SetLevel(&map_task.gzip->Base, Options_GetInt(OPT_MAP_COMPRESSION, 
+						DEFLATE_LEVEL_FAST, DEFLATE_LEVEL_BEST, DEFLATE_LEVEL_DEFAULT));
+	}
+
+	MapTask_Start(MapTask_SaveMain, "Map save", path);
+	return 0;
+
+failed:
+	Mem_Free(map_task.gzip);
+	Mem_Free(map_task.data);
+	map_task.gzip = NULL;
+	map_task.data = NULL;
+	return res;
+}
+
+void Map_WaitForSave(void) {
+	if (map_task.active && map_task.saving) MapTask_Finish();
+}
+
+
 /*########################################################################################################################*
 *-------------------------------------------------------Formats component-------------------------------------------------*
 *#########################################################################################################################*/
@@ -1865,6 +2447,7 @@ static struct MapImporter lvl_imp   = { ".lvl",     Lvl_Load };
 static struct MapImporter mine_imp  = { ".mine",    Dat_Load };
 static struct MapImporter fcm_imp   = { ".fcm",     Fcm_Load };
 static struct MapImporter mclvl_imp = { ".mclevel", MCLevel_Load };
+static struct MapImporter raw_imp   = { ".hcraw",   Raw_Load };
 
 static void OnInit(void) {
 	MapImporter_Register(&cw_imp);
@@ -1873,19 +2456,30 @@ static void OnInit(void) {
 	MapImporter_Register(&mine_imp);
 	MapImporter_Register(&fcm_imp);
 	MapImporter_Register(&mclvl_imp);
+	MapImporter_Register(&raw_imp);
+	ScheduledTask_Add(GAME_DEF_TICKS, MapTask_Tick);
 }
 
 static void OnFree(void) {
 	imp_head = NULL;
+	/* Still finish writing any map being saved, so the file isn't left truncated */
+	map_task.cancel = true;
+	MapTask_Wait();
 }
 #else
 /* No point including map format code when can't save/load maps anyways */
 struct MapImporter* MapImporter_Find(const hc_string* path) { return NULL; }
 hc_result Map_LoadFrom(const hc_string* path) { return ERR_NOT_SUPPORTED; }
+hc_result Map_SaveTo(const hc_string* path)   { return ERR_NOT_SUPPORTED; }
+hc_result Map_DecodeNbt(const hc_string* path) { return ERR_NOT_SUPPORTED; }
+void Map_CancelLoad(void) { }
+void Map_WaitForSave(void) { }
+hc_bool Map_IsLoading(void) { return false; }
 
 hc_result Cw_Save(struct Stream* stream)  { return ERR_NOT_SUPPORTED; }
 hc_result Dat_Save(struct Stream* stream) { return ERR_NOT_SUPPORTED; }
 hc_result Schematic_Save(struct Stream* stream) { return ERR_NOT_SUPPORTED; }
+hc_result Raw_Save(struct Stream* stream) { return ERR_NOT_SUPPORTED; }
 
 static void OnInit(void) { }
 static void OnFree(void) { }
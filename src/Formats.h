@@ -27,7 +27,23 @@ HC_API void MapImporter_Register(struct MapImporter* imp);
 /* Returns NULL if no match found */
 HC_API struct MapImporter* MapImporter_Find(const hc_string* path);
 /* Attempts to import a map from the given file */
+/* NOTE: Where threads are supported, the file is read and decompressed on a background thread, */
+/*  with progress reported through WorldEvents.Loading. The current world is kept until it finishes. */
 HC_API hc_result Map_LoadFrom(const hc_string* path);
+/* Cancels the in-progress map load (if any), leaving the current world unchanged */
+void Map_CancelLoad(void);
+/* Whether a map is still being loaded in the background */
+hc_bool Map_IsLoading(void);
+/* Exports the world to the given file, in the format given by its file extension */
+/* NOTE: Where threads are supported, the file is compressed and written on a background thread */
+/* NOTE: World.LastSave is only updated once the file has been successfully written */
+HC_API hc_result Map_SaveTo(const hc_string* path);
+/* Blocks until the in-progress map save (if any) has been fully written */
+void Map_WaitForSave(void);
+
+/* Decodes every tag of the given NBT based (.cw or .mclevel) map file without importing anything */
+/* Only useful for measuring how long reading and decompressing the map takes */
+hc_result Map_DecodeNbt(const hc_string* path);
 
 /* Exports a world to a .cw ClassicWorld map file. */
 /* Compatible with ClassiCube/ClassicalSharp */
@@ -35,6 +51,9 @@ hc_result Cw_Save(struct Stream* stream);
 /* Exports a world to a .schematic Schematic map file */
 /* Used by MCEdit and other tools */
 hc_result Schematic_Save(struct Stream* stream);
+/* Exports a world to a .hcraw uncompressed map file */
+/* Can be loaded by memory mapping the file, so useful for caching maps */
+hc_result Raw_Save(struct Stream* stream);
 /* Exports a world to a .dat Classic map file */
 /* Used by MineCraft Classic */
 hc_result Dat_Save(struct Stream* stream);
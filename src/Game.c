@@ -38,6 +38,7 @@
 #include "Protocol.h"
 #include "Picking.h"
 #include "Animations.h"
+#include "BlockPhysics.h"
 #include "SystemFonts.h"
 #include "Formats.h"
 #include "EntityRenderers.h"
@@ -205,6 +206,49 @@ void Game_UpdateBlock(int x, int y, int z, BlockID block) {
 	}
 	Lighting.OnBlockChanged(x, y, z, old, block);
 	MapRenderer_OnBlockChanged(x, y, z, block);
+	Physics_OnBlockUpdated(x, y, z, old, block);
+}
+
+#define GAME_MAX_BATCH_BLOCKS 256
+void Game_UpdateBlocks(const int* indices, const BlockID* blocks, int count) {
+	struct LightingBlockChange changes[GAME_MAX_BATCH_BLOCKS];
+	struct LightingBlockChange* c;
+	int i, beg, end, numChanges;
+	BlockID old;
+
+	for (beg = 0; beg < count; beg = end) {
+		end = min(count, beg + GAME_MAX_BATCH_BLOCKS);
+		numChanges = 0;
+
+		/* Lighting needs all of the blocks in the map to be changed first */
+		for (i = beg; i < end; i++) {
+			c = &changes[numChanges];
+			World_Unpack(indices[i], c->x, c->y, c->z);
+			old = World_GetBlock(c->x, c->y, c->z);
+			if (old == blocks[i]) continue;
+
+			World_SetBlock(c->x, c->y, c->z, blocks[i]);
+			c->oldBlock = old;
+			c->newBlock = blocks[i];
+			numChanges++;
+		}
+		Game_OnBlocksChanged(changes, numChanges);
+	}
+}
+
+void Game_OnBlocksChanged(const struct LightingBlockChange* changes, int count) {
+	const struct LightingBlockChange* c;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		c = &changes[i];
+		if (Weather_Heightmap) {
+			EnvRenderer_OnBlockChanged(c->x, c->y, c->z, c->oldBlock, c->newBlock);
+		}
+		MapRenderer_OnBlockChanged(c->x, c->y, c->z, c->newBlock);
+		Physics_OnBlockUpdated(c->x, c->y, c->z, c->oldBlock, c->newBlock);
+	}
+	Lighting.OnBlocksChanged(changes, count);
 }
 
 void Game_ChangeBlock(int x, int y, int z, BlockID block) {
@@ -9,6 +9,7 @@ HC_BEGIN_HEADER
 
 struct Bitmap;
 struct Stream;
+struct LightingBlockChange;
 typedef void (*Game_Draw2DHook)(float delta);
 
 HC_VAR extern struct _GameData {
@@ -103,6 +104,14 @@ void Game_Reset(void);
 /* (updating state means recalculating light, redrawing chunk block is in, etc) */
 /* NOTE: This does NOT notify the server, use Game_ChangeBlock for that. */
 HC_API void Game_UpdateBlock(int x, int y, int z, BlockID block);
+/* Sets multiple blocks in the map, then updates state associated with all of the blocks at once. */
+/* (lighting is only recalculated once for all of the changes, instead of once per block) */
+/* NOTE: Indices are World_Pack indices, and must be inside the map. */
+/* NOTE: This does NOT notify the server. */
+HC_API void Game_UpdateBlocks(const int* indices, const BlockID* blocks, int count);
+/* Updates state associated with multiple blocks that have already been changed in the map. */
+/* NOTE: This does NOT notify the server. */
+HC_API void Game_OnBlocksChanged(const struct LightingBlockChange* changes, int count);
 /* Calls Game_UpdateBlock, then informs server connection of the block change. */
 /* In multiplayer this is sent to the server, in singleplayer just activates physics. */
 HC_API void Game_ChangeBlock(int x, int y, int z, BlockID block);
@@ -7,6 +7,7 @@
 #include "Utils.h"
 #include "Game.h"
 #include "Window.h"
+#include "Options.h"
 
 const struct MapGenerator* Gen_Active;
 BlockRaw* Gen_Blocks;
@@ -16,6 +17,27 @@ volatile float Gen_CurrentProgress;
 volatile const char* Gen_CurrentState;
 volatile hc_bool gen_done;
 
+int Gen_StagesCount;
+const char* Gen_StageNames[GEN_MAX_STAGES];
+int Gen_StageMicros[GEN_MAX_STAGES];
+static hc_uint64 gen_stageBeg;
+/* Whether noise is calculated using SIMD instructions (when supported) */
+static hc_bool gen_simd = true;
+
+static void Gen_BeginStage(void) {
+	gen_stageBeg = Stopwatch_Measure();
+}
+
+/* Records how long the stage that was just performed took */
+static void Gen_EndStage(void) {
+	hc_uint64 end = Stopwatch_Measure();
+	if (Gen_StagesCount >= GEN_MAX_STAGES) return;
+
+	Gen_StageNames[Gen_StagesCount]  = (const char*)Gen_CurrentState;
+	Gen_StageMicros[Gen_StagesCount] = (int)Stopwatch_ElapsedMicroseconds(gen_stageBeg, end);
+	Gen_StagesCount++;
+}
+
 /* There are two main types of multitasking: */
 /*  - Pre-emptive multitasking (system automatically switches between threads) */
 /*  - Cooperative multitasking (threads must be manually switched by the app) */
@@ -37,7 +59,7 @@ static hc_uint64 lastRender;
 
 #define GEN_COOP_STEP(index, step) \
 	case index: \
-		step; \
+		Gen_BeginStage(); step; Gen_EndStage(); \
 		gen_step++; \
 		curTime = Stopwatch_Measure(); \
 		if (Stopwatch_ElapsedMS(lastRender, curTime) > 100) { lastRender = curTime; return; }
@@ -60,8 +82,12 @@ hc_bool Gen_IsDone(void) {
 #else
 /* For systems supporting preemptive threading, there's no point */
 /* bothering with all the cooperative tasking shenanigans */
+#define GEN_MAX_THREADS 32
+/* Number of extra threads that column based stages are split across */
+static int gen_threads;
+
 #define GEN_COOP_BEGIN
-#define GEN_COOP_STEP(index, step) step;
+#define GEN_COOP_STEP(index, step) Gen_BeginStage(); step; Gen_EndStage();
 #define GEN_COOP_END
 
 static void Gen_DoGen(void) {
@@ -70,6 +96,7 @@ static void Gen_DoGen(void) {
 
 static void Gen_Run(void) {
 	void* thread;
+	gen_threads = Options_GetInt(OPT_GEN_THREADS, 0, GEN_MAX_THREADS, 0);
 	Thread_Run(&thread, Gen_DoGen, 128 * 1024, "Map gen");
 	Thread_Detach(thread);
 }
@@ -80,6 +107,7 @@ hc_bool Gen_IsDone(void) { return gen_done; }
 static void Gen_Reset(void) {
 	Gen_CurrentProgress = 0.0f;
 	Gen_CurrentState    = "";
+	Gen_StagesCount     = 0;
 	gen_done = false;
 }
 
@@ -95,6 +123,103 @@ void Gen_Start(void) {
 	}
 }
 
+BlockRaw* Gen_GenerateNow(const struct MapGenerator* gen, int threads, hc_bool simd) {
+	BlockRaw* blocks;
+	Gen_Reset();
+	Gen_Blocks = (BlockRaw*)Mem_TryAlloc(World.Volume, 1);
+
+	if (!Gen_Blocks || !gen->Prepare()) {
+		Mem_Free(Gen_Blocks);
+		Gen_Blocks = NULL;
+		return NULL;
+	}
+	gen_simd = simd;
+
+#ifdef HC_BUILD_COOPTHREADED
+	gen_step   = 0;
+	lastRender = Stopwatch_Measure();
+	while (!gen_done) gen->Generate();
+#else
+	gen_threads = min(threads, GEN_MAX_THREADS);
+	gen->Generate();
+#endif
+
+	gen_simd   = true;
+	blocks     = Gen_Blocks;
+	Gen_Blocks = NULL;
+	return blocks;
+}
+
+
+/*########################################################################################################################*
+*--------------------------------------------------Parallel generation----------------------------------------------------*
+*#########################################################################################################################*/
+/* Stages where each column of the map only depends on that column are split up */
+/*  into tiles of rows, which are then generated across multiple threads */
+#define GEN_TILE_ROWS 16
+typedef void (*Gen_RowsFunc)(int zBeg, int zEnd);
+static Gen_RowsFunc gen_rowsFunc;
+
+#ifdef HC_BUILD_COOPTHREADED
+static void Gen_ForEachRows(Gen_RowsFunc func) {
+	int z;
+	for (z = 0; z < World.Length; z += GEN_TILE_ROWS) {
+		Gen_CurrentProgress = (float)z / World.Length;
+		func(z, min(z + GEN_TILE_ROWS, World.Length));
+	}
+}
+#else
+static void* gen_rowsMutex;
+static int gen_nextRow, gen_doneRows;
+
+static void Gen_RowsWorker(void) {
+	int zBeg, zEnd;
+	for (;;)
+	{
+		Mutex_Lock(gen_rowsMutex);
+		{
+			zBeg = gen_nextRow;
+			gen_nextRow += GEN_TILE_ROWS;
+		}
+		Mutex_Unlock(gen_rowsMutex);
+
+		if (zBeg >= World.Length) return;
+		zEnd = min(zBeg + GEN_TILE_ROWS, World.Length);
+		gen_rowsFunc(zBeg, zEnd);
+
+		Mutex_Lock(gen_rowsMutex);
+		{
+			gen_doneRows += zEnd - zBeg;
+			Gen_CurrentProgress = (float)gen_doneRows / World.Length;
+		}
+		Mutex_Unlock(gen_rowsMutex);
+	}
+}
+
+/* Calls the given function for all rows of the map, split across gen_threads extra threads */
+/* NOTE: The function must only access the columns in the rows it is given */
+static void Gen_ForEachRows(Gen_RowsFunc func) {
+	void* threads[GEN_MAX_THREADS];
+	int i;
+
+	gen_rowsFunc  = func;
+	gen_nextRow   = 0;
+	gen_doneRows  = 0;
+	gen_rowsMutex = Mutex_Create("Gen rows");
+
+	for (i = 0; i < gen_threads; i++) {
+		Thread_Run(&threads[i], Gen_RowsWorker, 64 * 1024, "Map gen worker");
+	}
+	/* Generation thread works on rows too while waiting */
+	Gen_RowsWorker();
+
+	for (i = 0; i < gen_threads; i++) {
+		Thread_Join(threads[i]);
+	}
+	Mutex_Free(gen_rowsMutex);
+}
+#endif
+
 
 /*########################################################################################################################*
 *-----------------------------------------------------Flatgrass gen-------------------------------------------------------*
@@ -195,6 +320,78 @@ static float ImprovedNoise_Calc(const hc_uint8* p, float x, float y) {
 }
 
 
+/* Only x86_64 is guaranteed to calculate the scalar noise with exactly the same rounding */
+/*  as the SIMD version - 32 bit x86 may use x87 registers, and FMA may fuse multiply-adds */
+#if (defined __x86_64__ || defined _M_X64) && !defined __FMA__
+	#include <emmintrin.h>
+	#define NOISE_SIMD
+
+/* Calculates ImprovedNoise_Calc for 4 points at once. Results are identical to ImprovedNoise_Calc */
+static __m128 ImprovedNoise_Calc4(const hc_uint8* p, __m128 x, __m128 y) {
+	int xFloor[4], yFloor[4];
+	float gx22[4], gy22[4], gx12[4], gy12[4];
+	float gx21[4], gy21[4], gx11[4], gy11[4];
+	__m128i xf, yf;
+	__m128 u, v, t, xm1, ym1;
+	__m128 g22, g12, g21, g11, c1, c2;
+	int i, X, Y, A, B, hash, same;
+
+	/* Adding the all bits set comparison mask subtracts 1 from negative coordinates */
+	xf = _mm_cvttps_epi32(x);
+	yf = _mm_cvttps_epi32(y);
+	xf = _mm_add_epi32(xf, _mm_castps_si128(_mm_cmplt_ps(x, _mm_setzero_ps())));
+	yf = _mm_add_epi32(yf, _mm_castps_si128(_mm_cmplt_ps(y, _mm_setzero_ps())));
+	_mm_storeu_si128((__m128i*)xFloor, xf);
+	_mm_storeu_si128((__m128i*)yFloor, yf);
+
+	x = _mm_sub_ps(x, _mm_cvtepi32_ps(xf));
+	y = _mm_sub_ps(y, _mm_cvtepi32_ps(yf));
+
+	t = _mm_add_ps(_mm_mul_ps(x, _mm_sub_ps(_mm_mul_ps(x, _mm_set1_ps(6)), _mm_set1_ps(15))), _mm_set1_ps(10));
+	u = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(x, x), x), t); /* Fade(x) */
+	t = _mm_add_ps(_mm_mul_ps(y, _mm_sub_ps(_mm_mul_ps(y, _mm_set1_ps(6)), _mm_set1_ps(15))), _mm_set1_ps(10));
+	v = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(y, y), y), t); /* Fade(y) */
+
+	/* Lower octaves are sampled at lower frequencies, so often all 4 points are in the same cell */
+	same = _mm_movemask_epi8(_mm_and_si128(
+				_mm_cmpeq_epi32(xf, _mm_shuffle_epi32(xf, 0)),
+				_mm_cmpeq_epi32(yf, _mm_shuffle_epi32(yf, 0)))) == 0xFFFF;
+
+	/* SSE2 has no gather instruction, so look up each point's gradients separately */
+	for (i = 0; i < (same ? 1 : 4); i++) {
+		X = xFloor[i] & 0xFF; Y = yFloor[i] & 0xFF;
+		A = p[X] + Y; B = p[X + 1] + Y;
+
+		hash = (p[p[A]] & 0xF) << 1;
+		gx22[i] = (float)(((xFlags >> hash) & 3) - 1); gy22[i] = (float)(((yFlags >> hash) & 3) - 1);
+		hash = (p[p[B]] & 0xF) << 1;
+		gx12[i] = (float)(((xFlags >> hash) & 3) - 1); gy12[i] = (float)(((yFlags >> hash) & 3) - 1);
+		hash = (p[p[A + 1]] & 0xF) << 1;
+		gx21[i] = (float)(((xFlags >> hash) & 3) - 1); gy21[i] = (float)(((yFlags >> hash) & 3) - 1);
+		hash = (p[p[B + 1]] & 0xF) << 1;
+		gx11[i] = (float)(((xFlags >> hash) & 3) - 1); gy11[i] = (float)(((yFlags >> hash) & 3) - 1);
+	}
+
+	for (i = 1; same && i < 4; i++) {
+		gx22[i] = gx22[0]; gy22[i] = gy22[0]; gx12[i] = gx12[0]; gy12[i] = gy12[0];
+		gx21[i] = gx21[0]; gy21[i] = gy21[0]; gx11[i] = gx11[0]; gy11[i] = gy11[0];
+	}
+
+	xm1 = _mm_sub_ps(x, _mm_set1_ps(1));
+	ym1 = _mm_sub_ps(y, _mm_set1_ps(1));
+	g22 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(gx22), x),   _mm_mul_ps(_mm_loadu_ps(gy22), y));
+	g12 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(gx12), xm1), _mm_mul_ps(_mm_loadu_ps(gy12), y));
+	c1  = _mm_add_ps(g22, _mm_mul_ps(u, _mm_sub_ps(g12, g22)));
+
+	g21 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(gx21), x),   _mm_mul_ps(_mm_loadu_ps(gy21), ym1));
+	g11 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(gx11), xm1), _mm_mul_ps(_mm_loadu_ps(gy11), ym1));
+	c2  = _mm_add_ps(g21, _mm_mul_ps(u, _mm_sub_ps(g11, g21)));
+
+	return _mm_add_ps(c1, _mm_mul_ps(v, _mm_sub_ps(c2, c1)));
+}
+#endif
+
+
 struct OctaveNoise { hc_uint8 p[8][NOISE_TABLE_SIZE]; int octaves; };
 static void OctaveNoise_Init(struct OctaveNoise* n, RNGState* rnd, int octaves) {
 	int i;
@@ -218,6 +415,37 @@ static float OctaveNoise_Calc(const struct OctaveNoise* n, float x, float y) {
 	return sum;
 }
 
+#ifdef NOISE_SIMD
+static __m128 OctaveNoise_Calc4(const struct OctaveNoise* n, __m128 x, __m128 y) {
+	float amplitude = 1, freq = 1;
+	__m128 sum = _mm_setzero_ps(), noise;
+	int i;
+
+	for (i = 0; i < n->octaves; i++) {
+		noise = ImprovedNoise_Calc4(n->p[i], _mm_mul_ps(x, _mm_set1_ps(freq)), _mm_mul_ps(y, _mm_set1_ps(freq)));
+		sum   = _mm_add_ps(sum, _mm_mul_ps(noise, _mm_set1_ps(amplitude)));
+		amplitude *= 2.0f;
+		freq *= 0.5f;
+	}
+	return sum;
+}
+#endif
+
+/* Calculates OctaveNoise_Calc at (x + i, z), for i from 0 up to count (at most 4) */
+static void OctaveNoise_CalcRow(const struct OctaveNoise* n, int x, int z, int count, float* values) {
+	int i;
+#ifdef NOISE_SIMD
+	if (count == 4 && gen_simd) {
+		__m128 xs = _mm_set_ps((float)(x + 3), (float)(x + 2), (float)(x + 1), (float)x);
+		_mm_storeu_ps(values, OctaveNoise_Calc4(n, xs, _mm_set1_ps((float)z)));
+		return;
+	}
+#endif
+	for (i = 0; i < count; i++) {
+		values[i] = OctaveNoise_Calc(n, (float)(x + i), (float)z);
+	}
+}
+
 
 struct CombinedNoise { struct OctaveNoise noise1, noise2; };
 static void CombinedNoise_Init(struct CombinedNoise* n, RNGState* rnd, int octaves1, int octaves2) {
@@ -230,6 +458,13 @@ static float CombinedNoise_Calc(const struct CombinedNoise* n, float x, float y)
 	return OctaveNoise_Calc(&n->noise1, x + offset, y);
 }
 
+#ifdef NOISE_SIMD
+static __m128 CombinedNoise_Calc4(const struct CombinedNoise* n, __m128 x, __m128 y) {
+	__m128 offset = OctaveNoise_Calc4(&n->noise2, x, y);
+	return OctaveNoise_Calc4(&n->noise1, _mm_add_ps(x, offset), y);
+}
+#endif
+
 
 /*########################################################################################################################*
 *----------------------------------------------------Notchy map gen-------------------------------------------------------*
@@ -300,10 +535,74 @@ static void NotchyGen_FloodFill(int index, BlockRaw block) {
 }
 
 
-static void NotchyGen_CreateHeightmap(void) {
+static const struct CombinedNoise* heightNoise1;
+static const struct CombinedNoise* heightNoise2;
+static const struct OctaveNoise*   heightNoise3;
+
+static int NotchyGen_CalcHeight(float low, float high, float mask) {
 	float hLow, hHigh, height;
-	int hIndex = 0, adjHeight;
-	int x, z;
+	hLow   = low / 6 - 4;
+	height = hLow;
+
+	if (mask <= 0) {
+		hHigh  = high / 5 + 6;
+		height = max(hLow, hHigh);
+	}
+
+	height *= 0.5f;
+	if (height < 0) height *= 0.8f;
+	return (int)(height + waterLevel);
+}
+
+static void NotchyGen_HeightmapRows(int zBeg, int zEnd) {
+	float low, high, mask;
+	int hIndex, x, z;
+#ifdef NOISE_SIMD
+	float lows[4], highs[4], masks[4];
+	__m128 xs, zs, xs13, zs13, mask4;
+	int i;
+#endif
+
+	for (z = zBeg; z < zEnd; z++) {
+		hIndex = z * World.Width;
+		x = 0;
+
+#ifdef NOISE_SIMD
+		zs   = _mm_set1_ps((float)z);
+		zs13 = _mm_set1_ps(z * 1.3f);
+
+		for (; gen_simd && x + 4 <= World.Width; x += 4) {
+			xs   = _mm_set_ps((float)(x + 3), (float)(x + 2), (float)(x + 1), (float)x);
+			xs13 = _mm_set_ps((x + 3) * 1.3f, (x + 2) * 1.3f, (x + 1) * 1.3f, x * 1.3f);
+
+			mask4 = OctaveNoise_Calc4(heightNoise3, xs, zs);
+			_mm_storeu_ps(masks, mask4);
+			_mm_storeu_ps(lows,  CombinedNoise_Calc4(heightNoise1, xs13, zs13));
+
+			/* Like the scalar path, only calculate high when it is actually needed */
+			if (_mm_movemask_ps(_mm_cmple_ps(mask4, _mm_setzero_ps()))) {
+				_mm_storeu_ps(highs, CombinedNoise_Calc4(heightNoise2, xs13, zs13));
+			} else {
+				_mm_storeu_ps(highs, _mm_setzero_ps());
+			}
+
+			for (i = 0; i < 4; i++) {
+				heightmap[hIndex++] = NotchyGen_CalcHeight(lows[i], highs[i], masks[i]);
+			}
+		}
+#endif
+
+		for (; x < World.Width; x++) {
+			low  = CombinedNoise_Calc(heightNoise1, x * 1.3f, z * 1.3f);
+			mask = OctaveNoise_Calc(heightNoise3, (float)x, (float)z);
+			high = mask <= 0 ? CombinedNoise_Calc(heightNoise2, x * 1.3f, z * 1.3f) : 0.0f;
+			heightmap[hIndex++] = NotchyGen_CalcHeight(low, high, mask);
+		}
+	}
+}
+
+static void NotchyGen_CreateHeightmap(void) {
+	int i, count = World.Width * World.Length;
 	struct CombinedNoise n1, n2;
 	struct OctaveNoise n3;
 
@@ -312,25 +611,13 @@ static void NotchyGen_CreateHeightmap(void) {
 	OctaveNoise_Init(&n3, &rnd, 6);
 
 	Gen_CurrentState = "Building heightmap";
-	for (z = 0; z < World.Length; z++) {
-		Gen_CurrentProgress = (float)z / World.Length;
-
-		for (x = 0; x < World.Width; x++) {
-			hLow   = CombinedNoise_Calc(&n1, x * 1.3f, z * 1.3f) / 6 - 4;
-			height = hLow;
-
-			if (OctaveNoise_Calc(&n3, (float)x, (float)z) <= 0) {
-				hHigh = CombinedNoise_Calc(&n2, x * 1.3f, z * 1.3f) / 5 + 6;
-				height = max(hLow, hHigh);
-			}
+	heightNoise1 = &n1;
+	heightNoise2 = &n2;
+	heightNoise3 = &n3;
+	Gen_ForEachRows(NotchyGen_HeightmapRows);
 
-			height *= 0.5f;
-			if (height < 0) height *= 0.8f;
-
-			adjHeight = (int)(height + waterLevel);
-			minHeight = min(adjHeight, minHeight);
-			heightmap[hIndex++] = adjHeight;
-		}
+	for (i = 0; i < count; i++) {
+		minHeight = min(heightmap[i], minHeight);
 	}
 }
 
@@ -363,43 +650,58 @@ static int NotchyGen_CreateStrataFast(void) {
 	return max(stoneHeight, 1);
 }
 
-static void NotchyGen_CreateStrata(void) {
+static const struct OctaveNoise* strataNoise;
+static int strataMinStoneY;
+
+static void NotchyGen_StrataRows(int zBeg, int zEnd) {
 	int dirtThickness, dirtHeight;
-	int minStoneY, stoneHeight;
-	int hIndex = 0, maxY = World.MaxY, index = 0;
-	int x, y, z;
-	struct OctaveNoise n;
+	int minStoneY = strataMinStoneY, stoneHeight;
+	int hIndex, maxY = World.MaxY, index;
+	int i, count, x, y, z;
+	float noise[4];
 
-	/* Try to bulk fill bottom of the map if possible */
-	minStoneY = NotchyGen_CreateStrataFast();
-	OctaveNoise_Init(&n, &rnd, 8);
+	for (z = zBeg; z < zEnd; z++) {
+		hIndex = z * World.Width;
 
-	Gen_CurrentState = "Creating strata";
-	for (z = 0; z < World.Length; z++) {
-		Gen_CurrentProgress = (float)z / World.Length;
+		for (x = 0; x < World.Width; x += count) {
+			count = min(4, World.Width - x);
+			OctaveNoise_CalcRow(strataNoise, x, z, count, noise);
 
-		for (x = 0; x < World.Width; x++) {
-			dirtThickness = (int)(OctaveNoise_Calc(&n, (float)x, (float)z) / 24 - 4);
-			dirtHeight    = heightmap[hIndex++];
-			stoneHeight   = dirtHeight + dirtThickness;
+			for (i = 0; i < count; i++) {
+				dirtThickness = (int)(noise[i] / 24 - 4);
+				dirtHeight    = heightmap[hIndex++];
+				stoneHeight   = dirtHeight + dirtThickness;
 
-			stoneHeight = min(stoneHeight, maxY);
-			dirtHeight  = min(dirtHeight,  maxY);
+				stoneHeight = min(stoneHeight, maxY);
+				dirtHeight  = min(dirtHeight,  maxY);
 
-			index = World_Pack(x, minStoneY, z);
-			for (y = minStoneY; y <= stoneHeight; y++) {
-				Gen_Blocks[index] = BLOCK_STONE; index += World.OneY;
-			}
+				index = World_Pack(x + i, minStoneY, z);
+				for (y = minStoneY; y <= stoneHeight; y++) {
+					Gen_Blocks[index] = BLOCK_STONE; index += World.OneY;
+				}
 
-			stoneHeight = max(stoneHeight, 0);
-			index = World_Pack(x, (stoneHeight + 1), z);
-			for (y = stoneHeight + 1; y <= dirtHeight; y++) {
-				Gen_Blocks[index] = BLOCK_DIRT; index += World.OneY;
+				stoneHeight = max(stoneHeight, 0);
+				index = World_Pack(x + i, (stoneHeight + 1), z);
+				for (y = stoneHeight + 1; y <= dirtHeight; y++) {
+					Gen_Blocks[index] = BLOCK_DIRT; index += World.OneY;
+				}
 			}
 		}
 	}
 }
 
+static void NotchyGen_CreateStrata(void) {
+	struct OctaveNoise n;
+
+	/* Try to bulk fill bottom of the map if possible */
+	strataMinStoneY = NotchyGen_CreateStrataFast();
+	OctaveNoise_Init(&n, &rnd, 8);
+
+	Gen_CurrentState = "Creating strata";
+	strataNoise = &n;
+	Gen_ForEachRows(NotchyGen_StrataRows);
+}
+
 static void NotchyGen_CarveCaves(void) {
 	int cavesCount, caveLen;
 	float caveX, caveY, caveZ;
@@ -540,18 +842,16 @@ static void NotchyGen_FloodFillLava(void) {
 	}
 }
 
-static void NotchyGen_CreateSurfaceLayer(void) {	
-	int hIndex = 0, index;
+static const struct OctaveNoise* surfaceNoise1;
+static const struct OctaveNoise* surfaceNoise2;
+
+static void NotchyGen_SurfaceRows(int zBeg, int zEnd) {
+	int hIndex, index;
 	BlockRaw above;
 	int x, y, z;
-	struct OctaveNoise n1, n2;
 
-	OctaveNoise_Init(&n1, &rnd, 8);
-	OctaveNoise_Init(&n2, &rnd, 8);
-
-	Gen_CurrentState = "Creating surface";
-	for (z = 0; z < World.Length; z++) {
-		Gen_CurrentProgress = (float)z / World.Length;
+	for (z = zBeg; z < zEnd; z++) {
+		hIndex = z * World.Width;
 
 		for (x = 0; x < World.Width; x++) {
 			y = heightmap[hIndex++];
@@ -561,15 +861,27 @@ static void NotchyGen_CreateSurfaceLayer(void) {
 			above = y >= World.MaxY ? BLOCK_AIR : Gen_Blocks[index + World.OneY];
 
 			/* TODO: update heightmap */
-			if (above == BLOCK_STILL_WATER && (OctaveNoise_Calc(&n2, (float)x, (float)z) > 12)) {
+			if (above == BLOCK_STILL_WATER && (OctaveNoise_Calc(surfaceNoise2, (float)x, (float)z) > 12)) {
 				Gen_Blocks[index] = BLOCK_GRAVEL;
 			} else if (above == BLOCK_AIR) {
-				Gen_Blocks[index] = (y <= waterLevel && (OctaveNoise_Calc(&n1, (float)x, (float)z) > 8)) ? BLOCK_SAND : BLOCK_GRASS;
+				Gen_Blocks[index] = (y <= waterLevel && (OctaveNoise_Calc(surfaceNoise1, (float)x, (float)z) > 8)) ? BLOCK_SAND : BLOCK_GRASS;
 			}
 		}
 	}
 }
 
+static void NotchyGen_CreateSurfaceLayer(void) {
+	struct OctaveNoise n1, n2;
+
+	OctaveNoise_Init(&n1, &rnd, 8);
+	OctaveNoise_Init(&n2, &rnd, 8);
+
+	Gen_CurrentState = "Creating surface";
+	surfaceNoise1 = &n1;
+	surfaceNoise2 = &n2;
+	Gen_ForEachRows(NotchyGen_SurfaceRows);
+}
+
 static void NotchyGen_PlantFlowers(void) {
 	int numPatches;
 	BlockRaw block;
@@ -17,6 +17,14 @@ extern volatile const char* Gen_CurrentState;
 extern int Gen_Seed;
 extern BlockRaw* Gen_Blocks;
 
+#define GEN_MAX_STAGES 16
+/* Number of stages performed when generating the last map */
+extern int Gen_StagesCount;
+/* Name of each stage performed when generating the last map */
+extern const char* Gen_StageNames[GEN_MAX_STAGES];
+/* Time taken by each stage performed when generating the last map, in microseconds */
+extern int Gen_StageMicros[GEN_MAX_STAGES];
+
 /* Starts generating a map using the Gen_Active generator */
 void Gen_Start(void);
 /* Checks whether the map generator has completed yet */
@@ -28,6 +36,12 @@ struct MapGenerator {
 	void   (*Generate)(void);
 };
 
+/* Generates a map of World's current dimensions with the given generator on the calling thread, */
+/*  splitting column based stages across the given number of extra threads. Used for benchmarking */
+/* simd: Whether to calculate noise using SIMD instructions, when supported by this build */
+/* Returns the generated blocks (which the caller must free), or NULL if out of memory */
+BlockRaw* Gen_GenerateNow(const struct MapGenerator* gen, int threads, hc_bool simd);
+
 extern const struct MapGenerator* Gen_Active;
 extern const struct MapGenerator FlatgrassGen;
 extern const struct MapGenerator NotchyGen;
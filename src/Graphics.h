@@ -28,11 +28,12 @@ struct MenuOptionsScreen;
 extern struct IGameComponent Gfx_Component;
 
 typedef enum VertexFormat_ {
-	VERTEX_FORMAT_COLOURED, VERTEX_FORMAT_TEXTURED
+	VERTEX_FORMAT_COLOURED, VERTEX_FORMAT_TEXTURED, VERTEX_FORMAT_TERRAIN
 } VertexFormat;
 
 #define SIZEOF_VERTEX_COLOURED 16
 #define SIZEOF_VERTEX_TEXTURED 24
+#define SIZEOF_VERTEX_TERRAIN  16
 
 #if defined HC_BUILD_PSP
 /* 3 floats for position (XYZ), 4 bytes for colour */
@@ -46,6 +47,19 @@ struct VertexColoured { float x, y, z; PackedCol Col; };
 struct VertexTextured { float x, y, z; PackedCol Col; float U, V; };
 #endif
 
+/* Chunk relative position (XYZ) and U as 16 bit fixed point, 4 bytes for colour, float V */
+/* NOTE: V stays a float, as 16 bits isn't enough to address a row of the terrain atlas */
+struct VertexTerrain { hc_int16 x, y, z, U; PackedCol Col; float V; };
+/* Number of units per block for VertexTerrain positions */
+#define TERRAIN_POS_SCALE 256.0f
+/* Number of units per 1.0 of VertexTerrain U */
+#define TERRAIN_U_SCALE  1024.0f
+
+/* Rows of a 3x4 matrix transforming model part vertices into world space, 4 bytes for colour, */
+/*  and 2 floats that the texture coordinates (UV) of model part vertices are scaled by */
+struct ModelInstance { float row0[4], row1[4], row2[4]; PackedCol Col; float uScale, vScale; };
+#define SIZEOF_MODEL_INSTANCE 60
+
 void Gfx_Create(void);
 void Gfx_Free(void);
 
@@ -84,6 +98,11 @@ HC_VAR extern struct _GfxData {
 	hc_uint8 ReducedPerfModeCooldown;
 	/* Default index buffer for a triangle list representing quads */
 	GfxResourceID DefaultIb;
+	/* Number of bytes of vertex data uploaded to the GPU during the last frame */
+	/* NOTE: Only OpenGL backends track this */
+	int UploadedBytes;
+	/* Whether the graphics backend supports Gfx_DrawModelInstances */
+	hc_bool SupportsInstancing;
 } Gfx;
 
 extern const hc_string Gfx_LowPerfMessage;
@@ -196,6 +215,8 @@ HC_API void Gfx_SetFogMode(FogFunc func);
 *#########################################################################################################################*/
 /* Sets whether backface culling is performed */
 HC_API void Gfx_SetFaceCulling(hc_bool enabled);
+/* Returns whether pixels with an alpha of less than 128 are discarded */
+HC_API hc_bool Gfx_GetAlphaTest(void);
 /* Sets whether pixels with an alpha of less than 128 are discarded */
 HC_API void Gfx_SetAlphaTest(hc_bool enabled);
 /* Sets whether existing and new pixels are blended together */
@@ -266,6 +287,13 @@ HC_API void  Gfx_UnlockDynamicVb(GfxResourceID vb);
 
 /* Updates the data of a dynamic vertex buffer */
 HC_API void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount);
+#ifdef HC_BUILD_TERRAINPOOL
+/* Creates a vertex buffer whose contents are updated in ranges, using Gfx_SetPoolVbRange */
+/* NOTE: Bind with Gfx_BindVb, and delete with Gfx_DeleteVb */
+GfxResourceID Gfx_CreatePoolVb(VertexFormat fmt, int count);
+/* Updates the data of a range of vertices in a pool vertex buffer */
+void Gfx_SetPoolVbRange(GfxResourceID vb, VertexFormat fmt, int startVertex, void* vertices, int vCount);
+#endif
 
 
 /*########################################################################################################################*
@@ -282,6 +310,21 @@ HC_API void Gfx_DrawVb_IndexedTris_Range(int verticesCount, int startVertex);
 HC_API void Gfx_DrawVb_IndexedTris(int verticesCount);
 /* Special case Gfx_DrawVb_IndexedTris_Range for map renderer */
 void Gfx_DrawIndexedTris_T2fC4b(int verticesCount, int startVertex);
+#ifdef HC_BUILD_TERRAINVERTICES
+/* Sets the world position that positions of VERTEX_FORMAT_TERRAIN vertices are relative to */
+void Gfx_SetTerrainOrigin(int x, int y, int z);
+#endif
+#ifdef HC_BUILD_TERRAINPOOL
+/* Special case Gfx_DrawIndexedTris_T2fC4b that draws several ranges at once (in one call if supported) */
+void Gfx_DrawIndexedTris_Multi(const int* counts, const int* starts, int drawsCount);
+#endif
+#ifdef HC_BUILD_MODELINSTANCING
+/* Renders vertices from the given static VERTEX_FORMAT_TEXTURED vertex buffer once for each instance */
+/* NOTE: Positions are transformed by the instance's matrix, then by the current view and projection matrices */
+/* NOTE: Only works when Gfx.SupportsInstancing is true */
+void Gfx_DrawModelInstances(GfxResourceID vb, int verticesCount, int startVertex, 
+							const struct ModelInstance* instances, int instancesCount);
+#endif
 
 
 /*########################################################################################################################*
@@ -162,6 +162,7 @@ void* Gfx_LockVb(GfxResourceID vb, VertexFormat fmt, int count) {
 
 void Gfx_UnlockVb(GfxResourceID vb) {
 	_glBufferData(GL_ARRAY_BUFFER, tmpSize, tmpData, GL_STATIC_DRAW);
+	gfx_frameUploads += tmpSize;
 }
 #else
 static GfxResourceID Gfx_AllocStaticVb(VertexFormat fmt, int count) {
@@ -186,6 +187,7 @@ static void UpdateDisplayList(GLuint list, void* vertices, VertexFormat fmt, int
 	gfx_setupVBFunc();
 	glDrawElements(GL_TRIANGLES, ICOUNT(count), GL_UNSIGNED_SHORT, gl_indices);
 	glEndList();
+	gfx_frameUploads += count * strideSizes[fmt];
 
 	Gfx_SetVertexFormat(realFormat);
 	dynamicListData = dyn_data;
@@ -244,12 +246,14 @@ void* Gfx_LockDynamicVb(GfxResourceID vb, VertexFormat fmt, int count) {
 void Gfx_UnlockDynamicVb(GfxResourceID vb) {
 	_glBindBuffer(GL_ARRAY_BUFFER, vb);
 	_glBufferSubData(GL_ARRAY_BUFFER, 0, tmpSize, tmpData);
+	gfx_frameUploads += tmpSize;
 }
 
 void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount) {
 	cc_uint32 size = vCount * gfx_stride;
 	_glBindBuffer(GL_ARRAY_BUFFER, vb);
 	_glBufferSubData(GL_ARRAY_BUFFER, 0, size, vertices);
+	gfx_frameUploads += size;
 }
 #else
 static GfxResourceID Gfx_AllocDynamicVb(VertexFormat fmt, int maxVertices) {
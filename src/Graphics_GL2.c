@@ -48,6 +48,13 @@ static const struct DynamicLibSym core_funcs[] = {
 
 #include "_GLShared.h"
 static GfxResourceID white_square;
+/* Core since OpenGL 1.4, but not part of OpenGL ES 2.0 or WebGL */
+static void (APIENTRY *_glMultiDrawElements)(GLenum mode, const GLsizei* count, GLenum type, 
+											const void* const* indices, GLsizei drawcount);
+/* Core since OpenGL 3.3 and OpenGL ES 3.0, otherwise requires GL_ARB_instanced_arrays */
+static void (APIENTRY *_glDrawElementsInstanced)(GLenum mode, GLsizei count, GLenum type, 
+												const void* indices, GLsizei instancecount);
+static void (APIENTRY *_glVertexAttribDivisor)(GLuint index, GLuint divisor);
 static int postProcess;
 enum PostProcess { POSTPROCESS_NONE, POSTPROCESS_GRAYSCALE };
 static const char* const postProcess_Names[2] = { "NONE", "GRAYSCALE" };
@@ -88,6 +95,9 @@ void Gfx_DeleteIb(GfxResourceID* ib) {
 /*########################################################################################################################*
 *------------------------------------------------------Vertex buffers-----------------------------------------------------*
 *#########################################################################################################################*/
+/* Offset in bytes of the vertices in the currently bound vertex buffer */
+static hc_uint32 gfx_vbBase;
+
 static GfxResourceID Gfx_AllocStaticVb(VertexFormat fmt, int count) {
 	GLuint id = GL_GenAndBind(GL_ARRAY_BUFFER);
 	return uint_to_ptr(id);
@@ -95,6 +105,7 @@ static GfxResourceID Gfx_AllocStaticVb(VertexFormat fmt, int count) {
 
 void Gfx_BindVb(GfxResourceID vb) { 
 	glBindBuffer(GL_ARRAY_BUFFER, ptr_to_uint(vb)); 
+	gfx_vbBase = 0;
 }
 
 void Gfx_DeleteVb(GfxResourceID* vb) {
@@ -109,43 +120,132 @@ void* Gfx_LockVb(GfxResourceID vb, VertexFormat fmt, int count) {
 
 void Gfx_UnlockVb(GfxResourceID vb) {
 	glBufferData(GL_ARRAY_BUFFER, tmpSize, tmpData, GL_STATIC_DRAW);
+	gfx_frameUploads += tmpSize;
+}
+
+#ifdef HC_BUILD_TERRAINPOOL
+GfxResourceID Gfx_CreatePoolVb(VertexFormat fmt, int count) {
+	GLuint id = GL_GenAndBind(GL_ARRAY_BUFFER);
+	glBufferData(GL_ARRAY_BUFFER, count * strideSizes[fmt], NULL, GL_DYNAMIC_DRAW);
+	return uint_to_ptr(id);
+}
+
+void Gfx_SetPoolVbRange(GfxResourceID vb, VertexFormat fmt, int startVertex, void* vertices, int vCount) {
+	hc_uint32 stride = strideSizes[fmt];
+	glBindBuffer(GL_ARRAY_BUFFER, ptr_to_uint(vb));
+	glBufferSubData(GL_ARRAY_BUFFER, startVertex * stride, vCount * stride, vertices);
+	gfx_frameUploads += vCount * stride;
+}
+#endif
+
+
+/*########################################################################################################################*
+*---------------------------------------------------Streaming vertex buffer-----------------------------------------------*
+*#########################################################################################################################*/
+/* Dynamic vertex buffers are all streamed through one large ring buffer, instead of each */
+/*  updating a buffer of its own (which may stall until the GPU has drawn the old contents) */
+/* When the ring buffer is full, it is orphaned and then restarted from the beginning */
+#define STREAM_MIN_SIZE (4 * 1024 * 1024)
+#define STREAM_ALIGNMENT 64
+
+struct DynamicVb {
+	void* data;     /* Vertices written through Gfx_LockDynamicVb, so they can be streamed again after the ring buffer is orphaned */
+	int capacity;   /* Size of data in bytes */
+	hc_bool kept;   /* Whether data holds the current vertices */
+	int size;       /* Size in bytes of the current vertices */
+	int offset;     /* Offset of the current vertices in the ring buffer */
+	int generation; /* Ring buffer generation the current vertices were streamed into */
+};
+static GLuint stream_id;
+static int stream_size, stream_offset, stream_generation = 1;
+
+static void Stream_Upload(struct DynamicVb* vb, const void* data) {
+	if (!stream_id) {
+		stream_id     = GL_GenAndBind(GL_ARRAY_BUFFER);
+		stream_offset = stream_size;
+	} else {
+		glBindBuffer(GL_ARRAY_BUFFER, stream_id);
+	}
+
+	if (stream_offset + vb->size > stream_size) {
+		stream_size = max(stream_size, max(STREAM_MIN_SIZE, vb->size * 4));
+		glBufferData(GL_ARRAY_BUFFER, stream_size, NULL, GL_STREAM_DRAW);
+		stream_offset = 0;
+		stream_generation++;
+	}
+
+	glBufferSubData(GL_ARRAY_BUFFER, stream_offset, vb->size, data);
+	gfx_frameUploads += vb->size;
+	vb->offset     = stream_offset;
+	vb->generation = stream_generation;
+	stream_offset += (vb->size + (STREAM_ALIGNMENT - 1)) & ~(STREAM_ALIGNMENT - 1);
+}
+
+static void Stream_Free(void) {
+	if (stream_id) glDeleteBuffers(1, &stream_id);
+	stream_id   = 0;
+	stream_size = 0;
+	/* Forces all dynamic vertex buffers to be streamed again */
+	stream_generation++;
+}
+
+/* Grows the vertices copy of a dynamic vertex buffer to fit the given size if needed */
+static void DynamicVb_Reserve(struct DynamicVb* vb, int size) {
+	if (size <= vb->capacity) return;
+	vb->data     = Mem_Realloc(vb->data, size, 1, "dynamic VB data");
+	vb->capacity = size;
 }
 
 
 /*########################################################################################################################*
 *--------------------------------------------------Dynamic vertex buffers-------------------------------------------------*
 *#########################################################################################################################*/
+/* Vertices copy is only allocated once the buffer is first locked */
 static GfxResourceID Gfx_AllocDynamicVb(VertexFormat fmt, int maxVertices) {
-	GLuint id      = GL_GenAndBind(GL_ARRAY_BUFFER);
-	hc_uint32 size = maxVertices * strideSizes[fmt];
-
-	glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
-	return uint_to_ptr(id);
+	return Mem_TryAllocCleared(1, sizeof(struct DynamicVb));
 }
 
+/* NOTE: Vertices given to Gfx_SetDynamicVbData are not kept, so callers must set them */
+/*  again before drawing in a later frame, as the ring buffer may have been orphaned */
 void Gfx_BindDynamicVb(GfxResourceID vb) {
-	glBindBuffer(GL_ARRAY_BUFFER, ptr_to_uint(vb)); 
+	struct DynamicVb* dyn = (struct DynamicVb*)vb;
+
+	if (dyn->generation != stream_generation && dyn->kept) {
+		Stream_Upload(dyn, dyn->data);
+	} else {
+		glBindBuffer(GL_ARRAY_BUFFER, stream_id);
+	}
+	gfx_vbBase = dyn->offset;
 }
 
 void Gfx_DeleteDynamicVb(GfxResourceID* vb) {
-	GLuint id = ptr_to_uint(*vb);
-	if (id) glDeleteBuffers(1, &id);
+	struct DynamicVb* dyn = (struct DynamicVb*)(*vb);
+	if (dyn) { Mem_Free(dyn->data); Mem_Free(dyn); }
 	*vb = 0;
 }
 
 void* Gfx_LockDynamicVb(GfxResourceID vb, VertexFormat fmt, int count) {
-	return FastAllocTempMem(count * strideSizes[fmt]);
+	struct DynamicVb* dyn = (struct DynamicVb*)vb;
+	dyn->size = count * strideSizes[fmt];
+
+	DynamicVb_Reserve(dyn, dyn->size);
+	dyn->kept = true;
+	return dyn->data;
 }
 
 void Gfx_UnlockDynamicVb(GfxResourceID vb) {
-	glBindBuffer(GL_ARRAY_BUFFER, ptr_to_uint(vb));
-	glBufferSubData(GL_ARRAY_BUFFER, 0, tmpSize, tmpData);
+	struct DynamicVb* dyn = (struct DynamicVb*)vb;
+	Stream_Upload(dyn, dyn->data);
+	gfx_vbBase = dyn->offset;
 }
 
 void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount) {
-	hc_uint32 size = vCount * gfx_stride;
-	glBindBuffer(GL_ARRAY_BUFFER, ptr_to_uint(vb));
-	glBufferSubData(GL_ARRAY_BUFFER, 0, size, vertices);
+	struct DynamicVb* dyn = (struct DynamicVb*)vb;
+	dyn->size = vCount * gfx_stride;
+	dyn->kept = false;
+
+	Stream_Upload(dyn, vertices);
+	gfx_vbBase = dyn->offset;
 }
 
 
@@ -158,6 +258,8 @@ void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount) {
 #define FTR_LINEAR_FOG (1 << 3)
 #define FTR_DENSIT_FOG (1 << 4)
 #define FTR_HASANY_FOG (FTR_LINEAR_FOG | FTR_DENSIT_FOG)
+#define FTR_TERRAIN_VB (1 << 5)
+#define FTR_INSTANCED  (1 << 6)
 #define FTR_FS_MEDIUMP (1 << 7)
 
 #define UNI_MVP_MATRIX (1 << 0)
@@ -165,7 +267,8 @@ void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount) {
 #define UNI_FOG_COL    (1 << 2)
 #define UNI_FOG_END    (1 << 3)
 #define UNI_FOG_DENS   (1 << 4)
-#define UNI_MASK_ALL   0x1F
+#define UNI_TERRAIN    (1 << 5)
+#define UNI_MASK_ALL   0x3F
 
 /* cached uniforms (cached for multiple programs */
 static struct Matrix _view, _proj, _mvp;
@@ -174,14 +277,16 @@ static float _texX, _texY;
 static PackedCol gfx_fogColor;
 static float gfx_fogEnd = -1.0f, gfx_fogDensity = -1.0f;
 static int gfx_fogMode = -1;
+static float _terrainX, _terrainY, _terrainZ;
+static hc_bool gfx_instanced;
 
 /* shader programs (emulate fixed function) */
 static struct GLShader {
 	int features;     /* what features are enabled for this shader */
 	int uniforms;     /* which associated uniforms need to be resent to GPU */
 	GLuint program;   /* OpenGL program ID (0 if not yet compiled) */
-	int locations[5]; /* location of uniforms (not constant) */
-} shaders[6 * 3] = {
+	int locations[6]; /* location of uniforms (not constant) */
+} shaders[10 * 3] = {
 	/* no fog */
 	{ 0              },
 	{ 0              | FTR_ALPHA_TEST },
@@ -189,6 +294,10 @@ static struct GLShader {
 	{ FTR_TEXTURE_UV | FTR_ALPHA_TEST },
 	{ FTR_TEXTURE_UV | FTR_TEX_OFFSET },
 	{ FTR_TEXTURE_UV | FTR_TEX_OFFSET | FTR_ALPHA_TEST },
+	{ FTR_TEXTURE_UV | FTR_TERRAIN_VB },
+	{ FTR_TEXTURE_UV | FTR_TERRAIN_VB | FTR_ALPHA_TEST },
+	{ FTR_TEXTURE_UV | FTR_INSTANCED  },
+	{ FTR_TEXTURE_UV | FTR_INSTANCED  | FTR_ALPHA_TEST },
 	/* linear fog */
 	{ FTR_LINEAR_FOG | 0              },
 	{ FTR_LINEAR_FOG | 0              | FTR_ALPHA_TEST },
@@ -196,6 +305,10 @@ static struct GLShader {
 	{ FTR_LINEAR_FOG | FTR_TEXTURE_UV | FTR_ALPHA_TEST },
 	{ FTR_LINEAR_FOG | FTR_TEXTURE_UV | FTR_TEX_OFFSET },
 	{ FTR_LINEAR_FOG | FTR_TEXTURE_UV | FTR_TEX_OFFSET | FTR_ALPHA_TEST },
+	{ FTR_LINEAR_FOG | FTR_TEXTURE_UV | FTR_TERRAIN_VB },
+	{ FTR_LINEAR_FOG | FTR_TEXTURE_UV | FTR_TERRAIN_VB | FTR_ALPHA_TEST },
+	{ FTR_LINEAR_FOG | FTR_TEXTURE_UV | FTR_INSTANCED  },
+	{ FTR_LINEAR_FOG | FTR_TEXTURE_UV | FTR_INSTANCED  | FTR_ALPHA_TEST },
 	/* density fog */
 	{ FTR_DENSIT_FOG | 0              },
 	{ FTR_DENSIT_FOG | 0              | FTR_ALPHA_TEST },
@@ -203,6 +316,10 @@ static struct GLShader {
 	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_ALPHA_TEST },
 	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_TEX_OFFSET },
 	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_TEX_OFFSET | FTR_ALPHA_TEST },
+	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_TERRAIN_VB },
+	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_TERRAIN_VB | FTR_ALPHA_TEST },
+	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_INSTANCED  },
+	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_INSTANCED  | FTR_ALPHA_TEST },
 };
 static struct GLShader* gfx_activeShader;
 
@@ -210,19 +327,48 @@ static struct GLShader* gfx_activeShader;
 static void GenVertexShader(const struct GLShader* shader, hc_string* dst) {
 	int uv = shader->features & FTR_TEXTURE_UV;
 	int tm = shader->features & FTR_TEX_OFFSET;
-
-	String_AppendConst(dst,         "attribute vec3 in_pos;\n");
-	String_AppendConst(dst,         "attribute vec4 in_col;\n");
-	if (uv) String_AppendConst(dst, "attribute vec2 in_uv;\n");
+	int tv = shader->features & FTR_TERRAIN_VB;
+	int it = shader->features & FTR_INSTANCED;
+
+	/* Terrain vertices pack U into in_pos.w, see struct VertexTerrain */
+	if (tv) {
+		String_AppendConst(dst,     "attribute vec4 in_pos;\n");
+		String_AppendConst(dst,     "attribute vec4 in_col;\n");
+		String_AppendConst(dst,     "attribute float in_uv;\n");
+		String_AppendConst(dst,     "uniform vec3 terrainOrigin;\n");
+	} else {
+		String_AppendConst(dst,     "attribute vec3 in_pos;\n");
+		String_AppendConst(dst,     "attribute vec4 in_col;\n");
+		if (uv) String_AppendConst(dst, "attribute vec2 in_uv;\n");
+	}
+	/* Instanced model parts, see struct ModelInstance */
+	if (it) {
+		String_AppendConst(dst,     "attribute vec4 in_row0;\n");
+		String_AppendConst(dst,     "attribute vec4 in_row1;\n");
+		String_AppendConst(dst,     "attribute vec4 in_row2;\n");
+		String_AppendConst(dst,     "attribute vec4 in_icol;\n");
+		String_AppendConst(dst,     "attribute vec2 in_uvScale;\n");
+	}
 	String_AppendConst(dst,         "varying vec4 out_col;\n");
 	if (uv) String_AppendConst(dst, "varying vec2 out_uv;\n");
 	String_AppendConst(dst,         "uniform mat4 mvp;\n");
 	if (tm) String_AppendConst(dst, "uniform vec2 texOffset;\n");
 
 	String_AppendConst(dst,         "void main() {\n");
-	String_AppendConst(dst,         "  gl_Position = mvp * vec4(in_pos, 1.0);\n");
-	String_AppendConst(dst,         "  out_col = in_col;\n");
-	if (uv) String_AppendConst(dst, "  out_uv  = in_uv;\n");
+	if (tv) {
+		String_AppendConst(dst,     "  vec3 pos = in_pos.xyz * (1.0 / 256.0) + terrainOrigin;\n");
+		String_AppendConst(dst,     "  gl_Position = mvp * vec4(pos, 1.0);\n");
+		String_AppendConst(dst,     "  out_uv  = vec2(in_pos.w * (1.0 / 1024.0), in_uv);\n");
+	} else if (it) {
+		String_AppendConst(dst,     "  vec4 pos = vec4(in_pos, 1.0);\n");
+		String_AppendConst(dst,     "  gl_Position = mvp * vec4(dot(in_row0, pos), dot(in_row1, pos), dot(in_row2, pos), 1.0);\n");
+		String_AppendConst(dst,     "  out_uv  = in_uv * in_uvScale;\n");
+	} else {
+		String_AppendConst(dst,     "  gl_Position = mvp * vec4(in_pos, 1.0);\n");
+		if (uv) String_AppendConst(dst, "  out_uv  = in_uv;\n");
+	}
+	if (it) String_AppendConst(dst, "  out_col = in_col * in_icol;\n");
+	else    String_AppendConst(dst, "  out_col = in_col;\n");
 	if (tm) String_AppendConst(dst, "  out_uv  = out_uv + texOffset;\n");
 	String_AppendConst(dst,         "}");
 }
@@ -342,6 +488,11 @@ static void CompileProgram(struct GLShader* shader) {
 	glBindAttribLocation(program, 0, "in_pos");
 	glBindAttribLocation(program, 1, "in_col");
 	glBindAttribLocation(program, 2, "in_uv");
+	glBindAttribLocation(program, 3, "in_row0");
+	glBindAttribLocation(program, 4, "in_row1");
+	glBindAttribLocation(program, 5, "in_row2");
+	glBindAttribLocation(program, 6, "in_icol");
+	glBindAttribLocation(program, 7, "in_uvScale");
 
 	glLinkProgram(program);
 	glGetProgramiv(program, GL_LINK_STATUS, &temp);
@@ -358,6 +509,7 @@ static void CompileProgram(struct GLShader* shader) {
 		shader->locations[2] = glGetUniformLocation(program, "fogCol");
 		shader->locations[3] = glGetUniformLocation(program, "fogEnd");
 		shader->locations[4] = glGetUniformLocation(program, "fogDensity");
+		shader->locations[5] = glGetUniformLocation(program, "terrainOrigin");
 		return;
 	}
 	temp = 0;
@@ -407,6 +559,10 @@ static void ReloadUniforms(void) {
 		glUniform1f(s->locations[4], -gfx_fogDensity);
 		s->uniforms &= ~UNI_FOG_DENS;
 	}
+	if ((s->uniforms & UNI_TERRAIN) && (s->features & FTR_TERRAIN_VB)) {
+		glUniform3f(s->locations[5], _terrainX, _terrainY, _terrainZ);
+		s->uniforms &= ~UNI_TERRAIN;
+	}
 }
 
 /* Switches program to one that duplicates current fixed function state */
@@ -416,13 +572,19 @@ static void SwitchProgram(void) {
 	int index = 0;
 
 	if (gfx_fogEnabled) {
-		index += 6;                       /* linear fog */
-		if (gfx_fogMode >= 1) index += 6; /* exp fog */
+		index += 10;                       /* linear fog */
+		if (gfx_fogMode >= 1) index += 10; /* exp fog */
 	}
 
-	if (gfx_format == VERTEX_FORMAT_TEXTURED) index += 2;
-	if (gfx_texTransform) index += 2;
-	if (gfx_alphaTest)    index += 1;
+	if (gfx_instanced) {
+		index += 8;
+	} else if (gfx_format == VERTEX_FORMAT_TERRAIN) {
+		index += 6;
+	} else {
+		if (gfx_format == VERTEX_FORMAT_TEXTURED) index += 2;
+		if (gfx_texTransform) index += 2;
+	}
+	if (gfx_alphaTest) index += 1;
 
 	shader = &shaders[index];
 	if (shader == gfx_activeShader) { ReloadUniforms(); return; }
@@ -517,6 +679,13 @@ void Gfx_DisableTextureOffset(void) {
 	SwitchProgram();
 }
 
+void Gfx_SetTerrainOrigin(int x, int y, int z) {
+	if (x == _terrainX && y == _terrainY && z == _terrainZ) return;
+	_terrainX = (float)x; _terrainY = (float)y; _terrainZ = (float)z;
+	DirtyUniform(UNI_TERRAIN);
+	ReloadUniforms();
+}
+
 
 /*########################################################################################################################*
 *-------------------------------------------------------State setup-------------------------------------------------------*
@@ -529,10 +698,45 @@ static void GLContext_GetAll(const struct DynamicLibSym* syms, int count) {
 	}
 }
 
+static void LoadInstancingFuncs(void) {
+	static const struct DynamicLibSym coreFuncs[] = {
+		{ "glDrawElementsInstanced",    (void**)&_glDrawElementsInstanced },
+		{ "glVertexAttribDivisor",      (void**)&_glVertexAttribDivisor }
+	};
+#ifdef HC_BUILD_GLES
+	GLint major = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	if (major >= 3) GLContext_GetAll(coreFuncs, Array_Elems(coreFuncs));
+#else
+	static const struct DynamicLibSym arbFuncs[] = {
+		{ "glDrawElementsInstancedARB", (void**)&_glDrawElementsInstanced },
+		{ "glVertexAttribDivisorARB",   (void**)&_glVertexAttribDivisor }
+	};
+	static const hc_string arbExt = String_FromConst("GL_ARB_instanced_arrays");
+	hc_string extensions = String_FromReadonly((const char*)glGetString(GL_EXTENSIONS));
+	const GLubyte* ver   = glGetString(GL_VERSION);
+	int major = ver[0] - '0', minor = ver[2] - '0';
+
+	if (major > 3 || (major == 3 && minor >= 3)) {
+		GLContext_GetAll(coreFuncs, Array_Elems(coreFuncs));
+	} else if (String_CaselessContains(&extensions, &arbExt)) {
+		GLContext_GetAll(arbFuncs,  Array_Elems(arbFuncs));
+	}
+#endif
+	Gfx.SupportsInstancing = _glDrawElementsInstanced && _glVertexAttribDivisor;
+}
+
 static void GLBackend_Init(void) {
+#ifndef HC_BUILD_GLES
+	static const struct DynamicLibSym multidraw_funcs[] = {
+		{ "glMultiDrawElements", (void**)&_glMultiDrawElements }
+	};
+	GLContext_GetAll(multidraw_funcs, Array_Elems(multidraw_funcs));
+#endif
 #ifdef HC_BUILD_WIN
 	GLContext_GetAll(core_funcs, Array_Elems(core_funcs));
 #endif
+	LoadInstancingFuncs();
 	Gfx.BackendType = HC_GFX_BACKEND_GL2;
 
 #ifdef HC_BUILD_GLES
@@ -579,6 +783,7 @@ static void DeleteShaders(void) {
 static void Gfx_FreeState(void) {
 	FreeDefaultResources();
 	DeleteShaders();
+	Stream_Free();
 	Gfx_DeleteTexture(&white_square);
 }
 
@@ -637,29 +842,45 @@ static GL_SetupVBFunc gfx_setupVBFunc;
 static GL_SetupVBRangeFunc gfx_setupVBRangeFunc;
 
 static void GL_SetupVbColoured(void) {
-	glVertexAttribPointer(0, 3, GL_FLOAT,         false, SIZEOF_VERTEX_COLOURED, uint_to_ptr( 0));
-	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true,  SIZEOF_VERTEX_COLOURED, uint_to_ptr(12));
+	hc_uint32 offset = gfx_vbBase;
+	glVertexAttribPointer(0, 3, GL_FLOAT,         false, SIZEOF_VERTEX_COLOURED, uint_to_ptr(offset     ));
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true,  SIZEOF_VERTEX_COLOURED, uint_to_ptr(offset + 12));
 }
 
 static void GL_SetupVbTextured(void) {
-	glVertexAttribPointer(0, 3, GL_FLOAT,         false, SIZEOF_VERTEX_TEXTURED, uint_to_ptr( 0));
-	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true,  SIZEOF_VERTEX_TEXTURED, uint_to_ptr(12));
-	glVertexAttribPointer(2, 2, GL_FLOAT,         false, SIZEOF_VERTEX_TEXTURED, uint_to_ptr(16));
+	hc_uint32 offset = gfx_vbBase;
+	glVertexAttribPointer(0, 3, GL_FLOAT,         false, SIZEOF_VERTEX_TEXTURED, uint_to_ptr(offset     ));
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true,  SIZEOF_VERTEX_TEXTURED, uint_to_ptr(offset + 12));
+	glVertexAttribPointer(2, 2, GL_FLOAT,         false, SIZEOF_VERTEX_TEXTURED, uint_to_ptr(offset + 16));
+}
+
+static void GL_SetupVbTerrain(void) {
+	hc_uint32 offset = gfx_vbBase;
+	glVertexAttribPointer(0, 4, GL_SHORT,         false, SIZEOF_VERTEX_TERRAIN, uint_to_ptr(offset     ));
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true,  SIZEOF_VERTEX_TERRAIN, uint_to_ptr(offset +  8));
+	glVertexAttribPointer(2, 1, GL_FLOAT,         false, SIZEOF_VERTEX_TERRAIN, uint_to_ptr(offset + 12));
 }
 
 static void GL_SetupVbColoured_Range(int startVertex) {
-	hc_uint32 offset = startVertex * SIZEOF_VERTEX_COLOURED;
+	hc_uint32 offset = gfx_vbBase + startVertex * SIZEOF_VERTEX_COLOURED;
 	glVertexAttribPointer(0, 3, GL_FLOAT,         false, SIZEOF_VERTEX_COLOURED, uint_to_ptr(offset     ));
 	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true,  SIZEOF_VERTEX_COLOURED, uint_to_ptr(offset + 12));
 }
 
 static void GL_SetupVbTextured_Range(int startVertex) {
-	hc_uint32 offset = startVertex * SIZEOF_VERTEX_TEXTURED;
+	hc_uint32 offset = gfx_vbBase + startVertex * SIZEOF_VERTEX_TEXTURED;
 	glVertexAttribPointer(0, 3, GL_FLOAT,         false, SIZEOF_VERTEX_TEXTURED, uint_to_ptr(offset     ));
 	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true,  SIZEOF_VERTEX_TEXTURED, uint_to_ptr(offset + 12));
 	glVertexAttribPointer(2, 2, GL_FLOAT,         false, SIZEOF_VERTEX_TEXTURED, uint_to_ptr(offset + 16));
 }
 
+static void GL_SetupVbTerrain_Range(int startVertex) {
+	hc_uint32 offset = gfx_vbBase + startVertex * SIZEOF_VERTEX_TERRAIN;
+	glVertexAttribPointer(0, 4, GL_SHORT,         false, SIZEOF_VERTEX_TERRAIN, uint_to_ptr(offset     ));
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true,  SIZEOF_VERTEX_TERRAIN, uint_to_ptr(offset +  8));
+	glVertexAttribPointer(2, 1, GL_FLOAT,         false, SIZEOF_VERTEX_TERRAIN, uint_to_ptr(offset + 12));
+}
+
 void Gfx_SetVertexFormat(VertexFormat fmt) {
 	if (fmt == gfx_format) return;
 	gfx_format = fmt;
@@ -669,6 +890,10 @@ void Gfx_SetVertexFormat(VertexFormat fmt) {
 		glEnableVertexAttribArray(2);
 		gfx_setupVBFunc      = GL_SetupVbTextured;
 		gfx_setupVBRangeFunc = GL_SetupVbTextured_Range;
+	} else if (fmt == VERTEX_FORMAT_TERRAIN) {
+		glEnableVertexAttribArray(2);
+		gfx_setupVBFunc      = GL_SetupVbTerrain;
+		gfx_setupVBRangeFunc = GL_SetupVbTerrain_Range;
 	} else {
 		glDisableVertexAttribArray(2);
 		gfx_setupVBFunc      = GL_SetupVbColoured;
@@ -692,19 +917,79 @@ void Gfx_DrawVb_IndexedTris(int verticesCount) {
 	glDrawElements(GL_TRIANGLES, ICOUNT(verticesCount), GL_UNSIGNED_SHORT, NULL);
 }
 
+/* NOTE: Map renderer may use either VERTEX_FORMAT_TEXTURED or VERTEX_FORMAT_TERRAIN */
 void Gfx_BindVb_Textured(GfxResourceID vb) {
 	Gfx_BindVb(vb);
-	GL_SetupVbTextured();
+	gfx_setupVBFunc();
 }
 
 void Gfx_DrawIndexedTris_T2fC4b(int verticesCount, int startVertex) {
 	if (startVertex + verticesCount > GFX_MAX_VERTICES) {
-		GL_SetupVbTextured_Range(startVertex);
+		gfx_setupVBRangeFunc(startVertex);
 		glDrawElements(GL_TRIANGLES, ICOUNT(verticesCount), GL_UNSIGNED_SHORT, NULL);
-		GL_SetupVbTextured();
+		gfx_setupVBFunc();
 	} else {
 		/* ICOUNT(startVertex) * 2 = startVertex * 3  */
 		glDrawElements(GL_TRIANGLES, ICOUNT(verticesCount), GL_UNSIGNED_SHORT, uint_to_ptr(startVertex * 3));
 	}
 }
+
+#define MAX_MULTI_DRAWS 16
+void Gfx_DrawIndexedTris_Multi(const int* counts, const int* starts, int drawsCount) {
+	GLsizei indices[MAX_MULTI_DRAWS];
+	const void* offsets[MAX_MULTI_DRAWS];
+	int i, count = 0;
+
+	for (i = 0; i < drawsCount; i++)
+	{
+		/* Ranges past the end of the index buffer need vertex attributes to be offset */
+		if (!_glMultiDrawElements || starts[i] + counts[i] > GFX_MAX_VERTICES) {
+			Gfx_DrawIndexedTris_T2fC4b(counts[i], starts[i]); continue;
+		}
+
+		indices[count] = ICOUNT(counts[i]);
+		offsets[count] = uint_to_ptr(starts[i] * 3);
+		if (++count < MAX_MULTI_DRAWS) continue;
+
+		_glMultiDrawElements(GL_TRIANGLES, indices, GL_UNSIGNED_SHORT, offsets, count);
+		count = 0;
+	}
+	if (count) _glMultiDrawElements(GL_TRIANGLES, indices, GL_UNSIGNED_SHORT, offsets, count);
+}
+#endif
+
+#ifdef HC_BUILD_MODELINSTANCING
+void Gfx_DrawModelInstances(GfxResourceID vb, int verticesCount, int startVertex, 
+							const struct ModelInstance* instances, int instancesCount) {
+	struct DynamicVb inst;
+	hc_uint32 offset;
+	int i;
+
+	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
+	/* Instances are streamed through the ring buffer like dynamic vertices */
+	inst.size = instancesCount * SIZEOF_MODEL_INSTANCE;
+	Stream_Upload(&inst, instances);
+	offset = inst.offset;
+
+	for (i = 3; i <= 7; i++) 
+	{
+		glEnableVertexAttribArray(i);
+		_glVertexAttribDivisor(i, 1);
+	}
+	glVertexAttribPointer(3, 4, GL_FLOAT,         false, SIZEOF_MODEL_INSTANCE, uint_to_ptr(offset     ));
+	glVertexAttribPointer(4, 4, GL_FLOAT,         false, SIZEOF_MODEL_INSTANCE, uint_to_ptr(offset + 16));
+	glVertexAttribPointer(5, 4, GL_FLOAT,         false, SIZEOF_MODEL_INSTANCE, uint_to_ptr(offset + 32));
+	glVertexAttribPointer(6, 4, GL_UNSIGNED_BYTE, true,  SIZEOF_MODEL_INSTANCE, uint_to_ptr(offset + 48));
+	glVertexAttribPointer(7, 2, GL_FLOAT,         false, SIZEOF_MODEL_INSTANCE, uint_to_ptr(offset + 52));
+
+	gfx_instanced = true;
+	SwitchProgram();
+	Gfx_BindVb(vb);
+	GL_SetupVbTextured_Range(startVertex);
+	_glDrawElementsInstanced(GL_TRIANGLES, ICOUNT(verticesCount), GL_UNSIGNED_SHORT, NULL, instancesCount);
+
+	for (i = 3; i <= 7; i++) glDisableVertexAttribArray(i);
+	gfx_instanced = false;
+	SwitchProgram();
+}
 #endif
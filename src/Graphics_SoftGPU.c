@@ -23,6 +23,11 @@ static int db_stride;
 static void* gfx_vertices;
 static GfxResourceID white_square;
 
+static void Bins_Init(void);
+static void Bins_Free(void);
+static void Bins_Flush(void);
+static void Bins_ResizeTiles(void);
+
 void Gfx_RestoreState(void) {
 	InitDefaultResources();
 
@@ -44,6 +49,7 @@ void Gfx_Create(void) {
 	Gfx.Created      = true;
 	Gfx.BackendType  = HC_GFX_BACKEND_SOFTGPU;
 	
+	Bins_Init();
 	Gfx_RestoreState();
 }
 
@@ -54,6 +60,7 @@ static void DestroyBuffers(void) {
 }
 
 void Gfx_Free(void) { 
+	Bins_Free();
 	Gfx_FreeState();
 	DestroyBuffers();
 }
@@ -84,6 +91,8 @@ void Gfx_BindTexture(GfxResourceID texId) {
 		
 void Gfx_DeleteTexture(GfxResourceID* texId) {
 	GfxResourceID data = *texId;
+	/* Binned triangles might still be using the texture */
+	if (data) Bins_Flush();
 	if (data) Mem_Free(data);
 	*texId = NULL;
 }
@@ -102,6 +111,7 @@ void Gfx_UpdateTexture(GfxResourceID texId, int x, int y, struct Bitmap* part, i
 	HCTexture* tex = (HCTexture*)texId;
 	BitmapCol* dst = (tex->pixels + x) + y * tex->width;
 
+	Bins_Flush();
 	CopyTextureData(dst, tex->width * BITMAPCOLOR_SIZE,
 					part, rowWidth  * BITMAPCOLOR_SIZE);
 }
@@ -155,6 +165,7 @@ static void ClearDepthBuffer(void) {
 }
 
 void Gfx_ClearBuffers(GfxBuffers buffers) {
+	Bins_Flush();
 	if (buffers & GFX_BUFFER_COLOR) ClearColorBuffer();
 	if (buffers & GFX_BUFFER_DEPTH) ClearDepthBuffer();
 }
@@ -374,9 +385,299 @@ static HC_INLINE int FastFloor(float value) {
 	return valueI > value ? valueI - 1 : valueI;
 }
 
+/* State that affects how triangles are rasterised */
+struct RastState {
+	BitmapCol* texPixels;
+	int texWidth, texHeight, texWidthMask, texHeightMask;
+	int clipMaxX, clipMaxY;
+	hc_bool textured, faceCulling, depthTest, depthWrite, colWrite, alphaTest, alphaBlend;
+};
+/* Region of the framebuffer that triangles are rasterised into */
+struct RastRect { int minX, minY, maxX, maxY; };
+
+static void RastState_Capture(struct RastState* st) {
+	Mem_Set(st, 0, sizeof(*st));
+	st->texPixels     = curTexPixels;
+	st->texWidth      = curTexWidth;
+	st->texHeight     = curTexHeight;
+	st->texWidthMask  = texWidthMask;
+	st->texHeightMask = texHeightMask;
+	st->clipMaxX      = fb_maxX;
+	st->clipMaxY      = fb_maxY;
+
+	st->textured    = gfx_format == VERTEX_FORMAT_TEXTURED;
+	st->faceCulling = faceCulling;
+	st->depthTest   = depthTest;
+	st->depthWrite  = depthWrite;
+	st->colWrite    = colWrite;
+	st->alphaTest   = gfx_alphaTest;
+	st->alphaBlend  = gfx_alphaBlend;
+}
+
 #define edgeFunction(ax,ay, bx,by, cx,cy) (((bx) - (ax)) * ((cy) - (ay)) - ((by) - (ay)) * ((cx) - (ax)))
 
-static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define SOFTGPU_SIMD
+	typedef __m128 SimdF;
+	typedef __m128 SimdM;
+
+	#define SimdF_Set1(v)    _mm_set1_ps(v)
+	#define SimdF_Load(p)    _mm_loadu_ps(p)
+	#define SimdF_Store(p,v) _mm_storeu_ps(p, v)
+	#define SimdF_Add(a,b)   _mm_add_ps(a, b)
+	#define SimdF_Sub(a,b)   _mm_sub_ps(a, b)
+	#define SimdF_Mul(a,b)   _mm_mul_ps(a, b)
+	#define SimdF_Div(a,b)   _mm_div_ps(a, b)
+	#define SimdF_Max(a,b)   _mm_max_ps(a, b)
+	#define SimdF_Lt(a,b)    _mm_cmplt_ps(a, b)
+	#define SimdF_Gt(a,b)    _mm_cmpgt_ps(a, b)
+	#define SimdM_Or(a,b)    _mm_or_ps(a, b)
+	#define SimdM_Bits(m)    _mm_movemask_ps(m)
+	/* Truncates to integer, then stores results in the given array */
+	#define SimdF_StoreInt(p,v) _mm_storeu_si128((__m128i*)(p), _mm_cvttps_epi32(v))
+
+	static HC_INLINE SimdF SimdF_Floor(SimdF v) {
+		SimdF t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+		return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, v), _mm_set1_ps(1.0f)));
+	}
+#elif defined __ARM_NEON || defined _M_ARM64
+	#include <arm_neon.h>
+	#define SOFTGPU_SIMD
+	typedef float32x4_t SimdF;
+	typedef uint32x4_t  SimdM;
+
+	#define SimdF_Set1(v)    vdupq_n_f32(v)
+	#define SimdF_Load(p)    vld1q_f32(p)
+	#define SimdF_Store(p,v) vst1q_f32(p, v)
+	#define SimdF_Add(a,b)   vaddq_f32(a, b)
+	#define SimdF_Sub(a,b)   vsubq_f32(a, b)
+	#define SimdF_Mul(a,b)   vmulq_f32(a, b)
+	#define SimdF_Max(a,b)   vmaxq_f32(a, b)
+	#define SimdF_Lt(a,b)    vcltq_f32(a, b)
+	#define SimdF_Gt(a,b)    vcgtq_f32(a, b)
+	#define SimdM_Or(a,b)    vorrq_u32(a, b)
+	#define SimdF_StoreInt(p,v) vst1q_s32(p, vcvtq_s32_f32(v))
+
+	#if defined __aarch64__ || defined _M_ARM64
+	#define SimdF_Div(a,b)   vdivq_f32(a, b)
+	#else
+	/* ARMv7 NEON lacks vector division, so use refined reciprocal estimate instead */
+	static HC_INLINE SimdF SimdF_Div(SimdF a, SimdF b) {
+		SimdF r = vrecpeq_f32(b);
+		r = vmulq_f32(vrecpsq_f32(b, r), r);
+		r = vmulq_f32(vrecpsq_f32(b, r), r);
+		return vmulq_f32(a, r);
+	}
+	#endif
+
+	static HC_INLINE int SimdM_Bits(SimdM m) {
+		static const hc_uint32 laneBits[4] = { 1, 2, 4, 8 };
+		uint32x4_t bits = vandq_u32(m, vld1q_u32(laneBits));
+		uint32x2_t sum  = vpadd_u32(vget_low_u32(bits), vget_high_u32(bits));
+		return (int)vget_lane_u32(vpadd_u32(sum, sum), 0);
+	}
+
+	static HC_INLINE SimdF SimdF_Floor(SimdF v) {
+		SimdF t = vcvtq_f32_s32(vcvtq_s32_f32(v));
+		return vbslq_f32(vcgtq_f32(t, v), vsubq_f32(t, vdupq_n_f32(1.0f)), t);
+	}
+#endif
+
+#ifdef SOFTGPU_SIMD
+/* Triangles are rasterised in 4x4 pixel blocks, 4 pixels (one row of a block) at a time */
+static const float simd_steps[4]    = { 0.0f, 1.0f, 2.0f, 3.0f };
+/* X and Y offsets of the 4 corner pixels of a block */
+static const float simd_cornersX[4] = { 0.0f, 3.0f, 0.0f, 3.0f };
+static const float simd_cornersY[4] = { 0.0f, 0.0f, 3.0f, 3.0f };
+
+/* Edge function values of the 3 edges of a triangle, normalised so that inside is positive */
+struct SimdEdges { float start[3]; float dx[3], dy[3]; float factor; };
+
+static hc_bool SimdEdges_Init(struct SimdEdges* e, int area, int minX, int minY,
+							int x0, int y0, int x1, int y1, int x2, int y2) {
+	float sign = area < 0 ? -1.0f : 1.0f;
+	if (area == 0) return false;
+
+	/* Negating both edge values and factor leaves barycentric coordinates exactly the same */
+	e->factor   = sign / area;
+	e->start[0] = sign * edgeFunction(x1,y1, x2,y2, minX+0.5f,minY+0.5f);
+	e->start[1] = sign * edgeFunction(x2,y2, x0,y0, minX+0.5f,minY+0.5f);
+	e->start[2] = sign * edgeFunction(x0,y0, x1,y1, minX+0.5f,minY+0.5f);
+
+	e->dx[0] = sign * (y1 - y2); e->dy[0] = sign * (x2 - x1);
+	e->dx[1] = sign * (y2 - y0); e->dy[1] = sign * (x0 - x2);
+	e->dx[2] = sign * (y0 - y1); e->dy[2] = sign * (x1 - x0);
+	return true;
+}
+
+/* Calculates edge function values at the top left pixel of the given block */
+/* Returns false if the block lies entirely outside of one of the edges */
+static HC_INLINE hc_bool SimdEdges_Block(struct SimdEdges* e, float* bc, float ox, float oy) {
+	int i;
+	for (i = 0; i < 3; i++)
+	{
+		bc[i] = e->start[i] + ox * e->dx[i] + oy * e->dy[i];
+		if (bc[i] + 3 * max(e->dx[i], 0.0f) + 3 * max(e->dy[i], 0.0f) < 0) return false;
+	}
+	return true;
+}
+
+/* Returns bitmask of which pixels in a row of a block lie inside minX to maxX */
+static HC_INLINE int Simd_RangeMask(int bx, int minX, int maxX) {
+	int mask = 0xF;
+	if (minX > bx)     mask &= 0xF << (minX - bx);
+	if (maxX < bx + 3) mask &= 0xF >> (bx + 3 - maxX);
+	return mask & 0xF;
+}
+
+/* Modulates the colour by the texture (if any), then alpha tests and blends it into the colour buffer */
+/* Returns false if the pixel was discarded by alpha testing */
+static HC_INLINE hc_bool Simd_WritePixel(const struct RastState* st, PackedCol color, int texIndex, int cb_index) {
+	int R, G, B, A;
+	if (texIndex >= 0) {
+		BitmapCol tColor = st->texPixels[texIndex];
+		A = (PackedCol_A(color) * BitmapCol_A(tColor)) >> 8;
+		R = (PackedCol_R(color) * BitmapCol_R(tColor)) >> 8;
+		G = (PackedCol_G(color) * BitmapCol_G(tColor)) >> 8;
+		B = (PackedCol_B(color) * BitmapCol_B(tColor)) >> 8;
+	} else {
+		R = PackedCol_R(color);
+		G = PackedCol_G(color);
+		B = PackedCol_B(color);
+		A = PackedCol_A(color);
+	}
+
+	if (st->alphaTest && A < 0x80) return false;
+	if (st->alphaBlend) {
+		BitmapCol dst = colorBuffer[cb_index];
+		R = (R * A + BitmapCol_R(dst) * (255 - A)) >> 8;
+		G = (G * A + BitmapCol_G(dst) * (255 - A)) >> 8;
+		B = (B * A + BitmapCol_B(dst) * (255 - A)) >> 8;
+	}
+
+	colorBuffer[cb_index] = BitmapCol_Make(R, G, B, 0xFF);
+	return true;
+}
+
+static void RasteriseTriangle2D(const struct RastState* st, const struct RastRect* r, Vertex* V0, Vertex* V1, Vertex* V2) {
+	int x0 = (int)V0->x, y0 = (int)V0->y;
+	int x1 = (int)V1->x, y1 = (int)V1->y;
+	int x2 = (int)V2->x, y2 = (int)V2->y;
+	int minX = min(x0, min(x1, x2));
+	int minY = min(y0, min(y1, y2));
+	int maxX = max(x0, max(x1, x2));
+	int maxY = max(y0, max(y1, y2));
+	struct SimdEdges e;
+
+	int area = edgeFunction(x0,y0, x1,y1, x2,y2);
+	// Reject triangles completely outside
+	if (maxX < r->minX || minX > r->maxX) return;
+	if (maxY < r->minY || minY > r->maxY) return;
+
+	// Perform scissoring
+	minX = max(minX, r->minX); maxX = min(maxX, r->maxX);
+	minY = max(minY, r->minY); maxY = min(maxY, r->maxY);
+	if (!SimdEdges_Init(&e, area, minX, minY, x0, y0, x1, y1, x2, y2)) return;
+
+	PackedCol color   = V0->c;
+	hc_bool textured  = st->textured;
+	SimdF steps  = SimdF_Load(simd_steps);
+	SimdF zero   = SimdF_Set1(0.0f);
+	SimdF factor = SimdF_Set1(e.factor);
+	SimdF dx0 = SimdF_Mul(steps, SimdF_Set1(e.dx[0]));
+	SimdF dx1 = SimdF_Mul(steps, SimdF_Set1(e.dx[1]));
+	SimdF dx2 = SimdF_Mul(steps, SimdF_Set1(e.dx[2]));
+
+	SimdF u0 = SimdF_Set1(V0->u * st->texWidth),  u1 = SimdF_Set1(V1->u * st->texWidth),  u2 = SimdF_Set1(V2->u * st->texWidth);
+	SimdF v0 = SimdF_Set1(V0->v * st->texHeight), v1 = SimdF_Set1(V1->v * st->texHeight), v2 = SimdF_Set1(V2->v * st->texHeight);
+
+	for (int by = minY & ~3; by <= maxY; by += 4)
+	{
+		for (int bx = minX & ~3; bx <= maxX; bx += 4)
+		{
+			float bc[3];
+			if (!SimdEdges_Block(&e, bc, (float)(bx - minX), (float)(by - minY))) continue;
+			int range = Simd_RangeMask(bx, minX, maxX);
+
+			for (int y = by; y < by + 4; y++, bc[0] += e.dy[0], bc[1] += e.dy[1], bc[2] += e.dy[2])
+			{
+				if (y < minY || y > maxY) continue;
+
+				SimdF ic0 = SimdF_Mul(SimdF_Add(SimdF_Set1(bc[0]), dx0), factor);
+				SimdF ic1 = SimdF_Mul(SimdF_Add(SimdF_Set1(bc[1]), dx1), factor);
+				SimdF ic2 = SimdF_Mul(SimdF_Add(SimdF_Set1(bc[2]), dx2), factor);
+
+				SimdM outside = SimdM_Or(SimdM_Or(SimdF_Lt(ic0, zero), SimdF_Lt(ic1, zero)), SimdF_Lt(ic2, zero));
+				int mask = ~SimdM_Bits(outside) & range;
+				if (!mask) continue;
+
+				int texX[4], texY[4];
+				if (textured) {
+					SimdF u = SimdF_Add(SimdF_Add(SimdF_Mul(ic0, u0), SimdF_Mul(ic1, u1)), SimdF_Mul(ic2, u2));
+					SimdF v = SimdF_Add(SimdF_Add(SimdF_Mul(ic0, v0), SimdF_Mul(ic1, v1)), SimdF_Mul(ic2, v2));
+					SimdF_StoreInt(texX, u);
+					SimdF_StoreInt(texY, v);
+				}
+
+				for (int i = 0; i < 4; i++)
+				{
+					if (!(mask & (1 << i))) continue;
+					int texIndex = -1;
+
+					if (textured) {
+						texIndex = (texY[i] & st->texHeightMask) * st->texWidth + (texX[i] & st->texWidthMask);
+					}
+					Simd_WritePixel(st, color, texIndex, y * cb_stride + bx + i);
+				}
+			}
+		}
+	}
+}
+
+/* Returns whether every pixel of the triangle in the given block is behind the depth buffer */
+static HC_INLINE hc_bool Simd_BlockOccluded(struct SimdEdges* e, float* bc, int bx, int by,
+											SimdF w0, SimdF w1, SimdF w2, SimdF z0, SimdF z1, SimdF z2) {
+	SimdF cx = SimdF_Load(simd_cornersX);
+	SimdF cy = SimdF_Load(simd_cornersY);
+	SimdF factor = SimdF_Set1(e->factor);
+	SimdF zero   = SimdF_Set1(0.0f);
+	float* depth = &depthBuffer[by * db_stride + bx];
+	float corners[4], depths[4];
+	float minZ, maxDepth;
+	int i;
+
+	/* Blocks straddling the edge of the depth buffer aren't worth handling */
+	if (bx + 3 > fb_maxX || by + 3 > fb_maxY) return false;
+
+	SimdF ic0 = SimdF_Mul(SimdF_Add(SimdF_Set1(bc[0]), SimdF_Add(SimdF_Mul(cx, SimdF_Set1(e->dx[0])), SimdF_Mul(cy, SimdF_Set1(e->dy[0])))), factor);
+	SimdF ic1 = SimdF_Mul(SimdF_Add(SimdF_Set1(bc[1]), SimdF_Add(SimdF_Mul(cx, SimdF_Set1(e->dx[1])), SimdF_Mul(cy, SimdF_Set1(e->dy[1])))), factor);
+	SimdF ic2 = SimdF_Mul(SimdF_Add(SimdF_Set1(bc[2]), SimdF_Add(SimdF_Mul(cx, SimdF_Set1(e->dx[2])), SimdF_Mul(cy, SimdF_Set1(e->dy[2])))), factor);
+
+	/* Depth is a ratio of two linear functions, so as long as the denominator is positive */
+	/*  across the whole block, the minimum depth within the block is at one of its corners */
+	SimdF W = SimdF_Add(SimdF_Add(SimdF_Mul(ic0, w0), SimdF_Mul(ic1, w1)), SimdF_Mul(ic2, w2));
+	SimdF Z = SimdF_Add(SimdF_Add(SimdF_Mul(ic0, z0), SimdF_Mul(ic1, z1)), SimdF_Mul(ic2, z2));
+	if (SimdM_Bits(SimdF_Gt(W, zero)) != 0xF) return false;
+	SimdF_Store(corners, SimdF_Div(Z, W));
+
+	SimdF maxD = SimdF_Load(depth);
+	maxD = SimdF_Max(maxD, SimdF_Load(depth + db_stride * 1));
+	maxD = SimdF_Max(maxD, SimdF_Load(depth + db_stride * 2));
+	maxD = SimdF_Max(maxD, SimdF_Load(depth + db_stride * 3));
+	SimdF_Store(depths, maxD);
+
+	minZ = corners[0]; maxDepth = depths[0];
+	for (i = 1; i < 4; i++)
+	{
+		minZ     = min(minZ, corners[i]);
+		maxDepth = max(maxDepth, depths[i]);
+	}
+	/* Small tolerance, as per-pixel depth is calculated slightly differently */
+	return minZ - Math_AbsF(minZ) * 0.0001f > maxDepth;
+}
+
+static void RasteriseTriangle3D(const struct RastState* st, const struct RastRect* r, Vertex* V0, Vertex* V1, Vertex* V2) {
 	int x0 = (int)V0->x, y0 = (int)V0->y;
 	int x1 = (int)V1->x, y1 = (int)V1->y;
 	int x2 = (int)V2->x, y2 = (int)V2->y;
@@ -384,19 +685,137 @@ static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
 	int minY = min(y0, min(y1, y2));
 	int maxX = max(x0, max(x1, x2));
 	int maxY = max(y0, max(y1, y2));
+	struct SimdEdges e;
 
 	int area = edgeFunction(x0,y0, x1,y1, x2,y2);
+	if (st->faceCulling) {
+		// https://gamedev.stackexchange.com/questions/203694/how-to-make-backface-culling-work-correctly-in-both-orthographic-and-perspective
+		if (area < 0) return;
+	}
+
 	// Reject triangles completely outside
-	if (maxX < 0 || minX > fb_maxX) return;
-	if (maxY < 0 || minY > fb_maxY) return;
+	if (maxX < r->minX || minX > r->maxX) return;
+	if (maxY < r->minY || minY > r->maxY) return;
 
 	// Perform scissoring
-	minX = max(minX, 0); maxX = min(maxX, fb_maxX);
-	minY = max(minY, 0); maxY = min(maxY, fb_maxY);
+	minX = max(minX, r->minX); maxX = min(maxX, r->maxX);
+	minY = max(minY, r->minY); maxY = min(maxY, r->maxY);
+
+	// TODO proper clipping
+	if (V0->w <= 0 || V1->w <= 0 || V2->w <= 0) return;
+	if (!SimdEdges_Init(&e, area, minX, minY, x0, y0, x1, y1, x2, y2)) return;
+
+	// NOTE: W in frag variables below is actually 1/W 
+	PackedCol color   = V0->c;
+	hc_bool textured  = st->textured;
+	SimdF steps  = SimdF_Load(simd_steps);
+	SimdF zero   = SimdF_Set1(0.0f);
+	SimdF one    = SimdF_Set1(1.0f);
+	SimdF factor = SimdF_Set1(e.factor);
+	SimdF dx0 = SimdF_Mul(steps, SimdF_Set1(e.dx[0]));
+	SimdF dx1 = SimdF_Mul(steps, SimdF_Set1(e.dx[1]));
+	SimdF dx2 = SimdF_Mul(steps, SimdF_Set1(e.dx[2]));
+
+	SimdF w0 = SimdF_Set1(V0->w), w1 = SimdF_Set1(V1->w), w2 = SimdF_Set1(V2->w);
+	SimdF z0 = SimdF_Set1(V0->z), z1 = SimdF_Set1(V1->z), z2 = SimdF_Set1(V2->z);
+	SimdF u0 = SimdF_Set1(V0->u), u1 = SimdF_Set1(V1->u), u2 = SimdF_Set1(V2->u);
+	SimdF v0 = SimdF_Set1(V0->v), v1 = SimdF_Set1(V1->v), v2 = SimdF_Set1(V2->v);
+	SimdF texW = SimdF_Set1((float)st->texWidth);
+	SimdF texH = SimdF_Set1((float)st->texHeight);
+
+	for (int by = minY & ~3; by <= maxY; by += 4)
+	{
+		for (int bx = minX & ~3; bx <= maxX; bx += 4)
+		{
+			float bc[3];
+			if (!SimdEdges_Block(&e, bc, (float)(bx - minX), (float)(by - minY))) continue;
+			if (st->depthTest && Simd_BlockOccluded(&e, bc, bx, by, w0, w1, w2, z0, z1, z2)) continue;
+			int range = Simd_RangeMask(bx, minX, maxX);
+
+			for (int y = by; y < by + 4; y++, bc[0] += e.dy[0], bc[1] += e.dy[1], bc[2] += e.dy[2])
+			{
+				if (y < minY || y > maxY) continue;
+
+				SimdF ic0 = SimdF_Mul(SimdF_Add(SimdF_Set1(bc[0]), dx0), factor);
+				SimdF ic1 = SimdF_Mul(SimdF_Add(SimdF_Set1(bc[1]), dx1), factor);
+				SimdF ic2 = SimdF_Mul(SimdF_Add(SimdF_Set1(bc[2]), dx2), factor);
+
+				SimdM outside = SimdM_Or(SimdM_Or(SimdF_Lt(ic0, zero), SimdF_Lt(ic1, zero)), SimdF_Lt(ic2, zero));
+				int mask = ~SimdM_Bits(outside) & range;
+				if (!mask) continue;
+
+				SimdF w = SimdF_Div(one, SimdF_Add(SimdF_Add(SimdF_Mul(ic0, w0), SimdF_Mul(ic1, w1)), SimdF_Mul(ic2, w2)));
+				SimdF z = SimdF_Mul(SimdF_Add(SimdF_Add(SimdF_Mul(ic0, z0), SimdF_Mul(ic1, z1)), SimdF_Mul(ic2, z2)), w);
+				int db_index = y * db_stride + bx;
+				float depths[4], zs[4];
+
+				if (st->depthTest) {
+					if (range == 0xF) {
+						SimdF_Store(depths, SimdF_Load(&depthBuffer[db_index]));
+					} else {
+						for (int i = 0; i < 4; i++) depths[i] = (range & (1 << i)) ? depthBuffer[db_index + i] : 0.0f;
+					}
+
+					SimdM failed = SimdM_Or(SimdF_Lt(z, zero), SimdF_Gt(z, SimdF_Load(depths)));
+					mask &= ~SimdM_Bits(failed);
+					if (!mask) continue;
+				}
+				SimdF_Store(zs, z);
+
+				if (!st->colWrite) {
+					if (!st->depthWrite) continue;
+					for (int i = 0; i < 4; i++)
+					{
+						if (mask & (1 << i)) depthBuffer[db_index + i] = zs[i];
+					}
+					continue;
+				}
+
+				int texX[4], texY[4];
+				if (textured) {
+					SimdF u = SimdF_Mul(SimdF_Add(SimdF_Add(SimdF_Mul(ic0, u0), SimdF_Mul(ic1, u1)), SimdF_Mul(ic2, u2)), w);
+					SimdF v = SimdF_Mul(SimdF_Add(SimdF_Add(SimdF_Mul(ic0, v0), SimdF_Mul(ic1, v1)), SimdF_Mul(ic2, v2)), w);
+					SimdF_StoreInt(texX, SimdF_Mul(SimdF_Sub(u, SimdF_Floor(u)), texW));
+					SimdF_StoreInt(texY, SimdF_Mul(SimdF_Sub(v, SimdF_Floor(v)), texH));
+				}
+
+				for (int i = 0; i < 4; i++)
+				{
+					if (!(mask & (1 << i))) continue;
+					int texIndex = -1;
+
+					if (textured) {
+						texIndex = (texY[i] & st->texHeightMask) * st->texWidth + (texX[i] & st->texWidthMask);
+					}
+					if (!Simd_WritePixel(st, color, texIndex, y * cb_stride + bx + i)) continue;
+					if (st->depthWrite) depthBuffer[db_index + i] = zs[i];
+				}
+			}
+		}
+	}
+}
+#else
+static void RasteriseTriangle2D(const struct RastState* st, const struct RastRect* r, Vertex* V0, Vertex* V1, Vertex* V2) {
+	int x0 = (int)V0->x, y0 = (int)V0->y;
+	int x1 = (int)V1->x, y1 = (int)V1->y;
+	int x2 = (int)V2->x, y2 = (int)V2->y;
+	int minX = min(x0, min(x1, x2));
+	int minY = min(y0, min(y1, y2));
+	int maxX = max(x0, max(x1, x2));
+	int maxY = max(y0, max(y1, y2));
+
+	int area = edgeFunction(x0,y0, x1,y1, x2,y2);
+	// Reject triangles completely outside
+	if (maxX < r->minX || minX > r->maxX) return;
+	if (maxY < r->minY || minY > r->maxY) return;
+
+	// Perform scissoring
+	minX = max(minX, r->minX); maxX = min(maxX, r->maxX);
+	minY = max(minY, r->minY); maxY = min(maxY, r->maxY);
 	float factor = 1.0f / area;
 
-	float u0 = V0->u * curTexWidth,  u1 = V1->u * curTexWidth,  u2 = V2->u * curTexWidth;
-	float v0 = V0->v * curTexHeight, v1 = V1->v * curTexHeight, v2 = V2->v * curTexHeight;
+	float u0 = V0->u * st->texWidth,  u1 = V1->u * st->texWidth,  u2 = V2->u * st->texWidth;
+	float v0 = V0->v * st->texHeight, v1 = V1->v * st->texHeight, v2 = V2->v * st->texHeight;
 	PackedCol color = V0->c;
 	
 	// https://fgiesen.wordpress.com/2013/02/10/optimizing-the-basic-rasterizer/
@@ -425,14 +844,14 @@ static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
 			int cb_index = y * cb_stride + x;
 
 			int R, G, B, A;
-			if (gfx_format == VERTEX_FORMAT_TEXTURED) {
+			if (st->textured) {
 				float u = ic0 * u0 + ic1 * u1 + ic2 * u2;
 				float v = ic0 * v0 + ic1 * v1 + ic2 * v2;
-				int texX = ((int)u) & texWidthMask;
-				int texY = ((int)v) & texHeightMask;
-				int texIndex = texY * curTexWidth + texX;
+				int texX = ((int)u) & st->texWidthMask;
+				int texY = ((int)v) & st->texHeightMask;
+				int texIndex = texY * st->texWidth + texX;
 
-				BitmapCol tColor = curTexPixels[texIndex];
+				BitmapCol tColor = st->texPixels[texIndex];
 				int a1 = PackedCol_A(color), a2 = BitmapCol_A(tColor);
 				A = ( a1 * a2 ) >> 8;
 				int r1 = PackedCol_R(color), r2 = BitmapCol_R(tColor);
@@ -448,8 +867,8 @@ static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
 				A = PackedCol_A(color);
 			}
 
-			if (gfx_alphaTest && A < 0x80) continue;
-			if (gfx_alphaBlend) {
+			if (st->alphaTest && A < 0x80) continue;
+			if (st->alphaBlend) {
 				BitmapCol dst = colorBuffer[cb_index];
 				int dstR = BitmapCol_R(dst);
 				int dstG = BitmapCol_G(dst);
@@ -465,7 +884,7 @@ static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
 	}
 }
 
-static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
+static void RasteriseTriangle3D(const struct RastState* st, const struct RastRect* r, Vertex* V0, Vertex* V1, Vertex* V2) {
 	int x0 = (int)V0->x, y0 = (int)V0->y;
 	int x1 = (int)V1->x, y1 = (int)V1->y;
 	int x2 = (int)V2->x, y2 = (int)V2->y;
@@ -475,18 +894,18 @@ static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
 	int maxY = max(y0, max(y1, y2));
 
 	int area = edgeFunction(x0,y0, x1,y1, x2,y2);
-	if (faceCulling) {
+	if (st->faceCulling) {
 		// https://gamedev.stackexchange.com/questions/203694/how-to-make-backface-culling-work-correctly-in-both-orthographic-and-perspective
 		if (area < 0) return;
 	}
 
 	// Reject triangles completely outside
-	if (maxX < 0 || minX > fb_maxX) return;
-	if (maxY < 0 || minY > fb_maxY) return;
+	if (maxX < r->minX || minX > r->maxX) return;
+	if (maxY < r->minY || minY > r->maxY) return;
 
 	// Perform scissoring
-	minX = max(minX, 0); maxX = min(maxX, fb_maxX);
-	minY = max(minY, 0); maxY = min(maxY, fb_maxY);
+	minX = max(minX, r->minX); maxX = min(maxX, r->maxX);
+	minY = max(minY, r->minY); maxY = min(maxY, r->maxY);
 
 	// NOTE: W in frag variables below is actually 1/W 
 	float factor = 1.0f / area;
@@ -529,21 +948,21 @@ static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
 			float w = 1 / (ic0 * w0 + ic1 * w1 + ic2 * w2);
 			float z = (ic0 * z0 + ic1 * z1 + ic2 * z2) * w;
 
-			if (depthTest && (z < 0 || z > depthBuffer[db_index])) continue;
-			if (!colWrite) {
-				if (depthWrite) depthBuffer[db_index] = z;
+			if (st->depthTest && (z < 0 || z > depthBuffer[db_index])) continue;
+			if (!st->colWrite) {
+				if (st->depthWrite) depthBuffer[db_index] = z;
 				continue;
 			}
 
 			int R, G, B, A;
-			if (gfx_format == VERTEX_FORMAT_TEXTURED) {
+			if (st->textured) {
 				float u = (ic0 * u0 + ic1 * u1 + ic2 * u2) * w;
 				float v = (ic0 * v0 + ic1 * v1 + ic2 * v2) * w;
-				int texX = ((int)(Math_AbsF(u - FastFloor(u)) * curTexWidth )) & texWidthMask;
-				int texY = ((int)(Math_AbsF(v - FastFloor(v)) * curTexHeight)) & texHeightMask;
-				int texIndex = texY * curTexWidth + texX;
+				int texX = ((int)(Math_AbsF(u - FastFloor(u)) * st->texWidth )) & st->texWidthMask;
+				int texY = ((int)(Math_AbsF(v - FastFloor(v)) * st->texHeight)) & st->texHeightMask;
+				int texIndex = texY * st->texWidth + texX;
 
-				BitmapCol tColor = curTexPixels[texIndex];
+				BitmapCol tColor = st->texPixels[texIndex];
 				int a1 = PackedCol_A(color), a2 = BitmapCol_A(tColor);
 				A = ( a1 * a2 ) >> 8;
 				int r1 = PackedCol_R(color), r2 = BitmapCol_R(tColor);
@@ -559,10 +978,10 @@ static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
 				A = PackedCol_A(color);
 			}
 
-			if (gfx_alphaTest && A < 0x80) continue;
+			if (st->alphaTest && A < 0x80) continue;
 			int cb_index = y * cb_stride + x;
 			
-			if (gfx_alphaBlend) {
+			if (st->alphaBlend) {
 				BitmapCol dst = colorBuffer[cb_index];
 				int dstR = BitmapCol_R(dst);
 				int dstG = BitmapCol_G(dst);
@@ -573,12 +992,311 @@ static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
 				B = (B * A + dstB * (255 - A)) >> 8;
 			}
 
-			if (depthWrite) depthBuffer[db_index] = z;
+			if (st->depthWrite) depthBuffer[db_index] = z;
 			colorBuffer[cb_index] = BitmapCol_Make(R, G, B, 0xFF);
 		}
 	}
 }
 
+#endif
+
+static struct RastState draw_state;
+static struct RastRect   draw_rect;
+
+#ifndef HC_BUILD_COOPTHREADED
+/*########################################################################################################################*
+*-----------------------------------------------------Binned rendering----------------------------------------------------*
+*#########################################################################################################################*/
+/* When enabled, triangles are binned into screen tiles instead of being immediately rasterised */
+/*  The tiles are then rasterised in parallel by multiple threads when the bins are flushed */
+/* NOTE: Each tile rasterises its triangles in submission order, so blending matches immediate rendering */
+#define SOFTGPU_BINNING
+#define BIN_TILE_SIZE   64
+#define BIN_MAX_TRIS    (64 * 1024)
+#define BIN_MAX_STATES  4096
+#define BIN_MAX_THREADS 32
+
+struct BinnedTri { Vertex v[3]; hc_uint16 state; hc_bool is2D; };
+struct TileBin   { int* tris; int count, capacity; };
+
+static int bin_numThreads; /* 0 when binned rendering is disabled */
+static struct BinnedTri* bin_tris;
+static struct RastState* bin_states;
+static int bin_numTris, bin_numStates;
+
+static struct TileBin* bin_tiles;
+static int bin_tilesX, bin_tilesY;
+
+static void* bin_threads[BIN_MAX_THREADS];
+static void* bin_wakeups[BIN_MAX_THREADS];
+static void* bin_finished;
+static void* bin_mutex;
+/* NOTE: All of the following variables must only be accessed while holding bin_mutex */
+static int bin_nextTile, bin_numFinished, bin_nextWorkerID, bin_generation;
+static hc_bool bin_quit;
+
+static void Bins_FreeTiles(void) {
+	int i;
+	for (i = 0; i < bin_tilesX * bin_tilesY; i++) 
+	{
+		Mem_Free(bin_tiles[i].tris);
+	}
+
+	Mem_Free(bin_tiles);
+	bin_tiles  = NULL;
+	bin_tilesX = 0;
+	bin_tilesY = 0;
+}
+
+static void Bins_ResizeTiles(void) {
+	Bins_FreeTiles();
+	if (!bin_numThreads) return;
+
+	bin_tilesX = (fb_width  + BIN_TILE_SIZE - 1) / BIN_TILE_SIZE;
+	bin_tilesY = (fb_height + BIN_TILE_SIZE - 1) / BIN_TILE_SIZE;
+	bin_tiles  = (struct TileBin*)Mem_AllocCleared(bin_tilesX * bin_tilesY, sizeof(struct TileBin), "tile bins");
+}
+
+static void Bins_RasteriseTile(int index) {
+	struct TileBin* bin = &bin_tiles[index];
+	struct BinnedTri* tri;
+	struct RastState* st;
+	struct RastRect r, tile;
+	int i;
+
+	tile.minX = (index % bin_tilesX) * BIN_TILE_SIZE;
+	tile.minY = (index / bin_tilesX) * BIN_TILE_SIZE;
+	tile.maxX = tile.minX + BIN_TILE_SIZE - 1;
+	tile.maxY = tile.minY + BIN_TILE_SIZE - 1;
+
+	for (i = 0; i < bin->count; i++)
+	{
+		tri = &bin_tris[bin->tris[i]];
+		st  = &bin_states[tri->state];
+
+		r = tile;
+		r.maxX = min(r.maxX, st->clipMaxX);
+		r.maxY = min(r.maxY, st->clipMaxY);
+
+		if (tri->is2D) {
+			RasteriseTriangle2D(st, &r, &tri->v[0], &tri->v[1], &tri->v[2]);
+		} else {
+			RasteriseTriangle3D(st, &r, &tri->v[0], &tri->v[1], &tri->v[2]);
+		}
+	}
+	bin->count = 0;
+}
+
+/* Rasterises tiles until there are no more tiles left to rasterise */
+static void Bins_RasteriseTiles(void) {
+	int numTiles = bin_tilesX * bin_tilesY;
+	int tile;
+
+	for (;;)
+	{
+		Mutex_Lock(bin_mutex);
+		{
+			tile = bin_nextTile++;
+		}
+		Mutex_Unlock(bin_mutex);
+
+		if (tile >= numTiles) return;
+		Bins_RasteriseTile(tile);
+	}
+}
+
+static void Bins_WorkerMain(void) {
+	int id, generation = 0;
+	hc_bool quit, wakeup;
+
+	Mutex_Lock(bin_mutex);
+	{
+		id = bin_nextWorkerID++;
+	}
+	Mutex_Unlock(bin_mutex);
+
+	for (;;)
+	{
+		Waitable_Wait(bin_wakeups[id]);
+
+		Mutex_Lock(bin_mutex);
+		{
+			quit   = bin_quit;
+			wakeup = bin_generation != generation;
+			generation = bin_generation;
+		}
+		Mutex_Unlock(bin_mutex);
+
+		if (quit) return;
+		if (!wakeup) continue;
+		Bins_RasteriseTiles();
+
+		Mutex_Lock(bin_mutex);
+		{
+			if (++bin_numFinished == bin_numThreads) Waitable_Signal(bin_finished);
+		}
+		Mutex_Unlock(bin_mutex);
+	}
+}
+
+/* Rasterises all binned triangles, then waits for all worker threads to finish */
+static void Bins_Flush(void) {
+	hc_bool finished;
+	int i;
+	if (!bin_numTris) { bin_numStates = 0; return; }
+
+	Mutex_Lock(bin_mutex);
+	{
+		bin_nextTile    = 0;
+		bin_numFinished = 0;
+		bin_generation++;
+	}
+	Mutex_Unlock(bin_mutex);
+
+	for (i = 0; i < bin_numThreads; i++) Waitable_Signal(bin_wakeups[i]);
+	Bins_RasteriseTiles();
+
+	for (;;)
+	{
+		Mutex_Lock(bin_mutex);
+		{
+			finished = bin_numFinished == bin_numThreads;
+		}
+		Mutex_Unlock(bin_mutex);
+
+		if (finished) break;
+		Waitable_Wait(bin_finished);
+	}
+
+	bin_numTris   = 0;
+	bin_numStates = 0;
+}
+
+/* Begins binning triangles using the current render state */
+static void Bins_BeginDraw(void) {
+	if (bin_numStates && Mem_Equal(&bin_states[bin_numStates - 1], &draw_state, sizeof(draw_state))) return;
+	if (bin_numStates == BIN_MAX_STATES) Bins_Flush();
+
+	bin_states[bin_numStates++] = draw_state;
+}
+
+static void Bins_AddTriangle(Vertex* V0, Vertex* V1, Vertex* V2, hc_bool is2D) {
+	struct BinnedTri* tri;
+	struct TileBin* bin;
+	int x0 = (int)V0->x, y0 = (int)V0->y;
+	int x1 = (int)V1->x, y1 = (int)V1->y;
+	int x2 = (int)V2->x, y2 = (int)V2->y;
+	int minX = max(min(x0, min(x1, x2)) / BIN_TILE_SIZE, 0);
+	int minY = max(min(y0, min(y1, y2)) / BIN_TILE_SIZE, 0);
+	int maxX = min(max(x0, max(x1, x2)), draw_state.clipMaxX);
+	int maxY = min(max(y0, max(y1, y2)), draw_state.clipMaxY);
+	int x, y, index;
+
+	if (maxX < 0 || maxY < 0) return;
+	maxX /= BIN_TILE_SIZE; maxY /= BIN_TILE_SIZE;
+	if (minX > maxX || minY > maxY) return;
+
+	if (bin_numTris == BIN_MAX_TRIS) {
+		Bins_Flush();
+		Bins_BeginDraw();
+	}
+	index = bin_numTris++;
+	tri   = &bin_tris[index];
+
+	tri->v[0]  = *V0; tri->v[1] = *V1; tri->v[2] = *V2;
+	tri->state = bin_numStates - 1;
+	tri->is2D  = is2D;
+
+	for (y = minY; y <= maxY; y++)
+		for (x = minX; x <= maxX; x++)
+		{
+			bin = &bin_tiles[y * bin_tilesX + x];
+
+			if (bin->count == bin->capacity) {
+				bin->capacity = max(bin->capacity * 2, 256);
+				bin->tris     = (int*)Mem_Realloc(bin->tris, bin->capacity, sizeof(int), "tile bin");
+			}
+			bin->tris[bin->count++] = index;
+		}
+}
+
+static void Bins_Init(void) {
+	int i;
+	bin_numThreads = Options_GetInt(OPT_SOFTGPU_THREADS, 0, BIN_MAX_THREADS, 0);
+	if (!bin_numThreads) return;
+
+	bin_tris   = (struct BinnedTri*)Mem_Alloc(BIN_MAX_TRIS,   sizeof(struct BinnedTri), "binned triangles");
+	bin_states = (struct RastState*)Mem_Alloc(BIN_MAX_STATES, sizeof(struct RastState), "binned states");
+	bin_mutex    = Mutex_Create("SoftGPU bins");
+	bin_finished = Waitable_Create("SoftGPU bins finished");
+
+	for (i = 0; i < bin_numThreads; i++)
+	{
+		bin_wakeups[i] = Waitable_Create("SoftGPU bins wakeup");
+		Thread_Run(&bin_threads[i], Bins_WorkerMain, 128 * 1024, "SoftGPU rasteriser");
+	}
+}
+
+static void Bins_Free(void) {
+	int i;
+	if (!bin_numThreads) return;
+	Bins_Flush();
+
+	Mutex_Lock(bin_mutex);
+	{
+		bin_quit = true;
+	}
+	Mutex_Unlock(bin_mutex);
+
+	for (i = 0; i < bin_numThreads; i++)
+	{
+		Waitable_Signal(bin_wakeups[i]);
+		Thread_Join(bin_threads[i]);
+		Waitable_Free(bin_wakeups[i]);
+	}
+
+	Mutex_Free(bin_mutex);
+	Waitable_Free(bin_finished);
+	Mem_Free(bin_tris);
+	Mem_Free(bin_states);
+	bin_numThreads   = 0;
+	Bins_FreeTiles();
+
+	bin_nextWorkerID = 0;
+	bin_quit         = false;
+}
+#else
+static void Bins_Init(void)        { }
+static void Bins_Free(void)        { }
+static void Bins_Flush(void)       { }
+static void Bins_ResizeTiles(void) { }
+#endif
+
+/* Captures the current render state for the triangles of a draw call */
+static void BeginDraw(void) {
+	RastState_Capture(&draw_state);
+	draw_rect.minX = 0; draw_rect.maxX = fb_maxX;
+	draw_rect.minY = 0; draw_rect.maxY = fb_maxY;
+
+#ifdef SOFTGPU_BINNING
+	if (bin_numThreads) Bins_BeginDraw();
+#endif
+}
+
+static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
+#ifdef SOFTGPU_BINNING
+	if (bin_numThreads) { Bins_AddTriangle(V0, V1, V2, true); return; }
+#endif
+	RasteriseTriangle2D(&draw_state, &draw_rect, V0, V1, V2);
+}
+
+static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
+#ifdef SOFTGPU_BINNING
+	if (bin_numThreads) { Bins_AddTriangle(V0, V1, V2, false); return; }
+#endif
+	RasteriseTriangle3D(&draw_state, &draw_rect, V0, V1, V2);
+}
+
 #define V0_VIS (1 << 0)
 #define V1_VIS (1 << 1)
 #define V2_VIS (1 << 2)
@@ -845,6 +1563,7 @@ static void DrawClipped(int mask, Vertex* v0, Vertex* v1, Vertex* v2, Vertex* v3
 void DrawQuads(int startVertex, int verticesCount) {
 	Vertex vertices[4];
 	int j = startVertex;
+	BeginDraw();
 
 	if (gfx_rendering2D) {
 		// 4 vertices = 1 quad = 2 triangles
@@ -916,6 +1635,7 @@ static BitmapCol* CB_GetRow(struct Bitmap* bmp, int y, void* ctx) {
 hc_result Gfx_TakeScreenshot(struct Stream* output) {
 	struct Bitmap bmp;
 	Bitmap_Init(bmp, fb_width, fb_height, NULL);
+	Bins_Flush();
 	return Png_Encode(&bmp, output, CB_GetRow, false, NULL);
 }
 
@@ -925,6 +1645,7 @@ hc_bool Gfx_GetUIOptions(struct MenuOptionsScreen* s) { return false; }
 void Gfx_BeginFrame(void) { }
 
 void Gfx_EndFrame(void) {
+	Bins_Flush();
 	Rect2D r = { 0, 0, fb_width, fb_height };
 	Window_DrawFramebuffer(r, &fb_bmp);
 }
@@ -934,6 +1655,7 @@ void Gfx_SetVSync(hc_bool vsync) {
 }
 
 void Gfx_OnWindowResize(void) {
+	Bins_Flush();
 	if (depthBuffer) DestroyBuffers();
 
 	fb_width   = Game.Width;
@@ -948,6 +1670,7 @@ void Gfx_OnWindowResize(void) {
 
 	Gfx_SetViewport(0, 0, Game.Width, Game.Height);
 	Gfx_SetScissor (0, 0, Game.Width, Game.Height);
+	Bins_ResizeTiles();
 }
 
 void Gfx_SetViewport(int x, int y, int w, int h) {
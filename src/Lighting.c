@@ -30,6 +30,63 @@ void Lighting_SetMode(hc_uint8 mode, hc_bool fromServer) {
 }
 
 
+/*########################################################################################################################*
+*----------------------------------------------------Lighting batches-----------------------------------------------------*
+*#########################################################################################################################*/
+static int batch_depth;
+static hc_uint8* batch_marked; /* Whether each chunk has been added to the current batch */
+static int* batch_chunks;      /* Indices of the chunks added to the current batch */
+static int batch_count, batch_capacity;
+
+void Lighting_BeginBatch(void) {
+	if (batch_depth++) return;
+	if (!batch_marked) batch_marked = (hc_uint8*)Mem_TryAllocCleared(World.ChunksCount, 1);
+}
+
+static hc_bool Lighting_IsChunkMarked(int cx, int cy, int cz) {
+	return batch_depth && batch_marked && batch_marked[World_ChunkPack(cx, cy, cz)];
+}
+
+void Lighting_RefreshChunk(int cx, int cy, int cz) {
+	int index;
+	if (!batch_depth || !batch_marked) { MapRenderer_RefreshChunk(cx, cy, cz); return; }
+	if (cx < 0 || cy < 0 || cz < 0 || cx >= World.ChunksX || cy >= World.ChunksY || cz >= World.ChunksZ) return;
+
+	index = World_ChunkPack(cx, cy, cz);
+	if (batch_marked[index]) return;
+	batch_marked[index] = true;
+
+	if (batch_count == batch_capacity) {
+		batch_capacity = max(64, batch_capacity * 2);
+		batch_chunks   = (int*)Mem_Realloc(batch_chunks, batch_capacity, sizeof(int), "lighting batch");
+	}
+	batch_chunks[batch_count++] = index;
+}
+
+void Lighting_EndBatch(void) {
+	int i, index, cx, cy, cz;
+	if (--batch_depth) return;
+
+	for (i = 0; i < batch_count; i++) {
+		index = batch_chunks[i];
+		batch_marked[index] = false;
+
+		cx = index % World.ChunksX; index /= World.ChunksX;
+		cy = index % World.ChunksY; cz = index / World.ChunksY;
+		MapRenderer_RefreshChunk(cx, cy, cz);
+	}
+	batch_count = 0;
+}
+
+static void Lighting_FreeBatch(void) {
+	Mem_Free(batch_marked);
+	Mem_Free(batch_chunks);
+	batch_marked   = NULL;
+	batch_chunks   = NULL;
+	batch_capacity = 0;
+}
+
+
 /*########################################################################################################################*
 *----------------------------------------------------Classic lighting-----------------------------------------------------*
 *#########################################################################################################################*/
@@ -194,20 +251,23 @@ static hc_bool ClassicLighting_NeedsNeighour(BlockID block, int i, int minY, int
 static void ClassicLighting_ResetNeighbour(int x, int y, int z, BlockID block, int cx, int cy, int cz, int minCy, int maxCy) {
 	int minY, maxY;
 
+	/* Chunks already marked in this batch don't need checking again */
 	if (minCy == maxCy) {
 		minY = cy << CHUNK_SHIFT;
+		if (Lighting_IsChunkMarked(cx, cy, cz)) return;
 
 		if (ClassicLighting_NeedsNeighour(block, World_Pack(x, y, z), minY, y, y)) {
-			MapRenderer_RefreshChunk(cx, cy, cz);
+			Lighting_RefreshChunk(cx, cy, cz);
 		}
 	} else {
 		for (cy = maxCy; cy >= minCy; cy--) {
 			minY = (cy << CHUNK_SHIFT); 
 			maxY = (cy << CHUNK_SHIFT) + CHUNK_MAX;
 			if (maxY > World.MaxY) maxY = World.MaxY;
+			if (Lighting_IsChunkMarked(cx, cy, cz)) continue;
 
 			if (ClassicLighting_NeedsNeighour(block, World_Pack(x, maxY, z), minY, maxY, y)) {
-				MapRenderer_RefreshChunk(cx, cy, cz);
+				Lighting_RefreshChunk(cx, cy, cz);
 			}
 		}
 	}
@@ -215,10 +275,10 @@ static void ClassicLighting_ResetNeighbour(int x, int y, int z, BlockID block, i
 
 static void ClassicLighting_ResetColumn(int cx, int cy, int cz, int minCy, int maxCy) {
 	if (minCy == maxCy) {
-		MapRenderer_RefreshChunk(cx, cy, cz);
+		Lighting_RefreshChunk(cx, cy, cz);
 	} else {
 		for (cy = maxCy; cy >= minCy; cy--) {
-			MapRenderer_RefreshChunk(cx, cy, cz);
+			Lighting_RefreshChunk(cx, cy, cz);
 		}
 	}
 }
@@ -238,7 +298,7 @@ static void ClassicLighting_RefreshAffected(int x, int y, int z, BlockID block,
 		ClassicLighting_ResetNeighbour(x - 1, y, z, block, cx - 1, cy, cz, minCy, maxCy);
 	}
 	if (bY == 0 && cy > 0 && ClassicLighting_Needs(block, World_GetBlock(x, y - 1, z))) {
-		MapRenderer_RefreshChunk(cx, cy - 1, cz);
+		Lighting_RefreshChunk(cx, cy - 1, cz);
 	}
 	if (bZ == 0 && cz > 0) {
 		ClassicLighting_ResetNeighbour(x, y, z - 1, block, cx, cy, cz - 1, minCy, maxCy);
@@ -248,7 +308,7 @@ static void ClassicLighting_RefreshAffected(int x, int y, int z, BlockID block,
 		ClassicLighting_ResetNeighbour(x + 1, y, z, block, cx + 1, cy, cz, minCy, maxCy);
 	}
 	if (bY == 15 && cy < World.ChunksY - 1 && ClassicLighting_Needs(block, World_GetBlock(x, y + 1, z))) {
-		MapRenderer_RefreshChunk(cx, cy + 1, cz);
+		Lighting_RefreshChunk(cx, cy + 1, cz);
 	}
 	if (bZ == 15 && cz < World.ChunksZ - 1) {
 		ClassicLighting_ResetNeighbour(x, y, z + 1, block, cx, cy, cz + 1, minCy, maxCy);
@@ -269,6 +329,66 @@ void ClassicLighting_OnBlockChanged(int x, int y, int z, BlockID oldBlock, Block
 	ClassicLighting_RefreshAffected(x, y, z, newBlock, lightH + 1, newHeight);
 }
 
+/* Column of the map affected by a batch of block changes */
+struct ClassicColumn { int x, z, maxY, oldHeight; };
+#define CLASSIC_MAX_COLUMNS 256
+
+static void ClassicLighting_UpdateColumns(const struct LightingBlockChange* changes, int count) {
+	struct ClassicColumn columns[CLASSIC_MAX_COLUMNS];
+	struct ClassicColumn* col;
+	const struct LightingBlockChange* c;
+	int i, j, hIndex, numColumns = 0;
+	int topY, newHeight;
+
+	/* Find the columns changed and their heights before the changes */
+	for (i = 0; i < count; i++) {
+		c = &changes[i];
+		if (classic_heightmap[Lighting_Pack(c->x, c->z)] == HEIGHT_UNCALCULATED) continue;
+
+		for (j = 0; j < numColumns; j++) {
+			if (columns[j].x == c->x && columns[j].z == c->z) break;
+		}
+		col = &columns[j];
+
+		if (j == numColumns) {
+			col->x = c->x; col->z = c->z; col->maxY = c->y;
+			col->oldHeight = classic_heightmap[Lighting_Pack(c->x, c->z)];
+			numColumns++;
+		}
+		col->maxY = max(col->maxY, c->y);
+	}
+
+	/* Recalculate light height of each column only once */
+	/* Blocks above the old light height and all the changes did not block light, so can be skipped */
+	for (j = 0; j < numColumns; j++) {
+		col    = &columns[j];
+		hIndex = Lighting_Pack(col->x, col->z);
+		topY   = min(max(col->maxY, col->oldHeight + 1), World.MaxY);
+		ClassicLighting_CalcHeightAt(col->x, topY, col->z, hIndex);
+	}
+
+	for (i = 0; i < count; i++) {
+		c = &changes[i];
+		for (j = 0; j < numColumns; j++) {
+			if (columns[j].x == c->x && columns[j].z == c->z) break;
+		}
+		if (j == numColumns) continue;
+
+		newHeight = classic_heightmap[Lighting_Pack(c->x, c->z)];
+		ClassicLighting_RefreshAffected(c->x, c->y, c->z, c->newBlock, columns[j].oldHeight + 1, newHeight + 1);
+	}
+}
+
+void ClassicLighting_OnBlocksChanged(const struct LightingBlockChange* changes, int count) {
+	int i;
+	Lighting_BeginBatch();
+
+	for (i = 0; i < count; i += CLASSIC_MAX_COLUMNS) {
+		ClassicLighting_UpdateColumns(changes + i, min(count - i, CLASSIC_MAX_COLUMNS));
+	}
+	Lighting_EndBatch();
+}
+
 
 /*########################################################################################################################*
 *---------------------------------------------------Lighting heightmap----------------------------------------------------*
@@ -387,6 +507,8 @@ void ClassicLighting_LightHint(int startX, int startY, int startZ) {
 }
 
 void ClassicLighting_FreeState(void) {
+	/* Chunks being built on worker threads may still be reading lighting state */
+	Builder_CancelJobs();
 	Mem_Free(classic_heightmap);
 	classic_heightmap = NULL;
 }
@@ -400,11 +522,15 @@ void ClassicLighting_AllocState(void) {
 	}
 }
 
+static hc_bool ClassicLighting_IsChunkPending(int cx, int cy, int cz) { return false; }
+static void ClassicLighting_WaitPending(void) { }
+
 static void ClassicLighting_SetActive(void) {
 	hc_bool smoothLighting = false;
 	if (!Game_ClassicMode) smoothLighting = Options_GetBool(OPT_SMOOTH_LIGHTING, false);
 
 	Lighting.OnBlockChanged = ClassicLighting_OnBlockChanged;
+	Lighting.OnBlocksChanged = ClassicLighting_OnBlocksChanged;
 	Lighting.Refresh        = ClassicLighting_Refresh;
 	Lighting.IsLit          = ClassicLighting_IsLit;
 	Lighting.Color          = smoothLighting ? SmoothLighting_Color : ClassicLighting_Color;
@@ -420,6 +546,8 @@ static void ClassicLighting_SetActive(void) {
 	Lighting.FreeState  = ClassicLighting_FreeState;
 	Lighting.AllocState = ClassicLighting_AllocState;
 	Lighting.LightHint  = ClassicLighting_LightHint;
+	Lighting.IsChunkPending = ClassicLighting_IsChunkPending;
+	Lighting.WaitPending    = ClassicLighting_WaitPending;
 }
 
 
@@ -463,7 +591,10 @@ static void OnInit(void) {
 
 	Event_Register_(&WorldEvents.LightingModeChanged, NULL, Lighting_HandleModeChanged);
 }
-static void OnReset(void)        { Lighting.FreeState(); }
+static void OnReset(void) {
+	Lighting.FreeState();
+	Lighting_FreeBatch();
+}
 static void OnNewMapLoaded(void) { Lighting.AllocState(); }
 
 struct IGameComponent Lighting_Component = {
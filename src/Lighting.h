@@ -37,6 +37,9 @@ void Lighting_SetMode(hc_uint8 mode, hc_bool fromServer);
 /* A byte that fills the lamp level area with ones. Equivalent to 0b_1111_0000 */
 #define FANCY_LIGHTING_LAMP_MASK 0xF0
 
+/* A block in the map that was changed, when updating lighting for many changes at once */
+struct LightingBlockChange { int x, y, z; BlockID oldBlock, newBlock; };
+
 HC_VAR extern struct _Lighting {
 	/* Releases/Frees the per-level lighting state */
 	void (*FreeState)(void);
@@ -50,6 +53,10 @@ HC_VAR extern struct _Lighting {
 	/* Called when a block is changed to update internal lighting state. */
 	/* NOTE: Implementations ***MUST*** mark all chunks affected by this lighting change as needing to be refreshed. */
 	void (*OnBlockChanged)(int x, int y, int z, BlockID oldBlock, BlockID newBlock);
+	/* Called after many blocks are changed at once to update internal lighting state only once for all of them. */
+	/* NOTE: All of the blocks must have already been changed in the map. */
+	/* NOTE: Implementations ***MUST*** mark all chunks affected by these lighting changes as needing to be refreshed. */
+	void (*OnBlocksChanged)(const struct LightingBlockChange* changes, int count);
 	/* Invalidates/Resets lighting state for all of the blocks in the world */
 	/*  (e.g. because a block changed whether it is full bright or not) */
 	void (*Refresh)(void);
@@ -72,8 +79,21 @@ HC_VAR extern struct _Lighting {
 	PackedCol (*Color_YMin_Fast)(int x, int y, int z);
 	PackedCol (*Color_XSide_Fast)(int x, int y, int z);
 	PackedCol (*Color_ZSide_Fast)(int x, int y, int z);
+
+	/* Returns whether lighting for the given chunk is still being calculated in the background */
+	/*  (chunks must not be built while this is true) */
+	hc_bool (*IsChunkPending)(int cx, int cy, int cz);
+	/* Blocks until lighting being calculated in the background (if any) has finished */
+	void (*WaitPending)(void);
 } Lighting;
 
+/* Starts a batch of lighting changes, during which each chunk is only marked as needing refresh once */
+void Lighting_BeginBatch(void);
+/* Ends a batch of lighting changes, and marks every chunk affected by the batch as needing refresh */
+void Lighting_EndBatch(void);
+/* Marks the given chunk as needing refresh, or adds it to the current batch of lighting changes */
+void Lighting_RefreshChunk(int cx, int cy, int cz);
+
 void FancyLighting_SetActive(void);
 void FancyLighting_OnInit(void);
 
@@ -86,6 +106,7 @@ void ClassicLighting_LightHint(int startX, int startY, int startZ);
 hc_bool ClassicLighting_IsLit(int x, int y, int z);
 hc_bool ClassicLighting_IsLit_Fast(int x, int y, int z);
 void ClassicLighting_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock);
+void ClassicLighting_OnBlocksChanged(const struct LightingBlockChange* changes, int count);
 
 HC_END_HEADER
 #endif
@@ -108,6 +108,8 @@ static const char* GetCCErrorDesc(hc_result res) {
 	case HTTP_ERR_NO_SSL: return "HTTPS URLs are not currently supported";
 	case SOCK_ERR_UNKNOWN_HOST: return "Host could not be resolved to an IP address";
 	case ERR_NO_NETWORKING: return "No working network access";
+	case RAW_ERR_IDENTIFIER: return "Invalid raw map identifier";
+	case RAW_ERR_VERSION:    return "Unsupported raw map version";
 	}
 	return NULL;
 }
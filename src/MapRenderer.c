@@ -9,6 +9,7 @@
 #include "Funcs.h"
 #include "Game.h"
 #include "Graphics.h"
+#include "Lighting.h"
 #include "Platform.h"
 #include "TexturePack.h"
 #include "Utils.h"
@@ -16,6 +17,8 @@
 #include "Options.h"
 
 int MapRenderer_1DUsedCount;
+int MapRenderer_OccludedChunks;
+int MapRenderer_DrawCalls;
 struct ChunkPartInfo* MapRenderer_PartsNormal;
 struct ChunkPartInfo* MapRenderer_PartsTranslucent;
 
@@ -33,19 +36,43 @@ static hc_bool checkNormParts[ATLAS1D_MAX_ATLASES], checkTranParts[ATLAS1D_MAX_A
 
 /* Render info for all chunks in the world. Unsorted. */
 static struct ChunkInfo* mapChunks;
-/* Pointers to render info for all chunks in the world, sorted by distance from the camera. */
+/* Pointers to render info for chunks near the camera, sorted by distance from the camera. */
+/* Only chunks within the build/render distance (see nearDistSquared) are included in this. */
 static struct ChunkInfo** sortedChunks;
+/* Number of actually used pointers in the sortedChunks array. */
+static int sortedChunksCount;
 /* Pointers to render info for all chunks in the world, sorted by distance from the camera. */
 /* Only chunks that can be rendered (i.e. not empty and are visible) are included in this.  */
 static struct ChunkInfo** renderChunks;
 /* Number of actually used pointers in the renderChunks array. Entries past this are ignored and skipped. */
 static int renderChunksCount;
-/* Distance of each chunk from the camera. */
+/* Distance of each chunk in sortedChunks from the camera. */
 static hc_uint32* distances;
 /* Maximum number of chunk updates that can be performed in one frame. */
 static int maxChunkUpdates;
 /* Cached number of chunks in the world */
 static int chunksCount;
+/* Face of each chunk that the occlusion flood fill first entered it through. */
+/* FACE_COUNT for the chunk the camera is in, OCCLUSION_UNREACHED if never reached. */
+static hc_uint8* occEntry;
+/* Directions travelled through from the camera's chunk to first reach each chunk */
+static hc_uint8* occDirs;
+/* Indices of chunks still to be visited by the occlusion flood fill */
+static int* occQueue;
+
+/* Chunks are grouped into 8x8x8 groups of chunks, so that whole groups of chunks */
+/*  that are out of range or outside the view frustum can be skipped at once */
+#define GROUP_SHIFT (CHUNK_SHIFT + 3)
+#define GROUP_SIZE (1 << GROUP_SHIFT)
+#define GROUP_CHUNKS (GROUP_SIZE / CHUNK_SIZE)
+#define Group_Pack(gx, gy, gz) (((gz) * groupsY + (gy)) * groupsX + (gx))
+#define Group_OfChunk(info) Group_Pack((info)->centreX >> GROUP_SHIFT, (info)->centreY >> GROUP_SHIFT, (info)->centreZ >> GROUP_SHIFT)
+/* Number of chunk groups along each axis of the world */
+static int groupsX, groupsY, groupsZ;
+/* Whether each chunk group is at least partially inside the view frustum */
+static hc_uint8* groupVisible;
+/* Range of chunk groups which contain the chunks in sortedChunks */
+static IVec3 groupsMin, groupsMax;
 
 static void ChunkInfo_Reset(struct ChunkInfo* chunk, int x, int y, int z) {
 	chunk->centreX = x + HALF_CHUNK_SIZE; chunk->centreY = y + HALF_CHUNK_SIZE; 
@@ -53,12 +80,18 @@ static void ChunkInfo_Reset(struct ChunkInfo* chunk, int x, int y, int z) {
 #ifndef HC_BUILD_GL11
 	chunk->vb = 0;
 #endif
+#ifdef HC_BUILD_TERRAINPOOL
+	chunk->poolCount = 0;
+#endif
 
 	chunk->visible = true;  
 	chunk->empty   = false;
 	chunk->dirty   = false; 
 	chunk->allAir  = false;
 	chunk->noData  = true;
+	chunk->building = false;
+	chunk->occluded = false;
+	chunk->connections = CHUNK_ALL_CONNECTED;
 
 	chunk->drawXMin = false; chunk->drawXMax = false; chunk->drawZMin = false;
 	chunk->drawZMax = false; chunk->drawYMin = false; chunk->drawYMax = false;
@@ -79,6 +112,181 @@ HC_NOINLINE static int MapRenderer_UsedAtlases(void) {
 }
 
 
+#ifdef HC_BUILD_TERRAINPOOL
+/*########################################################################################################################*
+*-------------------------------------------------------Terrain pool------------------------------------------------------*
+*#########################################################################################################################*/
+/* Chunk meshes are sub-allocated from a few large vertex buffers ('pages') shared between chunks, */
+/*  so that consecutive chunks can usually be drawn without binding another vertex buffer */
+/* Pages hold GFX_MAX_VERTICES, so any range in them can be drawn by just offsetting indices */
+/* Meshes too large to fit in a page are given a dedicated page of their own instead */
+#define POOL_BLOCK_SHIFT 6 /* Meshes are allocated in blocks of 64 vertices to limit fragmentation */
+#define POOL_BLOCK_SIZE  (1 << POOL_BLOCK_SHIFT)
+#define POOL_PAGE_BLOCKS (GFX_MAX_VERTICES >> POOL_BLOCK_SHIFT)
+
+struct PoolRange { int start, count; };
+static struct PoolPage {
+	GfxResourceID vb;     /* 0 if page is unused */
+	int blocks;           /* Size of the page in blocks */
+	int freeBlocks;       /* Total number of free blocks in the page */
+	struct PoolRange* free; /* Ranges of free blocks in the page, sorted by start */
+	int freeCount, freeCapacity;
+} * poolPages;
+static int poolPagesCount, poolPagesCapacity;
+/* Temp memory for a mesh's vertices, before they are uploaded */
+static struct VertexTerrain* poolVertices;
+static int poolVerticesCapacity;
+
+static void Pool_RemoveRange(struct PoolPage* page, int i) {
+	page->freeCount--;
+	Mem_Move(&page->free[i], &page->free[i + 1], (page->freeCount - i) * sizeof(struct PoolRange));
+}
+
+static void Pool_InsertRange(struct PoolPage* page, int i, int start, int count) {
+	if (page->freeCount == page->freeCapacity) {
+		page->freeCapacity = max(8, page->freeCapacity * 2);
+		page->free = (struct PoolRange*)Mem_Realloc(page->free, page->freeCapacity, 
+												sizeof(struct PoolRange), "terrain pool ranges");
+	}
+
+	Mem_Move(&page->free[i + 1], &page->free[i], (page->freeCount - i) * sizeof(struct PoolRange));
+	page->free[i].start = start;
+	page->free[i].count = count;
+	page->freeCount++;
+}
+
+static int Pool_NewPage(int blocks) {
+	struct PoolPage* page;
+	int i;
+	for (i = 0; i < poolPagesCount; i++) 
+	{
+		if (!poolPages[i].vb) break;
+	}
+
+	if (i == poolPagesCount) {
+		if (poolPagesCount == poolPagesCapacity) {
+			poolPagesCapacity = max(16, poolPagesCapacity * 2);
+			poolPages = (struct PoolPage*)Mem_Realloc(poolPages, poolPagesCapacity, 
+													sizeof(struct PoolPage), "terrain pool pages");
+		}
+		Mem_Set(&poolPages[i], 0, sizeof(struct PoolPage));
+		poolPagesCount++;
+	}
+
+	page = &poolPages[i];
+	page->vb         = Gfx_CreatePoolVb(VERTEX_FORMAT_TERRAIN, blocks << POOL_BLOCK_SHIFT);
+	page->blocks     = blocks;
+	page->freeBlocks = blocks;
+	page->freeCount  = 0;
+	Pool_InsertRange(page, 0, 0, blocks);
+	return i;
+}
+
+static void Pool_Alloc(struct ChunkInfo* info, int count) {
+	int blocks = (count + (POOL_BLOCK_SIZE - 1)) >> POOL_BLOCK_SHIFT;
+	struct PoolPage* page;
+	struct PoolRange* range;
+	int i, j = 0;
+
+	for (i = 0; i < poolPagesCount; i++) 
+	{
+		page = &poolPages[i];
+		if (page->blocks != POOL_PAGE_BLOCKS || page->freeBlocks < blocks) continue;
+
+		/* First fit */
+		for (j = 0; j < page->freeCount; j++) 
+		{
+			if (page->free[j].count >= blocks) break;
+		}
+		if (j < page->freeCount) break;
+	}
+	if (i == poolPagesCount) { i = Pool_NewPage(max(blocks, POOL_PAGE_BLOCKS)); j = 0; }
+
+	page  = &poolPages[i];
+	range = &page->free[j];
+	info->vb        = page->vb;
+	info->poolPage  = i;
+	info->poolStart = range->start << POOL_BLOCK_SHIFT;
+	info->poolCount = count;
+
+	range->start += blocks;
+	range->count -= blocks;
+	if (!range->count) Pool_RemoveRange(page, j);
+	page->freeBlocks -= blocks;
+}
+
+static void Pool_Free(struct ChunkInfo* info) {
+	struct PoolPage* page;
+	struct PoolRange* ranges;
+	int start, blocks, i;
+	hc_bool mergePrev, mergeNext;
+	if (!info->poolCount) return;
+
+	page   = &poolPages[info->poolPage];
+	start  = info->poolStart >> POOL_BLOCK_SHIFT;
+	blocks = (info->poolCount + (POOL_BLOCK_SIZE - 1)) >> POOL_BLOCK_SHIFT;
+	info->vb        = 0;
+	info->poolCount = 0;
+
+	if (page->blocks > POOL_PAGE_BLOCKS) {
+		Gfx_DeleteVb(&page->vb);
+		page->freeCount = 0;
+		return;
+	}
+	page->freeBlocks += blocks;
+	ranges = page->free;
+
+	for (i = 0; i < page->freeCount && ranges[i].start < start; i++) { }
+	mergePrev = i > 0 && ranges[i - 1].start + ranges[i - 1].count == start;
+	mergeNext = i < page->freeCount && start + blocks == ranges[i].start;
+
+	if (mergePrev && mergeNext) {
+		ranges[i - 1].count += blocks + ranges[i].count;
+		Pool_RemoveRange(page, i);
+	} else if (mergePrev) {
+		ranges[i - 1].count += blocks;
+	} else if (mergeNext) {
+		ranges[i].start  = start;
+		ranges[i].count += blocks;
+	} else {
+		Pool_InsertRange(page, i, start, blocks);
+	}
+}
+
+static void Pool_Clear(void) {
+	int i;
+	for (i = 0; i < poolPagesCount; i++) 
+	{
+		Gfx_DeleteVb(&poolPages[i].vb);
+		Mem_Free(poolPages[i].free);
+	}
+	Mem_Free(poolPages);
+	Mem_Free(poolVertices);
+
+	poolPages    = NULL;
+	poolVertices = NULL;
+	poolPagesCount = 0; poolPagesCapacity    = 0;
+	poolVerticesCapacity = 0;
+}
+
+struct VertexTerrain* MapRenderer_LockMesh(struct ChunkInfo* info, int count) {
+	Pool_Free(info);
+	Pool_Alloc(info, count);
+
+	if (count > poolVerticesCapacity) {
+		Mem_Free(poolVertices);
+		poolVertices = (struct VertexTerrain*)Mem_Alloc(count, sizeof(struct VertexTerrain), "terrain pool vertices");
+		poolVerticesCapacity = count;
+	}
+	return poolVertices;
+}
+
+void MapRenderer_UnlockMesh(struct ChunkInfo* info) {
+	Gfx_SetPoolVbRange(info->vb, VERTEX_FORMAT_TERRAIN, info->poolStart, poolVertices, info->poolCount);
+}
+#endif
+
+
 /*########################################################################################################################*
 *-------------------------------------------------------Map rendering-----------------------------------------------------*
 *#########################################################################################################################*/
@@ -99,19 +307,91 @@ static void CheckWeather(float delta) {
 	Gfx_SetAlphaBlending(false);
 }
 
-#ifdef HC_BUILD_GL11
-#define DrawFace(face, ign)    Gfx_BindVb(part.vbs[face]); Gfx_DrawIndexedTris_T2fC4b(0, 0);
+#ifdef HC_BUILD_TERRAINPOOL
+/* Max ranges drawn from one chunk, with face culling either off or on */
+#define MAX_CHUNK_DRAWS 8
+static int drawCounts[2][MAX_CHUNK_DRAWS], drawStarts[2][MAX_CHUNK_DRAWS], drawsCount[2];
+/* First vertex of the current chunk's mesh in its vertex buffer */
+static int chunkBase;
+static GfxResourceID boundVb;
+
+/* Queues a range of the current chunk's mesh to be drawn, merging it with the previous range if contiguous */
+static void AddDraw(int cull, int count, int offset) {
+	int i = drawsCount[cull], start = chunkBase + offset;
+
+	if (i && drawStarts[cull][i - 1] + drawCounts[cull][i - 1] == start) {
+		drawCounts[cull][i - 1] += count;
+	} else {
+		drawStarts[cull][i] = start;
+		drawCounts[cull][i] = count;
+		drawsCount[cull]++;
+	}
+}
+
+/* Draws all the queued ranges of the current chunk's mesh */
+static void FlushDraws(void) {
+	if (drawsCount[0]) {
+		Gfx_DrawIndexedTris_Multi(drawCounts[0], drawStarts[0], drawsCount[0]);
+		MapRenderer_DrawCalls++;
+	}
+	if (drawsCount[1]) {
+		Gfx_SetFaceCulling(true);
+		Gfx_DrawIndexedTris_Multi(drawCounts[1], drawStarts[1], drawsCount[1]);
+		Gfx_SetFaceCulling(false);
+		MapRenderer_DrawCalls++;
+	}
+	drawsCount[0] = 0; drawsCount[1] = 0;
+}
+
+/* Terrain vertex positions are relative to the origin of their chunk */
+static void BindChunkVb(struct ChunkInfo* info) {
+	FlushDraws();
+	Gfx_SetTerrainOrigin(info->centreX - HALF_CHUNK_SIZE, info->centreY - HALF_CHUNK_SIZE, info->centreZ - HALF_CHUNK_SIZE);
+	chunkBase = info->poolStart;
+
+	if (info->vb == boundVb) return;
+	boundVb = info->vb;
+	Gfx_BindVb_Textured(info->vb);
+}
+#define MAP_VERTEX_FORMAT VERTEX_FORMAT_TERRAIN
+#define BeginChunkDraws() boundVb = 0;
+#define EndChunkDraws()   FlushDraws();
+#elif defined HC_BUILD_TERRAINVERTICES
+#define MAP_VERTEX_FORMAT VERTEX_FORMAT_TERRAIN
+/* Terrain vertex positions are relative to the origin of their chunk */
+static void BindChunkVb(struct ChunkInfo* info) {
+	Gfx_SetTerrainOrigin(info->centreX - HALF_CHUNK_SIZE, info->centreY - HALF_CHUNK_SIZE, info->centreZ - HALF_CHUNK_SIZE);
+	Gfx_BindVb_Textured(info->vb);
+}
+#else
+#define MAP_VERTEX_FORMAT VERTEX_FORMAT_TEXTURED
+#define BindChunkVb(info) Gfx_BindVb_Textured((info)->vb)
+#endif
+#ifndef HC_BUILD_TERRAINPOOL
+#define BeginChunkDraws()
+#define EndChunkDraws()
+#endif
+
+#if defined HC_BUILD_GL11
+#define DrawFace(face, ign)    Gfx_BindVb(part.vbs[face]); Gfx_DrawIndexedTris_T2fC4b(0, 0); MapRenderer_DrawCalls++;
 #define DrawFaces(f1, f2, ign) DrawFace(f1, ign); DrawFace(f2, ign);
+#elif defined HC_BUILD_TERRAINPOOL
+#define DrawFace(face, offset)    AddDraw(false, part.counts[face], offset);
+#define DrawFaces(f1, f2, offset) AddDraw(false, part.counts[f1] + part.counts[f2], offset);
+#define DrawCulledFaces(f1, f2, offset) AddDraw(true, part.counts[f1] + part.counts[f2], offset);
+#define DrawSprites(count, offset)      AddDraw(true, count, offset);
 #else
-#define DrawFace(face, offset)    Gfx_DrawIndexedTris_T2fC4b(part.counts[face], offset);
-#define DrawFaces(f1, f2, offset) Gfx_DrawIndexedTris_T2fC4b(part.counts[f1] + part.counts[f2], offset);
+#define DrawFace(face, offset)    Gfx_DrawIndexedTris_T2fC4b(part.counts[face], offset); MapRenderer_DrawCalls++;
+#define DrawFaces(f1, f2, offset) Gfx_DrawIndexedTris_T2fC4b(part.counts[f1] + part.counts[f2], offset); MapRenderer_DrawCalls++;
+#endif
+#ifndef HC_BUILD_TERRAINPOOL
+#define DrawCulledFaces(f1, f2, offset) Gfx_SetFaceCulling(true); DrawFaces(f1, f2, offset); Gfx_SetFaceCulling(false);
+#define DrawSprites(count, offset)      Gfx_DrawIndexedTris_T2fC4b(count, offset); MapRenderer_DrawCalls++;
 #endif
 
 #define DrawNormalFaces(minFace, maxFace) \
 if (drawMin && drawMax) { \
-	Gfx_SetFaceCulling(true); \
-	DrawFaces(minFace, maxFace, offset); \
-	Gfx_SetFaceCulling(false); \
+	DrawCulledFaces(minFace, maxFace, offset); \
 	Game_Vertices += (part.counts[minFace] + part.counts[maxFace]); \
 } else if (drawMin) { \
 	DrawFace(minFace, offset); \
@@ -128,6 +408,7 @@ static void RenderNormalBatch(int batch) {
 	hc_bool drawMin, drawMax;
 	int i, offset, count;
 
+	BeginChunkDraws();
 	for (i = 0; i < renderChunksCount; i++) {
 		info = renderChunks[i];
 		if (!info->normalParts) continue;
@@ -137,7 +418,7 @@ static void RenderNormalBatch(int batch) {
 		hasNormParts[batch] = true;
 
 #ifndef HC_BUILD_GL11
-		Gfx_BindVb_Textured(info->vb);
+		BindChunkVb(info);
 #endif
 
 		offset  = part.offset + part.spriteCount;
@@ -159,39 +440,46 @@ static void RenderNormalBatch(int batch) {
 		offset = part.offset;
 		count  = part.spriteCount >> 2; /* 4 per sprite */
 
+#ifndef HC_BUILD_TERRAINPOOL
 		Gfx_SetFaceCulling(true);
+#endif
 		/* TODO: fix to not render them all */
 #ifdef HC_BUILD_GL11
 		Gfx_BindVb(part.vbs[FACE_COUNT]);
 		Gfx_DrawIndexedTris_T2fC4b(0, 0);
 		Game_Vertices += count * 4;
+		MapRenderer_DrawCalls++;
 		Gfx_SetFaceCulling(false);
 		continue;
 #endif
 		if (info->drawXMax || info->drawZMin) {
-			Gfx_DrawIndexedTris_T2fC4b(count, offset); Game_Vertices += count;
+			DrawSprites(count, offset); Game_Vertices += count;
 		} offset += count;
 
 		if (info->drawXMin || info->drawZMax) {
-			Gfx_DrawIndexedTris_T2fC4b(count, offset); Game_Vertices += count;
+			DrawSprites(count, offset); Game_Vertices += count;
 		} offset += count;
 
 		if (info->drawXMin || info->drawZMin) {
-			Gfx_DrawIndexedTris_T2fC4b(count, offset); Game_Vertices += count;
+			DrawSprites(count, offset); Game_Vertices += count;
 		} offset += count;
 
 		if (info->drawXMax || info->drawZMax) {
-			Gfx_DrawIndexedTris_T2fC4b(count, offset); Game_Vertices += count;
+			DrawSprites(count, offset); Game_Vertices += count;
 		}
+#ifndef HC_BUILD_TERRAINPOOL
 		Gfx_SetFaceCulling(false);
+#endif
 	}
+	EndChunkDraws();
 }
 
 void MapRenderer_RenderNormal(float delta) {
 	int batch;
+	MapRenderer_DrawCalls = 0;
 	if (!mapChunks) return;
 
-	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
+	Gfx_SetVertexFormat(MAP_VERTEX_FORMAT);
 	Gfx_SetAlphaTest(true);
 	
 	Gfx_EnableMipmaps();
@@ -208,9 +496,6 @@ void MapRenderer_RenderNormal(float delta) {
 
 	CheckWeather(delta);
 	Gfx_SetAlphaTest(false);
-#if DEBUG_OCCLUSION
-	DebugPickedPos();
-#endif
 }
 
 #define DrawTranslucentFaces(minFace, maxFace) \
@@ -232,6 +517,7 @@ static void RenderTranslucentBatch(int batch) {
 	hc_bool drawMin, drawMax;
 	int i, offset;
 
+	BeginChunkDraws();
 	for (i = 0; i < renderChunksCount; i++) {
 		info = renderChunks[i];
 		if (!info->translucentParts) continue;
@@ -241,7 +527,7 @@ static void RenderTranslucentBatch(int batch) {
 		hasTranParts[batch] = true;
 
 #ifndef HC_BUILD_GL11
-		Gfx_BindVb_Textured(info->vb);
+		BindChunkVb(info);
 #endif
 
 		offset  = part.offset;
@@ -259,6 +545,7 @@ static void RenderTranslucentBatch(int batch) {
 		drawMax = (inTranslucent || info->drawYMax) && part.counts[FACE_YMAX];
 		DrawTranslucentFaces(FACE_YMIN, FACE_YMAX);
 	}
+	EndChunkDraws();
 }
 
 void MapRenderer_RenderTranslucent(float delta) {
@@ -267,7 +554,7 @@ void MapRenderer_RenderTranslucent(float delta) {
 
 	/* First fill depth buffer */
 	vertices = Game_Vertices;
-	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
+	Gfx_SetVertexFormat(MAP_VERTEX_FORMAT);
 	Gfx_SetAlphaBlending(false);
 	Gfx_DepthOnlyRendering(true);
 
@@ -315,8 +602,10 @@ void MapRenderer_RenderTranslucent(float delta) {
 static void DeleteChunk(struct ChunkInfo* info) {
 	struct ChunkPartInfo* ptr;
 	int i;
-#ifdef HC_BUILD_GL11
+#if defined HC_BUILD_GL11
 	int j;
+#elif defined HC_BUILD_TERRAINPOOL
+	Pool_Free(info);
 #else
 	Gfx_DeleteVb(&info->vb);
 #endif
@@ -324,10 +613,6 @@ static void DeleteChunk(struct ChunkInfo* info) {
 	info->empty  = false; 
 	info->allAir = false;
 	info->noData = true;
-#ifdef OCCLUSION
-	info.OcclusionFlags = 0;
-	info.OccludedFlags = 0;
-#endif
 
 	if (info->normalParts) {
 		ptr = info->normalParts;
@@ -354,18 +639,14 @@ static void DeleteChunk(struct ChunkInfo* info) {
 	}
 }
 
-/* Builds the mesh (hence vertex buffer) for the given chunk, and updates internal state */
-static void BuildChunk(struct ChunkInfo* info, int* chunkUpdates) {
+/* Updates internal state after the mesh for the given chunk has been built */
+static void AddChunkParts(struct ChunkInfo* info) {
 	struct ChunkPartInfo* ptr;
 	int i;
 
-	Game.ChunkUpdates++;
-	(*chunkUpdates)++;
-	Builder_MakeChunk(info);
-
-	info->dirty  = false;
 	info->noData = !info->normalParts && !info->translucentParts;
-	info->empty  = info->noData;
+	/* Empty chunks are skipped, so must not be if blocks changed while the mesh was being built */
+	info->empty  = info->noData && !info->dirty;
 	if (info->empty) return;
 	
 	if (info->normalParts) {
@@ -383,6 +664,21 @@ static void BuildChunk(struct ChunkInfo* info, int* chunkUpdates) {
 	}
 }
 
+/* Whether the connections of any chunk have changed since occlusion was last calculated */
+static hc_bool occlusionDirty;
+
+/* Builds the mesh (hence vertex buffer) for the given chunk, and updates internal state */
+static void BuildChunk(struct ChunkInfo* info, int* chunkUpdates) {
+	int connections = info->connections;
+	Game.ChunkUpdates++;
+	(*chunkUpdates)++;
+	Builder_MakeChunk(info);
+
+	info->dirty = false;
+	AddChunkParts(info);
+	if (info->connections != connections) occlusionDirty = true;
+}
+
 
 /*########################################################################################################################*
 *----------------------------------------------------Chunks mangagement---------------------------------------------------*
@@ -398,11 +694,20 @@ static void FreeChunks(void) {
 	Mem_Free(sortedChunks);
 	Mem_Free(renderChunks);
 	Mem_Free(distances);
+	Mem_Free(occEntry);
+	Mem_Free(occDirs);
+	Mem_Free(occQueue);
+	Mem_Free(groupVisible);
 
 	mapChunks    = NULL;
 	sortedChunks = NULL;
 	renderChunks = NULL;
 	distances    = NULL;
+	occEntry     = NULL;
+	occDirs      = NULL;
+	occQueue     = NULL;
+	groupVisible = NULL;
+	sortedChunksCount = 0;
 }
 
 static void AllocateParts(void) {
@@ -419,6 +724,14 @@ static void AllocateChunks(void) {
 	sortedChunks = (struct ChunkInfo**)Mem_Alloc(chunksCount, sizeof(struct ChunkInfo*), "sorted chunk info");
 	renderChunks = (struct ChunkInfo**)Mem_Alloc(chunksCount, sizeof(struct ChunkInfo*), "render chunk info");
 	distances    = (hc_uint32*)Mem_Alloc(chunksCount, 4, "chunk distances");
+	occEntry     = (hc_uint8*)Mem_Alloc(chunksCount, 1, "chunk occlusion entry");
+	occDirs      = (hc_uint8*)Mem_Alloc(chunksCount, 1, "chunk occlusion dirs");
+	occQueue     = (int*)Mem_Alloc(chunksCount, 4, "chunk occlusion queue");
+
+	groupsX = (World.ChunksX + (GROUP_CHUNKS - 1)) / GROUP_CHUNKS;
+	groupsY = (World.ChunksY + (GROUP_CHUNKS - 1)) / GROUP_CHUNKS;
+	groupsZ = (World.ChunksZ + (GROUP_CHUNKS - 1)) / GROUP_CHUNKS;
+	groupVisible = (hc_uint8*)Mem_Alloc(groupsX * groupsY * groupsZ, 1, "chunk groups");
 }
 
 static void ResetPartFlags(void) {
@@ -445,13 +758,12 @@ static void InitChunks(void) {
 		for (y = 0; y < World.Height; y += CHUNK_SIZE) {
 			for (x = 0; x < World.Width; x += CHUNK_SIZE) {
 				ChunkInfo_Reset(&mapChunks[index], x, y, z);
-				sortedChunks[index] = &mapChunks[index];
-				renderChunks[index] = &mapChunks[index];
-				distances[index]    = 0;
 				index++;
 			}
 		}
 	}
+	sortedChunksCount = 0;
+	renderChunksCount = 0;
 }
 
 static void ResetChunks(void) {
@@ -469,11 +781,15 @@ static void ResetChunks(void) {
 static void DeleteChunks(void) {
 	int i;
 	if (!mapChunks) return;
+	Builder_CancelJobs();
 
 	for (i = 0; i < chunksCount; i++) {
 		DeleteChunk(&mapChunks[i]);
 	}
 	ResetPartCounts();
+#ifdef HC_BUILD_TERRAINPOOL
+	Pool_Clear();
+#endif
 }
 
 void MapRenderer_Refresh(void) {
@@ -517,6 +833,83 @@ static void RefreshBorderChunks(int maxHeight) {
 }
 
 
+/*########################################################################################################################*
+*----------------------------------------------------Occlusion culling----------------------------------------------------*
+*#########################################################################################################################*/
+#define OCCLUSION_UNREACHED 0xFF
+/* Whether chunks hidden behind other chunks are culled */
+static hc_bool occlusionCulling;
+
+static int Occlusion_Connection(int a, int b) {
+	return a < b ? CHUNK_CONNECTION_BIT(a, b) : CHUNK_CONNECTION_BIT(b, a);
+}
+
+#define Occlusion_Visit(face, ccx, ccy, ccz) \
+if (!(dirs & (1 << ((face) ^ 1))) && (entry == FACE_COUNT || (info->connections & Occlusion_Connection(entry, face)))) {\
+	next = World_ChunkPack(ccx, ccy, ccz); nInfo = &mapChunks[next];\
+	dx = nInfo->centreX - chunkPos.x; dy = nInfo->centreY - chunkPos.y; dz = nInfo->centreZ - chunkPos.z;\
+	\
+	if (occEntry[next] == OCCLUSION_UNREACHED && (dx * dx + dy * dy + dz * dz) <= renderDistSqr &&\
+			FrustumCulling_SphereInFrustum(nInfo->centreX, nInfo->centreY, nInfo->centreZ, 14)) {\
+		occEntry[next] = (face) ^ 1; occDirs[next] = dirs | (1 << (face));\
+		occQueue[tail++] = next;\
+	}\
+}
+
+/* Flood fills outwards from the chunk the camera is in, only passing from one chunk to the next */
+/*  when the face the fill entered a chunk through can be seen from the face it leaves through. */
+/* The fill never travels back towards the camera, so each chunk is reached at most once. */
+/* Chunks that are never reached are hidden behind opaque blocks and so are marked as occluded. */
+static void CalcOcclusion(int renderDistSqr) {
+	struct ChunkInfo* info;
+	struct ChunkInfo* nInfo;
+	int cx, cy, cz, dx, dy, dz;
+	int i, index, next, entry, dirs;
+	int head = 0, tail = 0;
+	IVec3 pos;
+
+	occlusionDirty = false;
+	IVec3_Floor(&pos, &Camera.CurrentPos);
+
+	/* Chunks can be seen from around the outside of the map, so culling doesn't work there */
+	if (!occlusionCulling || !World_Contains(pos.x, pos.y, pos.z)) {
+		for (i = 0; i < sortedChunksCount; i++) sortedChunks[i]->occluded = false;
+		return;
+	}
+
+	/* The flood fill never goes past render distance, so only nearby chunks can be reached */
+	for (i = 0; i < sortedChunksCount; i++) {
+		occEntry[sortedChunks[i] - mapChunks] = OCCLUSION_UNREACHED;
+	}
+
+	cx = pos.x >> CHUNK_SHIFT; cy = pos.y >> CHUNK_SHIFT; cz = pos.z >> CHUNK_SHIFT;
+	index = World_ChunkPack(cx, cy, cz);
+	occEntry[index]  = FACE_COUNT;
+	occDirs[index]   = 0;
+	occQueue[tail++] = index;
+
+	while (head < tail) {
+		index = occQueue[head++];
+		info  = &mapChunks[index];
+		entry = occEntry[index];
+		dirs  = occDirs[index];
+		cx = info->centreX >> CHUNK_SHIFT; cy = info->centreY >> CHUNK_SHIFT; cz = info->centreZ >> CHUNK_SHIFT;
+
+		if (cx > 0)                 Occlusion_Visit(FACE_XMIN, cx - 1, cy, cz);
+		if (cx < World.ChunksX - 1) Occlusion_Visit(FACE_XMAX, cx + 1, cy, cz);
+		if (cz > 0)                 Occlusion_Visit(FACE_ZMIN, cx, cy, cz - 1);
+		if (cz < World.ChunksZ - 1) Occlusion_Visit(FACE_ZMAX, cx, cy, cz + 1);
+		if (cy > 0)                 Occlusion_Visit(FACE_YMIN, cx, cy - 1, cz);
+		if (cy < World.ChunksY - 1) Occlusion_Visit(FACE_YMAX, cx, cy + 1, cz);
+	}
+
+	for (i = 0; i < sortedChunksCount; i++) {
+		info = sortedChunks[i];
+		info->occluded = occEntry[info - mapChunks] == OCCLUSION_UNREACHED;
+	}
+}
+
+
 /*########################################################################################################################*
 *--------------------------------------------------Chunks updating/sorting------------------------------------------------*
 *#########################################################################################################################*/
@@ -530,6 +923,65 @@ static int renderDistSquared;
 /* Max distance from camera that chunks are built within */
 /* Chunks past this distance are automatically unloaded */
 static int buildDistSquared;
+/* Max distance from camera that chunks are kept in sortedChunks within */
+/* Chunks past this distance are not rendered, built, or (once unloaded) tracked at all */
+static int nearDistSquared;
+
+#ifdef HC_BUILD_THREADEDBUILDER
+/* Whether no more chunks can be queued to be built on worker threads this frame */
+static hc_bool jobsFull;
+
+/* Uploads the meshes of chunks that have finished building on worker threads */
+static void FinishChunks(int* chunkUpdates) {
+	struct ChunkInfo* info;
+	int dx, dy, dz, distSqr, connections;
+	jobsFull = false;
+
+	while (*chunkUpdates < chunksTarget && (info = Builder_FinishedChunk())) {
+		Game.ChunkUpdates++;
+		(*chunkUpdates)++;
+
+		connections = info->connections;
+		DeleteChunk(info);
+		Builder_UploadChunk();
+		AddChunkParts(info);
+		if (info->connections != connections) occlusionDirty = true;
+
+		dx = info->centreX - chunkPos.x; dy = info->centreY - chunkPos.y; dz = info->centreZ - chunkPos.z;
+		distSqr = dx * dx + dy * dy + dz * dz;
+
+		/* Camera may have moved far away while chunk was building, in which case */
+		/*  the chunk is no longer in sortedChunks and so would never be unloaded */
+		if (distSqr > nearDistSquared) {
+			DeleteChunk(info); info->visible = false; continue;
+		}
+
+		/* UpdateChunksStill only recalculates visibility of chunks built on the main thread */
+		info->visible = distSqr <= renderDistSquared && !info->occluded &&
+			FrustumCulling_SphereInFrustum(info->centreX, info->centreY, info->centreZ, 14); /* 14 ~ sqrt(3 * 8^2) */
+	}
+}
+#endif
+
+/* Builds the mesh for the given chunk, or queues it to be built on a worker thread */
+/* Returns whether the chunk's mesh was built on the main thread */
+static hc_bool RequestChunk(struct ChunkInfo* info, int* chunkUpdates) {
+	/* Chunk is retried once its lighting has finished being calculated */
+	int cx = info->centreX >> CHUNK_SHIFT, cy = info->centreY >> CHUNK_SHIFT, cz = info->centreZ >> CHUNK_SHIFT;
+	if (Lighting.IsChunkPending(cx, cy, cz)) return false;
+#ifdef HC_BUILD_THREADEDBUILDER
+	if (Builder_WorkerThreads) {
+		/* Existing mesh is still drawn until the new mesh finishes building */
+		if (!info->building && !jobsFull) jobsFull = !Builder_QueueChunk(info);
+		return false;
+	}
+#endif
+	if (*chunkUpdates >= chunksTarget) return false;
+
+	DeleteChunk(info);
+	BuildChunk(info, chunkUpdates);
+	return true;
+}
 
 static int AdjustDist(int dist) {
 	if (dist < CHUNK_SIZE) dist = CHUNK_SIZE;
@@ -540,6 +992,22 @@ static int AdjustDist(int dist) {
 static void CalcViewDists(void) {
 	buildDistSquared  = AdjustDist(Game_UserViewDistance);
 	renderDistSquared = AdjustDist(Game_ViewDistance);
+	/* Chunks are only unloaded once past build distance + 32 * 16 */
+	nearDistSquared   = max(renderDistSquared, buildDistSquared + 32 * 16 - 1);
+}
+
+/* Calculates whether each chunk group near the camera is inside the view frustum */
+static void CalcGroupVisibility(void) {
+	int gx, gy, gz;
+	for (gz = groupsMin.z; gz <= groupsMax.z; gz++) {
+		for (gy = groupsMin.y; gy <= groupsMax.y; gy++) {
+			for (gx = groupsMin.x; gx <= groupsMax.x; gx++) {
+				groupVisible[Group_Pack(gx, gy, gz)] = FrustumCulling_SphereInFrustum(
+					(gx << GROUP_SHIFT) + GROUP_SIZE / 2, (gy << GROUP_SHIFT) + GROUP_SIZE / 2,
+					(gz << GROUP_SHIFT) + GROUP_SIZE / 2, 111); /* 111 ~ sqrt(3 * 64^2) */
+			}
+		}
+	}
 }
 
 static int UpdateChunksAndVisibility(int* chunkUpdates) {
@@ -547,10 +1015,13 @@ static int UpdateChunksAndVisibility(int* chunkUpdates) {
 	int buildDistSqr  = buildDistSquared;
 
 	struct ChunkInfo* info;
-	int i, j = 0, distSqr;
+	int i, j = 0, distSqr, occluded = 0;
 	hc_bool noData;
 
-	for (i = 0; i < chunksCount; i++) {
+	CalcOcclusion(renderDistSqr);
+	CalcGroupVisibility();
+
+	for (i = 0; i < sortedChunksCount; i++) {
 		info = sortedChunks[i];
 		if (info->empty) continue;
 
@@ -563,15 +1034,17 @@ static int UpdateChunksAndVisibility(int* chunkUpdates) {
 		}
 		noData |= info->dirty;
 
-		if (noData && distSqr <= buildDistSqr && *chunkUpdates < chunksTarget) {
-			DeleteChunk(info);
-			BuildChunk(info, chunkUpdates);
+		if (noData && distSqr <= buildDistSqr) {
+			RequestChunk(info, chunkUpdates);
 		}
 
-		info->visible = distSqr <= renderDistSqr &&
+		info->visible = distSqr <= renderDistSqr && groupVisible[Group_OfChunk(info)] &&
 			FrustumCulling_SphereInFrustum(info->centreX, info->centreY, info->centreZ, 14); /* 14 ~ sqrt(3 * 8^2) */
+		if (info->visible && info->occluded) { info->visible = false; occluded++; }
 		if (info->visible && !info->empty) { renderChunks[j] = info; j++; }
 	}
+
+	MapRenderer_OccludedChunks = occluded;
 	return j;
 }
 
@@ -583,7 +1056,7 @@ static int UpdateChunksStill(int* chunkUpdates) {
 	int i, j = 0, distSqr;
 	hc_bool noData;
 
-	for (i = 0; i < chunksCount; i++) {
+	for (i = 0; i < sortedChunksCount; i++) {
 		info = sortedChunks[i];
 		if (info->empty) continue;
 
@@ -596,12 +1069,9 @@ static int UpdateChunksStill(int* chunkUpdates) {
 		}
 		noData |= info->dirty;
 
-		if (noData && distSqr <= buildDistSqr && *chunkUpdates < chunksTarget) {
-			DeleteChunk(info);
-			BuildChunk(info, chunkUpdates);
-
+		if (noData && distSqr <= buildDistSqr && RequestChunk(info, chunkUpdates)) {
 			/* only need to update the visibility of chunks in range. */
-			info->visible = distSqr <= renderDistSqr &&
+			info->visible = distSqr <= renderDistSqr && !info->occluded &&
 				FrustumCulling_SphereInFrustum(info->centreX, info->centreY, info->centreZ, 14); /* 14 ~ sqrt(3 * 8^2) */
 			if (info->visible && !info->empty) { renderChunks[j] = info; j++; }
 		} else if (info->visible) {
@@ -620,9 +1090,14 @@ static void UpdateChunks(float delta) {
 	chunksTarget += delta < CHUNK_TARGET_TIME ? 1 : -1; 
 	Math_Clamp(chunksTarget, 4, maxChunkUpdates);
 
+#ifdef HC_BUILD_THREADEDBUILDER
+	if (Builder_WorkerThreads) FinishChunks(&chunkUpdates);
+#endif
+
 	p = Entities.CurPlayer;
+	/* Visibility must also be recalculated when chunks that occlude other chunks are rebuilt */
 	samePos = Vec3_Equals(&Camera.CurrentPos, &lastCamPos)
-		&& p->Base.Pitch == lastPitch && p->Base.Yaw == lastYaw;
+		&& p->Base.Pitch == lastPitch && p->Base.Yaw == lastYaw && !occlusionDirty;
 
 	renderChunksCount = samePos ?
 		UpdateChunksStill(&chunkUpdates) :
@@ -654,10 +1129,85 @@ static void SortMapChunks(int left, int right) {
 	}
 }
 
-static void UpdateSortOrder(void) {
+/* Returns distance along an axis from the given coordinate to the closest edge of a chunk group */
+static int Group_AxisDist(int gMin, int coord) {
+	int gMax = gMin + GROUP_SIZE;
+	if (coord < gMin) return gMin - coord;
+	if (coord > gMax) return coord - gMax;
+	return 0;
+}
+
+/* Unloads chunks that are no longer near the camera, then replaces */
+/*  the chunks in sortedChunks with all the chunks that are now near the camera */
+static void CollectNearbyChunks(void) {
 	struct ChunkInfo* info;
+	int i, count = 0, range, dx, dy, dz;
+	int gx, gy, gz, cx, cy, cz;
+	int cxEnd, cyEnd, czEnd;
+	hc_uint32 distSqr;
+
+	for (i = 0; i < sortedChunksCount; i++) {
+		info = sortedChunks[i];
+		dx = info->centreX - chunkPos.x; dy = info->centreY - chunkPos.y; dz = info->centreZ - chunkPos.z;
+		if (dx * dx + dy * dy + dz * dz <= nearDistSquared) continue;
+
+		/* Auto unload far away chunks */
+		if (!info->noData) DeleteChunk(info);
+		info->visible = false;
+	}
+
+	range = (int)Math_SqrtF((float)nearDistSquared) + 1;
+	groupsMin.x = max(0, (chunkPos.x - range) >> GROUP_SHIFT); groupsMax.x = min(groupsX - 1, (chunkPos.x + range) >> GROUP_SHIFT);
+	groupsMin.y = max(0, (chunkPos.y - range) >> GROUP_SHIFT); groupsMax.y = min(groupsY - 1, (chunkPos.y + range) >> GROUP_SHIFT);
+	groupsMin.z = max(0, (chunkPos.z - range) >> GROUP_SHIFT); groupsMax.z = min(groupsZ - 1, (chunkPos.z + range) >> GROUP_SHIFT);
+
+	for (gz = groupsMin.z; gz <= groupsMax.z; gz++) {
+		for (gy = groupsMin.y; gy <= groupsMax.y; gy++) {
+			for (gx = groupsMin.x; gx <= groupsMax.x; gx++) {
+				dx = Group_AxisDist(gx << GROUP_SHIFT, chunkPos.x);
+				dy = Group_AxisDist(gy << GROUP_SHIFT, chunkPos.y);
+				dz = Group_AxisDist(gz << GROUP_SHIFT, chunkPos.z);
+				if (dx * dx + dy * dy + dz * dz > nearDistSquared) continue;
+
+				cxEnd = min(World.ChunksX, (gx + 1) * GROUP_CHUNKS);
+				cyEnd = min(World.ChunksY, (gy + 1) * GROUP_CHUNKS);
+				czEnd = min(World.ChunksZ, (gz + 1) * GROUP_CHUNKS);
+
+				for (cz = gz * GROUP_CHUNKS; cz < czEnd; cz++) {
+					for (cy = gy * GROUP_CHUNKS; cy < cyEnd; cy++) {
+						for (cx = gx * GROUP_CHUNKS; cx < cxEnd; cx++) {
+							info = &mapChunks[World_ChunkPack(cx, cy, cz)];
+							/* Calculate distance to chunk centre */
+							dx = info->centreX - chunkPos.x; dy = info->centreY - chunkPos.y; dz = info->centreZ - chunkPos.z;
+							distSqr = dx * dx + dy * dy + dz * dz;
+							if (distSqr > (hc_uint32)nearDistSquared) continue;
+
+							/* Consider these 3 chunks: */
+							/* |       X-1      |        X        |       X+1      | */
+							/* |################|########@########|################| */
+							/* Assume the player is standing at @, then DrawXMin/XMax is calculated as this */
+							/*    X-1: DrawXMin = false, DrawXMax = true  */
+							/*    X  : DrawXMin = true,  DrawXMax = true  */
+							/*    X+1: DrawXMin = true,  DrawXMax = false */
+
+							info->drawXMin = dx >= 0; info->drawXMax = dx <= 0;
+							info->drawZMin = dz >= 0; info->drawZMax = dz <= 0;
+							info->drawYMin = dy >= 0; info->drawYMax = dy <= 0;
+
+							sortedChunks[count] = info;
+							distances[count]    = distSqr;
+							count++;
+						}
+					}
+				}
+			}
+		}
+	}
+	sortedChunksCount = count;
+}
+
+static void UpdateSortOrder(void) {
 	IVec3 pos;
-	int i, dx, dy, dz;
 
 	/* pos is centre coordinate of chunk camera is in */
 	IVec3_Floor(&pos, &Camera.CurrentPos);
@@ -670,28 +1220,9 @@ static void UpdateSortOrder(void) {
 	chunkPos = pos;
 	if (!chunksCount) return;
 
-	for (i = 0; i < chunksCount; i++) {
-		info = sortedChunks[i];
-		/* Calculate distance to chunk centre */
-		dx = info->centreX - pos.x; dy = info->centreY - pos.y; dz = info->centreZ - pos.z;
-		distances[i] = dx * dx + dy * dy + dz * dz;
-
-		/* Consider these 3 chunks: */
-		/* |       X-1      |        X        |       X+1      | */
-		/* |################|########@########|################| */
-		/* Assume the player is standing at @, then DrawXMin/XMax is calculated as this */
-		/*    X-1: DrawXMin = false, DrawXMax = true  */
-		/*    X  : DrawXMin = true,  DrawXMax = true  */
-		/*    X+1: DrawXMin = true,  DrawXMax = false */
-
-		info->drawXMin = dx >= 0; info->drawXMax = dx <= 0;
-		info->drawZMin = dz >= 0; info->drawZMax = dz <= 0;
-		info->drawYMin = dy >= 0; info->drawYMax = dy <= 0;
-	}
-
-	SortMapChunks(0, chunksCount - 1);
+	CollectNearbyChunks();
+	SortMapChunks(0, sortedChunksCount - 1);
 	ResetPartFlags();
-	/*SimpleOcclusionCulling();*/
 }
 
 void MapRenderer_Update(float delta) {
@@ -757,6 +1288,8 @@ static void OnBlockDefinitionChanged(void* obj) {
 
 static void OnVisibilityChanged(void* obj) {
 	lastCamPos = Vec3_BigPos();
+	/* Chunks near the camera need to be recollected for the new view distance */
+	chunkPos   = IVec3_MaxValue();
 	CalcViewDists();
 }
 static void DeleteChunks_(void* obj) { DeleteChunks(); }
@@ -764,6 +1297,7 @@ static void Refresh_(void* obj)      { MapRenderer_Refresh(); }
 
 static void OnNewMap(void) {
 	Game.ChunkUpdates = 0;
+	MapRenderer_OccludedChunks = 0;
 	DeleteChunks();
 	ResetPartCounts();
 
@@ -799,6 +1333,7 @@ static void OnInit(void) {
 
 	/* This = 87 fixes map being invisible when no textures */
 	MapRenderer_1DUsedCount = 87; /* Atlas1D_UsedAtlasesCount(); */
+	occlusionCulling = Options_GetBool(OPT_OCCLUSION_CULLING, true);
 	chunkPos   = IVec3_MaxValue();
 	maxChunkUpdates = Options_GetInt(OPT_MAX_CHUNK_UPDATES, 4, 1024, 30);
 	CalcViewDists();
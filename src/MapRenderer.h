@@ -14,6 +14,10 @@ extern struct IGameComponent MapRenderer_Component;
 
 /* Max used 1D atlases. (i.e. Atlas1D_Index(maxTextureLoc) + 1) */
 extern int MapRenderer_1DUsedCount;
+/* Number of chunks in view that were last culled for being hidden behind other chunks */
+extern int MapRenderer_OccludedChunks;
+/* Number of draw calls used to render the world's chunks in the last frame */
+extern int MapRenderer_DrawCalls;
 
 /* Buffer for all chunk parts. There are (MapRenderer_ChunksCount * Atlas1D_Count) parts in the buffer,
 with parts for 'normal' buffer being in lower half. */
@@ -32,6 +36,11 @@ struct ChunkPartInfo {
 	hc_uint16 counts[FACE_COUNT]; /* Counts per face */
 };
 
+/* Bit in ChunkInfo.connections for whether faces a and b (where a < b) of a chunk */
+/*  are connected to each other through non-opaque blocks. (15 possible face pairs) */
+#define CHUNK_CONNECTION_BIT(a, b) (1 << ((a) * (11 - (a)) / 2 + (b) - (a) - 1))
+#define CHUNK_ALL_CONNECTED 0x7FFF
+
 /* Describes data necessary for rendering a chunk. */
 struct ChunkInfo {	
 	hc_uint16 centreX, centreY, centreZ; /* Centre coordinates of the chunk */
@@ -41,6 +50,8 @@ struct ChunkInfo {
 	hc_uint8 dirty : 1;   /* Whether chunk is pending being rebuilt */
 	hc_uint8 allAir : 1;  /* Whether chunk is completely air */
 	hc_uint8 noData : 1;  /* Whether the chunk is currently empty of data, but may have data if built */
+	hc_uint8 building : 1; /* Whether chunk mesh is currently being built on a worker thread */
+	hc_uint8 occluded : 1; /* Whether chunk is hidden from the camera behind other chunks */
 	hc_uint8 : 0;         /* pad to next byte*/
 
 	hc_uint8 drawXMin : 1;
@@ -50,17 +61,28 @@ struct ChunkInfo {
 	hc_uint8 drawYMin : 1;
 	hc_uint8 drawYMax : 1;
 	hc_uint8 : 0;          /* pad to next byte */
-#ifdef OCCLUSION
-	public hc_bool Visited = false, Occluded = false;
-	public byte OcclusionFlags, OccludedFlags, DistanceFlags;
-#endif
+	/* Which pairs of faces of the chunk can be seen through from each other (see CHUNK_CONNECTION_BIT) */
+	hc_uint16 connections;
 #ifndef HC_BUILD_GL11
 	GfxResourceID vb;
+#endif
+#ifdef HC_BUILD_TERRAINPOOL
+	int poolPage;  /* Index of the shared terrain vertex buffer the mesh is in */
+	int poolStart; /* First vertex of the mesh in that vertex buffer */
+	int poolCount; /* Number of vertices in the mesh, 0 if no mesh */
 #endif
 	struct ChunkPartInfo* normalParts;
 	struct ChunkPartInfo* translucentParts;
 };
 
+#ifdef HC_BUILD_TERRAINPOOL
+/* Allocates space for a mesh of the given number of vertices in the shared terrain vertex buffers, */
+/*  then returns temp memory for the vertices of the mesh to be written into */
+struct VertexTerrain* MapRenderer_LockMesh(struct ChunkInfo* info, int count);
+/* Uploads the vertices written into the temp memory returned by MapRenderer_LockMesh */
+void MapRenderer_UnlockMesh(struct ChunkInfo* info);
+#endif
+
 /* Renders the meshes of non-translucent blocks in visible chunks. */
 void MapRenderer_RenderNormal(float delta);
 /* Renders the meshes of translucent blocks in visible chunks. */
@@ -1329,52 +1329,10 @@ static void SaveLevelScreen_RemoveOverwrites(struct SaveLevelScreen* s) {
 	}
 }
 
-static hc_result DoSaveMap(const hc_string* path, struct GZipState* state) {
-	static const hc_string schematic = String_FromConst(".schematic");
-	static const hc_string mine      = String_FromConst(".mine");
-	struct Stream stream, compStream;
-	hc_result res;
-
-	res = Stream_CreateFile(&stream, path);
-	if (res) { Logger_SysWarn2(res, "creating", path); return res; }
-	GZip_MakeStream(&compStream, state, &stream);
-
-	if (String_CaselessEnds(path, &schematic)) {
-		res = Schematic_Save(&compStream);
-	} else if (String_CaselessEnds(path, &mine)) {
-		res = Dat_Save(&compStream);
-	} else {
-		res = Cw_Save(&compStream);
-	}
-
-	if (res) {
-		stream.Close(&stream);
-		Logger_SysWarn2(res, "encoding", path); return res;
-	}
-
-	if ((res = compStream.Close(&compStream))) {
-		stream.Close(&stream);
-		Logger_SysWarn2(res, "closing", path); return res;
-	}
-
-	res = stream.Close(&stream);
-	if (res) { Logger_SysWarn2(res, "closing", path); return res; }
-	return 0;
-}
-
 static hc_result SaveLevelScreen_SaveMap(const hc_string* path) {
-	struct GZipState* state;
-	hc_result res;
-
-	state = Mem_TryAlloc(1, sizeof(struct GZipState));
-	res   = ERR_OUT_OF_MEMORY;
-	if (!state) { Logger_SysWarn(res, "allocating temp memory"); return res; }
-
-	res = DoSaveMap(path, state);
-	Mem_Free(state);
+	hc_result res = Map_SaveTo(path);
 	if (res) return res;
 
-	World.LastSave = Game.Time;
 	Gui_ShowPauseMenu();
 	return 0;
 }
@@ -1385,7 +1343,6 @@ static void SaveLevelScreen_Save(void* screen, void* widget) {
 	hc_string path; char pathBuffer[FILENAME_SIZE];
 	hc_string file = s->input.base.text;
 	hc_filepath str;
-	hc_result res;
 
 	if (!file.length) {
 		TextWidget_SetConst(&s->desc, "&ePlease enter a filename", &s->textFont);
@@ -1404,21 +1361,20 @@ static void SaveLevelScreen_Save(void* screen, void* widget) {
 	}
 		
 	SaveLevelScreen_RemoveOverwrites(s);
-	if ((res = SaveLevelScreen_SaveMap(&path))) return;
-	Chat_Add1("&eSaved map to: %s", &path);
+	SaveLevelScreen_SaveMap(&path);
 }
 
 static void SaveLevelScreen_UploadCallback(const hc_string* path) {
-	hc_result res = SaveLevelScreen_SaveMap(path);
-	if (!res) Chat_Add1("&eSaved map to: %s", path);
+	/* Some platforms copy/upload the file as soon as this callback returns */
+	if (!SaveLevelScreen_SaveMap(path)) Map_WaitForSave();
 }
 
 static void SaveLevelScreen_File(void* screen, void* b) {
 	static const char* const titles[] = {
-		"ClassiCube map", "Minecraft schematic", "Minecraft classic map", NULL
+		"ClassiCube map", "Minecraft schematic", "Minecraft classic map", "Uncompressed map cache", NULL
 	};
 	static const char* const filters[] = {
-		".cw", ".schematic", ".mine", NULL
+		".cw", ".schematic", ".mine", ".hcraw", NULL
 	};
 	struct SaveLevelScreen* s = (struct SaveLevelScreen*)screen;
 	struct SaveFileDialogArgs args;
@@ -1816,7 +1772,7 @@ static void LoadLevelScreen_LoadEntries(struct ListScreen* s) {
 static void LoadLevelScreen_UploadCallback(const hc_string* path) { Map_LoadFrom(path); }
 static void LoadLevelScreen_ActionFunc(void* s, void* w) {
 	static const char* const filters[] = { 
-		".cw", ".dat", ".lvl", ".mine", ".fcm", ".mclevel", NULL 
+		".cw", ".dat", ".lvl", ".mine", ".fcm", ".mclevel", ".hcraw", NULL 
 	}; /* TODO not hardcode list */
 	static struct OpenFileDialogArgs args = {
 		"Classic map files", filters,
@@ -24,6 +24,476 @@ struct _ModelsData Models;
 #define AABB_Height(bb) ((bb)->Max.y - (bb)->Min.y)
 #define AABB_Length(bb) ((bb)->Max.z - (bb)->Min.z)
 
+#define Model_RotateX t = cosX * v.y + sinX * v.z; v.z = -sinX * v.y + cosX * v.z; v.y = t;
+#define Model_RotateY t = cosY * v.x - sinY * v.z; v.z =  sinY * v.x + cosY * v.z; v.x = t;
+#define Model_RotateZ t = cosZ * v.x + sinZ * v.y; v.y = -sinZ * v.x + cosZ * v.y; v.x = t;
+/* Rotates v around the part's rotation origin, in the current rotation order */
+#define Model_RotateLocal \
+if (Models.Rotation == ROTATE_ORDER_ZYX) {\
+	Model_RotateZ\
+	Model_RotateY\
+	Model_RotateX\
+} else if (Models.Rotation == ROTATE_ORDER_XZY) {\
+	Model_RotateX\
+	Model_RotateZ\
+	Model_RotateY\
+} else if (Models.Rotation == ROTATE_ORDER_YZX) {\
+	Model_RotateY\
+	Model_RotateZ\
+	Model_RotateX\
+} else if (Models.Rotation == ROTATE_ORDER_XYZ) {\
+	Model_RotateX\
+	Model_RotateY\
+	Model_RotateZ\
+}
+/* Rotates v by the head's offset from the body rotation (inlined RotY) */
+#define Model_RotateHead t = Models.cosHead * v.x - Models.sinHead * v.z; v.z = Models.sinHead * v.x + Models.cosHead * v.z; v.x = t;
+
+
+#ifdef HC_BUILD_MODELINSTANCING
+/*########################################################################################################################*
+*----------------------------------------------------Model instancing-----------------------------------------------------*
+*#########################################################################################################################*/
+/* When many entities share the same model and skin, their parts are drawn as instances of static vertex buffers, */
+/*  instead of every part being transformed on the CPU and uploaded again for every entity each frame */
+#define INSTANCE_MIN_SHARED 8
+#define MAX_MODEL_MESHES (16 + MAX_CUSTOM_MODELS)
+
+/* Static vertex buffer containing the parts of a model that have been instanced so far */
+struct ModelMesh {
+	struct ModelVertex* vertices; /* Shared between models (e.g. humanoid and sit) */
+	GfxResourceID vb;
+	int partsCount, verticesCount;
+	hc_bool dirty; /* Whether parts have been added since vb was created */
+	struct MeshPart { hc_uint16 offset, count, start; } parts[MAX_CUSTOM_MODEL_PARTS];
+};
+static struct ModelMesh meshes[MAX_MODEL_MESHES];
+static int meshesCount;
+
+/* Part of the entity currently being drawn that will be drawn as an instance */
+struct InstancePart { int index, count; struct ModelMesh* mesh; int start; struct ModelInstance data; };
+/* Instances of a range of a mesh, all drawn with the same texture and alpha testing state */
+struct InstanceBatch { struct ModelMesh* mesh; int start, count; GfxResourceID tex; hc_bool alphaTest; int first, instances; };
+struct InstanceDraw  { int batch; struct ModelInstance data; };
+
+static hc_bool inst_enabled, inst_active, inst_entity, inst_locked;
+static struct Matrix inst_transform;
+static PackedCol inst_cols[FACE_COUNT];
+static GfxResourceID inst_tex;
+
+static struct InstancePart inst_parts[MAX_CUSTOM_MODEL_PARTS];
+static int inst_partsCount, inst_lockCount, inst_fallbackEnd;
+static struct VertexTextured* inst_vertices;
+static int inst_verticesCapacity;
+
+static struct InstanceBatch* inst_batches;
+static int inst_batchesCount, inst_batchesCapacity, inst_lastBatch;
+static struct InstanceDraw* inst_draws;
+static struct ModelInstance* inst_sorted;
+static int inst_drawsCount, inst_drawsCapacity;
+
+static struct { struct ModelVertex* vertices; GfxResourceID tex; int count; } inst_skins[ENTITIES_MAX_COUNT];
+static int inst_skinsCount;
+
+static struct ModelMesh* ModelMesh_Get(struct ModelVertex* vertices) {
+	struct ModelMesh* mesh;
+	int i;
+	for (i = 0; i < meshesCount; i++) 
+	{
+		if (meshes[i].vertices == vertices) return &meshes[i];
+	}
+	if (meshesCount == MAX_MODEL_MESHES) return NULL;
+
+	mesh = &meshes[meshesCount++];
+	Mem_Set(mesh, 0, sizeof(struct ModelMesh));
+	mesh->vertices = vertices;
+	return mesh;
+}
+
+/* Returns the index of the part's vertices in the mesh, adding the part if needed */
+static int ModelMesh_GetPart(struct ModelMesh* mesh, struct ModelPart* part) {
+	struct MeshPart* p;
+	int i;
+	for (i = 0; i < mesh->partsCount; i++) 
+	{
+		p = &mesh->parts[i];
+		if (p->offset == part->offset && p->count == part->count) return p->start;
+	}
+	if (mesh->partsCount == MAX_CUSTOM_MODEL_PARTS) return -1;
+
+	p = &mesh->parts[mesh->partsCount++];
+	p->offset = part->offset;
+	p->count  = part->count;
+	p->start  = mesh->verticesCount;
+
+	mesh->verticesCount += part->count;
+	mesh->dirty = true;
+	return p->start;
+}
+
+/* Recreates the mesh's vertex buffer from the model's raw vertices */
+static void ModelMesh_Build(struct ModelMesh* mesh) {
+	static const float shades[FACE_COUNT] = { 
+		1.0f, PACKEDCOL_SHADE_YMIN, PACKEDCOL_SHADE_Z, PACKEDCOL_SHADE_Z, PACKEDCOL_SHADE_X, PACKEDCOL_SHADE_X 
+	};
+	struct VertexTextured* dst;
+	struct ModelVertex* src;
+	struct ModelVertex v;
+	int i, j;
+
+	Gfx_DeleteVb(&mesh->vb);
+	mesh->vb    = Gfx_CreateVb(VERTEX_FORMAT_TEXTURED, mesh->verticesCount);
+	dst         = (struct VertexTextured*)Gfx_LockVb(mesh->vb, VERTEX_FORMAT_TEXTURED, mesh->verticesCount);
+	mesh->dirty = false;
+
+	/* Colours are the face shading and U/V are in texels, see Model_DrawPart */
+	/* The entity's colour and skin's U/V scale are then applied per instance */
+	for (i = 0; i < mesh->partsCount; i++) 
+	{
+		src = &mesh->vertices[mesh->parts[i].offset];
+
+		for (j = 0; j < mesh->parts[i].count; j++, dst++) 
+		{
+			v = src[j];
+			dst->x = v.x; dst->y = v.y; dst->z = v.z;
+			dst->Col = PackedCol_Scale(PACKEDCOL_WHITE, shades[j >> 2]);
+
+			dst->U = (v.u & UV_POS_MASK) - (v.u >> UV_MAX_SHIFT) * 0.01f;
+			dst->V = (v.v & UV_POS_MASK) - (v.v >> UV_MAX_SHIFT) * 0.01f;
+		}
+	}
+	Gfx_UnlockVb(mesh->vb);
+}
+
+#ifdef CUSTOM_MODELS
+static void ModelMesh_Remove(struct ModelVertex* vertices) {
+	int i;
+	for (i = 0; i < meshesCount; i++) 
+	{
+		if (meshes[i].vertices != vertices) continue;
+
+		Gfx_DeleteVb(&meshes[i].vb);
+		meshes[i] = meshes[--meshesCount];
+		return;
+	}
+}
+#endif
+
+static GfxResourceID Instance_GetSkin(struct Model* model, struct Entity* e) {
+	GfxResourceID tex = model->usesHumanSkin ? e->TextureId : e->MobTextureId;
+	if (tex || !model->defaultTex) return tex;
+	return model->defaultTex->texID;
+}
+
+static void Instance_CountSkins(void) {
+	struct ModelVertex* vertices;
+	struct Entity* e;
+	GfxResourceID tex;
+	int i, j;
+	inst_skinsCount = 0;
+
+	for (i = 0; i < ENTITIES_MAX_COUNT; i++) 
+	{
+		e = Entities.List[i];
+		if (!e || !e->Model || !e->Model->vertices) continue;
+
+		vertices = e->Model->vertices;
+		tex      = Instance_GetSkin(e->Model, e);
+
+		for (j = 0; j < inst_skinsCount; j++) 
+		{
+			if (inst_skins[j].vertices == vertices && inst_skins[j].tex == tex) break;
+		}
+		if (j == inst_skinsCount) {
+			inst_skins[j].vertices = vertices;
+			inst_skins[j].tex      = tex;
+			inst_skins[j].count    = 0;
+			inst_skinsCount++;
+		}
+		inst_skins[j].count++;
+	}
+}
+
+static hc_bool Instance_IsShared(struct Model* model, struct Entity* e) {
+	GfxResourceID tex = Instance_GetSkin(model, e);
+	int i;
+
+	for (i = 0; i < inst_skinsCount; i++) 
+	{
+		if (inst_skins[i].vertices != model->vertices || inst_skins[i].tex != tex) continue;
+		return inst_skins[i].count >= INSTANCE_MIN_SHARED;
+	}
+	return false;
+}
+
+static void Instance_BeginEntity(struct Model* model, struct Entity* e, const struct Matrix* transform) {
+	inst_partsCount = 0;
+	/* Shading of instanced parts is baked into the mesh */
+	inst_entity = inst_active && !e->NoShade && model->vertices && Instance_IsShared(model, e);
+	if (!inst_entity) return;
+
+	inst_transform = *transform;
+	Mem_Copy(inst_cols, Models.Cols, sizeof(inst_cols));
+}
+
+static void Instance_EndEntity(void) {
+	inst_entity     = false;
+	inst_partsCount = 0;
+}
+
+/* Parts are transformed into a staging buffer instead, as instanced parts don't need to be uploaded */
+static struct VertexTextured* Instance_Lock(int verticesCount) {
+	if (verticesCount > inst_verticesCapacity) {
+		inst_vertices = (struct VertexTextured*)Mem_Realloc(inst_vertices, verticesCount, 
+									sizeof(struct VertexTextured), "model staging vertices");
+		inst_verticesCapacity = verticesCount;
+	}
+
+	inst_locked    = true;
+	inst_lockCount = verticesCount;
+	return inst_vertices;
+}
+
+static void Instance_Unlock(void) {
+	int i, count = inst_lockCount;
+	inst_locked = false;
+
+	/* Only upload vertices up to the end of the last part that wasn't instanced */
+	if (inst_partsCount) {
+		count = Models.Active->index;
+		for (i = inst_partsCount - 1; i >= 0 && inst_parts[i].index + inst_parts[i].count == count; i--) 
+		{
+			count = inst_parts[i].index;
+		}
+	}
+	inst_fallbackEnd = count;
+	if (!count) return;
+
+	if (!Models.Vb)
+		Models.Vb = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, Models.MaxVertices);
+	Gfx_SetDynamicVbData(Models.Vb, inst_vertices, count);
+}
+
+/* Returns whether the part will be drawn as an instance, given the positions */
+/*  that the part's transformation maps (0,0,0), (1,0,0), (0,1,0) and (0,0,1) to */
+static hc_bool Instance_AddPart(struct ModelPart* part, Vec3* points) {
+	struct Model* model = Models.Active;
+	struct ModelInstance* data;
+	struct InstancePart* p;
+	struct ModelMesh* mesh;
+	int i, start;
+
+	if (inst_partsCount == MAX_CUSTOM_MODEL_PARTS || part->count > MODEL_BOX_VERTICES) return false;
+	/* e.g. fullbright custom model parts */
+	if (!Mem_Equal(inst_cols, Models.Cols, sizeof(inst_cols))) return false;
+
+	if (!(mesh = ModelMesh_Get(model->vertices)))  return false;
+	if ((start = ModelMesh_GetPart(mesh, part)) < 0) return false;
+
+	for (i = 0; i < 4; i++) 
+	{
+		Vec3_Transform(&points[i], &points[i], &inst_transform);
+	}
+	p = &inst_parts[inst_partsCount++];
+	p->index = model->index;
+	p->count = part->count;
+	p->mesh  = mesh;
+	p->start = start;
+
+	data = &p->data;
+	data->row0[0] = points[1].x - points[0].x; data->row0[1] = points[2].x - points[0].x; 
+	data->row0[2] = points[3].x - points[0].x; data->row0[3] = points[0].x;
+	data->row1[0] = points[1].y - points[0].y; data->row1[1] = points[2].y - points[0].y; 
+	data->row1[2] = points[3].y - points[0].y; data->row1[3] = points[0].y;
+	data->row2[0] = points[1].z - points[0].z; data->row2[1] = points[2].z - points[0].z; 
+	data->row2[2] = points[3].z - points[0].z; data->row2[3] = points[0].z;
+
+	data->Col    = Models.Cols[0];
+	data->uScale = Models.uScale;
+	data->vScale = Models.vScale;
+	model->index += part->count;
+	return true;
+}
+
+static hc_bool Instance_AddRotated(struct ModelPart* part, float cosX, float sinX, float cosY, float sinY, 
+									float cosZ, float sinZ, hc_bool head) {
+	float t, x = part->rotX, y = part->rotY, z = part->rotZ;
+	struct ModelVertex v;
+	Vec3 points[4];
+	int i;
+
+	/* Same transformation as Model_DrawRotate */
+	for (i = 0; i < 4; i++) 
+	{
+		v.x = (i == 1) - x; v.y = (i == 2) - y; v.z = (i == 3) - z;
+		Model_RotateLocal
+		if (head) { Model_RotateHead }
+
+		points[i].x = v.x + x; points[i].y = v.y + y; points[i].z = v.z + z;
+	}
+	return Instance_AddPart(part, points);
+}
+
+static hc_bool Instance_AddUnrotated(struct ModelPart* part) {
+	Vec3 points[4] = { { 0,0,0 }, { 1,0,0 }, { 0,1,0 }, { 0,0,1 } };
+	return Instance_AddPart(part, points);
+}
+
+static void Instance_Queue(struct InstancePart* p) {
+	hc_bool alphaTest = Gfx_GetAlphaTest();
+	struct InstanceBatch* b;
+	struct InstanceDraw* draw;
+	int i = inst_lastBatch;
+
+	if (i >= inst_batchesCount || inst_batches[i].mesh != p->mesh || inst_batches[i].start != p->start 
+		|| inst_batches[i].tex != inst_tex || inst_batches[i].alphaTest != alphaTest) {
+
+		for (i = 0; i < inst_batchesCount; i++) 
+		{
+			b = &inst_batches[i];
+			if (b->mesh == p->mesh && b->start == p->start && b->tex == inst_tex && b->alphaTest == alphaTest) break;
+		}
+	}
+
+	if (i == inst_batchesCount) {
+		if (i == inst_batchesCapacity) {
+			inst_batchesCapacity = max(32, inst_batchesCapacity * 2);
+			inst_batches = (struct InstanceBatch*)Mem_Realloc(inst_batches, inst_batchesCapacity, 
+										sizeof(struct InstanceBatch), "model instance batches");
+		}
+		b = &inst_batches[inst_batchesCount++];
+		b->mesh  = p->mesh;  b->start     = p->start;
+		b->count = p->count; b->alphaTest = alphaTest;
+		b->tex   = inst_tex; b->instances = 0;
+	}
+	inst_lastBatch = i;
+	inst_batches[i].instances++;
+
+	if (inst_drawsCount == inst_drawsCapacity) {
+		inst_drawsCapacity = max(256, inst_drawsCapacity * 2);
+		inst_draws  = (struct InstanceDraw*)Mem_Realloc(inst_draws, inst_drawsCapacity, 
+								sizeof(struct InstanceDraw),  "model instance draws");
+		inst_sorted = (struct ModelInstance*)Mem_Realloc(inst_sorted, inst_drawsCapacity, 
+								sizeof(struct ModelInstance), "model instances");
+	}
+	draw = &inst_draws[inst_drawsCount++];
+	draw->batch = i;
+	draw->data  = p->data;
+}
+
+/* Draws the non instanced vertices in the given range, and queues the instanced parts in it */
+static void Instance_DrawVb(int verticesCount, int startVertex) {
+	int i, cur = startVertex, end = startVertex + verticesCount;
+	struct InstancePart* p;
+
+	for (i = 0; i < inst_partsCount; i++) 
+	{
+		p = &inst_parts[i];
+		if (p->index < cur || p->index + p->count > end) continue;
+
+		if (p->index > cur) Gfx_DrawVb_IndexedTris_Range(p->index - cur, cur);
+		Instance_Queue(p);
+		cur = p->index + p->count;
+	}
+
+	end = min(end, inst_fallbackEnd);
+	if (cur < end) Gfx_DrawVb_IndexedTris_Range(end - cur, cur);
+}
+
+static void Instance_Flush(void) {
+	struct InstanceBatch* b;
+	struct InstanceDraw* draw;
+	hc_bool alphaTest;
+	int i, first = 0;
+	if (!inst_drawsCount) return;
+
+	for (i = 0; i < meshesCount; i++) 
+	{
+		if (meshes[i].dirty) ModelMesh_Build(&meshes[i]);
+	}
+
+	/* Group the instances of each batch together */
+	for (i = 0; i < inst_batchesCount; i++) 
+	{
+		b = &inst_batches[i];
+		b->first = first; first += b->instances;
+		b->instances = 0;
+	}
+	for (i = 0; i < inst_drawsCount; i++) 
+	{
+		draw = &inst_draws[i];
+		b    = &inst_batches[draw->batch];
+		inst_sorted[b->first + b->instances++] = draw->data;
+	}
+
+	alphaTest = Gfx_GetAlphaTest();
+	for (i = 0; i < inst_batchesCount; i++) 
+	{
+		b = &inst_batches[i];
+		Gfx_BindTexture(b->tex);
+		Gfx_SetAlphaTest(b->alphaTest);
+		Gfx_DrawModelInstances(b->mesh->vb, b->count, b->start, &inst_sorted[b->first], b->instances);
+	}
+	Gfx_SetAlphaTest(alphaTest);
+
+	inst_drawsCount   = 0;
+	inst_batchesCount = 0;
+}
+
+void Model_BeginInstancing(void) {
+	inst_active = inst_enabled && Gfx.SupportsInstancing;
+	if (inst_active) Instance_CountSkins();
+}
+
+void Model_EndInstancing(void) {
+	Instance_Flush();
+	inst_active = false;
+}
+
+static void Instance_ContextLost(void) {
+	int i;
+	for (i = 0; i < meshesCount; i++) 
+	{
+		Gfx_DeleteVb(&meshes[i].vb);
+		meshes[i].dirty = true;
+	}
+	inst_drawsCount   = 0;
+	inst_batchesCount = 0;
+}
+
+static void Instance_Free(void) {
+	Instance_ContextLost();
+	meshesCount = 0;
+
+	Mem_Free(inst_vertices); inst_vertices = NULL;
+	Mem_Free(inst_batches);  inst_batches  = NULL;
+	Mem_Free(inst_draws);    inst_draws    = NULL;
+	Mem_Free(inst_sorted);   inst_sorted   = NULL;
+
+	inst_verticesCapacity = 0;
+	inst_batchesCapacity  = 0;
+	inst_drawsCapacity    = 0;
+}
+
+static void Model_BindTexture(GfxResourceID tex) {
+	inst_tex = tex;
+	Gfx_BindTexture(tex);
+}
+
+static void Model_DrawVb_Range(int verticesCount, int startVertex) {
+	if (inst_partsCount) {
+		Instance_DrawVb(verticesCount, startVertex);
+	} else {
+		Gfx_DrawVb_IndexedTris_Range(verticesCount, startVertex);
+	}
+}
+#define Model_DrawVb(verticesCount) Model_DrawVb_Range(verticesCount, 0)
+#else
+#define Model_BindTexture  Gfx_BindTexture
+#define Model_DrawVb_Range Gfx_DrawVb_IndexedTris_Range
+#define Model_DrawVb       Gfx_DrawVb_IndexedTris
+#endif
+
 
 /*########################################################################################################################*
 *------------------------------------------------------------Model--------------------------------------------------------*
@@ -113,7 +583,13 @@ void Model_Render(struct Model* model, struct Entity* e) {
 	Matrix_Mul(&m, &transform, &Gfx.View);
 
 	Gfx_LoadMatrix(MATRIX_VIEW, &m);
+#ifdef HC_BUILD_MODELINSTANCING
+	Instance_BeginEntity(model, e, &transform);
 	model->Draw(e);
+	Instance_EndEntity();
+#else
+	model->Draw(e);
+#endif
 	Gfx_LoadMatrix(MATRIX_VIEW, &Gfx.View);
 }
 
@@ -164,7 +640,7 @@ void Model_ApplyTexture(struct Entity* e) {
 		Models.skinType = data->skinType;
 	}
 
-	Gfx_BindTexture(tex);
+	Model_BindTexture(tex);
 	_64x64 = Models.skinType != SKIN_64x32;
 
 	Models.uScale = e->uScale * 0.015625f;
@@ -200,10 +676,19 @@ void Model_LockVB(struct Entity* entity, int verticesCount) {
 #endif
 
 	real_vertices   = Models.Vertices;
+#ifdef HC_BUILD_MODELINSTANCING
+	inst_partsCount = 0;
+	if (inst_entity) { Models.Vertices = Instance_Lock(verticesCount); return; }
+#endif
 	Models.Vertices = Gfx_LockDynamicVb(modelVB, VERTEX_FORMAT_TEXTURED, verticesCount);
 }
 
 void Model_UnlockVB(void) {
+#ifdef HC_BUILD_MODELINSTANCING
+	if (inst_locked) {
+		Instance_Unlock();
+	} else
+#endif
 	Gfx_UnlockDynamicVb(modelVB);
 	Models.Vertices = real_vertices;
 }
@@ -217,6 +702,9 @@ void Model_DrawPart(struct ModelPart* part) {
 	struct ModelVertex v;
 	int i, count = part->count;
 
+#ifdef HC_BUILD_MODELINSTANCING
+	if (inst_locked && Instance_AddUnrotated(part)) return;
+#endif
 	for (i = 0; i < count; i++) {
 		v = *src;
 		dst->x = v.x; dst->y = v.y; dst->z = v.z;
@@ -229,10 +717,6 @@ void Model_DrawPart(struct ModelPart* part) {
 	model->index += count;
 }
 
-#define Model_RotateX t = cosX * v.y + sinX * v.z; v.z = -sinX * v.y + cosX * v.z; v.y = t;
-#define Model_RotateY t = cosY * v.x - sinY * v.z; v.z =  sinY * v.x + cosY * v.z; v.x = t;
-#define Model_RotateZ t = cosZ * v.x + sinZ * v.y; v.y = -sinZ * v.x + cosZ * v.y; v.x = t;
-
 void Model_DrawRotate(float angleX, float angleY, float angleZ, struct ModelPart* part, hc_bool head) {
 	struct Model* model        = Models.Active;
 	struct ModelVertex* src    = &model->vertices[part->offset];
@@ -246,33 +730,18 @@ void Model_DrawRotate(float angleX, float angleY, float angleZ, struct ModelPart
 	struct ModelVertex v;
 	int i, count = part->count;
 
+#ifdef HC_BUILD_MODELINSTANCING
+	if (inst_locked && Instance_AddRotated(part, cosX, sinX, cosY, sinY, cosZ, sinZ, head)) return;
+#endif
+
 	for (i = 0; i < count; i++) {
 		v = *src;
 		v.x -= x; v.y -= y; v.z -= z;
 
 		/* Rotate locally */
-		if (Models.Rotation == ROTATE_ORDER_ZYX) {
-			Model_RotateZ
-			Model_RotateY
-			Model_RotateX
-		} else if (Models.Rotation == ROTATE_ORDER_XZY) {
-			Model_RotateX
-			Model_RotateZ
-			Model_RotateY
-		} else if (Models.Rotation == ROTATE_ORDER_YZX) {
-			Model_RotateY
-			Model_RotateZ
-			Model_RotateX
-		} else if (Models.Rotation == ROTATE_ORDER_XYZ) {
-			Model_RotateX
-			Model_RotateY
-			Model_RotateZ
-		}
-
-		/* Rotate globally (inlined RotY) */
-		if (head) {
-			t = Models.cosHead * v.x - Models.sinHead * v.z; v.z = Models.sinHead * v.x + Models.cosHead * v.z; v.x = t;
-		}
+		Model_RotateLocal
+		/* Rotate globally */
+		if (head) { Model_RotateHead }
 		dst->x = v.x + x; dst->y = v.y + y; dst->z = v.z + z;
 		dst->Col = Models.Cols[i >> 2];
 
@@ -782,11 +1251,18 @@ static void CustomModel_DrawPart(
 		}
 	}
 
+#ifdef HC_BUILD_MODELINSTANCING
+	/* Vertices are only temporarily changed, so can't be instanced */
+	if (modifiedVertices) inst_locked = false;
+#endif
 	if (rotX || rotY || rotZ || head) {
 		Model_DrawRotate(rotX, rotY, rotZ, &part->modelPart, head);
 	} else {
 		Model_DrawPart(&part->modelPart);
 	}
+#ifdef HC_BUILD_MODELINSTANCING
+	if (modifiedVertices) inst_locked = inst_entity;
+#endif
 
 	if (modifiedVertices) {
 		Mem_Copy(
@@ -819,7 +1295,7 @@ static void CustomModel_Draw(struct Entity* e) {
 	}
 
 	Model_UnlockVB();
-	Gfx_DrawVb_IndexedTris(cm->numParts * MODEL_BOX_VERTICES);
+	Model_DrawVb(cm->numParts * MODEL_BOX_VERTICES);
 	Models.Rotation = ROTATE_ORDER_ZYX;
 }
 
@@ -901,6 +1377,9 @@ void CustomModel_Undefine(struct CustomModel* cm) {
 	if (!cm->defined) return;
 	if (cm->registered) Model_Unregister((struct Model*)cm);
 
+#ifdef HC_BUILD_MODELINSTANCING
+	ModelMesh_Remove(cm->model.vertices);
+#endif
 	Mem_Free(cm->model.vertices);
 	Mem_Set(cm, 0, sizeof(struct CustomModel));
 }
@@ -944,19 +1423,26 @@ static void HumanModel_DrawCore(struct Entity* e, struct ModelSet* model, hc_boo
 	type = Models.skinType;
 	set  = &model->limbs[type & 0x3];
 	num  = HUMAN_BASE_VERTICES + (type == SKIN_64x32 ? HUMAN_HAT32_VERTICES : HUMAN_HAT64_VERTICES);
+	/* Skin layers are too small to notice on distant models */
+	if (Models.Lod != MODEL_LOD_FULL) num = HUMAN_BASE_VERTICES;
 	Model_LockVB(e, num);
 
 	Model_DrawRotate(-e->Pitch * MATH_DEG2RAD, 0, 0, &model->head, true);
 	Model_DrawPart(&model->torso);
-	Model_DrawRotate(e->Anim.LeftLegX,  0, e->Anim.LeftLegZ,  &set->leftLeg,  false);
-	Model_DrawRotate(e->Anim.RightLegX, 0, e->Anim.RightLegZ, &set->rightLeg, false);
+	if (Models.Lod == MODEL_LOD_STILL) {
+		Model_DrawPart(&set->leftLeg);
+		Model_DrawPart(&set->rightLeg);
+	} else {
+		Model_DrawRotate(e->Anim.LeftLegX,  0, e->Anim.LeftLegZ,  &set->leftLeg,  false);
+		Model_DrawRotate(e->Anim.RightLegX, 0, e->Anim.RightLegZ, &set->rightLeg, false);
+	}
 
 	Models.Rotation = ROTATE_ORDER_XZY;
 	Model_DrawRotate(e->Anim.LeftArmX,  0, e->Anim.LeftArmZ,  &set->leftArm,  false);
 	Model_DrawRotate(e->Anim.RightArmX, 0, e->Anim.RightArmZ, &set->rightArm, false);
 	Models.Rotation = ROTATE_ORDER_ZYX;
 
-	if (type != SKIN_64x32) {
+	if (type != SKIN_64x32 && Models.Lod == MODEL_LOD_FULL) {
 		Model_DrawPart(&model->torsoLayer);
 		Model_DrawRotate(e->Anim.LeftLegX,  0, e->Anim.LeftLegZ,  &set->leftLegLayer,  false);
 		Model_DrawRotate(e->Anim.RightLegX, 0, e->Anim.RightLegZ, &set->rightLegLayer, false);
@@ -966,17 +1452,17 @@ static void HumanModel_DrawCore(struct Entity* e, struct ModelSet* model, hc_boo
 		Model_DrawRotate(e->Anim.RightArmX, 0, e->Anim.RightArmZ, &set->rightArmLayer, false);
 		Models.Rotation = ROTATE_ORDER_ZYX;
 	}
-	Model_DrawRotate(-e->Pitch * MATH_DEG2RAD, 0, 0, &model->hat, true);
+	if (Models.Lod == MODEL_LOD_FULL) Model_DrawRotate(-e->Pitch * MATH_DEG2RAD, 0, 0, &model->hat, true);
 
 	Model_UnlockVB();
 	if (opaqueBody) {
 		/* human model draws the body opaque so players can't have invisible skins */
 		Gfx_SetAlphaTest(false);
-		Gfx_DrawVb_IndexedTris_Range(HUMAN_BASE_VERTICES, 0);
+		Model_DrawVb_Range(HUMAN_BASE_VERTICES, 0);
 		Gfx_SetAlphaTest(true);
-		Gfx_DrawVb_IndexedTris_Range(num - HUMAN_BASE_VERTICES, HUMAN_BASE_VERTICES);
+		if (num > HUMAN_BASE_VERTICES) Model_DrawVb_Range(num - HUMAN_BASE_VERTICES, HUMAN_BASE_VERTICES);
 	} else {
-		Gfx_DrawVb_IndexedTris(num);
+		Model_DrawVb(num);
 	}
 }
 
@@ -1358,7 +1844,7 @@ static void HeadModel_Draw(struct Entity* e) {
 	Model_DrawRotate(-e->Pitch * MATH_DEG2RAD, 0, 0, &part, true);
 
 	Model_UnlockVB();
-	Gfx_DrawVb_IndexedTris(HEAD_MAX_VERTICES);
+	Model_DrawVb(HEAD_MAX_VERTICES);
 }
 
 static float HeadModel_GetEyeY(struct Entity* e)  { return 6.0f/16.0f; }
@@ -1472,7 +1958,7 @@ static void ChickenModel_Draw(struct Entity* e) {
 	Model_DrawRotate(e->Anim.RightLegX, 0, 0, &chicken_rightLeg, false);
 
 	Model_UnlockVB();
-	Gfx_DrawVb_IndexedTris(CHICKEN_MAX_VERTICES);
+	Model_DrawVb(CHICKEN_MAX_VERTICES);
 }
 
 static float ChickenModel_GetNameY(struct Entity* e) { return 1.0125f; }
@@ -1554,7 +2040,7 @@ static void CreeperModel_Draw(struct Entity* e) {
 	Model_DrawRotate(e->Anim.LeftLegX,  0, 0, &creeper_rightLegBack,  false);
 
 	Model_UnlockVB();
-	Gfx_DrawVb_IndexedTris(CREEPER_MAX_VERTICES);
+	Model_DrawVb(CREEPER_MAX_VERTICES);
 }
 
 static float CreeperModel_GetNameY(struct Entity* e) { return 1.7f; }
@@ -1637,7 +2123,7 @@ static void PigModel_Draw(struct Entity* e) {
 	Model_DrawRotate(e->Anim.LeftLegX,  0, 0, &pig_rightLegBack,  false);
 
 	Model_UnlockVB();
-	Gfx_DrawVb_IndexedTris(PIG_MAX_VERTICES);
+	Model_DrawVb(PIG_MAX_VERTICES);
 }
 
 static float PigModel_GetNameY(struct Entity* e) { return 1.075f; }
@@ -1771,7 +2257,7 @@ static void FurlessModel_Draw(struct Entity* e) {
 	SheepModel_DrawBody(e);
 
 	Model_UnlockVB();
-	Gfx_DrawVb_IndexedTris(SHEEP_BODY_VERTICES);
+	Model_DrawVb(SHEEP_BODY_VERTICES);
 }
 
 static void SheepModel_Draw(struct Entity* e) {
@@ -1787,9 +2273,9 @@ static void SheepModel_Draw(struct Entity* e) {
 	Model_DrawRotate(e->Anim.LeftLegX,  0, 0, &fur_rightLegBack,  false);
 
 	Model_UnlockVB();
-	Gfx_DrawVb_IndexedTris(SHEEP_BODY_VERTICES);
-	Gfx_BindTexture(fur_tex.texID);
-	Gfx_DrawVb_IndexedTris_Range(SHEEP_FUR_VERTICES, SHEEP_BODY_VERTICES);
+	Model_DrawVb(SHEEP_BODY_VERTICES);
+	Model_BindTexture(fur_tex.texID);
+	Model_DrawVb_Range(SHEEP_FUR_VERTICES, SHEEP_BODY_VERTICES);
 }
 
 static float SheepModel_GetNameY(struct Entity* e) { return 1.48125f; }
@@ -1882,7 +2368,7 @@ static void SkeletonModel_Draw(struct Entity* e) {
 	Model_DrawRotate(90.0f * MATH_DEG2RAD,   0, e->Anim.RightArmZ, &skeleton_rightArm, false);
 
 	Model_UnlockVB();
-	Gfx_DrawVb_IndexedTris(SKELETON_MAX_VERTICES);
+	Model_DrawVb(SKELETON_MAX_VERTICES);
 }
 
 static void SkeletonModel_DrawArm(struct Entity* e) {
@@ -1986,7 +2472,7 @@ static void SpiderModel_Draw(struct Entity* e) {
 	Models.Rotation = ROTATE_ORDER_ZYX;
 
 	Model_UnlockVB();
-	Gfx_DrawVb_IndexedTris(SPIDER_MAX_VERTICES);
+	Model_DrawVb(SPIDER_MAX_VERTICES);
 }
 
 static float SpiderModel_GetNameY(struct Entity* e) { return 1.0125f; }
@@ -2279,7 +2765,7 @@ static void SkinnedCubeModel_Draw(struct Entity* e) {
 	Model_DrawRotate(-e->Pitch * MATH_DEG2RAD, 0, 0, &skinnedCube_head, true);
 
 	Model_UnlockVB();
-	Gfx_DrawVb_IndexedTris(SKINNEDCUBE_MAX_VERTICES);
+	Model_DrawVb(SKINNEDCUBE_MAX_VERTICES);
 }
 
 static float SkinnedCubeModel_GetNameY(struct Entity* e) { return 1.075f; }
@@ -2416,6 +2902,9 @@ static void RegisterDefaultModels(void) {
 static void OnContextLost(void* obj) {
 	struct ModelTex* tex;
 	Gfx_DeleteDynamicVb(&Models.Vb);
+#ifdef HC_BUILD_MODELINSTANCING
+	Instance_ContextLost();
+#endif
 	if (Gfx.ManagedTextures) return;
 
 	for (tex = textures_head; tex; tex = tex->next) 
@@ -2428,6 +2917,9 @@ static void OnInit(void) {
 	Models.MaxVertices = MODELS_MAX_VERTICES;
 	RegisterDefaultModels();
 	Models.ClassicArms = Options_GetBool(OPT_CLASSIC_ARM_MODEL, Game_ClassicMode);
+#ifdef HC_BUILD_MODELINSTANCING
+	inst_enabled = Options_GetBool(OPT_MODEL_INSTANCING, true);
+#endif
 
 	Event_Register_(&TextureEvents.FileChanged, NULL, Models_TextureChanged);
 	Event_Register_(&GfxEvents.ContextLost,     NULL, OnContextLost);
@@ -2436,6 +2928,9 @@ static void OnInit(void) {
 static void OnFree(void) {
 	OnContextLost(NULL);
 	CustomModel_FreeAll();
+#ifdef HC_BUILD_MODELINSTANCING
+	Instance_Free();
+#endif
 }
 
 static void OnReset(void) { CustomModel_FreeAll(); }
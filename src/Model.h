@@ -19,6 +19,8 @@ extern struct IGameComponent Models_Component;
 #define MODEL_QUAD_VERTICES 4
 #define MODEL_BOX_VERTICES (FACE_COUNT * MODEL_QUAD_VERTICES)
 enum RotateOrder { ROTATE_ORDER_ZYX, ROTATE_ORDER_XZY, ROTATE_ORDER_YZX, ROTATE_ORDER_XYZ };
+/* Level of detail models are drawn at, depending on distance from the camera */
+enum ModelLod { MODEL_LOD_FULL, MODEL_LOD_REDUCED, MODEL_LOD_STILL };
 
 /* Describes a vertex within a model. */
 struct ModelVertex { float x, y, z; hc_uint16 u, v; };
@@ -118,6 +120,9 @@ HC_VAR extern struct _ModelsData {
 	struct Model* Human;
 	/* Pointer to block model */
 	struct Model* Block;
+	/* Level of detail the current model is drawn at. (see ModelLod enum) */
+	/* NOTE: Only some built in models draw less detail at lower levels. */
+	hc_uint8 Lod;
 } Models;
 
 /* Initialises fields of a model to default. */
@@ -146,6 +151,12 @@ void Model_UnlockVB(void);
 HC_API void Model_DrawPart(struct ModelPart* part);
 /* Draws the given part with rotation around part's rotation origin. (e.g. arms, head) */
 HC_API void Model_DrawRotate(float angleX, float angleY, float angleZ, struct ModelPart* part, hc_bool head);
+#ifdef HC_BUILD_MODELINSTANCING
+/* Begins collecting model parts of entities that share the same model and skin. */
+void Model_BeginInstancing(void);
+/* Draws all collected model parts using instancing. */
+void Model_EndInstancing(void);
+#endif
 /* Renders the 'arm' of a model. */
 void Model_RenderArm(struct Model* model, struct Entity* entity);
 /* Draws the given part with appropriate rotation to produce an arm look. */
@@ -16,6 +16,7 @@ Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 
 #define OPT_VIEW_DISTANCE "viewdist"
 #define OPT_BLOCK_PHYSICS "singleplayerphysics"
+#define OPT_PHYSICS_THREADS "singleplayerphysicsthreads"
 #define OPT_NAMES_MODE "namesmode"
 #define OPT_INVERT_MOUSE "invertmouse"
 #define OPT_SENSITIVITY "mousesensitivity"
@@ -26,6 +27,7 @@ Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 #define OPT_RENDER_TYPE "normal"
 #define OPT_SMOOTH_LIGHTING "gfx-smoothlighting"
 #define OPT_LIGHTING_MODE "gfx-lightingmode"
+#define OPT_LIGHTING_THREADS "gfx-lightingthreads"
 #define OPT_MIPMAPS "gfx-mipmaps"
 #define OPT_CHAT_LOGGING "chat-logging"
 #define OPT_WINDOW_WIDTH "window-width"
@@ -71,6 +73,13 @@ Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 #define OPT_CLASSIC_CHAT "nostalgia-classicchat"
 #define OPT_CLASSIC_INVENTORY "nostalgia-classicinventory"
 #define OPT_MAX_CHUNK_UPDATES "gfx-maxchunkupdates"
+#define OPT_BUILDER_THREADS "gfx-builderthreads"
+#define OPT_OCCLUSION_CULLING "gfx-occlusionculling"
+#define OPT_MODEL_INSTANCING "gfx-modelinstancing"
+#define OPT_ENTITY_LOD_DISTANCE "gfx-entitylod"
+#define OPT_ENTITY_STILL_DISTANCE "gfx-entitystill"
+#define OPT_GEN_THREADS "gen-threads"
+#define OPT_SOFTGPU_THREADS "gfx-softgputhreads"
 #define OPT_CAMERA_MASS "cameramass"
 #define OPT_CAMERA_SMOOTH "camera-smooth"
 #define OPT_GRAB_CURSOR "win-grab-cursor"
@@ -85,6 +94,8 @@ Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 #define OPT_GAME_VERSION "game-version"
 #define OPT_INV_SCROLLBAR_SCALE "inv-scrollbar-scale"
 #define OPT_ANAGLYPH3D "anaglyph-3d"
+#define OPT_MAP_COMPRESSION "map-compression"
+#define OPT_NET_READ_BUDGET "net-readbudget"
 
 #define OPT_SELECTED_BLOCK_OUTLINE_COLOR "selected-block-outline-color"
 #define OPT_SELECTED_BLOCK_OUTLINE_OPACITY "selected-block-outline-opacity"
@@ -224,6 +224,13 @@ hc_result File_Seek(hc_file file, int offset, int seekType);
 hc_result File_Position(hc_file file, hc_uint32* pos);
 /* Attempts to retrieve the length of the given file. */
 hc_result File_Length(hc_file file, hc_uint32* len);
+#ifdef HC_BUILD_FILEMAP
+/* Maps the first length bytes of the given file into memory. */
+/* NOTE: The mapping is private and copy-on-write, so writes to it are never saved to the file. */
+hc_result File_Map(hc_file file, hc_uint32 length, void** data);
+/* Unmaps memory previously mapped using File_Map. */
+hc_result File_Unmap(void* data, hc_uint32 length);
+#endif
 
 typedef void (*Thread_StartFunc)(void);
 /* Blocks the current thread for the given number of milliseconds. */
@@ -328,6 +328,21 @@ hc_result File_Length(hc_file file, hc_uint32* len) {
 	*len = st.st_size; return 0;
 }
 
+#ifdef HC_BUILD_FILEMAP
+#include <sys/mman.h>
+
+hc_result File_Map(hc_file file, hc_uint32 length, void** data) {
+	void* ptr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+	if (ptr == MAP_FAILED) { *data = NULL; return errno; }
+
+	*data = ptr; return 0;
+}
+
+hc_result File_Unmap(void* data, hc_uint32 length) {
+	return munmap(data, length) == -1 ? errno : 0;
+}
+#endif
+
 
 /*########################################################################################################################*
 *--------------------------------------------------------Threading--------------------------------------------------------*
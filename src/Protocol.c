@@ -410,7 +410,7 @@ static hc_result MapState_Read(struct MapState* m) {
 		m->blocks = (BlockRaw*)Mem_TryAlloc(map_volume, 1);
 		/* unlikely but possible */
 		if (!m->blocks) {
-			Window_ShowDialog("Out of memory", "Not enough free memory to join that map.\nTry joining a different map.");
+			/* NOTE: Out of memory dialog is shown in Classic_LevelFinalise */
 			m->allocFailed = true;
 			return 0;
 		}
@@ -423,6 +423,179 @@ static hc_result MapState_Read(struct MapState* m) {
 	return res;
 }
 
+/* Decompresses the given chunk of map data into the given map */
+static hc_result MapState_Decompress(struct MapState* m, hc_uint8* data, int length) {
+	hc_result res;
+	map_part.meta.mem.cur    = data;
+	map_part.meta.mem.base   = data;
+	map_part.meta.mem.left   = length;
+	map_part.meta.mem.length = length;
+
+	if (!m->gzHeader.done) {
+		res = GZipHeader_Read(&map_part, &m->gzHeader);
+		if (res && res != ERR_END_OF_STREAM) return res;
+	}
+
+	if (m->gzHeader.done) return MapState_Read(m);
+	return 0;
+}
+
+static float MapState_Progress(void) {
+	return !map_volume ? 0.0f : (float)map1.index / map_volume;
+}
+
+
+#ifndef HC_BUILD_COOPTHREADED
+/*########################################################################################################################*
+*-------------------------------------------------Map decompressor worker-------------------------------------------------*
+*#########################################################################################################################*/
+/* Map data is decompressed on a background thread, so that receiving packets isn't held up by decompression */
+#define MAP_WORKER_THREAD
+struct MapChunk { struct MapChunk* next; struct MapState* map; int length; hc_uint8 data[1024]; };
+
+static void* mapWorker_thread;
+static void* mapWorker_mutex;
+static void* mapWorker_pending; /* Signalled when chunks are added to the queue */
+static void* mapWorker_idle;    /* Signalled when worker has finished all queued chunks */
+/* NOTE: All of the following variables must only be accessed while holding mapWorker_mutex */
+static struct MapChunk* mapWorker_head;
+static struct MapChunk* mapWorker_tail;
+static hc_bool mapWorker_busy;
+static hc_result mapWorker_result;
+static float mapWorker_progress;
+
+static void MapWorker_Run(void) {
+	struct MapChunk* chunk;
+	hc_bool failed;
+	hc_result res;
+
+	for (;;) {
+		Mutex_Lock(mapWorker_mutex);
+		{
+			chunk = mapWorker_head;
+			if (chunk) mapWorker_head = chunk->next;
+			if (!mapWorker_head) mapWorker_tail = NULL;
+
+			mapWorker_busy = chunk != NULL;
+			failed         = mapWorker_result != 0;
+		}
+		Mutex_Unlock(mapWorker_mutex);
+
+		if (!chunk) {
+			/* Block until main thread queues more map data */
+			Waitable_Signal(mapWorker_idle);
+			Waitable_Wait(mapWorker_pending);
+			continue;
+		}
+
+		/* Rest of the map data is pointless to decompress after corrupted data */
+		res = failed ? 0 : MapState_Decompress(chunk->map, chunk->data, chunk->length);
+		Mem_Free(chunk);
+
+		Mutex_Lock(mapWorker_mutex);
+		{
+			if (res) mapWorker_result = res;
+			mapWorker_progress = MapState_Progress();
+		}
+		Mutex_Unlock(mapWorker_mutex);
+	}
+}
+
+/* Blocks until the worker thread has finished decompressing all queued map data */
+static void MapWorker_WaitIdle(void) {
+	hc_bool busy;
+	if (!mapWorker_thread) return;
+
+	for (;;) {
+		Mutex_Lock(mapWorker_mutex);
+		{
+			busy = mapWorker_head || mapWorker_busy;
+		}
+		Mutex_Unlock(mapWorker_mutex);
+
+		if (!busy) return;
+		Waitable_Wait(mapWorker_idle);
+	}
+}
+
+/* Discards all queued map data, then waits for the worker thread to stop using map states */
+static void MapWorker_Cancel(void) {
+	struct MapChunk* chunk;
+	if (!mapWorker_thread) return;
+
+	Mutex_Lock(mapWorker_mutex);
+	{
+		while ((chunk = mapWorker_head)) {
+			mapWorker_head = chunk->next;
+			Mem_Free(chunk);
+		}
+		mapWorker_tail = NULL;
+	}
+	Mutex_Unlock(mapWorker_mutex);
+	MapWorker_WaitIdle();
+
+	/* Worker is idle now, so it is safe to reset state */
+	mapWorker_result   = 0;
+	mapWorker_progress = 0.0f;
+}
+
+/* Adds the given chunk of map data to the queue of data to decompress */
+static void MapWorker_Queue(struct MapState* m, hc_uint8* data, int length) {
+	struct MapChunk* chunk;
+	length = min(length, (int)sizeof(chunk->data));
+	chunk  = (struct MapChunk*)Mem_TryAlloc(1, sizeof(struct MapChunk));
+
+	/* Decompress on main thread instead when out of memory */
+	if (!chunk) {
+		MapWorker_WaitIdle();
+		mapWorker_result   = MapState_Decompress(m, data, length);
+		mapWorker_progress = MapState_Progress();
+		return;
+	}
+
+	chunk->next   = NULL;
+	chunk->map    = m;
+	chunk->length = length;
+	Mem_Copy(chunk->data, data, length);
+
+	if (!mapWorker_thread) {
+		mapWorker_mutex   = Mutex_Create("Map decompress");
+		mapWorker_pending = Waitable_Create("Map decompress pending");
+		mapWorker_idle    = Waitable_Create("Map decompress idle");
+		Thread_Run(&mapWorker_thread, MapWorker_Run, 128 * 1024, "Map decompressor");
+	}
+
+	Mutex_Lock(mapWorker_mutex);
+	{
+		if (mapWorker_tail) {
+			mapWorker_tail->next = chunk;
+		} else {
+			mapWorker_head = chunk;
+		}
+		mapWorker_tail = chunk;
+	}
+	Mutex_Unlock(mapWorker_mutex);
+	Waitable_Signal(mapWorker_pending);
+}
+
+/* Retrieves how much map data has been decompressed, returning non-zero if map data is corrupted */
+static hc_result MapWorker_Poll(float* progress) {
+	hc_result res;
+	if (!mapWorker_thread) { *progress = mapWorker_progress; return mapWorker_result; }
+
+	Mutex_Lock(mapWorker_mutex);
+	{
+		*progress = mapWorker_progress;
+		res       = mapWorker_result;
+	}
+	Mutex_Unlock(mapWorker_mutex);
+	return res;
+}
+#else
+static void MapWorker_WaitIdle(void) { }
+static void MapWorker_Cancel(void)   { }
+#endif
+
 
 /*########################################################################################################################*
 *----------------------------------------------------Classic protocol-----------------------------------------------------*
@@ -533,6 +706,7 @@ static void Classic_StartLoading(void) {
 	map_receiveBeg   = Stopwatch_Measure();
 	map_volume       = 0;
 
+	MapWorker_Cancel();
 	MapState_Init(&map1);
 #ifdef EXTENDED_BLOCKS
 	MapState_Init(&map2);
@@ -564,11 +738,6 @@ static void Classic_LevelDataChunk(hc_uint8* data) {
 	if (!map_begunLoading) Classic_StartLoading();
 	usedLength = Stream_GetU16_BE(data);
 
-	map_part.meta.mem.cur    = data + 2;
-	map_part.meta.mem.base   = data + 2;
-	map_part.meta.mem.left   = usedLength;
-	map_part.meta.mem.length = usedLength;
-
 #ifndef EXTENDED_BLOCKS
 	m = &map1;
 #else
@@ -580,17 +749,15 @@ static void Classic_LevelDataChunk(hc_uint8* data) {
 	}
 #endif
 
-	if (!m->gzHeader.done) {
-		res = GZipHeader_Read(&map_part, &m->gzHeader);
-		if (res && res != ERR_END_OF_STREAM) { DisconnectInvalidMap(res); return; }
-	}
-
-	if (m->gzHeader.done) {
-		res = MapState_Read(m);
-		if (res) { DisconnectInvalidMap(res); return; }
-	}
+#ifdef MAP_WORKER_THREAD
+	MapWorker_Queue(m, data + 2, usedLength);
+	res = MapWorker_Poll(&progress);
+#else
+	res      = MapState_Decompress(m, data + 2, usedLength);
+	progress = MapState_Progress();
+#endif
 
-	progress = !map_volume ? 0.0f : (float)map1.index / map_volume;
+	if (res) { DisconnectInvalidMap(res); return; }
 	Event_RaiseFloat(&WorldEvents.Loading, progress);
 }
 
@@ -598,6 +765,15 @@ static void Classic_LevelFinalise(hc_uint8* data) {
 	int width, height, length, volume;
 	hc_uint64 end;
 	int delta;
+#ifdef MAP_WORKER_THREAD
+	float progress;
+	hc_result res;
+
+	/* Usually only the last few chunks of map data are still being decompressed */
+	MapWorker_WaitIdle();
+	res = MapWorker_Poll(&progress);
+	if (res) { DisconnectInvalidMap(res); return; }
+#endif
 
 	end   = Stopwatch_Measure();
 	delta = Stopwatch_ElapsedMS(map_receiveBeg, end);
@@ -607,7 +783,12 @@ static void Classic_LevelFinalise(hc_uint8* data) {
 
 #ifdef EXTENDED_BLOCKS
 	if (map2.allocFailed) FreeMapStates();
+	if (map1.allocFailed || map2.allocFailed) {
+#else
+	if (map1.allocFailed) {
 #endif
+		Window_ShowDialog("Out of memory", "Not enough free memory to join that map.\nTry joining a different map.");
+	}
 
 	width  = Stream_GetU16_BE(data + 0);
 	height = Stream_GetU16_BE(data + 2);
@@ -1248,10 +1429,9 @@ static void CPE_ExtAddEntity2(hc_uint8* data) {
 
 #define BULK_MAX_BLOCKS 256
 static void CPE_BulkBlockUpdate(hc_uint8* data) {
-	hc_int32 indices[BULK_MAX_BLOCKS];
+	int indices[BULK_MAX_BLOCKS];
 	BlockID blocks[BULK_MAX_BLOCKS];
-	int index, i;
-	int x, y, z;
+	int index, i, valid;
 	int count = 1 + *data++;
 
 	for (i = 0; i < count; i++) {
@@ -1275,17 +1455,20 @@ static void CPE_BulkBlockUpdate(hc_uint8* data) {
 		data += BULK_MAX_BLOCKS / 4;
 	}
 
-	for (i = 0; i < count; i++) {
+	/* Drop any changes outside the map */
+	for (i = 0, valid = 0; i < count; i++) {
 		index = indices[i];
 		if (index < 0 || index >= World.Volume) continue;
-		World_Unpack(index, x, y, z);
 
+		indices[valid] = index;
 #ifdef EXTENDED_BLOCKS
-		Game_UpdateBlock(x, y, z, blocks[i] % BLOCK_COUNT);
+		blocks[valid]  = blocks[i] % BLOCK_COUNT;
 #else
-		Game_UpdateBlock(x, y, z, blocks[i]);
+		blocks[valid]  = blocks[i];
 #endif
+		valid++;
 	}
+	Game_UpdateBlocks(indices, blocks, valid);
 }
 
 static void CPE_SetTextColor(hc_uint8* data) {
@@ -1914,6 +2097,7 @@ static void OnReset(void) {
 	if (Server.IsSinglePlayer) return;
 	Mem_Set(&Protocol, 0, sizeof(Protocol));
 	Protocol_Reset();
+	MapWorker_Cancel();
 	FreeMapStates();
 }
 #else
@@ -23,6 +23,8 @@
 #include "Utils.h"
 #include "Options.h"
 #include "InputHandler.h"
+#include "Formats.h"
+#include "MapRenderer.h"
 
 #define CHAT_MAX_STATUS Array_Elems(Chat_Status)
 #define CHAT_MAX_BOTTOMRIGHT Array_Elems(Chat_BottomRight)
@@ -88,7 +90,7 @@ static struct HUDScreen {
 
 static void HUDScreen_RemakeLine1(struct HUDScreen* s) {
 	hc_string status; char statusBuffer[STRING_SIZE * 2];
-	int indices, ping, fps;
+	int indices, ping, fps, netKB, uploadKB;
 	float real_fps;
 
 	String_InitArray(status, statusBuffer);
@@ -116,9 +118,19 @@ static void HUDScreen_RemakeLine1(struct HUDScreen* s) {
 
 		indices = ICOUNT(Game_Vertices);
 		String_Format1(&status, "%i vertices", &indices);
+		String_Format1(&status, " in %i draws", &MapRenderer_DrawCalls);
+		if (MapRenderer_OccludedChunks) {
+			String_Format1(&status, " (%i chunks occluded)", &MapRenderer_OccludedChunks);
+		}
+
+		uploadKB = Gfx.UploadedBytes / 1024;
+		if (uploadKB) String_Format1(&status, ", %i KB/frame uploaded", &uploadKB);
 
 		ping = Ping_AveragePingMS();
 		if (ping) String_Format1(&status, ", ping %i ms", &ping);
+
+		netKB = NetStats.BytesPerSec / 1024;
+		if (netKB) String_Format2(&status, ", net %i KB/s (%i packets/tick)", &netKB, &NetStats.PacketsPerTick);
 	}
 	TextWidget_Set(&s->line1, &status, &s->font);
 	s->dirty = true;
@@ -2046,6 +2058,35 @@ void GeneratingScreen_Show(void) {
 }
 
 
+/*########################################################################################################################*
+*---------------------------------------------------LoadingMapScreen------------------------------------------------------*
+*#########################################################################################################################*/
+static void LoadingMapScreen_Render(void* screen, float delta) {
+	LoadingScreen_Render(screen, delta);
+	/* Map load was cancelled or failed, so MapLoaded event won't remove this screen */
+	if (!Map_IsLoading()) Gui_Remove((struct Screen*)screen);
+}
+
+static int LoadingMapScreen_KeyDown(void* screen, int key, struct InputDevice* device) {
+	if (InputDevice_IsPause(key, device)) Map_CancelLoad();
+	return true;
+}
+
+static const struct ScreenVTABLE LoadingMapScreen_VTABLE = {
+	GeneratingScreen_Init,   Screen_NullUpdate, GeneratingScreen_Free,
+	LoadingMapScreen_Render, LoadingScreen_BuildMesh,
+	LoadingMapScreen_KeyDown, Screen_InputUp,   Screen_TKeyPress,   Screen_TText,
+	Screen_TPointer,         Screen_PointerUp,  Screen_FPointer,    Screen_TMouseScroll,
+	LoadingScreen_Layout, LoadingScreen_ContextLost, LoadingScreen_ContextRecreated
+};
+void LoadingMapScreen_Show(const hc_string* path) {
+	static const hc_string title = String_FromConst("Loading level");
+
+	LoadingScreen.VTABLE = &LoadingMapScreen_VTABLE;
+	LoadingScreen_ShowCommon(&title, path);
+}
+
+
 /*########################################################################################################################*
 *----------------------------------------------------DisconnectScreen-----------------------------------------------------*
 *#########################################################################################################################*/
@@ -30,6 +30,8 @@ void InventoryScreen_Show(void);
 void HUDScreen_Show(void);
 void LoadingScreen_Show(const hc_string* title, const hc_string* message);
 void GeneratingScreen_Show(void);
+/* Shows a loading screen for a map being loaded in the background, which can be cancelled with Escape */
+void LoadingMapScreen_Show(const hc_string* path);
 void ChatScreen_Show(void);
 void DisconnectScreen_Show(const hc_string* title, const hc_string* message);
 #ifdef HC_BUILD_TOUCH
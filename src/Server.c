@@ -31,6 +31,7 @@ static char motdBuffer[STRING_SIZE];
 static char appBuffer[STRING_SIZE];
 static int ticks;
 struct _ServerConnectionData Server;
+struct _NetStatsData NetStats;
 
 /*########################################################################################################################*
 *-----------------------------------------------------Common handlers-----------------------------------------------------*
@@ -234,8 +235,15 @@ static hc_result net_writeFailure;
 static void OnClose(void);
 
 #ifdef HC_BUILD_NETWORKING
-static hc_uint8  net_readBuffer[4096 * 5];
+/* NOTE: using a read call that is a multiple of 4096 (appears to?) improve read performance */
+#define NET_READ_SIZE (4096 * 16)
+/* Unprocessed bytes of a partially received packet are kept before the newly read data */
+static hc_uint8  net_readBuffer[NET_READ_SIZE + 4096];
 static hc_uint8* net_readCurrent;
+/* Maximum milliseconds spent reading from the socket per tick (0 = only read once per tick) */
+static int net_readBudget;
+static hc_uint64 net_statsBeg;
+static int net_statsBytes, net_statsPackets, net_statsTicks;
 static double net_lastPacket;
 static hc_uint8 lastOpcode;
 
@@ -243,6 +251,29 @@ static hc_bool net_connecting;
 static double net_connectTimeout;
 #define NET_TIMEOUT_SECS 15
 
+static void MPConnection_ResetStats(void) {
+	net_statsBeg     = Stopwatch_Measure();
+	net_statsBytes   = 0;
+	net_statsPackets = 0;
+	net_statsTicks   = 0;
+	NetStats.BytesPerSec    = 0;
+	NetStats.PacketsPerTick = 0;
+}
+
+static void MPConnection_UpdateStats(void) {
+	hc_uint64 now = Stopwatch_Measure();
+	int elapsed   = Stopwatch_ElapsedMS(net_statsBeg, now);
+	if (elapsed < 1000) return;
+
+	NetStats.BytesPerSec    = (int)((hc_uint64)net_statsBytes * 1000 / elapsed);
+	NetStats.PacketsPerTick = net_statsTicks ? net_statsPackets / net_statsTicks : 0;
+
+	net_statsBeg     = now;
+	net_statsBytes   = 0;
+	net_statsPackets = 0;
+	net_statsTicks   = 0;
+}
+
 static void MPConnection_FinishConnect(void) {
 	net_connecting = false;
 	Event_RaiseVoid(&NetEvents.Connected);
@@ -250,6 +281,7 @@ static void MPConnection_FinishConnect(void) {
 
 	net_readCurrent = net_readBuffer;
 	net_lastPacket  = Game.Time;
+	MPConnection_ResetStats();
 	Classic_SendLogin();
 }
 
@@ -376,67 +408,82 @@ static void DisconnectInvalidOpcode(hc_uint8 opcode) {
 	Game_Disconnect(&title, &tmp); return;
 }
 
-static void MPConnection_Tick(struct ScheduledTask* task) {
+/* Processes all complete packets in the read buffer, returning false if an invalid packet was received */
+static hc_bool MPConnection_ProcessPackets(hc_uint32 read) {
 	Net_Handler handler;
-	hc_uint8* readEnd;
-	hc_uint8* readCur;
+	hc_uint8* readEnd = net_readCurrent + read;
+	hc_uint8* readCur = net_readBuffer;
+	int remaining;
+
+	while (readCur < readEnd) {
+		hc_uint8 opcode = readCur[0];
+
+		/* Workaround for older D3 servers which wrote one byte too many for HackControl packets */
+		if (cpe_needD3Fix && lastOpcode == OPCODE_HACK_CONTROL && (opcode == 0x00 || opcode == 0xFF)) {
+			Platform_LogConst("Skipping invalid HackControl byte from D3 server");
+			readCur++;
+			LocalPlayer_ResetJumpVelocity(Entities.CurPlayer);
+			continue;
+		}
+
+		if (readCur + Protocol.Sizes[opcode] > readEnd) break;
+		handler = Protocol.Handlers[opcode];
+		if (!handler) { DisconnectInvalidOpcode(opcode); return false; }
+
+		lastOpcode = opcode;
+		handler(readCur + 1); /* skip opcode */
+		readCur += Protocol.Sizes[opcode];
+		net_statsPackets++;
+	}
+
+	/* Protocol packets might be split up across TCP packets */
+	/* If so, move last few unprocessed bytes back to beginning of buffer */
+	/* These bytes are then later combined with subsequently read TCP packet data */
+	remaining = (int)(readEnd - readCur);
+	Mem_Move(net_readBuffer, readCur, remaining);
+	net_readCurrent = net_readBuffer + remaining;
+	return true;
+}
+
+static void MPConnection_Tick(struct ScheduledTask* task) {
+	hc_uint64 beg;
 	hc_uint32 read;
-	int i, remaining;
 	hc_result res;
 
 	if (Server.Disconnected) return;
 	if (net_connecting) { MPConnection_TickConnect(); return; }
-
-	/* NOTE: using a read call that is a multiple of 4096 (appears to?) improve read performance */	
-	res = Socket_Read(net_socket, net_readCurrent, 4096 * 4, &read);
-	
-	if (res) {
-		/* 'no data available for non-blocking read' is an expected error */
-		if (res == ReturnCode_SocketInProgess)  res = 0;
-		if (res == ReturnCode_SocketWouldBlock) res = 0;
-
-		if (res) { DisconnectReadFailed(res); return; }
-	} else if (read == 0) {
-		/* recv only returns 0 read when socket is closed.. probably? */
-		/* Over 30 seconds since last packet, connection probably dropped */
-		/* TODO: Should this be checked unconditonally instead of just when read = 0 ? */
-		if (net_lastPacket + 30 < Game.Time) { MPConnection_Disconnect(); return; }
-	} else {
-		readCur        = net_readBuffer;
-		readEnd        = net_readCurrent + read;
-		net_lastPacket = Game.Time;
-
-		while (readCur < readEnd) {
-			hc_uint8 opcode = readCur[0];
-
-			/* Workaround for older D3 servers which wrote one byte too many for HackControl packets */
-			if (cpe_needD3Fix && lastOpcode == OPCODE_HACK_CONTROL && (opcode == 0x00 || opcode == 0xFF)) {
-				Platform_LogConst("Skipping invalid HackControl byte from D3 server");
-				readCur++;
-				LocalPlayer_ResetJumpVelocity(Entities.CurPlayer);
-				continue;
-			}
-
-			if (readCur + Protocol.Sizes[opcode] > readEnd) break;
-			handler = Protocol.Handlers[opcode];
-			if (!handler) { DisconnectInvalidOpcode(opcode); return; }
-
-			lastOpcode = opcode;
-			handler(readCur + 1); /* skip opcode */
-			readCur += Protocol.Sizes[opcode];
+	beg = Stopwatch_Measure();
+
+	/* Keep reading until socket has no more data, so large maps aren't limited by tick rate */
+	for (;;) {
+		res = Socket_Read(net_socket, net_readCurrent, NET_READ_SIZE, &read);
+
+		if (res) {
+			/* 'no data available for non-blocking read' is an expected error */
+			if (res == ReturnCode_SocketInProgess)  res = 0;
+			if (res == ReturnCode_SocketWouldBlock) res = 0;
+
+			if (res) { DisconnectReadFailed(res); return; }
+			break;
+		} else if (read == 0) {
+			/* recv only returns 0 read when socket is closed.. probably? */
+			/* Over 30 seconds since last packet, connection probably dropped */
+			/* TODO: Should this be checked unconditonally instead of just when read = 0 ? */
+			if (net_lastPacket + 30 < Game.Time) { MPConnection_Disconnect(); return; }
+			break;
 		}
 
-		/* Protocol packets might be split up across TCP packets */
-		/* If so, copy last few unprocessed bytes back to beginning of buffer */
-		/* These bytes are then later combined with subsequently read TCP packet data */
-		remaining = (int)(readEnd - readCur);
-		for (i = 0; i < remaining; i++) 
-		{
-			net_readBuffer[i] = readCur[i];
-		}
-		net_readCurrent = net_readBuffer + remaining;
+		net_lastPacket  = Game.Time;
+		net_statsBytes += read;
+		if (!MPConnection_ProcessPackets(read)) return;
+
+		if (Server.Disconnected || !net_readBudget) break;
+		if (Stopwatch_ElapsedMS(beg, Stopwatch_Measure()) >= net_readBudget) break;
 	}
 
+	net_statsTicks++;
+	MPConnection_UpdateStats();
+
 	if (net_writeFailure) {
 		Platform_Log1("Error from send: %e", &net_writeFailure);
 		MPConnection_Disconnect(); return;
@@ -483,6 +530,7 @@ static void MPConnection_Init(void) {
 	Server.SendChat     = MPConnection_SendChat;
 	Server.SendData     = MPConnection_SendData;
 	net_readCurrent     = net_readBuffer;
+	net_readBudget      = Options_GetInt(OPT_NET_READ_BUDGET, 0, 1000, 8);
 }
 #else
 static void MPConnection_Init(void) { SPConnection_Init(); }
@@ -67,6 +67,14 @@ HC_VAR extern struct _ServerConnectionData {
 	int Port;
 } Server;
 
+/* Statistics about data received from a multiplayer server, updated once per second */
+HC_VAR extern struct _NetStatsData {
+	/* Average number of bytes received per second */
+	int BytesPerSec;
+	/* Average number of packets processed per network tick */
+	int PacketsPerTick;
+} NetStats;
+
 /* If user hasn't previously accepted url, displays a dialog asking to confirm downloading it */
 /* Otherwise just calls TexturePack_Extract */
 void Server_RetrieveTexturePack(const hc_string* url);
@@ -10,6 +10,7 @@
 #include "Game.h"
 #include "TexturePack.h"
 #include "Window.h"
+#include "Errors.h"
 
 struct _WorldData World;
 static char nameBuffer[STRING_SIZE];
@@ -37,14 +38,74 @@ static void GenerateNewUuid(void) {
 	World.Uuid[8] |= 0x80; /* variant 2*/
 }
 
+#ifdef HC_BUILD_FILEMAP
+static hc_uint8* mappedData;
+static hc_uint32 mappedSize;
+
+void World_SetMapped(void* data, hc_uint32 size) {
+	mappedData = (hc_uint8*)data;
+	mappedSize = size;
+}
+
+/* Block arrays inside the memory mapped file are released by unmapping it */
+static void FreeBlocks(BlockRaw* blocks) {
+	if (mappedData && blocks >= mappedData && blocks < mappedData + mappedSize) return;
+	Mem_Free(blocks);
+}
+
+static void FreeMapped(void) {
+	if (!mappedData) return;
+	File_Unmap(mappedData, mappedSize);
+	mappedData = NULL;
+	mappedSize = 0;
+}
+
+static BlockRaw* CopyMappedBlocks(BlockRaw* blocks) {
+	BlockRaw* copy;
+	if (!(blocks >= mappedData && blocks < mappedData + mappedSize)) return blocks;
+
+	copy = (BlockRaw*)Mem_TryAlloc(World.Volume, 1);
+	if (copy) Mem_Copy(copy, blocks, World.Volume);
+	return copy;
+}
+
+hc_result World_CopyMapped(void) {
+	BlockRaw* blocks;
+	if (!mappedData) return 0;
+
+	blocks = CopyMappedBlocks(World.Blocks);
+	if (!blocks) return ERR_OUT_OF_MEMORY;
+#ifdef EXTENDED_BLOCKS
+	if (World.Blocks2 == World.Blocks) {
+		World.Blocks2 = blocks;
+	} else {
+		BlockRaw* blocks2 = CopyMappedBlocks(World.Blocks2);
+		if (!blocks2) {
+			/* Blocks might not have been mapped, in which case they are still in use */
+			if (blocks != World.Blocks) Mem_Free(blocks);
+			return ERR_OUT_OF_MEMORY;
+		}
+		World.Blocks2 = blocks2;
+	}
+#endif
+	World.Blocks = blocks;
+	FreeMapped();
+	return 0;
+}
+#else
+#define FreeBlocks(blocks) Mem_Free(blocks)
+#define FreeMapped()
+#endif
+
 void World_Reset(void) {
 #ifdef EXTENDED_BLOCKS
-	if (World.Blocks != World.Blocks2) Mem_Free(World.Blocks2);
+	if (World.Blocks != World.Blocks2) FreeBlocks(World.Blocks2);
 	World.Blocks2 = NULL;
 	World.IDMask  = 0xFF;
 #endif
-	Mem_Free(World.Blocks);
+	FreeBlocks(World.Blocks);
 	World.Blocks = NULL;
+	FreeMapped();
 	String_InitArray(World.Name, nameBuffer);
 
 	World_SetDimensions(0, 0, 0);
@@ -74,6 +74,14 @@ HC_API void World_SetNewMap(BlockRaw* blocks, int width, int height, int length)
 /* NOTE: This is an internal API. Use World_SetNewMap instead. */
 HC_NOINLINE void World_SetDimensions(int width, int height, int length);
 void World_OutOfMemory(void);
+#ifdef HC_BUILD_FILEMAP
+/* Marks the block arrays of the world as being inside the given memory mapped file */
+/* World_Reset then unmaps the file, instead of freeing those block arrays */
+void World_SetMapped(void* data, hc_uint32 size);
+/* Copies any block arrays inside the memory mapped file into memory, then unmaps the file */
+/* NOTE: Must be called before the file is overwritten, as the mapping would then be invalid */
+hc_result World_CopyMapped(void);
+#endif
 
 #ifdef EXTENDED_BLOCKS
 /* Sets World.Blocks2 and updates internal state for more than 256 blocks. */
@@ -52,6 +52,8 @@ void Gfx_Free(void) {
 #define gl_Toggle(cap) if (enabled) { glEnable(cap); } else { glDisable(cap); }
 static void* tmpData;
 static int tmpSize;
+/* Number of bytes of vertex data uploaded so far this frame */
+static int gfx_frameUploads;
 
 static void* FastAllocTempMem(int size) {
 	if (size > tmpSize) {
@@ -305,6 +307,9 @@ void Gfx_ClearBuffers(GfxBuffers buffers) {
 }
 
 void Gfx_EndFrame(void) {
+	Gfx.UploadedBytes = gfx_frameUploads;
+	gfx_frameUploads  = 0;
+
 #if HC_GFX_BACKEND == HC_GFX_BACKEND_GL1
 	if (Window_IsObscured()) {
 		TickReducedPerformance();
@@ -15,7 +15,7 @@ struct _GfxData Gfx;
 static GfxResourceID Gfx_quadVb, Gfx_texVb;
 const hc_string Gfx_LowPerfMessage = String_FromConst("&eRunning in reduced performance mode (game minimised or hidden)");
 
-static const int strideSizes[] = { SIZEOF_VERTEX_COLOURED, SIZEOF_VERTEX_TEXTURED };
+static const int strideSizes[] = { SIZEOF_VERTEX_COLOURED, SIZEOF_VERTEX_TEXTURED, SIZEOF_VERTEX_TERRAIN };
 /* Whether mipmaps must be created for all dimensions down to 1x1 or not */
 static hc_bool customMipmapsLevels;
 /* Current format and size of vertices */
@@ -31,6 +31,7 @@ static hc_bool gfx_rendering2D;
 static hc_bool gfx_colorMask[4] = { true, true, true, true };
 hc_bool Gfx_GetFog(void) { return gfx_fogEnabled; }
 static hc_bool gfx_alphaTest, gfx_alphaBlend;
+hc_bool Gfx_GetAlphaTest(void) { return gfx_alphaTest; }
 
 static void SetAlphaTest(hc_bool enabled);
 void Gfx_SetAlphaTest(hc_bool enabled) {